@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <library.h>
+#include <hydra.h>
+#include <daemon.h>
+#include <sa/ikev2/keymat_v2.h>
+
+/**
+ * Measures the CPU time and the number of heap allocations needed to derive
+ * CHILD_SA keys from an established IKEv2 keymat, with and without PFS.
+ */
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+/**
+ * Number of allocations done, overriding the glibc allocator functions
+ */
+static u_int allocs;
+
+void *malloc(size_t size)
+{
+	allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	allocs++;
+	return __libc_realloc(ptr, size);
+}
+#endif /* __GLIBC__ */
+
+static void usage()
+{
+	printf("usage: child_key_speed plugins rounds\n");
+	exit(1);
+}
+
+static void start_timing(struct timespec *start)
+{
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, start);
+}
+
+static double end_timing(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+	return (end.tv_nsec - start->tv_nsec) / 1000000000.0 +
+			(end.tv_sec - start->tv_sec) * 1.0;
+}
+
+/**
+ * Create a pair of DH objects with a shared secret
+ */
+static diffie_hellman_t *create_dh(diffie_hellman_group_t group)
+{
+	diffie_hellman_t *dh, *peer;
+	chunk_t value;
+
+	dh = lib->crypto->create_dh(lib->crypto, group);
+	peer = lib->crypto->create_dh(lib->crypto, group);
+	if (!dh || !peer)
+	{
+		DESTROY_IF(dh);
+		DESTROY_IF(peer);
+		return NULL;
+	}
+	peer->get_my_public_value(peer, &value);
+	dh->set_other_public_value(dh, value);
+	free(value.ptr);
+	peer->destroy(peer);
+	return dh;
+}
+
+/**
+ * Create a keymat with derived IKE_SA keys
+ */
+static keymat_v2_t *create_keymat(diffie_hellman_t *dh, chunk_t nonce)
+{
+	proposal_t *proposal;
+	ike_sa_id_t *id;
+	keymat_v2_t *keymat;
+	bool success;
+
+	keymat = keymat_v2_create(TRUE);
+	proposal = proposal_create_default(PROTO_IKE);
+	id = ike_sa_id_create(IKEV2_MAJOR_VERSION, 0x0102030405060708ULL,
+						  0x0807060504030201ULL, TRUE);
+	success = keymat->derive_ike_keys(keymat, proposal, dh, nonce, nonce, id,
+									  PRF_UNDEFINED, chunk_empty);
+	id->destroy(id);
+	proposal->destroy(proposal);
+	if (!success)
+	{
+		keymat->keymat.destroy(&keymat->keymat);
+		return NULL;
+	}
+	return keymat;
+}
+
+/**
+ * Derive CHILD_SA keys the given number of times
+ */
+static bool run_test(char *name, keymat_v2_t *keymat, diffie_hellman_t *dh,
+					 chunk_t nonce, int rounds)
+{
+	struct timespec timing;
+	proposal_t *proposal;
+	chunk_t encr_i, integ_i, encr_r, integ_r;
+	u_int count = 0;
+	double time;
+	int i;
+
+	proposal = proposal_create_default(PROTO_ESP);
+#ifdef __GLIBC__
+	allocs = 0;
+#endif
+	start_timing(&timing);
+	for (i = 0; i < rounds; i++)
+	{
+		if (!keymat->derive_child_keys(keymat, proposal, dh, nonce, nonce,
+								&encr_i, &integ_i, &encr_r, &integ_r))
+		{
+			printf("deriving %s keys failed\n", name);
+			proposal->destroy(proposal);
+			return FALSE;
+		}
+		chunk_clear(&encr_i);
+		chunk_clear(&integ_i);
+		chunk_clear(&encr_r);
+		chunk_clear(&integ_r);
+	}
+	time = end_timing(&timing);
+#ifdef __GLIBC__
+	count = allocs;
+#endif
+	printf("%d CHILD_SAs %s: %.3fs (%.2fus/CHILD_SA, %.1f allocs/CHILD_SA)\n",
+		   rounds, name, time, time * 1000000 / rounds,
+		   (double)count / rounds);
+	proposal->destroy(proposal);
+	return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+	diffie_hellman_t *dh;
+	keymat_v2_t *keymat;
+	u_int8_t buf[32];
+	chunk_t nonce;
+	bool success;
+	int rounds;
+
+	if (argc < 3)
+	{
+		usage();
+	}
+	rounds = atoi(argv[2]);
+	if (rounds <= 0)
+	{
+		usage();
+	}
+
+	library_init(NULL);
+	atexit(library_deinit);
+	if (!libhydra_init("child_key_speed"))
+	{
+		return 1;
+	}
+	atexit(libhydra_deinit);
+	if (!libcharon_init("child_key_speed"))
+	{
+		return 1;
+	}
+	atexit(libcharon_deinit);
+	if (!lib->plugins->load(lib->plugins, argv[1]))
+	{
+		return 1;
+	}
+	dh = create_dh(MODP_2048_BIT);
+	if (!dh)
+	{
+		printf("MODP_2048 not supported\n");
+		return 1;
+	}
+	memset(buf, 0x42, sizeof(buf));
+	nonce = chunk_from_thing(buf);
+	keymat = create_keymat(dh, nonce);
+	if (!keymat)
+	{
+		printf("deriving IKE_SA keys failed\n");
+		dh->destroy(dh);
+		return 1;
+	}
+	success = run_test("without PFS", keymat, NULL, nonce, rounds) &&
+			  run_test("with PFS", keymat, dh, nonce, rounds);
+	keymat->keymat.destroy(&keymat->keymat);
+	dh->destroy(dh);
+	return success ? 0 : 1;
+}
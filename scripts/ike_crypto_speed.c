@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <library.h>
+#include <utils/debug.h>
+
+/**
+ * Measures the CPU time spent creating and using the symmetric crypto
+ * primitives of an IKE_SA_INIT/IKE_AUTH exchange (NAT detection, IKE and
+ * CHILD_SA key derivation, AUTH payload, message protection). DH and public
+ * key operations are not included, use dh_speed and pubkey_speed for these.
+ */
+
+static void usage()
+{
+	printf("usage: ike_crypto_speed plugins rounds\n");
+	exit(1);
+}
+
+static void start_timing(struct timespec *start)
+{
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, start);
+}
+
+static double end_timing(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+	return (end.tv_nsec - start->tv_nsec) / 1000000000.0 +
+			(end.tv_sec - start->tv_sec) * 1.0;
+}
+
+/**
+ * Derive keys with prf+ using a new PRF, as keymat_v2 does
+ */
+static bool prf_plus(chunk_t key, chunk_t seed, u_int8_t *out, size_t len)
+{
+	u_int8_t buf[64];
+	prf_t *prf;
+	size_t done;
+
+	prf = lib->crypto->create_prf(lib->crypto, PRF_HMAC_SHA2_256);
+	if (!prf || !prf->set_key(prf, key))
+	{
+		DESTROY_IF(prf);
+		return FALSE;
+	}
+	for (done = 0; done < len; done += prf->get_block_size(prf))
+	{
+		if (!prf->get_bytes(prf, seed, buf))
+		{
+			prf->destroy(prf);
+			return FALSE;
+		}
+		memcpy(out + done, buf, min(len - done, prf->get_block_size(prf)));
+	}
+	prf->destroy(prf);
+	return TRUE;
+}
+
+/**
+ * Simulate the symmetric crypto of one IKE_SA_INIT/IKE_AUTH exchange
+ */
+static bool run_exchange(chunk_t msg)
+{
+	u_int8_t keys[512], hash[HASH_SIZE_SHA1], iv[16];
+	crypter_t *crypter[2];
+	signer_t *signer[2];
+	hasher_t *hasher;
+	prf_t *prf;
+	chunk_t key = chunk_create(keys, 32);
+	int i;
+
+	/* NAT detection payloads, each side */
+	for (i = 0; i < 2; i++)
+	{
+		hasher = lib->crypto->create_hasher(lib->crypto, HASH_SHA1);
+		if (!hasher ||
+			!hasher->get_hash(hasher, chunk_create(msg.ptr, 22), hash) ||
+			!hasher->get_hash(hasher, chunk_create(msg.ptr, 22), hash))
+		{
+			DESTROY_IF(hasher);
+			return FALSE;
+		}
+		hasher->destroy(hasher);
+	}
+
+	/* SKEYSEED and SK_* */
+	prf = lib->crypto->create_prf(lib->crypto, PRF_HMAC_SHA2_256);
+	if (!prf || !prf->set_key(prf, chunk_create(msg.ptr, 64)) ||
+		!prf->get_bytes(prf, msg, keys))
+	{
+		DESTROY_IF(prf);
+		return FALSE;
+	}
+	prf->destroy(prf);
+	if (!prf_plus(key, msg, keys, 7 * 32))
+	{
+		return FALSE;
+	}
+
+	/* IKE_SA transforms, and AUTH octets using SK_pi/SK_pr */
+	for (i = 0; i < 2; i++)
+	{
+		crypter[i] = lib->crypto->create_crypter(lib->crypto, ENCR_AES_CBC, 16);
+		signer[i] = lib->crypto->create_signer(lib->crypto,
+											   AUTH_HMAC_SHA2_256_128);
+		if (!crypter[i] || !signer[i] ||
+			!crypter[i]->set_key(crypter[i], chunk_create(keys, 16)) ||
+			!signer[i]->set_key(signer[i], key))
+		{
+			return FALSE;
+		}
+		prf = lib->crypto->create_prf(lib->crypto, PRF_HMAC_SHA2_256);
+		if (!prf || !prf->set_key(prf, key) ||
+			!prf->get_bytes(prf, msg, keys + 256))
+		{
+			DESTROY_IF(prf);
+			return FALSE;
+		}
+		prf->destroy(prf);
+	}
+
+	/* protect IKE_AUTH request and response */
+	for (i = 0; i < 2; i++)
+	{
+		memset(iv, i, sizeof(iv));
+		if (!crypter[i]->encrypt(crypter[i], msg, chunk_from_thing(iv), NULL) ||
+			!signer[i]->get_signature(signer[i], msg, keys + 256) ||
+			!signer[!i]->verify_signature(signer[!i], msg,
+										  chunk_create(keys + 256, 16)) ||
+			!crypter[!i]->decrypt(crypter[!i], msg, chunk_from_thing(iv),
+								  NULL))
+		{
+			return FALSE;
+		}
+	}
+	for (i = 0; i < 2; i++)
+	{
+		crypter[i]->destroy(crypter[i]);
+		signer[i]->destroy(signer[i]);
+	}
+
+	/* CHILD_SA keys */
+	return prf_plus(key, msg, keys, 4 * 32);
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec timing;
+	u_int8_t buf[256];
+	int rounds, i;
+	double time;
+
+	if (argc < 3)
+	{
+		usage();
+	}
+	rounds = atoi(argv[2]);
+	if (rounds <= 0)
+	{
+		usage();
+	}
+
+	library_init(NULL);
+	atexit(library_deinit);
+	if (!lib->plugins->load(lib->plugins, argv[1]))
+	{
+		return 1;
+	}
+
+	memset(buf, 0x42, sizeof(buf));
+	start_timing(&timing);
+	for (i = 0; i < rounds; i++)
+	{
+		if (!run_exchange(chunk_from_thing(buf)))
+		{
+			printf("exchange failed, required algorithms missing?\n");
+			return 1;
+		}
+	}
+	time = end_timing(&timing);
+	printf("%d exchanges: %.3fs (%.1fus/exchange)\n",
+		   rounds, time, time * 1000000 / rounds);
+	return 0;
+}
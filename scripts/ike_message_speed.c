@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <library.h>
+#include <hydra.h>
+#include <daemon.h>
+#include <encoding/message.h>
+#include <encoding/payloads/sa_payload.h>
+#include <encoding/payloads/ke_payload.h>
+#include <encoding/payloads/nonce_payload.h>
+#include <encoding/payloads/id_payload.h>
+#include <encoding/payloads/cert_payload.h>
+#include <encoding/payloads/auth_payload.h>
+#include <encoding/payloads/ts_payload.h>
+
+/**
+ * Measures the CPU time and the number of heap allocations needed to parse
+ * (and decrypt) typical IKE_SA_INIT and IKE_AUTH requests.
+ */
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+/**
+ * Number of allocations done, overriding the glibc allocator functions
+ */
+static u_int allocs;
+
+void *malloc(size_t size)
+{
+	allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	allocs++;
+	return __libc_realloc(ptr, size);
+}
+#endif /* __GLIBC__ */
+
+/**
+ * Keymat providing a static AEAD for both directions
+ */
+typedef struct {
+	keymat_t public;
+	aead_t *aead;
+} static_keymat_t;
+
+METHOD(keymat_t, get_version, ike_version_t,
+	static_keymat_t *this)
+{
+	return IKEV2;
+}
+
+METHOD(keymat_t, get_aead, aead_t*,
+	static_keymat_t *this, bool in)
+{
+	return this->aead;
+}
+
+METHOD(keymat_t, keymat_destroy, void,
+	static_keymat_t *this)
+{
+	this->aead->destroy(this->aead);
+	free(this);
+}
+
+static keymat_t *static_keymat_create()
+{
+	static_keymat_t *this;
+	crypter_t *crypter;
+	signer_t *signer;
+	u_int8_t key[32];
+
+	crypter = lib->crypto->create_crypter(lib->crypto, ENCR_AES_CBC, 16);
+	signer = lib->crypto->create_signer(lib->crypto, AUTH_HMAC_SHA2_256_128);
+	memset(key, 0x42, sizeof(key));
+	if (!crypter || !signer ||
+		!crypter->set_key(crypter, chunk_create(key, 16)) ||
+		!signer->set_key(signer, chunk_from_thing(key)))
+	{
+		DESTROY_IF(crypter);
+		DESTROY_IF(signer);
+		return NULL;
+	}
+	INIT(this,
+		.public = {
+			.get_version = _get_version,
+			.get_aead = _get_aead,
+			.destroy = _keymat_destroy,
+		},
+		.aead = aead_create(crypter, signer),
+	);
+	return &this->public;
+}
+
+static void usage()
+{
+	printf("usage: ike_message_speed plugins rounds\n");
+	exit(1);
+}
+
+static void start_timing(struct timespec *start)
+{
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, start);
+}
+
+static double end_timing(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+	return (end.tv_nsec - start->tv_nsec) / 1000000000.0 +
+			(end.tv_sec - start->tv_sec) * 1.0;
+}
+
+/**
+ * Create an empty IKEv2 request
+ */
+static message_t *create_message(exchange_type_t type, u_int32_t mid)
+{
+	message_t *message;
+
+	message = message_create(IKEV2_MAJOR_VERSION, IKEV2_MINOR_VERSION);
+	message->set_exchange_type(message, type);
+	message->set_message_id(message, mid);
+	message->set_request(message, TRUE);
+	message->set_ike_sa_id(message, ike_sa_id_create(IKEV2_MAJOR_VERSION,
+									0x0102030405060708ULL, mid ? 42 : 0, TRUE));
+	message->set_source(message, host_create_from_string("192.168.0.1", 500));
+	message->set_destination(message,
+							 host_create_from_string("192.168.0.2", 500));
+	return message;
+}
+
+/**
+ * Build an IKE_SA_INIT request with the default proposal
+ */
+static message_t *build_ike_sa_init()
+{
+	diffie_hellman_t *dh;
+	nonce_payload_t *nonce;
+	proposal_t *proposal;
+	message_t *message;
+	u_int8_t buf[32];
+
+	dh = lib->crypto->create_dh(lib->crypto, MODP_2048_BIT);
+	if (!dh)
+	{
+		return NULL;
+	}
+	message = create_message(IKE_SA_INIT, 0);
+	proposal = proposal_create_default(PROTO_IKE);
+	message->add_payload(message, (payload_t*)
+						 sa_payload_create_from_proposal_v2(proposal));
+	proposal->destroy(proposal);
+	message->add_payload(message, (payload_t*)
+				ke_payload_create_from_diffie_hellman(KEY_EXCHANGE, dh));
+	dh->destroy(dh);
+	memset(buf, 0x23, sizeof(buf));
+	nonce = nonce_payload_create(NONCE);
+	nonce->set_nonce(nonce, chunk_from_thing(buf));
+	message->add_payload(message, (payload_t*)nonce);
+	message->add_notify(message, FALSE, NAT_DETECTION_SOURCE_IP,
+						chunk_create(buf, 20));
+	message->add_notify(message, FALSE, NAT_DETECTION_DESTINATION_IP,
+						chunk_create(buf, 20));
+	message->add_notify(message, FALSE, MULTIPLE_AUTH_SUPPORTED, chunk_empty);
+	return message;
+}
+
+/**
+ * Build an IKE_AUTH request with a certificate
+ */
+static message_t *build_ike_auth()
+{
+	identification_t *id;
+	auth_payload_t *auth;
+	proposal_t *proposal;
+	linked_list_t *list;
+	message_t *message;
+	u_int8_t buf[1024];
+
+	memset(buf, 0x17, sizeof(buf));
+	message = create_message(IKE_AUTH, 1);
+	id = identification_create_from_string("C=CH, O=strongSwan, CN=moon");
+	message->add_payload(message, (payload_t*)
+						 id_payload_create_from_identification(ID_INITIATOR, id));
+	id->destroy(id);
+	message->add_payload(message, (payload_t*)
+						 cert_payload_create_custom(CERTIFICATE, ENC_X509_SIGNATURE,
+									chunk_clone(chunk_create(buf, 1024))));
+	message->add_notify(message, FALSE, INITIAL_CONTACT, chunk_empty);
+	auth = auth_payload_create();
+	auth->set_auth_method(auth, AUTH_RSA);
+	auth->set_data(auth, chunk_create(buf, 256));
+	message->add_payload(message, (payload_t*)auth);
+	proposal = proposal_create_default(PROTO_ESP);
+	message->add_payload(message, (payload_t*)
+						 sa_payload_create_from_proposal_v2(proposal));
+	proposal->destroy(proposal);
+	list = linked_list_create();
+	list->insert_last(list, traffic_selector_create_from_cidr("10.1.0.0/16",
+															  0, 0, 65535));
+	message->add_payload(message, (payload_t*)
+						 ts_payload_create_from_traffic_selectors(TRUE, list));
+	message->add_payload(message, (payload_t*)
+						 ts_payload_create_from_traffic_selectors(FALSE, list));
+	list->destroy_offset(list, offsetof(traffic_selector_t, destroy));
+	return message;
+}
+
+/**
+ * Parse a generated message the given number of times
+ */
+static bool run_test(char *name, message_t *message, keymat_t *keymat,
+					 int rounds)
+{
+	struct timespec timing;
+	packet_t *packet;
+	message_t *parsed;
+	u_int count = 0;
+	double time;
+	int i;
+
+	if (!message || message->generate(message, keymat, &packet) != SUCCESS)
+	{
+		printf("generating %s failed\n", name);
+		DESTROY_IF(message);
+		return FALSE;
+	}
+	message->destroy(message);
+
+#ifdef __GLIBC__
+	allocs = 0;
+#endif
+	start_timing(&timing);
+	for (i = 0; i < rounds; i++)
+	{
+		parsed = message_create_from_packet(packet->clone(packet));
+		if (parsed->parse_header(parsed) != SUCCESS ||
+			parsed->parse_body(parsed, keymat) != SUCCESS)
+		{
+			printf("parsing %s failed\n", name);
+			parsed->destroy(parsed);
+			packet->destroy(packet);
+			return FALSE;
+		}
+		parsed->destroy(parsed);
+	}
+	time = end_timing(&timing);
+#ifdef __GLIBC__
+	count = allocs;
+#endif
+	printf("%d %s (%zu bytes): %.3fs (%.1fus/msg, %.1f allocs/msg)\n",
+		   rounds, name, packet->get_data(packet).len, time,
+		   time * 1000000 / rounds, (double)count / rounds);
+	packet->destroy(packet);
+	return TRUE;
+}
+
+int main(int argc, char *argv[])
+{
+	keymat_t *keymat;
+	bool success;
+	int rounds;
+
+	if (argc < 3)
+	{
+		usage();
+	}
+	rounds = atoi(argv[2]);
+	if (rounds <= 0)
+	{
+		usage();
+	}
+
+	library_init(NULL);
+	atexit(library_deinit);
+	if (!libhydra_init("ike_message_speed"))
+	{
+		return 1;
+	}
+	atexit(libhydra_deinit);
+	if (!libcharon_init("ike_message_speed"))
+	{
+		return 1;
+	}
+	atexit(libcharon_deinit);
+	if (!lib->plugins->load(lib->plugins, argv[1]))
+	{
+		return 1;
+	}
+	keymat = static_keymat_create();
+	if (!keymat)
+	{
+		printf("AES-CBC or HMAC-SHA2-256 not supported\n");
+		return 1;
+	}
+	success = run_test("IKE_SA_INIT", build_ike_sa_init(), NULL, rounds) &&
+			  run_test("IKE_AUTH", build_ike_auth(), keymat, rounds);
+	keymat->destroy(keymat);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <library.h>
+#include <hydra.h>
+#include <daemon.h>
+#include <encoding/parser.h>
+#include <encoding/generator.h>
+#include <encoding/payloads/sa_payload.h>
+#include <encoding/payloads/ke_payload.h>
+#include <encoding/payloads/nonce_payload.h>
+#include <encoding/payloads/id_payload.h>
+#include <encoding/payloads/auth_payload.h>
+#include <encoding/payloads/notify_payload.h>
+#include <encoding/payloads/ts_payload.h>
+
+/**
+ * Verifies that the specialized payload parsers and generators behave like
+ * the encoding rule interpreter, by parsing randomly mutated payloads with
+ * both. Then measures the throughput of both implementations.
+ */
+
+/**
+ * A generated payload to mutate and parse
+ */
+typedef struct {
+	payload_type_t type;
+	chunk_t data;
+} sample_t;
+
+/**
+ * Samples of all payloads with a specialized layout
+ */
+static sample_t samples[16];
+
+/**
+ * Number of samples
+ */
+static int count;
+
+static void usage()
+{
+	printf("usage: ike_payload_speed plugins fuzz-rounds speed-rounds "
+		   "[seed]\n");
+	exit(1);
+}
+
+static void start_timing(struct timespec *start)
+{
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, start);
+}
+
+static double end_timing(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+	return (end.tv_nsec - start->tv_nsec) / 1000000000.0 +
+			(end.tv_sec - start->tv_sec) * 1.0;
+}
+
+/**
+ * Generate a payload, using specialized generators or not
+ */
+static chunk_t generate(payload_t *payload, bool specialized)
+{
+	generator_t *generator;
+	u_int32_t *lenpos;
+	chunk_t data;
+
+	generator = generator_create_no_dbg();
+	generator->set_specialized(generator, specialized);
+	generator->generate_payload(generator, payload);
+	data = chunk_clone(generator->get_chunk(generator, &lenpos));
+	generator->destroy(generator);
+	return data;
+}
+
+/**
+ * Add a sample payload, destroys it
+ */
+static void add_sample(payload_t *payload)
+{
+	samples[count].type = payload->get_type(payload);
+	samples[count].data = generate(payload, FALSE);
+	count++;
+	payload->destroy(payload);
+}
+
+/**
+ * Create samples of all payloads with a specialized layout
+ */
+static bool create_samples()
+{
+	diffie_hellman_t *dh;
+	identification_t *id;
+	proposal_t *proposal;
+	nonce_payload_t *nonce;
+	notify_payload_t *notify;
+	auth_payload_t *auth;
+	linked_list_t *list;
+	u_int8_t buf[128];
+
+	memset(buf, 0x42, sizeof(buf));
+
+	proposal = proposal_create_default(PROTO_IKE);
+	add_sample((payload_t*)sa_payload_create_from_proposal_v2(proposal));
+	proposal->destroy(proposal);
+	proposal = proposal_create_default(PROTO_ESP);
+	proposal->set_spi(proposal, htonl(0xc0ffee));
+	add_sample((payload_t*)sa_payload_create_from_proposal_v2(proposal));
+	proposal->destroy(proposal);
+
+	dh = lib->crypto->create_dh(lib->crypto, MODP_2048_BIT);
+	if (!dh)
+	{
+		return FALSE;
+	}
+	add_sample((payload_t*)ke_payload_create_from_diffie_hellman(KEY_EXCHANGE,
+																 dh));
+	dh->destroy(dh);
+
+	nonce = nonce_payload_create(NONCE);
+	nonce->set_nonce(nonce, chunk_create(buf, 32));
+	add_sample((payload_t*)nonce);
+
+	id = identification_create_from_string("C=CH, O=strongSwan, CN=moon");
+	add_sample((payload_t*)id_payload_create_from_identification(ID_INITIATOR,
+																 id));
+	id->destroy(id);
+
+	auth = auth_payload_create();
+	auth->set_auth_method(auth, AUTH_RSA);
+	auth->set_data(auth, chunk_create(buf, sizeof(buf)));
+	add_sample((payload_t*)auth);
+
+	notify = notify_payload_create_from_protocol_and_type(NOTIFY, PROTO_ESP,
+														  REKEY_SA);
+	notify->set_spi(notify, htonl(0xc0ffee));
+	notify->set_notification_data(notify, chunk_create(buf, 4));
+	add_sample((payload_t*)notify);
+
+	list = linked_list_create();
+	list->insert_last(list, traffic_selector_create_from_cidr("10.1.0.0/16",
+															  0, 0, 65535));
+	list->insert_last(list, traffic_selector_create_from_cidr("fec1::/64",
+															  17, 500, 500));
+	add_sample((payload_t*)ts_payload_create_from_traffic_selectors(TRUE,
+																	list));
+	list->destroy_offset(list, offsetof(traffic_selector_t, destroy));
+
+	/* the generic header followed by arbitrary data */
+	samples[count].type = ENCRYPTED;
+	samples[count].data = chunk_clone(chunk_create(buf, 64));
+	htoun16(samples[count].data.ptr + 2, 64);
+	count++;
+	return TRUE;
+}
+
+/**
+ * Parse a payload, using specialized parsers or not
+ */
+static status_t parse(chunk_t data, payload_type_t type, bool specialized,
+					  payload_t **payload, int *remaining)
+{
+	parser_t *parser;
+	status_t status;
+
+	parser = parser_create(data);
+	parser->set_specialized(parser, specialized);
+	status = parser->parse_payload(parser, type, payload);
+	*remaining = parser->get_remaining_byte_count(parser);
+	parser->destroy(parser);
+	return status;
+}
+
+/**
+ * Randomly mutate a copy of a sample
+ */
+static chunk_t mutate(sample_t *sample)
+{
+	chunk_t data;
+	int i, mutations;
+
+	data = chunk_clone(sample->data);
+	mutations = random() % 4;
+	for (i = 0; i < mutations; i++)
+	{
+		data.ptr[random() % data.len] = random();
+	}
+	if (random() % 8 == 0)
+	{
+		data.len = random() % data.len;
+	}
+	return data;
+}
+
+/**
+ * Parse a mutated sample with both implementations and compare the results
+ */
+static bool fuzz(sample_t *sample)
+{
+	payload_t *interpreted = NULL, *specialized = NULL;
+	chunk_t data, a = chunk_empty, b = chunk_empty, c = chunk_empty;
+	status_t status_a, status_b;
+	int remaining_a, remaining_b;
+	bool equal;
+
+	data = mutate(sample);
+	status_a = parse(data, sample->type, FALSE, &interpreted, &remaining_a);
+	status_b = parse(data, sample->type, TRUE, &specialized, &remaining_b);
+	equal = status_a == status_b;
+	if (equal && status_a == SUCCESS)
+	{
+		a = generate(interpreted, FALSE);
+		b = generate(specialized, FALSE);
+		c = generate(interpreted, TRUE);
+		equal = remaining_a == remaining_b && chunk_equals(a, b) &&
+				chunk_equals(a, c);
+	}
+	if (!equal)
+	{
+		printf("%N payload mismatch, parsed %N/%N, remaining %d/%d\n"
+			   "  input       %B\n  interpreted %B\n  specialized %B\n"
+			   "  generated   %B\n", payload_type_names, sample->type,
+			   status_names, status_a, status_names, status_b,
+			   remaining_a, remaining_b, &data, &a, &b, &c);
+	}
+	if (status_a == SUCCESS)
+	{
+		interpreted->destroy(interpreted);
+	}
+	if (status_b == SUCCESS)
+	{
+		specialized->destroy(specialized);
+	}
+	free(data.ptr);
+	free(a.ptr);
+	free(b.ptr);
+	free(c.ptr);
+	return equal;
+}
+
+/**
+ * Parse and generate all samples the given number of times
+ */
+static void run_speed(bool specialized, int rounds)
+{
+	struct timespec timing;
+	payload_t *payload;
+	double parsing = 0, generating = 0;
+	size_t len = 0;
+	chunk_t data;
+	int i, j, remaining;
+
+	for (i = 0; i < count; i++)
+	{
+		if (parse(samples[i].data, samples[i].type, specialized, &payload,
+				  &remaining) != SUCCESS)
+		{
+			continue;
+		}
+		start_timing(&timing);
+		for (j = 0; j < rounds; j++)
+		{
+			data = generate(payload, specialized);
+			free(data.ptr);
+		}
+		generating += end_timing(&timing);
+		payload->destroy(payload);
+
+		start_timing(&timing);
+		for (j = 0; j < rounds; j++)
+		{
+			parse(samples[i].data, samples[i].type, specialized, &payload,
+				  &remaining);
+			payload->destroy(payload);
+		}
+		parsing += end_timing(&timing);
+		len += samples[i].data.len;
+	}
+	printf("%s: parsing %.1f MB/s (%.2fus/payload), "
+		   "generating %.1f MB/s (%.2fus/payload)\n",
+		   specialized ? "specialized" : "interpreted",
+		   len * rounds / parsing / 1000000, parsing * 1000000 / rounds / count,
+		   len * rounds / generating / 1000000,
+		   generating * 1000000 / rounds / count);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, fuzz_rounds, speed_rounds, failed = 0;
+
+	if (argc < 4)
+	{
+		usage();
+	}
+	fuzz_rounds = atoi(argv[2]);
+	speed_rounds = atoi(argv[3]);
+	if (fuzz_rounds < 0 || speed_rounds < 0)
+	{
+		usage();
+	}
+	srandom(argc > 4 ? atoi(argv[4]) : time(NULL));
+
+	library_init(NULL);
+	atexit(library_deinit);
+	if (!libhydra_init("ike_payload_speed"))
+	{
+		return 1;
+	}
+	atexit(libhydra_deinit);
+	if (!libcharon_init("ike_payload_speed"))
+	{
+		return 1;
+	}
+	atexit(libcharon_deinit);
+	if (!lib->plugins->load(lib->plugins, argv[1]))
+	{
+		return 1;
+	}
+	if (!create_samples())
+	{
+		printf("MODP_2048 not supported\n");
+		return 1;
+	}
+
+	for (i = 0; i < fuzz_rounds; i++)
+	{
+		if (!fuzz(&samples[random() % count]))
+		{
+			failed++;
+		}
+	}
+	printf("%d of %d mutated payloads parsed differently\n",
+		   failed, fuzz_rounds);
+
+	if (speed_rounds)
+	{
+		run_speed(FALSE, speed_rounds);
+		run_speed(TRUE, speed_rounds);
+	}
+	for (i = 0; i < count; i++)
+	{
+		free(samples[i].data.ptr);
+	}
+	return failed ? 1 : 0;
+}
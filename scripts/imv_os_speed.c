@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <library.h>
+#include <threading/thread.h>
+
+#include <imv_os_database.h>
+
+/**
+ * Simulates OS IMV package assessments of a number of endpoints against a
+ * local sqlite package database, with and without the package status cache.
+ */
+
+/**
+ * Product all endpoints run
+ */
+#define PRODUCT "Debian 7.0 x86_64"
+
+/**
+ * Number of packages in the database
+ */
+#define PACKAGES 3000
+
+/**
+ * Number of packages installed on each endpoint
+ */
+#define INSTALLED 800
+
+/**
+ * Number of distinct package versions deployed in the simulated network
+ */
+#define RELEASES 3
+
+static void usage()
+{
+	printf("usage: imv_os_speed plugins dbfile endpoints threads\n");
+	exit(1);
+}
+
+static void start_timing(struct timespec *start)
+{
+	clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static double end_timing(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_nsec - start->tv_nsec) / 1000000000.0 +
+			(end.tv_sec - start->tv_sec) * 1.0;
+}
+
+/**
+ * Create the package tables and fill in some packages and versions
+ */
+static database_t *create_db(char *file)
+{
+	database_t *db;
+	char uri[PATH_MAX], name[32], release[32], trigger[128];
+	char *tables[] = { "packages", "versions" };
+	char *ops[] = { "INSERT", "UPDATE", "DELETE" };
+	int i, j;
+
+	unlink(file);
+	snprintf(uri, sizeof(uri), "sqlite://%s", file);
+	db = lib->db->create(lib->db, uri);
+	if (!db)
+	{
+		return NULL;
+	}
+	if (db->execute(db, NULL, "CREATE TABLE products ("
+				"id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+				"name TEXT NOT NULL)") < 0 ||
+		db->execute(db, NULL, "CREATE TABLE packages ("
+				"id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+				"name TEXT NOT NULL, blacklist INTEGER DEFAULT 0)") < 0 ||
+		db->execute(db, NULL, "CREATE INDEX packages_name ON packages "
+				"(name)") < 0 ||
+		db->execute(db, NULL, "CREATE TABLE versions ("
+				"id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, "
+				"package INTEGER NOT NULL, product INTEGER NOT NULL, "
+				"release TEXT NOT NULL, security INTEGER DEFAULT 0, "
+				"blacklist INTEGER DEFAULT 0, time INTEGER DEFAULT 0)") < 0 ||
+		db->execute(db, NULL, "CREATE INDEX versions_package_product ON "
+				"versions (package, product)") < 0 ||
+		db->execute(db, NULL, "CREATE TABLE package_changes ("
+				"counter INTEGER NOT NULL)") < 0 ||
+		db->execute(db, NULL, "INSERT INTO package_changes (counter) "
+				"VALUES (0)") != 1 ||
+		db->execute(db, NULL, "INSERT INTO products (name) VALUES (?)",
+				DB_TEXT, PRODUCT) != 1)
+	{
+		db->destroy(db);
+		return NULL;
+	}
+	for (i = 0; i < countof(tables); i++)
+	{
+		for (j = 0; j < countof(ops); j++)
+		{
+			snprintf(trigger, sizeof(trigger), "CREATE TRIGGER %s_%d AFTER %s "
+					 "ON %s BEGIN UPDATE package_changes SET counter = "
+					 "counter + 1; END", tables[i], j, ops[j], tables[i]);
+			if (db->execute(db, NULL, trigger) < 0)
+			{
+				db->destroy(db);
+				return NULL;
+			}
+		}
+	}
+	db->execute(db, NULL, "BEGIN TRANSACTION");
+	for (i = 1; i <= PACKAGES; i++)
+	{
+		snprintf(name, sizeof(name), "package-%d", i);
+		db->execute(db, NULL, "INSERT INTO packages (name) VALUES (?)",
+					DB_TEXT, name);
+		/* the first release is outdated, the last one blacklisted */
+		for (j = 1; j < RELEASES; j++)
+		{
+			snprintf(release, sizeof(release), "1.%d-%d", j, i);
+			db->execute(db, NULL, "INSERT INTO versions (package, product, "
+						"release, security, blacklist) VALUES (?, 1, ?, ?, ?)",
+						DB_INT, i, DB_TEXT, release, DB_INT, j % 2,
+						DB_INT, j == RELEASES - 1 && i % 100 == 0);
+		}
+	}
+	db->execute(db, NULL, "COMMIT TRANSACTION");
+	return db;
+}
+
+/**
+ * Mock IMV database, providing access to the package database
+ */
+typedef struct {
+	imv_database_t public;
+	database_t *db;
+} mock_imv_db_t;
+
+METHOD(imv_database_t, get_database, database_t*,
+	mock_imv_db_t *this)
+{
+	return this->db;
+}
+
+/**
+ * Mock OS IMV state of an endpoint
+ */
+typedef struct {
+	imv_os_state_t public;
+	int count, count_update, count_blacklist, count_ok;
+	int bad;
+} mock_state_t;
+
+METHOD(imv_os_state_t, get_info, char*,
+	mock_state_t *this, os_type_t *os_type, chunk_t *name, chunk_t *version)
+{
+	*os_type = OS_TYPE_DEBIAN;
+	return PRODUCT;
+}
+
+METHOD(imv_os_state_t, set_count, void,
+	mock_state_t *this, int count, int count_update, int count_blacklist,
+	int count_ok)
+{
+	this->count += count;
+	this->count_update += count_update;
+	this->count_blacklist += count_blacklist;
+	this->count_ok += count_ok;
+}
+
+METHOD(imv_os_state_t, add_bad_package, void,
+	mock_state_t *this, char *package, os_package_state_t package_state)
+{
+	this->bad++;
+}
+
+/**
+ * Enumerator over the packages installed on an endpoint
+ */
+typedef struct {
+	enumerator_t public;
+	u_int endpoint;
+	u_int i;
+	char name[32];
+	char release[32];
+} package_enumerator_t;
+
+METHOD(enumerator_t, enumerate_packages, bool,
+	package_enumerator_t *this, chunk_t *name, chunk_t *release)
+{
+	u_int package;
+
+	if (this->i >= INSTALLED)
+	{
+		return FALSE;
+	}
+	/* endpoints share most packages, but deploy different releases */
+	package = (this->endpoint * 7 + this->i * 6) % PACKAGES + 1;
+	snprintf(this->name, sizeof(this->name), "package-%u", package);
+	snprintf(this->release, sizeof(this->release), "1.%u-%u",
+			 (this->endpoint + this->i) % RELEASES, package);
+	*name = chunk_from_str(this->name);
+	*release = chunk_from_str(this->release);
+	this->i++;
+	return TRUE;
+}
+
+/**
+ * Shared state of the assessment threads
+ */
+typedef struct {
+	imv_os_database_t *os_db;
+	refcount_t next;
+	u_int endpoints;
+	u_int count;
+	u_int count_update;
+	u_int count_blacklist;
+} assessment_t;
+
+/**
+ * Assess endpoints until all are done
+ */
+static void *assess(assessment_t *this)
+{
+	package_enumerator_t packages;
+	mock_state_t state;
+	u_int endpoint;
+
+	while ((endpoint = ref_get(&this->next)) <= this->endpoints)
+	{
+		state = (mock_state_t){
+			.public = {
+				.get_info = _get_info,
+				.set_count = _set_count,
+				.add_bad_package = _add_bad_package,
+			},
+		};
+		packages = (package_enumerator_t){
+			.public = {
+				.enumerate = (void*)_enumerate_packages,
+			},
+			.endpoint = endpoint,
+		};
+		if (this->os_db->check_packages(this->os_db, &state.public,
+										&packages.public) != SUCCESS)
+		{
+			printf("assessing endpoint %u failed\n", endpoint);
+			break;
+		}
+		if (endpoint == 1)
+		{	/* totals are the same for all runs, report them once */
+			this->count = state.count;
+			this->count_update = state.count_update;
+			this->count_blacklist = state.count_blacklist;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Assess all endpoints with the given cache size
+ */
+static void run_test(database_t *db, u_int endpoints, u_int threads,
+					 int cache_size)
+{
+	mock_imv_db_t imv_db = {
+		.public = {
+			.get_database = _get_database,
+		},
+		.db = db,
+	};
+	assessment_t assessment = {
+		.endpoints = endpoints,
+	};
+	struct timespec timing;
+	thread_t *thread[threads];
+	double time;
+	u_int i;
+
+	lib->settings->set_int(lib->settings, "libimcv.plugins.imv-os.cache_size",
+						   cache_size);
+	assessment.os_db = imv_os_database_create(&imv_db.public);
+
+	start_timing(&timing);
+	for (i = 0; i < threads; i++)
+	{
+		thread[i] = thread_create((void*)assess, &assessment);
+	}
+	for (i = 0; i < threads; i++)
+	{
+		thread[i]->join(thread[i]);
+	}
+	time = end_timing(&timing);
+	assessment.os_db->destroy(assessment.os_db);
+
+	printf("%u endpoints, cache size %5d: %.3fs (%.1f endpoints/s), "
+		   "%u packages, %u updates, %u blacklisted per endpoint\n",
+		   endpoints, cache_size, time, endpoints / time,
+		   assessment.count, assessment.count_update,
+		   assessment.count_blacklist);
+}
+
+/**
+ * Check that in-place updates of the package database invalidate the cache
+ */
+static bool check_update(database_t *db)
+{
+	mock_imv_db_t imv_db = {
+		.public = {
+			.get_database = _get_database,
+		},
+		.db = db,
+	};
+	assessment_t assessment = {
+		.endpoints = 1,
+	};
+	u_int before;
+
+	lib->settings->set_int(lib->settings, "libimcv.plugins.imv-os.cache_size",
+						   10000);
+	assessment.os_db = imv_os_database_create(&imv_db.public);
+	assess(&assessment);
+	before = assessment.count_blacklist;
+
+	/* blacklist all versions, without changing the time of the updates */
+	db->execute(db, NULL, "UPDATE versions SET blacklist = 1");
+	sleep(2);
+	assessment.next = 0;
+	assess(&assessment);
+	assessment.os_db->destroy(assessment.os_db);
+
+	printf("in-place update: %u blacklisted before, %u after\n",
+		   before, assessment.count_blacklist);
+	return assessment.count_blacklist > before;
+}
+
+int main(int argc, char *argv[])
+{
+	database_t *db;
+	int endpoints, threads;
+	bool updated;
+
+	if (argc < 5)
+	{
+		usage();
+	}
+	endpoints = atoi(argv[3]);
+	threads = atoi(argv[4]);
+	if (endpoints <= 0 || threads <= 0)
+	{
+		usage();
+	}
+
+	library_init(NULL);
+	atexit(library_deinit);
+	/* don't log every package that doesn't match */
+	dbg_default_set_level(0);
+	if (!lib->plugins->load(lib->plugins, argv[1]))
+	{
+		return 1;
+	}
+	db = create_db(argv[2]);
+	if (!db)
+	{
+		printf("creating package database '%s' failed\n", argv[2]);
+		return 1;
+	}
+
+	run_test(db, endpoints, threads, 0);
+	run_test(db, endpoints, threads, 10000);
+	updated = check_update(db);
+
+	db->destroy(db);
+	unlink(argv[2]);
+	return updated ? 0 : 1;
+}
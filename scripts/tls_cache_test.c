@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <library.h>
+
+#include <tls_cache.h>
+
+/**
+ * Tests the TLS session cache: session tickets, their expiry, ticket key
+ * rotation and identity binding, and the identity to session mapping.
+ */
+
+/**
+ * Maximum session age used in ticket key rotation tests
+ */
+#define MAX_AGE 4
+
+/**
+ * Number of failed checks
+ */
+static int failed = 0;
+
+#define verify(cond) ({ if (!(cond)) { \
+	printf("  check failed at line %d: %s\n", __LINE__, #cond); failed++; }})
+
+/**
+ * Create a ticket for the given master secret, identity and creation time
+ */
+static chunk_t create_ticket(tls_cache_t *cache, identification_t *id,
+							 chunk_t master, time_t created)
+{
+	chunk_t ticket = chunk_empty;
+
+	verify(cache->create_ticket(cache, id, master, TLS_RSA_WITH_AES_128_CBC_SHA,
+							   created, &ticket));
+	return ticket;
+}
+
+/**
+ * Check if a ticket resumes the given master secret and creation time
+ */
+static bool resumes(tls_cache_t *cache, chunk_t ticket, identification_t *id,
+					chunk_t master, time_t created)
+{
+	tls_cipher_suite_t suite;
+	chunk_t secret;
+	time_t t;
+	bool match;
+
+	suite = cache->lookup_ticket(cache, ticket, id, &secret, &t);
+	if (!suite)
+	{
+		return FALSE;
+	}
+	match = suite == TLS_RSA_WITH_AES_128_CBC_SHA &&
+			chunk_equals(secret, master) && t == created;
+	chunk_clear(&secret);
+	return match;
+}
+
+int main(int argc, char *argv[])
+{
+	identification_t *alice, *bob;
+	tls_cache_t *cache;
+	chunk_t master, session, found, tampered, t1, t2, t3;
+	time_t now, created;
+
+	library_init(NULL);
+	atexit(library_deinit);
+	lib->plugins->load(lib->plugins, PLUGINS);
+	dbg_default_set_level(0);
+
+	alice = identification_create_from_string("alice@strongswan.org");
+	bob = identification_create_from_string("bob@strongswan.org");
+	master = chunk_from_chars(0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,
+							  0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f,0x10);
+
+	printf("tickets resume the session they have been created for:\n");
+	cache = tls_cache_create(16, 3600);
+	now = time_monotonic(NULL);
+	t1 = create_ticket(cache, NULL, master, now);
+	verify(resumes(cache, t1, NULL, master, now));
+	tampered = chunk_clone(t1);
+	tampered.ptr[tampered.len / 2] ^= 0x01;
+	verify(!resumes(cache, tampered, NULL, master, now));
+	verify(!resumes(cache, chunk_create(t1.ptr, t1.len - 1), NULL, master, now));
+	chunk_free(&tampered);
+	chunk_free(&t1);
+
+	printf("reissued tickets keep the creation time of the session:\n");
+	now = time_monotonic(NULL);
+	t1 = create_ticket(cache, NULL, master, now - 3000);
+	verify(resumes(cache, t1, NULL, master, now - 3000));
+	chunk_free(&t1);
+	t1 = create_ticket(cache, NULL, master, now - 3601);
+	verify(!resumes(cache, t1, NULL, master, now - 3601));
+	chunk_free(&t1);
+
+	printf("tickets are bound to the identity of the peer:\n");
+	now = time_monotonic(NULL);
+	t1 = create_ticket(cache, alice, master, now);
+	verify(resumes(cache, t1, alice, master, now));
+	verify(resumes(cache, t1, NULL, master, now));
+	verify(!resumes(cache, t1, bob, master, now));
+	chunk_free(&t1);
+	t1 = create_ticket(cache, NULL, master, now);
+	verify(resumes(cache, t1, bob, master, now));
+	chunk_free(&t1);
+	cache->destroy(cache);
+
+	printf("identities map to a remaining session if the newest is removed:\n");
+	cache = tls_cache_create(2, 3600);
+	cache->create(cache, chunk_from_str("session1"), alice, master,
+				  TLS_RSA_WITH_AES_128_CBC_SHA);
+	cache->create(cache, chunk_from_str("session2"), alice, master,
+				  TLS_RSA_WITH_AES_128_CBC_SHA);
+	/* make session2 the least recently used one, so it gets evicted */
+	verify(cache->lookup(cache, chunk_from_str("session1"), alice, &found,
+						&created));
+	chunk_clear(&found);
+	cache->create(cache, chunk_from_str("session3"), bob, master,
+				  TLS_RSA_WITH_AES_128_CBC_SHA);
+	session = cache->check(cache, alice, NULL);
+	verify(chunk_equals(session, chunk_from_str("session1")));
+	chunk_free(&session);
+	session = cache->check(cache, bob, NULL);
+	verify(chunk_equals(session, chunk_from_str("session3")));
+	chunk_free(&session);
+	cache->destroy(cache);
+
+	printf("tickets of the previous ticket key are accepted:\n");
+	cache = tls_cache_create(16, MAX_AGE);
+	t1 = create_ticket(cache, NULL, master, time_monotonic(NULL));
+	chunk_free(&t1);
+	sleep(MAX_AGE - 1);
+	now = time_monotonic(NULL);
+	t1 = create_ticket(cache, NULL, master, now);
+	sleep(2);
+	/* rotates the ticket key */
+	t2 = create_ticket(cache, NULL, master, time_monotonic(NULL));
+	verify(resumes(cache, t1, NULL, master, now));
+
+	printf("tickets are rejected after two key rotations:\n");
+	sleep(MAX_AGE + 1);
+	now = time_monotonic(NULL);
+	t3 = create_ticket(cache, NULL, master, now);
+	verify(!cache->lookup_ticket(cache, t1, NULL, &found, &created));
+	verify(!cache->lookup_ticket(cache, t2, NULL, &found, &created));
+	verify(resumes(cache, t3, NULL, master, now));
+	chunk_free(&t1);
+	chunk_free(&t2);
+	chunk_free(&t3);
+	cache->destroy(cache);
+
+	alice->destroy(alice);
+	bob->destroy(bob);
+
+	printf("%s\n", failed ? "FAILED" : "passed");
+	return failed ? 1 : 0;
+}
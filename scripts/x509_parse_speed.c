@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <library.h>
+#include <utils/debug.h>
+#include <credentials/certificates/certificate.h>
+
+/**
+ * Measures the CPU time and the number of heap allocations needed to parse
+ * an X.509 certificate, with eager and with lazy decoding of extensions.
+ */
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+/**
+ * Number of allocations done, overriding the glibc allocator functions
+ */
+static u_int allocs;
+
+void *malloc(size_t size)
+{
+	allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	allocs++;
+	return __libc_realloc(ptr, size);
+}
+#endif /* __GLIBC__ */
+
+static void usage()
+{
+	printf("usage: x509_parse_speed plugins certificate rounds\n");
+	exit(1);
+}
+
+static void start_timing(struct timespec *start)
+{
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, start);
+}
+
+static double end_timing(struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+	return (end.tv_nsec - start->tv_nsec) / 1000000000.0 +
+			(end.tv_sec - start->tv_sec) * 1.0;
+}
+
+/**
+ * Parse the certificate the given number of times, returns CPU time
+ */
+static double run_test(char *plugins, char *path, int rounds, bool lazy,
+					   u_int *count)
+{
+	struct timespec timing;
+	char conf[] = "/tmp/x509_parse_speed.XXXXXX";
+	certificate_t *cert;
+	chunk_t encoding;
+	double time;
+	FILE *file;
+	int fd, i;
+
+	fd = mkstemp(conf);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	file = fdopen(fd, "w");
+	fprintf(file, "libstrongswan {\n  x509 {\n    lazy_parsing = %s\n  }\n}\n",
+			lazy ? "yes" : "no");
+	fclose(file);
+	library_init(conf);
+	unlink(conf);
+	if (!lib->plugins->load(lib->plugins, plugins))
+	{
+		library_deinit();
+		return -1;
+	}
+	cert = lib->creds->create(lib->creds, CRED_CERTIFICATE, CERT_X509,
+							  BUILD_FROM_FILE, path, BUILD_END);
+	if (!cert || !cert->get_encoding(cert, CERT_ASN1_DER, &encoding))
+	{
+		printf("loading certificate '%s' failed\n", path);
+		DESTROY_IF(cert);
+		library_deinit();
+		return -1;
+	}
+	cert->destroy(cert);
+
+#ifdef __GLIBC__
+	allocs = 0;
+#endif
+	start_timing(&timing);
+	for (i = 0; i < rounds; i++)
+	{
+		cert = lib->creds->create(lib->creds, CRED_CERTIFICATE, CERT_X509,
+								  BUILD_BLOB_ASN1_DER, encoding, BUILD_END);
+		if (!cert)
+		{
+			printf("parsing certificate failed\n");
+			break;
+		}
+		cert->destroy(cert);
+	}
+	time = end_timing(&timing);
+#ifdef __GLIBC__
+	*count = allocs;
+#endif
+	free(encoding.ptr);
+	library_deinit();
+	return i == rounds ? time : -1;
+}
+
+int main(int argc, char *argv[])
+{
+	u_int eager_allocs = 0, lazy_allocs = 0;
+	double eager, lazy;
+	int rounds;
+
+	if (argc < 4)
+	{
+		usage();
+	}
+	rounds = atoi(argv[3]);
+	if (rounds <= 0)
+	{
+		usage();
+	}
+
+	eager = run_test(argv[1], argv[2], rounds, FALSE, &eager_allocs);
+	lazy = run_test(argv[1], argv[2], rounds, TRUE, &lazy_allocs);
+	if (eager < 0 || lazy < 0)
+	{
+		return 1;
+	}
+	printf("%d certificates, eager: %.3fs (%.1fus/cert, %.1f allocs/cert)\n",
+		   rounds, eager, eager * 1000000 / rounds,
+		   (double)eager_allocs / rounds);
+	printf("%d certificates, lazy:  %.3fs (%.1fus/cert, %.1f allocs/cert)\n",
+		   rounds, lazy, lazy * 1000000 / rounds,
+		   (double)lazy_allocs / rounds);
+	return 0;
+}
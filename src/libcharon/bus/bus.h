@@ -107,6 +107,9 @@ enum alert_t {
 	ALERT_RETRANSMIT_SEND_TIMEOUT,
 	/** received a retransmit for a message, argument is message_t */
 	ALERT_RETRANSMIT_RECEIVE,
+	/** received a request with an unexpected message ID, argument is
+	 *  message_t, followed by the expected message ID as u_int32_t */
+	ALERT_UNEXPECTED_MESSAGE_ID,
 	/** received half-open timeout before IKE_SA established, no argument */
 	ALERT_HALF_OPEN_TIMEOUT,
 	/** IKE proposals do not match, argument is linked_list_t of proposal_t */
@@ -22,6 +22,7 @@
 #include <sys/types.h>
 
 #include "file_logger.h"
+#include "log_ring.h"
 
 #include <daemon.h>
 #include <threading/mutex.h>
@@ -73,13 +74,23 @@ struct private_file_logger_t {
 	 * Lock to read/write options (FD, levels, time_format, etc.)
 	 */
 	rwlock_t *lock;
+
+	/**
+	 * Ring buffer to write log messages asynchronously, if any
+	 */
+	log_ring_t *ring;
+
+	/**
+	 * Requested size of the ring buffer
+	 */
+	u_int ring_size;
 };
 
 METHOD(logger_t, log_, void,
 	private_file_logger_t *this, debug_t group, level_t level, int thread,
 	ike_sa_t* ike_sa, const char *message)
 {
-	char timestr[128], namestr[128] = "";
+	char timestr[128] = "", namestr[128] = "", prefix[320];
 	const char *current = message, *next;
 	struct tm tm;
 	time_t t;
@@ -94,7 +105,8 @@ METHOD(logger_t, log_, void,
 	{
 		t = time(NULL);
 		localtime_r(&t, &tm);
-		strftime(timestr, sizeof(timestr), this->time_format, &tm);
+		strftime(timestr, sizeof(timestr) - 1, this->time_format, &tm);
+		strcat(timestr, " ");
 	}
 	if (this->ike_name && ike_sa)
 	{
@@ -109,9 +121,14 @@ METHOD(logger_t, log_, void,
 				ike_sa->get_unique_id(ike_sa));
 		}
 	}
-	else
-	{
-		namestr[0] = '\0';
+	snprintf(prefix, sizeof(prefix), "%s%.2d[%N]%s ",
+			 timestr, thread, debug_names, group, namestr);
+
+	if (this->ring)
+	{	/* the writer thread does the actual I/O */
+		this->ring->push(this->ring, log_ring_format(prefix, message));
+		this->lock->unlock(this->lock);
+		return;
 	}
 
 	/* prepend a prefix in front of every line */
@@ -119,28 +136,45 @@ METHOD(logger_t, log_, void,
 	while (TRUE)
 	{
 		next = strchr(current, '\n');
-		if (this->time_format)
-		{
-			fprintf(this->out, "%s %.2d[%N]%s ",
-					timestr, thread, debug_names, group, namestr);
-		}
-		else
-		{
-			fprintf(this->out, "%.2d[%N]%s ",
-					thread, debug_names, group, namestr);
-		}
 		if (next == NULL)
 		{
-			fprintf(this->out, "%s\n", current);
+			fprintf(this->out, "%s%s\n", prefix, current);
 			break;
 		}
-		fprintf(this->out, "%.*s\n", (int)(next - current), current);
+		fprintf(this->out, "%s%.*s\n", prefix, (int)(next - current), current);
 		current = next + 1;
 	}
 	this->mutex->unlock(this->mutex);
 	this->lock->unlock(this->lock);
 }
 
+/**
+ * Write a batch of records, invoked by the writer thread of the ring
+ */
+static void write_records(private_file_logger_t *this, char **records,
+						  int count, u_int dropped)
+{
+	int i;
+
+	this->lock->read_lock(this->lock);
+	if (this->out)
+	{
+		this->mutex->lock(this->mutex);
+		if (dropped)
+		{
+			fprintf(this->out, "%u log messages dropped due to an overflow\n",
+					dropped);
+		}
+		for (i = 0; i < count; i++)
+		{
+			fputs(records[i], this->out);
+		}
+		fflush(this->out);
+		this->mutex->unlock(this->mutex);
+	}
+	this->lock->unlock(this->lock);
+}
+
 METHOD(logger_t, get_level, level_t,
 	private_file_logger_t *this, debug_t group)
 {
@@ -225,9 +259,33 @@ METHOD(file_logger_t, open_, void,
 	this->lock->unlock(this->lock);
 }
 
+METHOD(file_logger_t, set_async, void,
+	private_file_logger_t *this, u_int size)
+{
+	log_ring_t *ring = NULL, *old;
+
+	this->lock->write_lock(this->lock);
+	if (this->ring_size == size)
+	{	/* keep the current ring, if any */
+		this->lock->unlock(this->lock);
+		return;
+	}
+	if (size)
+	{
+		ring = log_ring_create(size, (log_ring_write_t)write_records, this);
+	}
+	this->ring_size = ring ? size : 0;
+	old = this->ring;
+	this->ring = ring;
+	this->lock->unlock(this->lock);
+	/* the writer of the old ring flushes pending records, if any */
+	DESTROY_IF(old);
+}
+
 METHOD(file_logger_t, destroy, void,
 	private_file_logger_t *this)
 {
+	set_async(this, 0);
 	this->lock->write_lock(this->lock);
 	close_file(this);
 	this->lock->unlock(this->lock);
@@ -253,6 +311,7 @@ file_logger_t *file_logger_create(char *filename)
 			},
 			.set_level = _set_level,
 			.set_options = _set_options,
+			.set_async = _set_async,
 			.open = _open_,
 			.destroy = _destroy,
 		},
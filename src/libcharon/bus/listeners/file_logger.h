@@ -52,6 +52,18 @@ struct file_logger_t {
 	 */
 	void (*set_options) (file_logger_t *this, char *time_format, bool ike_name);
 
+	/**
+	 * Enable or disable asynchronous logging.
+	 *
+	 * If enabled, log messages are formatted by the calling thread and
+	 * queued in a ring buffer of the given size. A dedicated thread writes
+	 * them in batches to the file. If the buffer is full, messages are
+	 * dropped instead of blocking the caller.
+	 *
+	 * @param size			number of buffered messages, 0 to log synchronously
+	 */
+	void (*set_async) (file_logger_t *this, u_int size);
+
 	/**
 	 * Open (or reopen) the log file according to the given parameters
 	 *
@@ -0,0 +1,393 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "log_ring.h"
+
+#include <bio/bio_writer.h>
+#include <threading/thread.h>
+#include <threading/mutex.h>
+#include <threading/condvar.h>
+
+/**
+ * Maximum number of records passed to the write callback at once
+ */
+#define BATCH_SIZE 64
+
+/**
+ * Time in ms the writer sleeps at most if it missed a wakeup
+ */
+#define WAIT_TIMEOUT 100
+
+/**
+ * Minimum number of slots
+ */
+#define MIN_SIZE 16
+
+#ifdef HAVE_GCC_ATOMIC_OPERATIONS
+# define memory_barrier() __sync_synchronize()
+#else
+# define memory_barrier()
+#endif
+
+typedef struct private_log_ring_t private_log_ring_t;
+
+/**
+ * A slot in the ring
+ */
+typedef struct {
+
+	/**
+	 * Sequence number, equals the position if the slot is free and
+	 * the position + 1 if it contains a record for the writer
+	 */
+	volatile u_int seq;
+
+	/**
+	 * Record stored in this slot
+	 */
+	char *record;
+
+} slot_t;
+
+/**
+ * Private data of a log_ring_t object.
+ */
+struct private_log_ring_t {
+
+	/**
+	 * Public interface.
+	 */
+	log_ring_t public;
+
+	/**
+	 * Slots of the ring
+	 */
+	slot_t *slots;
+
+	/**
+	 * Number of slots - 1
+	 */
+	u_int mask;
+
+	/**
+	 * Next position to write to, shared by all producers
+	 */
+	volatile u_int head;
+
+	/**
+	 * Next position to read from, only used by the writer thread
+	 */
+	u_int tail;
+
+	/**
+	 * Number of records dropped
+	 */
+	refcount_t dropped;
+
+	/**
+	 * TRUE if the writer thread waits for new records
+	 */
+	volatile bool waiting;
+
+	/**
+	 * TRUE if the writer thread should terminate
+	 */
+	bool terminate;
+
+	/**
+	 * Mutex to wait for new records, and to protect the ring if no
+	 * atomic operations are available
+	 */
+	mutex_t *mutex;
+
+	/**
+	 * Condvar to signal new records
+	 */
+	condvar_t *condvar;
+
+	/**
+	 * Writer thread
+	 */
+	thread_t *thread;
+
+	/**
+	 * Callback to write records
+	 */
+	log_ring_write_t write;
+
+	/**
+	 * User data for callback
+	 */
+	void *data;
+};
+
+/**
+ * Claim a free slot for the given record, returns FALSE if the ring is full
+ */
+static bool claim_slot(private_log_ring_t *this, char *record)
+{
+	slot_t *slot;
+	u_int pos, seq;
+
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->lock(this->mutex);
+#endif
+	pos = this->head;
+	while (TRUE)
+	{
+		slot = &this->slots[pos & this->mask];
+		seq = slot->seq;
+		memory_barrier();
+		if (seq == pos)
+		{
+#ifdef HAVE_GCC_ATOMIC_OPERATIONS
+			if (__sync_bool_compare_and_swap(&this->head, pos, pos + 1))
+			{
+				break;
+			}
+#else
+			this->head = pos + 1;
+			break;
+#endif
+		}
+		else if ((int)(seq - pos) < 0)
+		{	/* slot still contains a record from the previous round */
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+			this->mutex->unlock(this->mutex);
+#endif
+			return FALSE;
+		}
+		pos = this->head;
+	}
+	slot->record = record;
+	memory_barrier();
+	slot->seq = pos + 1;
+	memory_barrier();
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->unlock(this->mutex);
+#endif
+	return TRUE;
+}
+
+/**
+ * Take the next record from the ring, if any (writer thread only)
+ */
+static bool take_slot(private_log_ring_t *this, char **record)
+{
+	slot_t *slot;
+	bool found = FALSE;
+
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->lock(this->mutex);
+#endif
+	slot = &this->slots[this->tail & this->mask];
+	if (slot->seq == this->tail + 1)
+	{
+		memory_barrier();
+		*record = slot->record;
+		slot->record = NULL;
+		memory_barrier();
+		slot->seq = this->tail + this->mask + 1;
+		this->tail++;
+		found = TRUE;
+	}
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->unlock(this->mutex);
+#endif
+	return found;
+}
+
+/**
+ * Check if there is a record available for the writer thread
+ */
+static bool has_record(private_log_ring_t *this)
+{
+	return this->slots[this->tail & this->mask].seq == this->tail + 1;
+}
+
+METHOD(log_ring_t, push, bool,
+	private_log_ring_t *this, char *record)
+{
+	if (!claim_slot(this, record))
+	{
+		ref_get(&this->dropped);
+		free(record);
+		return FALSE;
+	}
+	if (this->waiting)
+	{
+		this->mutex->lock(this->mutex);
+		this->condvar->signal(this->condvar);
+		this->mutex->unlock(this->mutex);
+	}
+	return TRUE;
+}
+
+METHOD(log_ring_t, get_dropped, u_int,
+	private_log_ring_t *this)
+{
+	memory_barrier();
+	return this->dropped;
+}
+
+METHOD(log_ring_t, get_size, u_int,
+	private_log_ring_t *this)
+{
+	return this->mask + 1;
+}
+
+/**
+ * Writer thread draining the ring
+ */
+static void *writer(private_log_ring_t *this)
+{
+	char *records[BATCH_SIZE];
+	u_int dropped, reported = 0;
+	int count, i;
+
+	thread_cancelability(FALSE);
+	while (TRUE)
+	{
+		for (count = 0; count < BATCH_SIZE; count++)
+		{
+			if (!take_slot(this, &records[count]))
+			{
+				break;
+			}
+		}
+		dropped = get_dropped(this);
+		if (count || dropped != reported)
+		{
+			this->write(this->data, records, count, dropped - reported);
+			reported = dropped;
+			for (i = 0; i < count; i++)
+			{
+				free(records[i]);
+			}
+			continue;
+		}
+		this->mutex->lock(this->mutex);
+		if (this->terminate)
+		{
+			this->mutex->unlock(this->mutex);
+			break;
+		}
+		this->waiting = TRUE;
+		memory_barrier();
+		if (!has_record(this))
+		{
+			this->condvar->timed_wait(this->condvar, this->mutex,
+									  WAIT_TIMEOUT);
+		}
+		this->waiting = FALSE;
+		this->mutex->unlock(this->mutex);
+	}
+	return NULL;
+}
+
+METHOD(log_ring_t, destroy, void,
+	private_log_ring_t *this)
+{
+	char *record;
+
+	this->mutex->lock(this->mutex);
+	this->terminate = TRUE;
+	this->condvar->signal(this->condvar);
+	this->mutex->unlock(this->mutex);
+	this->thread->join(this->thread);
+
+	while (take_slot(this, &record))
+	{	/* records pushed while the writer terminated */
+		free(record);
+	}
+	this->condvar->destroy(this->condvar);
+	this->mutex->destroy(this->mutex);
+	free(this->slots);
+	free(this);
+}
+
+/*
+ * Described in header.
+ */
+log_ring_t *log_ring_create(u_int size, log_ring_write_t write, void *data)
+{
+	private_log_ring_t *this;
+	u_int i, slots = MIN_SIZE;
+
+	while (slots < size && slots < (1 << 30))
+	{
+		slots <<= 1;
+	}
+
+	INIT(this,
+		.public = {
+			.push = _push,
+			.get_dropped = _get_dropped,
+			.get_size = _get_size,
+			.destroy = _destroy,
+		},
+		.slots = calloc(slots, sizeof(slot_t)),
+		.mask = slots - 1,
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+		.condvar = condvar_create(CONDVAR_TYPE_DEFAULT),
+		.write = write,
+		.data = data,
+	);
+
+	for (i = 0; i < slots; i++)
+	{
+		this->slots[i].seq = i;
+	}
+
+	this->thread = thread_create((thread_main_t)writer, this);
+	if (!this->thread)
+	{
+		this->condvar->destroy(this->condvar);
+		this->mutex->destroy(this->mutex);
+		free(this->slots);
+		free(this);
+		return NULL;
+	}
+	return &this->public;
+}
+
+/*
+ * Described in header.
+ */
+char *log_ring_format(char *prefix, const char *message)
+{
+	const char *current = message, *next;
+	bio_writer_t *writer;
+	chunk_t record;
+
+	writer = bio_writer_create(strlen(prefix) + strlen(message) + 2);
+	while (TRUE)
+	{
+		next = strchr(current, '\n');
+		writer->write_data(writer, chunk_from_str(prefix));
+		if (next == NULL)
+		{
+			writer->write_data(writer, chunk_from_str((char*)current));
+			writer->write_uint8(writer, '\n');
+			break;
+		}
+		writer->write_data(writer, chunk_create((u_char*)current,
+												next - current + 1));
+		current = next + 1;
+	}
+	writer->write_uint8(writer, '\0');
+	record = writer->extract_buf(writer);
+	writer->destroy(writer);
+	return record.ptr;
+}
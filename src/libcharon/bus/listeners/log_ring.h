@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup log_ring log_ring
+ * @{ @ingroup listeners
+ */
+
+#ifndef LOG_RING_H_
+#define LOG_RING_H_
+
+#include <library.h>
+
+typedef struct log_ring_t log_ring_t;
+
+/**
+ * Callback function invoked by the writer thread with a batch of records.
+ *
+ * The records are owned by the ring and get freed after the callback returns.
+ *
+ * @param data			user data supplied to log_ring_create()
+ * @param records		array of preformatted, null-terminated records
+ * @param count			number of records in the array
+ * @param dropped		number of records dropped since the last invocation
+ */
+typedef void (*log_ring_write_t)(void *data, char **records, int count,
+								 u_int dropped);
+
+/**
+ * Bounded multi-producer ring buffer of preformatted log records.
+ *
+ * Loggers push records from the calling threads without blocking on I/O,
+ * a dedicated writer thread drains the ring and passes the records in
+ * batches to a write callback. If the ring is full, records get dropped and
+ * counted instead of blocking the producer.
+ *
+ * If the platform provides atomic operations, push() is lock-free.
+ */
+struct log_ring_t {
+
+	/**
+	 * Push a record to the ring.
+	 *
+	 * @param record		preformatted record, gets owned (and freed) by the ring
+	 * @return				TRUE if queued, FALSE if the record got dropped
+	 */
+	bool (*push)(log_ring_t *this, char *record);
+
+	/**
+	 * Get the total number of records dropped due to an overflow.
+	 *
+	 * @return				number of dropped records
+	 */
+	u_int (*get_dropped)(log_ring_t *this);
+
+	/**
+	 * Get the size of the ring.
+	 *
+	 * @return				maximum number of queued records
+	 */
+	u_int (*get_size)(log_ring_t *this);
+
+	/**
+	 * Destroy the ring, the writer thread writes pending records before
+	 * it terminates.
+	 */
+	void (*destroy)(log_ring_t *this);
+};
+
+/**
+ * Create a log_ring_t instance and start its writer thread.
+ *
+ * @param size			number of slots, gets rounded up to a power of two
+ * @param write			callback invoked by the writer thread
+ * @param data			user data to pass to the callback
+ * @return				log_ring_t instance, NULL if thread creation failed
+ */
+log_ring_t *log_ring_create(u_int size, log_ring_write_t write, void *data);
+
+/**
+ * Build a record from a (multi-line) log message, prepending the given prefix
+ * to every line and terminating every line with a newline.
+ *
+ * @param prefix		prefix to prepend to each line
+ * @param message		log message
+ * @return				allocated record
+ */
+char *log_ring_format(char *prefix, const char *message);
+
+#endif /** LOG_RING_H_ @}*/
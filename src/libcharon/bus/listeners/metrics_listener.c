@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "metrics_listener.h"
+
+#include <daemon.h>
+#include <threading/mutex.h>
+#include <collections/hashtable.h>
+
+typedef struct private_metrics_listener_t private_metrics_listener_t;
+
+/**
+ * Private data of an metrics_listener_t object.
+ */
+struct private_metrics_listener_t {
+
+	/**
+	 * Public metrics_listener_t interface.
+	 */
+	metrics_listener_t public;
+
+	/**
+	 * Start time of connecting IKE_SAs, unique ID => timeval_t
+	 */
+	hashtable_t *connecting;
+
+	/**
+	 * Mutex to lock hashtable
+	 */
+	mutex_t *mutex;
+
+	/**
+	 * Time to establish IKE_SAs
+	 */
+	histogram_t *establish;
+
+	/**
+	 * Number of established IKE_SAs
+	 */
+	metrics_counter_t *established;
+
+	/**
+	 * Number of IKE_SAs destroyed while connecting
+	 */
+	metrics_counter_t *failed;
+};
+
+/**
+ * Hashtable hash function
+ */
+static u_int hash(uintptr_t key)
+{
+	return key;
+}
+
+/**
+ * Hashtable equals function
+ */
+static bool equals(uintptr_t a, uintptr_t b)
+{
+	return a == b;
+}
+
+METHOD(listener_t, ike_state_change, bool,
+	private_metrics_listener_t *this, ike_sa_t *ike_sa, ike_sa_state_t state)
+{
+	uintptr_t id;
+	timeval_t *start;
+
+	id = ike_sa->get_unique_id(ike_sa);
+	switch (state)
+	{
+		case IKE_CONNECTING:
+			INIT(start);
+			time_monotonic(start);
+			this->mutex->lock(this->mutex);
+			start = this->connecting->put(this->connecting, (void*)id, start);
+			this->mutex->unlock(this->mutex);
+			free(start);
+			break;
+		case IKE_ESTABLISHED:
+		case IKE_DESTROYING:
+			this->mutex->lock(this->mutex);
+			start = this->connecting->remove(this->connecting, (void*)id);
+			this->mutex->unlock(this->mutex);
+			if (start)
+			{
+				if (state == IKE_ESTABLISHED)
+				{
+					this->establish->record_since(this->establish, start);
+					this->established->add(this->established, 1);
+				}
+				else
+				{
+					this->failed->add(this->failed, 1);
+				}
+				free(start);
+			}
+			break;
+		default:
+			break;
+	}
+	return TRUE;
+}
+
+METHOD(metrics_listener_t, destroy, void,
+	private_metrics_listener_t *this)
+{
+	enumerator_t *enumerator;
+	timeval_t *start;
+	void *id;
+
+	enumerator = this->connecting->create_enumerator(this->connecting);
+	while (enumerator->enumerate(enumerator, &id, &start))
+	{
+		free(start);
+	}
+	enumerator->destroy(enumerator);
+	this->connecting->destroy(this->connecting);
+	this->mutex->destroy(this->mutex);
+	free(this);
+}
+
+/**
+ * See header
+ */
+metrics_listener_t *metrics_listener_create(metrics_t *metrics)
+{
+	private_metrics_listener_t *this;
+
+	INIT(this,
+		.public = {
+			.listener = {
+				.ike_state_change = _ike_state_change,
+			},
+			.destroy = _destroy,
+		},
+		.connecting = hashtable_create((hashtable_hash_t)hash,
+									   (hashtable_equals_t)equals, 32),
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+		.establish = metrics->histogram(metrics,
+								"strongswan_ike_sa_establish_seconds", NULL,
+								"Time to establish IKE_SAs"),
+		.established = metrics->counter(metrics,
+								"strongswan_ike_sa_established_total", NULL,
+								"Number of established IKE_SAs"),
+		.failed = metrics->counter(metrics,
+								"strongswan_ike_sa_failed_total", NULL,
+								"Number of IKE_SAs destroyed while connecting"),
+	);
+
+	return &this->public;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup metrics_listener metrics_listener
+ * @{ @ingroup listeners
+ */
+
+#ifndef METRICS_LISTENER_H_
+#define METRICS_LISTENER_H_
+
+#include <bus/listeners/listener.h>
+
+typedef struct metrics_listener_t metrics_listener_t;
+
+/**
+ * Listener measuring the time to establish IKE_SAs.
+ *
+ * The time from entering IKE_CONNECTING until IKE_ESTABLISHED is recorded
+ * in the "strongswan_ike_sa_establish_seconds" histogram of lib->metrics.
+ */
+struct metrics_listener_t {
+
+	/**
+	 * Implements listener_t interface.
+	 */
+	listener_t listener;
+
+	/**
+	 * Destroy a metrics_listener_t.
+	 */
+	void (*destroy)(metrics_listener_t *this);
+};
+
+/**
+ * Create a metrics_listener_t instance.
+ *
+ * @param metrics		metrics registry to record to
+ * @return				listener
+ */
+metrics_listener_t *metrics_listener_create(metrics_t *metrics);
+
+#endif /** METRICS_LISTENER_H_ @}*/
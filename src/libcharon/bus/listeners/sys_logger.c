@@ -19,6 +19,7 @@
 #include <syslog.h>
 
 #include "sys_logger.h"
+#include "log_ring.h"
 
 #include <threading/mutex.h>
 #include <threading/rwlock.h>
@@ -59,17 +60,48 @@ struct private_sys_logger_t {
 	 * Lock to read/write options (levels, ike_name)
 	 */
 	rwlock_t *lock;
+
+	/**
+	 * Ring buffer to log messages asynchronously, if any
+	 */
+	log_ring_t *ring;
+
+	/**
+	 * Requested size of the ring buffer
+	 */
+	u_int ring_size;
 };
 
+/**
+ * Do a syslog for every line of a message, with an optional prefix
+ */
+static void syslog_lines(private_sys_logger_t *this, char *prefix,
+						 const char *message)
+{
+	const char *current = message, *next;
+
+	while (TRUE)
+	{
+		next = strchr(current, '\n');
+		if (next == NULL)
+		{
+			if (*current)
+			{
+				syslog(this->facility | LOG_INFO, "%s%s\n", prefix, current);
+			}
+			break;
+		}
+		syslog(this->facility | LOG_INFO, "%s%.*s\n",
+			   prefix, (int)(next - current), current);
+		current = next + 1;
+	}
+}
+
 METHOD(logger_t, log_, void,
 	private_sys_logger_t *this, debug_t group, level_t level, int thread,
 	ike_sa_t* ike_sa, const char *message)
 {
-	char groupstr[4], namestr[128] = "";
-	const char *current = message, *next;
-
-	/* cache group name and optional name string */
-	snprintf(groupstr, sizeof(groupstr), "%N", debug_names, group);
+	char prefix[160], namestr[128] = "";
 
 	this->lock->read_lock(this->lock);
 	if (this->ike_name && ike_sa)
@@ -85,22 +117,40 @@ METHOD(logger_t, log_, void,
 				ike_sa->get_unique_id(ike_sa));
 		}
 	}
+	snprintf(prefix, sizeof(prefix), "%.2d[%N]%s ",
+			 thread, debug_names, group, namestr);
+
+	if (this->ring)
+	{	/* the writer thread does the actual syslog() calls */
+		this->ring->push(this->ring, log_ring_format(prefix, message));
+		this->lock->unlock(this->lock);
+		return;
+	}
 	this->lock->unlock(this->lock);
 
 	/* do a syslog for every line */
 	this->mutex->lock(this->mutex);
-	while (TRUE)
+	syslog_lines(this, prefix, message);
+	this->mutex->unlock(this->mutex);
+}
+
+/**
+ * Log a batch of records, invoked by the writer thread of the ring
+ */
+static void write_records(private_sys_logger_t *this, char **records,
+						  int count, u_int dropped)
+{
+	int i;
+
+	this->mutex->lock(this->mutex);
+	if (dropped)
 	{
-		next = strchr(current, '\n');
-		if (next == NULL)
-		{
-			syslog(this->facility | LOG_INFO, "%.2d[%s]%s %s\n",
-				   thread, groupstr, namestr, current);
-			break;
-		}
-		syslog(this->facility | LOG_INFO, "%.2d[%s]%s %.*s\n",
-			   thread, groupstr, namestr, (int)(next - current), current);
-		current = next + 1;
+		syslog(this->facility | LOG_INFO,
+			   "%u log messages dropped due to an overflow\n", dropped);
+	}
+	for (i = 0; i < count; i++)
+	{	/* records are already prefixed */
+		syslog_lines(this, "", records[i]);
 	}
 	this->mutex->unlock(this->mutex);
 }
@@ -142,9 +192,33 @@ METHOD(sys_logger_t, set_options, void,
 	this->lock->unlock(this->lock);
 }
 
+METHOD(sys_logger_t, set_async, void,
+	private_sys_logger_t *this, u_int size)
+{
+	log_ring_t *ring = NULL, *old;
+
+	this->lock->write_lock(this->lock);
+	if (this->ring_size == size)
+	{	/* keep the current ring, if any */
+		this->lock->unlock(this->lock);
+		return;
+	}
+	if (size)
+	{
+		ring = log_ring_create(size, (log_ring_write_t)write_records, this);
+	}
+	this->ring_size = ring ? size : 0;
+	old = this->ring;
+	this->ring = ring;
+	this->lock->unlock(this->lock);
+	/* the writer of the old ring flushes pending records, if any */
+	DESTROY_IF(old);
+}
+
 METHOD(sys_logger_t, destroy, void,
 	private_sys_logger_t *this)
 {
+	set_async(this, 0);
 	this->lock->destroy(this->lock);
 	this->mutex->destroy(this->mutex);
 	free(this);
@@ -165,6 +239,7 @@ sys_logger_t *sys_logger_create(int facility)
 			},
 			.set_level = _set_level,
 			.set_options = _set_options,
+			.set_async = _set_async,
 			.destroy = _destroy,
 		},
 		.facility = facility,
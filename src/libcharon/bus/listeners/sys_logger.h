@@ -51,6 +51,17 @@ struct sys_logger_t {
 	 */
 	void (*set_options) (sys_logger_t *this, bool ike_name);
 
+	/**
+	 * Enable or disable asynchronous logging.
+	 *
+	 * If enabled, log messages are queued in a ring buffer of the given size
+	 * and passed to syslog() by a dedicated thread. If the buffer is full,
+	 * messages are dropped instead of blocking the caller.
+	 *
+	 * @param size			number of buffered messages, 0 to log synchronously
+	 */
+	void (*set_async) (sys_logger_t *this, u_int size);
+
 	/**
 	 * Destroys a sys_logger_t object.
 	 */
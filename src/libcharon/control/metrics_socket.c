@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "metrics_socket.h"
+
+#include <daemon.h>
+
+typedef struct private_metrics_socket_t private_metrics_socket_t;
+
+/**
+ * Private data of an metrics_socket_t object.
+ */
+struct private_metrics_socket_t {
+
+	/**
+	 * Public metrics_socket_t interface.
+	 */
+	metrics_socket_t public;
+
+	/**
+	 * Metrics to export
+	 */
+	metrics_t *metrics;
+
+	/**
+	 * Service accepting scrapers
+	 */
+	stream_service_t *service;
+};
+
+/**
+ * Write all metrics to an accepted client
+ */
+static bool on_accept(private_metrics_socket_t *this, stream_t *stream)
+{
+	FILE *out;
+
+	out = stream->get_file(stream);
+	if (!out)
+	{
+		DBG1(DBG_CFG, "creating metrics output stream failed");
+		return FALSE;
+	}
+	this->metrics->print(this->metrics, out);
+	fclose(out);
+	return FALSE;
+}
+
+METHOD(metrics_socket_t, destroy, void,
+	private_metrics_socket_t *this)
+{
+	DESTROY_IF(this->service);
+	free(this);
+}
+
+/**
+ * See header
+ */
+metrics_socket_t *metrics_socket_create(metrics_t *metrics, char *uri)
+{
+	private_metrics_socket_t *this;
+
+	INIT(this,
+		.public = {
+			.destroy = _destroy,
+		},
+		.metrics = metrics,
+	);
+
+	this->service = lib->streams->create_service(lib->streams, uri, 10);
+	if (!this->service)
+	{
+		DBG1(DBG_CFG, "creating metrics socket '%s' failed", uri);
+		destroy(this);
+		return NULL;
+	}
+	this->service->on_accept(this->service, (stream_service_cb_t)on_accept,
+							 this, JOB_PRIO_CRITICAL, 1);
+
+	return &this->public;
+}
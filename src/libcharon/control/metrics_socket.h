@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup metrics_socket metrics_socket
+ * @{ @ingroup control
+ */
+
+#ifndef METRICS_SOCKET_H_
+#define METRICS_SOCKET_H_
+
+#include <library.h>
+
+typedef struct metrics_socket_t metrics_socket_t;
+
+/**
+ * Socket exporting lib->metrics to scrapers.
+ *
+ * Each client connecting to the socket receives all metrics in the
+ * Prometheus text exposition format, the connection is closed afterwards.
+ */
+struct metrics_socket_t {
+
+	/**
+	 * Destroy a metrics_socket_t.
+	 */
+	void (*destroy)(metrics_socket_t *this);
+};
+
+/**
+ * Create a metrics_socket_t instance.
+ *
+ * @param metrics		metrics registry to export
+ * @param uri			URI of the socket to listen on, e.g. tcp://127.0.0.1:9090
+ * @return				socket, NULL if creating the service failed
+ */
+metrics_socket_t *metrics_socket_create(metrics_t *metrics, char *uri);
+
+#endif /** METRICS_SOCKET_H_ @}*/
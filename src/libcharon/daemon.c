@@ -27,10 +27,13 @@
 #include <library.h>
 #include <bus/listeners/sys_logger.h>
 #include <bus/listeners/file_logger.h>
+#include <bus/listeners/metrics_listener.h>
+#include <control/metrics_socket.h>
 #include <config/proposal.h>
 #include <plugins/plugin_feature.h>
 #include <kernel/kernel_handler.h>
 #include <processing/jobs/start_action_job.h>
+#include <sa/authenticator.h>
 #include <threading/mutex.h>
 
 #ifndef LOG_AUTHPRIV /* not defined on OpenSolaris */
@@ -68,6 +71,16 @@ struct private_daemon_t {
 	 */
 	mutex_t *mutex;
 
+	/**
+	 * Listener recording IKE_SA metrics, if enabled
+	 */
+	metrics_listener_t *metrics_listener;
+
+	/**
+	 * Socket exporting metrics, if configured
+	 */
+	metrics_socket_t *metrics_socket;
+
 	/**
 	 * Integrity check failed?
 	 */
@@ -293,6 +306,9 @@ static void load_sys_logger(private_daemon_t *this, char *facility,
 	sys_logger->set_options(sys_logger,
 				lib->settings->get_bool(lib->settings, "%s.syslog.%s.ike_name",
 										FALSE, charon->name, facility));
+	sys_logger->set_async(sys_logger,
+				lib->settings->get_int(lib->settings, "%s.syslog.%s.async",
+									   0, charon->name, facility));
 
 	def = lib->settings->get_int(lib->settings, "%s.syslog.%s.default", 1,
 								 charon->name, facility);
@@ -316,6 +332,7 @@ static void load_file_logger(private_daemon_t *this, char *filename,
 	level_t def;
 	bool ike_name, flush_line, append;
 	char *time_format;
+	u_int async;
 
 	time_format = lib->settings->get_str(lib->settings,
 					"%s.filelog.%s.time_format", NULL, charon->name, filename);
@@ -325,10 +342,13 @@ static void load_file_logger(private_daemon_t *this, char *filename,
 					"%s.filelog.%s.flush_line", FALSE, charon->name, filename);
 	append = lib->settings->get_bool(lib->settings,
 					"%s.filelog.%s.append", TRUE, charon->name, filename);
+	async = lib->settings->get_int(lib->settings,
+					"%s.filelog.%s.async", 0, charon->name, filename);
 
 	file_logger = add_file_logger(this, filename, current_loggers);
 	file_logger->set_options(file_logger, time_format, ike_name);
 	file_logger->open(file_logger, flush_line, append);
+	file_logger->set_async(file_logger, async);
 
 	def = lib->settings->get_int(lib->settings, "%s.filelog.%s.default", 1,
 								 charon->name, filename);
@@ -430,6 +450,7 @@ METHOD(daemon_t, set_level, void,
  */
 static void destroy(private_daemon_t *this)
 {
+	DESTROY_IF(this->metrics_socket);
 	/* terminate all idle threads */
 	lib->processor->set_threads(lib->processor, 0);
 	/* make sure nobody waits for a DNS query */
@@ -468,6 +489,14 @@ static void destroy(private_daemon_t *this)
 	DESTROY_IF(this->public.backends);
 	DESTROY_IF(this->public.socket);
 
+	if (this->metrics_listener)
+	{
+		this->public.bus->remove_listener(this->public.bus,
+										  &this->metrics_listener->listener);
+		this->metrics_listener->destroy(this->metrics_listener);
+		authenticator_metrics_init(NULL);
+	}
+
 	/* rehook library logging, shutdown logging */
 	dbg = dbg_old;
 	DESTROY_IF(this->public.bus);
@@ -540,6 +569,18 @@ METHOD(daemon_t, initialize, bool,
 		return FALSE;
 	}
 
+	if (lib->metrics)
+	{
+		char *uri;
+
+		uri = lib->settings->get_str(lib->settings, "%s.metrics.socket", NULL,
+									 charon->name);
+		if (uri)
+		{
+			this->metrics_socket = metrics_socket_create(lib->metrics, uri);
+		}
+	}
+
 	/* Queue start_action job */
 	lib->processor->queue_job(lib->processor, (job_t*)start_action_job_create());
 
@@ -585,6 +626,14 @@ private_daemon_t *daemon_create(const char *name)
 	this->public.shunts = shunt_manager_create();
 	this->kernel_handler = kernel_handler_create();
 
+	if (lib->metrics)
+	{
+		this->metrics_listener = metrics_listener_create(lib->metrics);
+		this->public.bus->add_listener(this->public.bus,
+									   &this->metrics_listener->listener);
+		authenticator_metrics_init(lib->metrics);
+	}
+
 	return this;
 }
 
@@ -50,11 +50,6 @@
  */
 #define GENERATOR_DATA_BUFFER_SIZE 500
 
-/**
- * Number of bytes to increase the buffer, if it is too small.
- */
-#define GENERATOR_DATA_BUFFER_INCREASE_VALUE 500
-
 typedef struct private_generator_t private_generator_t;
 
 /**
@@ -114,6 +109,11 @@ struct private_generator_t {
 	 * TRUE, if debug messages should be logged during generation.
 	 */
 	bool debug;
+
+	/**
+	 * Use specialized generators for common payload layouts
+	 */
+	bool specialized;
 };
 
 /**
@@ -158,7 +158,8 @@ static void make_space_available(private_generator_t *this, int bits)
 		int old_buffer_size, new_buffer_size, out_position_offset;
 
 		old_buffer_size = get_size(this);
-		new_buffer_size = old_buffer_size + GENERATOR_DATA_BUFFER_INCREASE_VALUE;
+		/* grow geometrically, large messages need only a few reallocs */
+		new_buffer_size = old_buffer_size * 2;
 		out_position_offset = this->out_position - this->buffer;
 
 		if (this->debug)
@@ -427,6 +428,189 @@ static void generate_from_chunk(private_generator_t *this, u_int32_t offset)
 	write_bytes_to_buffer(this, value->ptr, value->len);
 }
 
+/**
+ * Generate all substructures in a list
+ */
+static void generate_list(private_generator_t *this, void *data,
+						  u_int32_t offset)
+{
+	linked_list_t *list;
+	enumerator_t *enumerator;
+	payload_t *current;
+
+	list = *((linked_list_t**)(data + offset));
+	enumerator = list->create_enumerator(list);
+	while (enumerator->enumerate(enumerator, &current))
+	{
+		this->public.generate_payload(&this->public, current);
+	}
+	enumerator->destroy(enumerator);
+}
+
+/**
+ * Get an 8-bit value of a specialized layout
+ */
+static inline u_int8_t get_uint8(void *data, encoding_rule_t *rule)
+{
+	return *(u_int8_t*)(data + rule->offset);
+}
+
+/**
+ * Get a 16-bit value of a specialized layout
+ */
+static inline u_int16_t get_uint16(void *data, encoding_rule_t *rule)
+{
+	return *(u_int16_t*)(data + rule->offset);
+}
+
+/**
+ * Get a bit of a specialized layout, as mask for its position
+ */
+static inline u_int8_t get_bit(void *data, encoding_rule_t *rule,
+							   u_int8_t mask)
+{
+	return *(bool*)(data + rule->offset) ? mask : 0;
+}
+
+/**
+ * Reserve space for the fixed size fields of a specialized layout
+ */
+static inline u_int8_t *reserve(private_generator_t *this, int bytes)
+{
+	u_int8_t *pos;
+
+	make_space_available(this, bytes * 8);
+	pos = this->out_position;
+	this->out_position += bytes;
+	return pos;
+}
+
+/**
+ * Generate the generic payload header from rules 0-9 of a specialized layout
+ */
+static void generate_header(private_generator_t *this, void *data,
+							encoding_rule_t *rules)
+{
+	u_int8_t *pos;
+
+	pos = reserve(this, 4);
+	pos[0] = get_uint8(data, &rules[0]);
+	pos[1] = get_bit(data, &rules[1], 0x80) | get_bit(data, &rules[2], 0x40) |
+			 get_bit(data, &rules[3], 0x20) | get_bit(data, &rules[4], 0x10) |
+			 get_bit(data, &rules[5], 0x08) | get_bit(data, &rules[6], 0x04) |
+			 get_bit(data, &rules[7], 0x02) | get_bit(data, &rules[8], 0x01);
+	htoun16(pos + 2, get_uint16(data, &rules[9]));
+}
+
+/**
+ * Generate a payload with a specialized layout, in straight-line code
+ */
+static void generate_layout(private_generator_t *this, payload_layout_t layout,
+							void *data, encoding_rule_t *rules)
+{
+	u_int8_t *pos;
+
+	switch (layout)
+	{
+		case LAYOUT_DATA:
+			generate_header(this, data, rules);
+			generate_from_chunk(this, rules[10].offset);
+			break;
+		case LAYOUT_KE:
+			generate_header(this, data, rules);
+			pos = reserve(this, 4);
+			htoun16(pos, get_uint16(data, &rules[10]));
+			pos[2] = get_uint8(data, &rules[11]);
+			pos[3] = get_uint8(data, &rules[12]);
+			generate_from_chunk(this, rules[13].offset);
+			break;
+		case LAYOUT_TYPED_DATA:
+			generate_header(this, data, rules);
+			pos = reserve(this, 4);
+			pos[0] = get_uint8(data, &rules[10]);
+			pos[1] = get_uint8(data, &rules[11]);
+			pos[2] = get_uint8(data, &rules[12]);
+			pos[3] = get_uint8(data, &rules[13]);
+			generate_from_chunk(this, rules[14].offset);
+			break;
+		case LAYOUT_NOTIFY:
+			generate_header(this, data, rules);
+			pos = reserve(this, 4);
+			pos[0] = get_uint8(data, &rules[10]);
+			pos[1] = get_uint8(data, &rules[11]);
+			htoun16(pos + 2, get_uint16(data, &rules[12]));
+			generate_from_chunk(this, rules[13].offset);
+			generate_from_chunk(this, rules[14].offset);
+			break;
+		case LAYOUT_SA:
+			generate_header(this, data, rules);
+			generate_list(this, data, rules[10].offset);
+			break;
+		case LAYOUT_TS:
+			generate_header(this, data, rules);
+			pos = reserve(this, 4);
+			pos[0] = get_uint8(data, &rules[10]);
+			pos[1] = get_uint8(data, &rules[11]);
+			pos[2] = get_uint8(data, &rules[12]);
+			pos[3] = get_uint8(data, &rules[13]);
+			generate_list(this, data, rules[14].offset);
+			break;
+		case LAYOUT_ENCRYPTED:
+			pos = reserve(this, 4);
+			pos[0] = get_uint8(data, &rules[0]);
+			pos[1] = get_uint8(data, &rules[1]);
+			htoun16(pos + 2, get_uint16(data, &rules[2]));
+			generate_from_chunk(this, rules[3].offset);
+			break;
+		case LAYOUT_PROPOSAL:
+			pos = reserve(this, 8);
+			pos[0] = get_uint8(data, &rules[0]);
+			pos[1] = get_uint8(data, &rules[1]);
+			htoun16(pos + 2, get_uint16(data, &rules[2]));
+			pos[4] = get_uint8(data, &rules[3]);
+			pos[5] = get_uint8(data, &rules[4]);
+			pos[6] = get_uint8(data, &rules[5]);
+			pos[7] = get_uint8(data, &rules[6]);
+			generate_from_chunk(this, rules[7].offset);
+			generate_list(this, data, rules[8].offset);
+			break;
+		case LAYOUT_TRANSFORM:
+			pos = reserve(this, 8);
+			pos[0] = get_uint8(data, &rules[0]);
+			pos[1] = get_uint8(data, &rules[1]);
+			htoun16(pos + 2, get_uint16(data, &rules[2]));
+			pos[4] = get_uint8(data, &rules[3]);
+			pos[5] = get_uint8(data, &rules[4]);
+			htoun16(pos + 6, get_uint16(data, &rules[5]));
+			generate_list(this, data, rules[6].offset);
+			break;
+		case LAYOUT_ATTRIBUTE:
+			pos = reserve(this, 4);
+			this->attribute_format = *(bool*)(data + rules[0].offset);
+			htoun16(pos, (get_uint16(data, &rules[1]) & 0x7FFF) |
+						 (this->attribute_format ? 0x8000 : 0));
+			htoun16(pos + 2, get_uint16(data, &rules[2]));
+			if (!this->attribute_format)
+			{	/* TLV format, the value follows its length */
+				this->attribute_length = get_uint16(data, &rules[2]);
+				generate_from_chunk(this, rules[3].offset);
+			}
+			break;
+		case LAYOUT_TS_SUBSTRUCTURE:
+			pos = reserve(this, 8);
+			pos[0] = get_uint8(data, &rules[0]);
+			pos[1] = get_uint8(data, &rules[1]);
+			htoun16(pos + 2, get_uint16(data, &rules[2]));
+			htoun16(pos + 4, get_uint16(data, &rules[3]));
+			htoun16(pos + 6, get_uint16(data, &rules[4]));
+			generate_from_chunk(this, rules[5].offset);
+			generate_from_chunk(this, rules[6].offset);
+			break;
+		default:
+			break;
+	}
+}
+
 METHOD(generator_t, get_chunk, chunk_t,
 	private_generator_t *this, u_int32_t **lenpos)
 {
@@ -447,6 +631,7 @@ METHOD(generator_t, generate_payload, void,
 	int i, offset_start, rule_count;
 	encoding_rule_t *rules;
 	payload_type_t payload_type;
+	payload_layout_t layout;
 
 	this->data_struct = payload;
 	payload_type = payload->get_type(payload);
@@ -462,6 +647,17 @@ METHOD(generator_t, generate_payload, void,
 	/* each payload has its own encoding rules */
 	rule_count = payload->get_encoding_rules(payload, &rules);
 
+	if (this->specialized && this->current_bit == 0)
+	{
+		layout = payload_get_layout(payload, rules, rule_count);
+		if (layout != LAYOUT_NONE)
+		{
+			generate_layout(this, layout, payload, rules);
+			/* nothing left to interpret */
+			rule_count = 0;
+		}
+	}
+
 	for (i = 0; i < rule_count;i++)
 	{
 		if (this->debug)
@@ -507,21 +703,8 @@ METHOD(generator_t, generate_payload, void,
 			case PAYLOAD_LIST + CONFIGURATION_ATTRIBUTE:
 			case PAYLOAD_LIST + CONFIGURATION_ATTRIBUTE_V1:
 			case PAYLOAD_LIST + TRAFFIC_SELECTOR_SUBSTRUCTURE:
-			{
-				linked_list_t *proposals;
-				enumerator_t *enumerator;
-				payload_t *proposal;
-
-				proposals = *((linked_list_t **)
-										(this->data_struct + rules[i].offset));
-				enumerator = proposals->create_enumerator(proposals);
-				while (enumerator->enumerate(enumerator, &proposal))
-				{
-					generate_payload(this, proposal);
-				}
-				enumerator->destroy(enumerator);
+				generate_list(this, this->data_struct, rules[i].offset);
 				break;
-			}
 			case ATTRIBUTE_FORMAT:
 				generate_flag(this, rules[i].offset);
 				/* Attribute format is a flag which is stored in context*/
@@ -570,6 +753,12 @@ METHOD(generator_t, generate_payload, void,
 	}
 }
 
+METHOD(generator_t, set_specialized, void,
+	private_generator_t *this, bool specialized)
+{
+	this->specialized = specialized;
+}
+
 METHOD(generator_t, destroy, void,
 	private_generator_t *this)
 {
@@ -588,10 +777,12 @@ generator_t *generator_create()
 		.public = {
 			.get_chunk = _get_chunk,
 			.generate_payload = _generate_payload,
+			.set_specialized = _set_specialized,
 			.destroy = _destroy,
 		},
 		.buffer = malloc(GENERATOR_DATA_BUFFER_SIZE),
 		.debug = TRUE,
+		.specialized = TRUE,
 	);
 
 	this->out_position = this->buffer;
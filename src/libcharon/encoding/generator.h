@@ -59,6 +59,16 @@ struct generator_t {
 	 */
 	chunk_t (*get_chunk) (generator_t *this, u_int32_t **lenpos);
 
+	/**
+	 * Enable or disable the specialized generators for common payload layouts.
+	 *
+	 * The specialized generators are enabled by default. If disabled, the
+	 * encoding rules of all payloads get interpreted rule by rule.
+	 *
+	 * @param specialized	TRUE to use specialized generators
+	 */
+	void (*set_specialized) (generator_t *this, bool specialized);
+
 	/**
 	 * Destroys a generator_t object.
 	 */
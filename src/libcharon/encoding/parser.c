@@ -83,6 +83,11 @@ struct private_parser_t {
 	 * Set of encoding rules for this parsing session.
 	 */
 	encoding_rule_t *rules;
+
+	/**
+	 * Use specialized parsers for common payload layouts
+	 */
+	bool specialized;
 };
 
 /**
@@ -358,6 +363,253 @@ static bool parse_chunk(private_parser_t *this, int rule_number,
 	return TRUE;
 }
 
+/**
+ * Check if the given number of bytes is available for a fixed size part
+ */
+static inline bool available(private_parser_t *this, int rule_number,
+							 int bytes)
+{
+	if (this->byte_pos + bytes > this->input_roof)
+	{
+		return short_input(this, rule_number);
+	}
+	return TRUE;
+}
+
+/**
+ * Store an 8-bit value of a specialized layout
+ */
+static inline void set_uint8(void *output, encoding_rule_t *rule,
+							 u_int8_t value)
+{
+	*(u_int8_t*)(output + rule->offset) = value;
+}
+
+/**
+ * Store a 16-bit value of a specialized layout
+ */
+static inline void set_uint16(void *output, encoding_rule_t *rule,
+							  u_int16_t value)
+{
+	*(u_int16_t*)(output + rule->offset) = value;
+}
+
+/**
+ * Store a bit of a specialized layout
+ */
+static inline void set_bit(void *output, encoding_rule_t *rule,
+						   u_int8_t byte, u_int8_t mask)
+{
+	*(bool*)(output + rule->offset) = (byte & mask) != 0;
+}
+
+/**
+ * Parse the generic payload header using rules 0-9 of a specialized layout
+ */
+static bool parse_header(private_parser_t *this, void *output,
+						 encoding_rule_t *rules, int *length)
+{
+	u_int8_t *pos = this->byte_pos;
+
+	if (!available(this, 0, 4))
+	{
+		return FALSE;
+	}
+	set_uint8(output, &rules[0], pos[0]);
+	set_bit(output, &rules[1], pos[1], 0x80);
+	set_bit(output, &rules[2], pos[1], 0x40);
+	set_bit(output, &rules[3], pos[1], 0x20);
+	set_bit(output, &rules[4], pos[1], 0x10);
+	set_bit(output, &rules[5], pos[1], 0x08);
+	set_bit(output, &rules[6], pos[1], 0x04);
+	set_bit(output, &rules[7], pos[1], 0x02);
+	set_bit(output, &rules[8], pos[1], 0x01);
+	*length = untoh16(pos + 2);
+	set_uint16(output, &rules[9], *length);
+	this->byte_pos += 4;
+	/* all payloads must have at least 4 bytes header */
+	return *length >= 4;
+}
+
+/**
+ * Parse the body of a payload after its header into a chunk
+ */
+static bool parse_data(private_parser_t *this, payload_t *pld,
+					   encoding_rule_t *rules, int rule_number, int length)
+{
+	int header_length = pld->get_header_length(pld);
+
+	return length >= header_length &&
+		   parse_chunk(this, rule_number,
+					   (void*)pld + rules[rule_number].offset,
+					   length - header_length);
+}
+
+/**
+ * Parse the body of a payload after its header into a substructure list
+ */
+static bool parse_body_list(private_parser_t *this, payload_t *pld,
+							encoding_rule_t *rules, int rule_number, int length)
+{
+	int header_length = pld->get_header_length(pld);
+
+	return length >= header_length &&
+		   parse_list(this, rule_number,
+					  (void*)pld + rules[rule_number].offset,
+					  rules[rule_number].type - PAYLOAD_LIST,
+					  length - header_length);
+}
+
+/**
+ * Parse a payload with a specialized layout, in straight-line code
+ */
+static bool parse_layout(private_parser_t *this, payload_layout_t layout,
+						 payload_t *pld, encoding_rule_t *rules)
+{
+	void *output = pld;
+	u_int8_t *pos;
+	int length, size;
+
+	switch (layout)
+	{
+		case LAYOUT_DATA:
+			return parse_header(this, output, rules, &length) &&
+				   parse_data(this, pld, rules, 10, length);
+		case LAYOUT_KE:
+			if (!parse_header(this, output, rules, &length) ||
+				!available(this, 10, 4))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint16(output, &rules[10], untoh16(pos));
+			set_uint8(output, &rules[11], pos[2]);
+			set_uint8(output, &rules[12], pos[3]);
+			this->byte_pos += 4;
+			return parse_data(this, pld, rules, 13, length);
+		case LAYOUT_TYPED_DATA:
+			if (!parse_header(this, output, rules, &length) ||
+				!available(this, 10, 4))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint8(output, &rules[10], pos[0]);
+			set_uint8(output, &rules[11], pos[1]);
+			set_uint8(output, &rules[12], pos[2]);
+			set_uint8(output, &rules[13], pos[3]);
+			this->byte_pos += 4;
+			return parse_data(this, pld, rules, 14, length);
+		case LAYOUT_NOTIFY:
+			if (!parse_header(this, output, rules, &length) ||
+				!available(this, 10, 4))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint8(output, &rules[10], pos[0]);
+			set_uint8(output, &rules[11], pos[1]);
+			set_uint16(output, &rules[12], untoh16(pos + 2));
+			this->byte_pos += 4;
+			return parse_chunk(this, 13, output + rules[13].offset, pos[1]) &&
+				   parse_data(this, pld, rules, 14, length);
+		case LAYOUT_SA:
+			return parse_header(this, output, rules, &length) &&
+				   parse_body_list(this, pld, rules, 10, length);
+		case LAYOUT_TS:
+			if (!parse_header(this, output, rules, &length) ||
+				!available(this, 10, 4))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint8(output, &rules[10], pos[0]);
+			set_uint8(output, &rules[11], pos[1]);
+			set_uint8(output, &rules[12], pos[2]);
+			set_uint8(output, &rules[13], pos[3]);
+			this->byte_pos += 4;
+			return parse_body_list(this, pld, rules, 14, length);
+		case LAYOUT_ENCRYPTED:
+			if (!available(this, 0, 4))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint8(output, &rules[0], pos[0]);
+			set_uint8(output, &rules[1], pos[1]);
+			length = untoh16(pos + 2);
+			set_uint16(output, &rules[2], length);
+			this->byte_pos += 4;
+			return length >= 4 && parse_data(this, pld, rules, 3, length);
+		case LAYOUT_PROPOSAL:
+			if (!available(this, 0, 8))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint8(output, &rules[0], pos[0]);
+			set_uint8(output, &rules[1], pos[1]);
+			length = untoh16(pos + 2);
+			set_uint16(output, &rules[2], length);
+			set_uint8(output, &rules[3], pos[4]);
+			set_uint8(output, &rules[4], pos[5]);
+			set_uint8(output, &rules[5], pos[6]);
+			set_uint8(output, &rules[6], pos[7]);
+			this->byte_pos += 8;
+			return length >= 4 &&
+				   parse_chunk(this, 7, output + rules[7].offset, pos[6]) &&
+				   parse_body_list(this, pld, rules, 8, length);
+		case LAYOUT_TRANSFORM:
+			if (!available(this, 0, 8))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint8(output, &rules[0], pos[0]);
+			set_uint8(output, &rules[1], pos[1]);
+			length = untoh16(pos + 2);
+			set_uint16(output, &rules[2], length);
+			set_uint8(output, &rules[3], pos[4]);
+			set_uint8(output, &rules[4], pos[5]);
+			set_uint16(output, &rules[5], untoh16(pos + 6));
+			this->byte_pos += 8;
+			return length >= 4 && parse_body_list(this, pld, rules, 6, length);
+		case LAYOUT_ATTRIBUTE:
+			if (!available(this, 0, 4))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_bit(output, &rules[0], pos[0], 0x80);
+			set_uint16(output, &rules[1], untoh16(pos) & ~0x8000);
+			length = untoh16(pos + 2);
+			set_uint16(output, &rules[2], length);
+			this->byte_pos += 4;
+			/* TV format has no value, TLV format is followed by it */
+			return (pos[0] & 0x80) ||
+				   parse_chunk(this, 3, output + rules[3].offset, length);
+		case LAYOUT_TS_SUBSTRUCTURE:
+			if (!available(this, 0, 8))
+			{
+				return FALSE;
+			}
+			pos = this->byte_pos;
+			set_uint8(output, &rules[0], pos[0]);
+			set_uint8(output, &rules[1], pos[1]);
+			length = untoh16(pos + 2);
+			set_uint16(output, &rules[2], length);
+			set_uint16(output, &rules[3], untoh16(pos + 4));
+			set_uint16(output, &rules[4], untoh16(pos + 6));
+			this->byte_pos += 8;
+			size = (pos[0] == TS_IPV4_ADDR_RANGE) ? 4 : 16;
+			return length >= 4 &&
+				   parse_chunk(this, 5, output + rules[5].offset, size) &&
+				   parse_chunk(this, 6, output + rules[6].offset, size);
+		default:
+			return FALSE;
+	}
+}
+
 METHOD(parser_t, parse_payload, status_t,
 	private_parser_t *this, payload_type_t payload_type, payload_t **payload)
 {
@@ -368,6 +620,7 @@ METHOD(parser_t, parse_payload, status_t,
 	bool attribute_format = FALSE;
 	int rule_number, rule_count;
 	encoding_rule_t *rule;
+	payload_layout_t layout;
 
 	/* create instance of the payload to parse */
 	pld = payload_create(payload_type);
@@ -382,6 +635,23 @@ METHOD(parser_t, parse_payload, status_t,
 	output = pld;
 	/* parse the payload with its own rulse */
 	rule_count = pld->get_encoding_rules(pld, &this->rules);
+
+	if (this->specialized && this->bit_pos == 0)
+	{
+		layout = payload_get_layout(pld, this->rules, rule_count);
+		if (layout != LAYOUT_NONE)
+		{
+			if (!parse_layout(this, layout, pld, this->rules))
+			{
+				pld->destroy(pld);
+				return PARSE_ERROR;
+			}
+			*payload = pld;
+			DBG2(DBG_ENC, "parsing %N payload finished",
+				 payload_type_names, payload_type);
+			return SUCCESS;
+		}
+	}
 	for (rule_number = 0; rule_number < rule_count; rule_number++)
 	{
 		/* update header length for each rule, as it is dynamic (SPIs) */
@@ -630,6 +900,12 @@ METHOD(parser_t, reset_context, void,
 	this->bit_pos = 0;
 }
 
+METHOD(parser_t, set_specialized, void,
+	private_parser_t *this, bool specialized)
+{
+	this->specialized = specialized;
+}
+
 METHOD(parser_t, destroy, void,
 	private_parser_t *this)
 {
@@ -648,11 +924,13 @@ parser_t *parser_create(chunk_t data)
 			.parse_payload = _parse_payload,
 			.reset_context = _reset_context,
 			.get_remaining_byte_count = _get_remaining_byte_count,
+			.set_specialized = _set_specialized,
 			.destroy = _destroy,
 		},
 		.input = data.ptr,
 		.byte_pos = data.ptr,
 		.input_roof = data.ptr + data.len,
+		.specialized = TRUE,
 	);
 
 	return &this->public;
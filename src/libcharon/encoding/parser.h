@@ -62,6 +62,16 @@ struct parser_t {
 	 */
 	void (*reset_context) (parser_t *this);
 
+	/**
+	 * Enable or disable the specialized parsers for common payload layouts.
+	 *
+	 * The specialized parsers are enabled by default. If disabled, the
+	 * encoding rules of all payloads get interpreted rule by rule.
+	 *
+	 * @param specialized	TRUE to use specialized parsers
+	 */
+	void (*set_specialized)(parser_t *this, bool specialized);
+
 	/**
 	 * Destroys a parser_t object.
 	 */
@@ -304,3 +304,170 @@ void* payload_get_field(payload_t *payload, encoding_type_t type, u_int skip)
 	}
 	return NULL;
 }
+
+/**
+ * Generic payload header, shared by most IKEv2 payloads
+ */
+static encoding_type_t layout_header[] = {
+	U_INT_8, FLAG, RESERVED_BIT, RESERVED_BIT, RESERVED_BIT, RESERVED_BIT,
+	RESERVED_BIT, RESERVED_BIT, RESERVED_BIT, PAYLOAD_LENGTH,
+};
+
+static encoding_type_t layout_data[] = {
+	CHUNK_DATA,
+};
+
+static encoding_type_t layout_ke[] = {
+	U_INT_16, RESERVED_BYTE, RESERVED_BYTE, CHUNK_DATA,
+};
+
+static encoding_type_t layout_typed_data[] = {
+	U_INT_8, RESERVED_BYTE, RESERVED_BYTE, RESERVED_BYTE, CHUNK_DATA,
+};
+
+static encoding_type_t layout_notify[] = {
+	U_INT_8, SPI_SIZE, U_INT_16, SPI, CHUNK_DATA,
+};
+
+static encoding_type_t layout_sa[] = {
+	PAYLOAD_LIST + PROPOSAL_SUBSTRUCTURE,
+};
+
+static encoding_type_t layout_ts[] = {
+	U_INT_8, RESERVED_BYTE, RESERVED_BYTE, RESERVED_BYTE,
+	PAYLOAD_LIST + TRAFFIC_SELECTOR_SUBSTRUCTURE,
+};
+
+static encoding_type_t layout_encrypted[] = {
+	U_INT_8, U_INT_8, PAYLOAD_LENGTH, CHUNK_DATA,
+};
+
+static encoding_type_t layout_proposal[] = {
+	U_INT_8, RESERVED_BYTE, PAYLOAD_LENGTH, U_INT_8, U_INT_8, SPI_SIZE,
+	U_INT_8, SPI, PAYLOAD_LIST + TRANSFORM_SUBSTRUCTURE,
+};
+
+static encoding_type_t layout_transform[] = {
+	U_INT_8, RESERVED_BYTE, PAYLOAD_LENGTH, U_INT_8, RESERVED_BYTE, U_INT_16,
+	PAYLOAD_LIST + TRANSFORM_ATTRIBUTE,
+};
+
+static encoding_type_t layout_attribute[] = {
+	ATTRIBUTE_FORMAT, ATTRIBUTE_TYPE, ATTRIBUTE_LENGTH_OR_VALUE, ATTRIBUTE_VALUE,
+};
+
+static encoding_type_t layout_ts_substructure[] = {
+	TS_TYPE, U_INT_8, PAYLOAD_LENGTH, U_INT_16, U_INT_16, ADDRESS, ADDRESS,
+};
+
+/**
+ * Layouts, indexed by payload_layout_t
+ */
+static struct {
+	/** TRUE if the layout starts with the generic header */
+	bool header;
+	/** rule types following the header */
+	encoding_type_t *types;
+	/** number of rule types */
+	int count;
+} layouts[] = {
+	{ FALSE,	NULL,					0								},
+	{ TRUE,		layout_data,			countof(layout_data)			},
+	{ TRUE,		layout_ke,				countof(layout_ke)				},
+	{ TRUE,		layout_typed_data,		countof(layout_typed_data)		},
+	{ TRUE,		layout_notify,			countof(layout_notify)			},
+	{ TRUE,		layout_sa,				countof(layout_sa)				},
+	{ TRUE,		layout_ts,				countof(layout_ts)				},
+	{ FALSE,	layout_encrypted,		countof(layout_encrypted)		},
+	{ FALSE,	layout_proposal,		countof(layout_proposal)		},
+	{ FALSE,	layout_transform,		countof(layout_transform)		},
+	{ FALSE,	layout_attribute,		countof(layout_attribute)		},
+	{ FALSE,	layout_ts_substructure,	countof(layout_ts_substructure)	},
+};
+
+/**
+ * Check if a sequence of encoding rules has the given types
+ */
+static bool match_types(encoding_rule_t *rules, encoding_type_t *types,
+						int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (rules[i].type != types[i])
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * See header.
+ */
+payload_layout_t payload_get_layout(payload_t *payload, encoding_rule_t *rules,
+									int count)
+{
+	payload_layout_t layout;
+	int header = 0;
+
+	switch (payload->get_type(payload))
+	{
+		case NONCE:
+		case VENDOR_ID:
+		case EXTENSIBLE_AUTHENTICATION:
+			layout = LAYOUT_DATA;
+			break;
+		case KEY_EXCHANGE:
+			layout = LAYOUT_KE;
+			break;
+		case ID_INITIATOR:
+		case ID_RESPONDER:
+		case AUTHENTICATION:
+			layout = LAYOUT_TYPED_DATA;
+			break;
+		case NOTIFY:
+			layout = LAYOUT_NOTIFY;
+			break;
+		case SECURITY_ASSOCIATION:
+			layout = LAYOUT_SA;
+			break;
+		case TRAFFIC_SELECTOR_INITIATOR:
+		case TRAFFIC_SELECTOR_RESPONDER:
+			layout = LAYOUT_TS;
+			break;
+		case ENCRYPTED:
+			layout = LAYOUT_ENCRYPTED;
+			break;
+		case PROPOSAL_SUBSTRUCTURE:
+			layout = LAYOUT_PROPOSAL;
+			break;
+		case TRANSFORM_SUBSTRUCTURE:
+			layout = LAYOUT_TRANSFORM;
+			break;
+		case TRANSFORM_ATTRIBUTE:
+			layout = LAYOUT_ATTRIBUTE;
+			break;
+		case TRAFFIC_SELECTOR_SUBSTRUCTURE:
+			layout = LAYOUT_TS_SUBSTRUCTURE;
+			break;
+		default:
+			return LAYOUT_NONE;
+	}
+	if (layouts[layout].header)
+	{
+		header = countof(layout_header);
+		if (count < header || !match_types(rules, layout_header, header))
+		{
+			return LAYOUT_NONE;
+		}
+	}
+	if (count != header + layouts[layout].count ||
+		!match_types(rules + header, layouts[layout].types,
+					 layouts[layout].count))
+	{
+		return LAYOUT_NONE;
+	}
+	return layout;
+}
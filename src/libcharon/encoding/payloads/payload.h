@@ -24,6 +24,7 @@
 #define PAYLOAD_H_
 
 typedef enum payload_type_t payload_type_t;
+typedef enum payload_layout_t payload_layout_t;
 typedef struct payload_t payload_t;
 
 #include <library.h>
@@ -304,6 +305,40 @@ extern enum_name_t *payload_type_names;
  */
 extern enum_name_t *payload_type_short_names;
 
+/**
+ * Layouts of common IKEv2 payloads having a specialized parser and generator.
+ *
+ * The specialized functions process the fields of a layout in straight-line
+ * code instead of interpreting the encoding rules one by one. Field locations
+ * are still taken from the encoding rules of the payload.
+ */
+enum payload_layout_t {
+	/** no specialized layout, encoding rules get interpreted */
+	LAYOUT_NONE = 0,
+	/** generic header followed by data (NONCE, VENDOR_ID, EAP) */
+	LAYOUT_DATA,
+	/** generic header, DH group, two reserved bytes, data (KE) */
+	LAYOUT_KE,
+	/** generic header, type, three reserved bytes, data (ID, AUTH) */
+	LAYOUT_TYPED_DATA,
+	/** generic header, protocol, SPI size, type, SPI, data (NOTIFY) */
+	LAYOUT_NOTIFY,
+	/** generic header followed by proposal substructures (SA) */
+	LAYOUT_SA,
+	/** generic header, TS count, reserved bytes, TS substructures (TS) */
+	LAYOUT_TS,
+	/** header without flags followed by encrypted data (ENCRYPTED) */
+	LAYOUT_ENCRYPTED,
+	/** proposal substructure with SPI and transforms */
+	LAYOUT_PROPOSAL,
+	/** transform substructure with transform attributes */
+	LAYOUT_TRANSFORM,
+	/** transform attribute, in TV or TLV format */
+	LAYOUT_ATTRIBUTE,
+	/** traffic selector substructure */
+	LAYOUT_TS_SUBSTRUCTURE,
+};
+
 /**
  * Generic interface for all payload types (incl.header and substructures).
  *
@@ -399,4 +434,18 @@ bool payload_is_known(payload_type_t type);
  */
 void* payload_get_field(payload_t *payload, encoding_type_t type, u_int skip);
 
+/**
+ * Get the layout of a payload, if it has a specialized parser/generator.
+ *
+ * The layout expected for the payload type is verified against the encoding
+ * rules, so the specialized code can't get out of sync with them.
+ *
+ * @param payload	payload to get the layout for
+ * @param rules		encoding rules of the payload
+ * @param count		number of encoding rules
+ * @return			layout, LAYOUT_NONE to interpret the encoding rules
+ */
+payload_layout_t payload_get_layout(payload_t *payload, encoding_rule_t *rules,
+									int count);
+
 #endif /** PAYLOAD_H_ @}*/
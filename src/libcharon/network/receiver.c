@@ -120,14 +120,16 @@ struct private_receiver_t {
 	u_int32_t block_threshold;
 
 	/**
-	 * Drop IKE_SA_INIT requests if processor job load exceeds this limit
+	 * Drop IKE_SA_INIT requests if processor job load exceeds this limit,
+	 * read for each request to follow reloaded settings
 	 */
-	u_int init_limit_job_load;
+	settings_key_t *init_limit_job_load;
 
 	/**
-	 * Drop IKE_SA_INIT requests if half open IKE_SA count exceeds this limit
+	 * Drop IKE_SA_INIT requests if half open IKE_SA count exceeds this limit,
+	 * read for each request to follow reloaded settings
 	 */
-	u_int init_limit_half_open;
+	settings_key_t *init_limit_half_open;
 
 	/**
 	 * Delay for receiving incoming packets, to simulate larger RTT
@@ -326,7 +328,7 @@ static bool cookie_required(private_receiver_t *this,
  */
 static bool drop_ike_sa_init(private_receiver_t *this, message_t *message)
 {
-	u_int half_open;
+	u_int half_open, limit;
 	u_int32_t now;
 
 	now = time_monotonic(NULL);
@@ -384,17 +386,18 @@ static bool drop_ike_sa_init(private_receiver_t *this, message_t *message)
 	}
 
 	/* check if global half open IKE_SA limit reached */
-	if (this->init_limit_half_open &&
-		half_open >= this->init_limit_half_open)
+	limit = this->init_limit_half_open->get_int(this->init_limit_half_open, 0);
+	if (limit && half_open >= limit)
 	{
 		DBG1(DBG_NET, "ignoring IKE_SA setup from %H, half open IKE_SA "
 			 "count of %d exceeds limit of %d", message->get_source(message),
-			 half_open, this->init_limit_half_open);
+			 half_open, limit);
 		return TRUE;
 	}
 
 	/* check if job load acceptable */
-	if (this->init_limit_job_load)
+	limit = this->init_limit_job_load->get_int(this->init_limit_job_load, 0);
+	if (limit)
 	{
 		u_int jobs = 0, i;
 
@@ -402,11 +405,11 @@ static bool drop_ike_sa_init(private_receiver_t *this, message_t *message)
 		{
 			jobs += lib->processor->get_job_load(lib->processor, i);
 		}
-		if (jobs > this->init_limit_job_load)
+		if (jobs > limit)
 		{
 			DBG1(DBG_NET, "ignoring IKE_SA setup from %H, job load of %d "
 				 "exceeds limit of %d", message->get_source(message),
-				 jobs, this->init_limit_job_load);
+				 jobs, limit);
 			return TRUE;
 		}
 	}
@@ -644,10 +647,10 @@ receiver_t *receiver_create()
 		this->block_threshold = lib->settings->get_int(lib->settings,
 				"%s.block_threshold", BLOCK_THRESHOLD_DEFAULT, charon->name);
 	}
-	this->init_limit_job_load = lib->settings->get_int(lib->settings,
-				"%s.init_limit_job_load", 0, charon->name);
-	this->init_limit_half_open = lib->settings->get_int(lib->settings,
-				"%s.init_limit_half_open", 0, charon->name);
+	this->init_limit_job_load = lib->settings->get_key(lib->settings,
+				"%s.init_limit_job_load", charon->name);
+	this->init_limit_half_open = lib->settings->get_key(lib->settings,
+				"%s.init_limit_half_open", charon->name);
 	this->receive_delay = lib->settings->get_int(lib->settings,
 				"%s.receive_delay", 0, charon->name);
 	this->receive_delay_type = lib->settings->get_int(lib->settings,
@@ -46,7 +46,7 @@ struct private_eap_simaka_pseudonym_card_t {
  */
 static u_int hash(identification_t *key)
 {
-	return chunk_hash(key->get_encoding(key));
+	return key->hash(key, 0);
 }
 
 /**
@@ -51,7 +51,7 @@ struct private_eap_simaka_pseudonym_provider_t {
  */
 static u_int hash(identification_t *key)
 {
-	return chunk_hash(key->get_encoding(key));
+	return key->hash(key, 0);
 }
 
 /**
@@ -19,14 +19,37 @@
 
 #include <daemon.h>
 
+typedef struct private_eap_tls_plugin_t private_eap_tls_plugin_t;
+
+/**
+ * Private data of an eap_tls_plugin_t object.
+ */
+struct private_eap_tls_plugin_t {
+
+	/**
+	 * Public eap_tls_plugin_t interface.
+	 */
+	eap_tls_plugin_t public;
+
+	/**
+	 * TLS session cache shared by all EAP-TLS instances, if any
+	 */
+	tls_cache_t *cache;
+};
+
+/**
+ * Instance of the EAP-TLS plugin
+ */
+static private_eap_tls_plugin_t *instance = NULL;
+
 METHOD(plugin_t, get_name, char*,
-	eap_tls_plugin_t *this)
+	private_eap_tls_plugin_t *this)
 {
 	return "eap-tls";
 }
 
 METHOD(plugin_t, get_features, int,
-	eap_tls_plugin_t *this, plugin_feature_t *features[])
+	private_eap_tls_plugin_t *this, plugin_feature_t *features[])
 {
 	static plugin_feature_t f[] = {
 		PLUGIN_CALLBACK(eap_method_register, eap_tls_create_server),
@@ -46,9 +69,11 @@ METHOD(plugin_t, get_features, int,
 }
 
 METHOD(plugin_t, destroy, void,
-	eap_tls_plugin_t *this)
+	private_eap_tls_plugin_t *this)
 {
+	DESTROY_IF(this->cache);
 	free(this);
+	instance = NULL;
 }
 
 /*
@@ -56,15 +81,40 @@ METHOD(plugin_t, destroy, void,
  */
 plugin_t *eap_tls_plugin_create()
 {
-	eap_tls_plugin_t *this;
+	private_eap_tls_plugin_t *this;
+	u_int max_sessions, lifetime;
 
 	INIT(this,
-		.plugin = {
-			.get_name = _get_name,
-			.get_features = _get_features,
-			.destroy = _destroy,
+		.public = {
+			.plugin = {
+				.get_name = _get_name,
+				.get_features = _get_features,
+				.destroy = _destroy,
+			},
 		},
 	);
 
-	return &this->plugin;
+	max_sessions = lib->settings->get_int(lib->settings,
+					"%s.plugins.eap-tls.max_sessions", 0, charon->name);
+	lifetime = lib->settings->get_int(lib->settings,
+					"%s.plugins.eap-tls.session_lifetime", 3600, charon->name);
+	if (max_sessions && lifetime)
+	{
+		this->cache = tls_cache_create(max_sessions, lifetime);
+	}
+	instance = this;
+
+	return &this->public.plugin;
+}
+
+/**
+ * See header
+ */
+tls_cache_t *eap_tls_plugin_get_cache()
+{
+	if (instance)
+	{
+		return instance->cache;
+	}
+	return NULL;
 }
@@ -25,6 +25,7 @@
 #define EAP_TLS_PLUGIN_H_
 
 #include <plugins/plugin.h>
+#include <tls_cache.h>
 
 typedef struct eap_tls_plugin_t eap_tls_plugin_t;
 
@@ -39,4 +40,11 @@ struct eap_tls_plugin_t {
 	plugin_t plugin;
 };
 
+/**
+ * Get the TLS session cache shared by EAP-TLS instances.
+ *
+ * @return			session cache, NULL if session resumption disabled
+ */
+tls_cache_t *eap_tls_plugin_get_cache();
+
 #endif /** EAP_TLS_PLUGIN_H_ @}*/
@@ -204,6 +204,53 @@ METHOD(ha_cache_t, delete_, void,
 	}
 }
 
+METHOD(ha_cache_t, get_mid, u_int32_t,
+	private_ha_cache_t *this, ike_sa_t *ike_sa, bool initiator,
+	u_int32_t *base)
+{
+	ha_message_attribute_t attribute;
+	ha_message_value_t value;
+	enumerator_t *enumerator;
+	ha_message_t *message = NULL;
+	entry_t *entry;
+	u_int32_t mid = 0;
+
+	if (base)
+	{
+		*base = 0;
+	}
+	this->mutex->lock(this->mutex);
+	entry = this->cache->get(this->cache, ike_sa);
+	if (entry)
+	{
+		message = initiator ? entry->midi : entry->midr;
+	}
+	if (message)
+	{
+		enumerator = message->create_attribute_enumerator(message);
+		while (enumerator->enumerate(enumerator, &attribute, &value))
+		{
+			switch (attribute)
+			{
+				case HA_MID:
+					mid = value.u32;
+					break;
+				case HA_MID_BASE:
+					if (base)
+					{
+						*base = value.u32;
+					}
+					break;
+				default:
+					break;
+			}
+		}
+		enumerator->destroy(enumerator);
+	}
+	this->mutex->unlock(this->mutex);
+	return mid;
+}
+
 /**
  * Rekey all children of an IKE_SA
  */
@@ -374,6 +421,7 @@ ha_cache_t *ha_cache_create(ha_kernel_t *kernel, ha_socket_t *socket,
 		.public = {
 			.cache = _cache,
 			.delete = _delete_,
+			.get_mid = _get_mid,
 			.resync = _resync,
 			.destroy = _destroy,
 		},
@@ -51,6 +51,18 @@ struct ha_cache_t {
 	 */
 	void (*delete)(ha_cache_t *this, ike_sa_t *ike_sa);
 
+	/**
+	 * Get the message ID last cached for an IKE_SA.
+	 *
+	 * @param ike_sa		IKE_SA to look up
+	 * @param initiator		TRUE for the initiator, FALSE for responder MID
+	 * @param base			message ID following the lowest DPD the cached
+	 *						one covers, 0 if none, NULL to ignore
+	 * @return				cached message ID, 0 if none cached
+	 */
+	u_int32_t (*get_mid)(ha_cache_t *this, ike_sa_t *ike_sa, bool initiator,
+						 u_int32_t *base);
+
 	/**
 	 * Resync a segment to the node using the cached messages.
 	 *
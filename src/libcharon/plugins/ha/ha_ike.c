@@ -17,6 +17,13 @@
 
 #include <sa/ikev2/keymat_v2.h>
 #include <sa/ikev1/keymat_v1.h>
+#include <collections/hashtable.h>
+#include <threading/mutex.h>
+
+/**
+ * Default number of message IDs covered by a lazy message ID sync
+ */
+#define DEFAULT_MID_WINDOW 16
 
 typedef struct private_ha_ike_t private_ha_ike_t;
 
@@ -44,8 +51,58 @@ struct private_ha_ike_t {
 	 * message cache
 	 */
 	ha_cache_t *cache;
+
+	/**
+	 * Number of message IDs a synced high-water mark is ahead, 0 to sync all
+	 */
+	u_int mid_window;
+
+	/**
+	 * Taken over IKEv2 SAs, ike_sa_t => MID following the lowest DPD synced
+	 */
+	hashtable_t *takeover;
+
+	/**
+	 * Mutex to lock takeover table
+	 */
+	mutex_t *mutex;
 };
 
+/**
+ * Hashtable hash function
+ */
+static u_int hash(void *key)
+{
+	return (uintptr_t)key;
+}
+
+/**
+ * Hashtable equals function
+ */
+static bool equals(void *a, void *b)
+{
+	return a == b;
+}
+
+/**
+ * Check if a message is an IKEv2 DPD, an INFORMATIONAL without payloads
+ */
+static bool is_dpd(message_t *message)
+{
+	enumerator_t *enumerator;
+	payload_t *payload;
+	bool dpd;
+
+	if (message->get_exchange_type(message) != INFORMATIONAL)
+	{
+		return FALSE;
+	}
+	enumerator = message->create_payload_enumerator(message);
+	dpd = !enumerator->enumerate(enumerator, &payload);
+	enumerator->destroy(enumerator);
+	return dpd;
+}
+
 /**
  * Return condition if it is set on ike_sa
  */
@@ -233,14 +290,111 @@ METHOD(listener_t, ike_rekey, bool,
 METHOD(listener_t, ike_state_change, bool,
 	private_ha_ike_t *this, ike_sa_t *ike_sa, ike_sa_state_t new)
 {
+	u_int32_t base;
+
 	/* delete any remaining cache entry if IKE_SA gets destroyed */
 	if (new == IKE_DESTROYING)
 	{
 		this->cache->delete(this->cache, ike_sa);
 	}
+	this->mutex->lock(this->mutex);
+	this->takeover->remove(this->takeover, ike_sa);
+	this->mutex->unlock(this->mutex);
+	if (new == IKE_ESTABLISHED && ike_sa->get_state(ike_sa) == IKE_PASSIVE &&
+		ike_sa->get_version(ike_sa) == IKEV2)
+	{	/* taking over, the synced MID might be ahead of the peer's DPDs */
+		if (this->cache->get_mid(this->cache, ike_sa, FALSE, &base) && base)
+		{
+			this->mutex->lock(this->mutex);
+			this->takeover->put(this->takeover, ike_sa, (void*)(uintptr_t)base);
+			this->mutex->unlock(this->mutex);
+		}
+	}
 	return TRUE;
 }
 
+METHOD(listener_t, alert, bool,
+	private_ha_ike_t *this, ike_sa_t *ike_sa, alert_t alert, va_list args)
+{
+	message_t *message;
+	u_int32_t mid, expected, base;
+	bool adopt = FALSE;
+
+	if (alert == ALERT_UNEXPECTED_MESSAGE_ID && ike_sa)
+	{
+		message = va_arg(args, message_t*);
+		expected = va_arg(args, u_int32_t);
+		mid = message->get_message_id(message);
+		if (!is_dpd(message))
+		{	/* other requests might not be idempotent, never process them
+			 * again */
+			return TRUE;
+		}
+
+		/* the previously active node synced a MID ahead of the peer's DPDs,
+		 * or the peer retransmits the last DPD it answered. All requests
+		 * from the DPD preceding base up to the synced MID have been DPDs,
+		 * so we can process them again. Only once, a request processed
+		 * normally ends this. */
+		this->mutex->lock(this->mutex);
+		base = (uintptr_t)this->takeover->get(this->takeover, ike_sa);
+		if (base && (int32_t)(mid + 1 - base) >= 0 &&
+			(int32_t)(mid - expected) < 0)
+		{
+			this->takeover->remove(this->takeover, ike_sa);
+			adopt = TRUE;
+		}
+		this->mutex->unlock(this->mutex);
+		if (adopt)
+		{
+			DBG1(DBG_CFG, "adopting message ID %u of taken over IKE_SA", mid);
+			ike_sa->set_message_id(ike_sa, FALSE, mid);
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Send a message ID sync message, base follows the lowest DPD it covers
+ */
+static void sync_mid(private_ha_ike_t *this, ike_sa_t *ike_sa, bool initiator,
+					 u_int32_t mid, u_int32_t base)
+{
+	ha_message_t *m;
+
+	if (initiator)
+	{
+		m = ha_message_create(HA_IKE_MID_INITIATOR);
+	}
+	else
+	{
+		m = ha_message_create(HA_IKE_MID_RESPONDER);
+	}
+	m->add_attribute(m, HA_IKE_ID, ike_sa->get_id(ike_sa));
+	m->add_attribute(m, HA_MID, mid);
+	if (base)
+	{
+		m->add_attribute(m, HA_MID_BASE, base);
+	}
+	this->socket->push(this->socket, m);
+	this->cache->cache(this->cache, ike_sa, m);
+}
+
+/**
+ * Sync a message ID lazily, as a high-water mark mid_window ahead.
+ */
+static void sync_mid_lazy(private_ha_ike_t *this, ike_sa_t *ike_sa,
+						  bool initiator, u_int32_t mid, u_int32_t base)
+{
+	u_int32_t hwm;
+
+	hwm = this->cache->get_mid(this->cache, ike_sa, initiator, NULL);
+	if (!hwm || (int32_t)(hwm - mid) < 0)
+	{
+		sync_mid(this, ike_sa, initiator, mid + this->mid_window, base);
+	}
+}
+
 /**
  * Send a virtual IP sync message for remote VIPs
  */
@@ -273,6 +427,8 @@ METHOD(listener_t, message_hook, bool,
 	private_ha_ike_t *this, ike_sa_t *ike_sa, message_t *message,
 	bool incoming, bool plain)
 {
+	u_int32_t mid;
+
 	if (this->tunnel && this->tunnel->is_sa(this->tunnel, ike_sa))
 	{	/* do not sync SA between nodes */
 		return TRUE;
@@ -283,20 +439,30 @@ METHOD(listener_t, message_hook, bool,
 		if (message->get_exchange_type(message) != IKE_SA_INIT &&
 			message->get_request(message))
 		{	/* we sync on requests, but skip it on IKE_SA_INIT */
-			ha_message_t *m;
-
-			if (incoming)
-			{
-				m = ha_message_create(HA_IKE_MID_RESPONDER);
+			mid = message->get_message_id(message) + 1;
+			if (!incoming)
+			{	/* the peer rejects requests with a MID we skipped ahead */
+				sync_mid(this, ike_sa, TRUE, mid, 0);
 			}
 			else
 			{
-				m = ha_message_create(HA_IKE_MID_INITIATOR);
+				/* a request processed normally ends adopting DPDs */
+				this->mutex->lock(this->mutex);
+				this->takeover->remove(this->takeover, ike_sa);
+				this->mutex->unlock(this->mutex);
+				if (!is_dpd(message))
+				{	/* a replay must not get processed again */
+					sync_mid(this, ike_sa, FALSE, mid, 0);
+				}
+				else if (this->mid_window)
+				{	/* a node taking over adopts DPDs below the mark */
+					sync_mid_lazy(this, ike_sa, FALSE, mid, mid);
+				}
+				else
+				{	/* a node taking over answers a retransmit of the DPD */
+					sync_mid(this, ike_sa, FALSE, mid, mid);
+				}
 			}
-			m->add_attribute(m, HA_IKE_ID, ike_sa->get_id(ike_sa));
-			m->add_attribute(m, HA_MID, message->get_message_id(message) + 1);
-			this->socket->push(this->socket, m);
-			this->cache->cache(this->cache, ike_sa, m);
 		}
 		if (ike_sa->get_state(ike_sa) == IKE_ESTABLISHED &&
 			message->get_exchange_type(message) == IKE_AUTH &&
@@ -311,7 +477,6 @@ METHOD(listener_t, message_hook, bool,
 	{
 		ha_message_t *m;
 		keymat_v1_t *keymat;
-		u_int32_t mid;
 		chunk_t iv;
 
 		mid = message->get_message_id(message);
@@ -335,10 +500,8 @@ METHOD(listener_t, message_hook, bool,
 	if (plain && ike_sa->get_version(ike_sa) == IKEV1 &&
 		message->get_exchange_type(message) == INFORMATIONAL_V1)
 	{
-		ha_message_t *m;
 		notify_payload_t *notify;
 		chunk_t data;
-		u_int32_t seq;
 
 		notify = message->get_notify(message, DPD_R_U_THERE);
 		if (notify)
@@ -346,19 +509,17 @@ METHOD(listener_t, message_hook, bool,
 			data = notify->get_notification_data(notify);
 			if (data.len == 4)
 			{
-				seq = untoh32(data.ptr);
-				if (incoming)
+				mid = untoh32(data.ptr) + 1;
+				if (!this->mid_window)
 				{
-					m = ha_message_create(HA_IKE_MID_RESPONDER);
+					sync_mid(this, ike_sa, !incoming, mid, 0);
 				}
-				else
-				{
-					m = ha_message_create(HA_IKE_MID_INITIATOR);
+				else if (!incoming)
+				{	/* skipping ahead with DPD sequence numbers is fine */
+					sync_mid_lazy(this, ike_sa, TRUE, mid, 0);
 				}
-				m->add_attribute(m, HA_IKE_ID, ike_sa->get_id(ike_sa));
-				m->add_attribute(m, HA_MID, seq + 1);
-				this->socket->push(this->socket, m);
-				this->cache->cache(this->cache, ike_sa, m);
+				/* a passive IKE_SA never synced accepts any DPD sequence
+				 * number from the peer, no need to sync it lazily */
 			}
 		}
 	}
@@ -368,6 +529,8 @@ METHOD(listener_t, message_hook, bool,
 METHOD(ha_ike_t, destroy, void,
 	private_ha_ike_t *this)
 {
+	this->takeover->destroy(this->takeover);
+	this->mutex->destroy(this->mutex);
 	free(this);
 }
 
@@ -382,6 +545,7 @@ ha_ike_t *ha_ike_create(ha_socket_t *socket, ha_tunnel_t *tunnel,
 	INIT(this,
 		.public = {
 			.listener = {
+				.alert = _alert,
 				.ike_keys = _ike_keys,
 				.ike_updown = _ike_updown,
 				.ike_rekey = _ike_rekey,
@@ -393,6 +557,10 @@ ha_ike_t *ha_ike_create(ha_socket_t *socket, ha_tunnel_t *tunnel,
 		.socket = socket,
 		.tunnel = tunnel,
 		.cache = cache,
+		.mid_window = lib->settings->get_int(lib->settings,
+				"%s.plugins.ha.mid_window", DEFAULT_MID_WINDOW, charon->name),
+		.takeover = hashtable_create(hash, equals, 8),
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 	);
 
 	return &this->public;
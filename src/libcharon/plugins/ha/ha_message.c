@@ -254,6 +254,7 @@ METHOD(ha_message_t, add_attribute, void,
 		case HA_INBOUND_SPI:
 		case HA_OUTBOUND_SPI:
 		case HA_MID:
+		case HA_MID_BASE:
 		{
 			u_int32_t val;
 
@@ -475,6 +476,7 @@ METHOD(enumerator_t, attribute_enumerate, bool,
 		case HA_INBOUND_SPI:
 		case HA_OUTBOUND_SPI:
 		case HA_MID:
+		case HA_MID_BASE:
 		{
 			if (this->buf.len < sizeof(u_int32_t))
 			{
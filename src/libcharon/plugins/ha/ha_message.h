@@ -30,7 +30,7 @@
 /**
  * Protocol version of this implementation
  */
-#define HA_MESSAGE_VERSION 3
+#define HA_MESSAGE_VERSION 4
 
 typedef struct ha_message_t ha_message_t;
 typedef enum ha_message_type_t ha_message_type_t;
@@ -154,6 +154,8 @@ enum ha_message_attribute_t {
 	HA_PSK,
 	/** chunk_t, IV for next IKEv1 message */
 	HA_IV,
+	/** u_int32_t, message ID following the lowest DPD a HA_MID covers */
+	HA_MID_BASE,
 };
 
 /**
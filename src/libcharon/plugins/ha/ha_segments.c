@@ -95,13 +95,18 @@ struct private_ha_segments_t {
 	 * Interval to check for autobalance, 0 to disable
 	 */
 	int autobalance;
+
+	/**
+	 * Number of IKE_SA table segments, switched in parallel on takeover
+	 */
+	u_int table_segments;
 };
 
 /**
  * Log currently active segments
  */
 static void log_segments(private_ha_segments_t *this, bool activated,
-						 u_int segment)
+						 u_int segment, u_int sas)
 {
 	char buf[64] = "none", *pos = buf;
 	int i;
@@ -122,83 +127,247 @@ static void log_segments(private_ha_segments_t *this, bool activated,
 			pos += snprintf(pos, buf + sizeof(buf) - pos, "%d", i);
 		}
 	}
-	DBG1(DBG_CFG, "HA segment %d %sactivated, now active: %s",
-		 segment, activated ? "" : "de", buf);
+	DBG1(DBG_CFG, "HA segment %d %sactivated (%u IKE_SAs), now active: %s",
+		 segment, activated ? "" : "de", sas, buf);
 }
 
 /**
- * Enable/Disable a specific segment
+ * State shared by the threads switching IKE_SA states in parallel
  */
-static void enable_disable(private_ha_segments_t *this, u_int segment,
-						   bool enable, bool notify)
+typedef struct {
+	/** segments object */
+	private_ha_segments_t *segments;
+	/** segments to switch */
+	segment_mask_t mask;
+	/** state to switch from */
+	ike_sa_state_t old;
+	/** state to switch to */
+	ike_sa_state_t new;
+	/** next part of the IKE_SA table to switch */
+	u_int next;
+	/** number of parts the IKE_SA table is split into */
+	u_int parts;
+	/** number of parts switched completely */
+	u_int done;
+	/** number of IKE_SAs switched, per segment */
+	u_int sas[SEGMENTS_MAX];
+	/** mutex to lock this context */
+	mutex_t *mutex;
+	/** condvar to signal completed parts */
+	condvar_t *condvar;
+	/** reference count, jobs might start after the switch completed */
+	refcount_t ref;
+} switch_t;
+
+/**
+ * Release a reference to a switch context
+ */
+static void switch_destroy(switch_t *this)
 {
-	ike_sa_t *ike_sa;
+	if (ref_put(&this->ref))
+	{
+		this->condvar->destroy(this->condvar);
+		this->mutex->destroy(this->mutex);
+		free(this);
+	}
+}
+
+/**
+ * Switch the state of IKE_SAs in parts of the IKE_SA table, while they are
+ * checked out by the enumerator, until no parts are left
+ */
+static void switch_parts(switch_t *this)
+{
+	private_ha_segments_t *segments = this->segments;
+	u_int sas[SEGMENTS_MAX], part, segment, i;
 	enumerator_t *enumerator;
-	ike_sa_state_t old, new;
-	ha_message_t *message = NULL;
-	ha_message_type_t type;
-	bool changes = FALSE;
+	ike_sa_t *ike_sa;
+
+	while (TRUE)
+	{
+		this->mutex->lock(this->mutex);
+		if (this->next >= this->parts)
+		{
+			this->mutex->unlock(this->mutex);
+			return;
+		}
+		part = this->next++;
+		this->mutex->unlock(this->mutex);
+
+		memset(sas, 0, sizeof(sas));
+		enumerator = charon->ike_sa_manager->create_part_enumerator(
+								charon->ike_sa_manager, TRUE, part, this->parts);
+		while (enumerator->enumerate(enumerator, &ike_sa))
+		{
+			if (ike_sa->get_state(ike_sa) != this->old)
+			{
+				continue;
+			}
+			if (segments->tunnel &&
+				segments->tunnel->is_sa(segments->tunnel, ike_sa))
+			{
+				continue;
+			}
+			segment = segments->kernel->get_segment(segments->kernel,
+											ike_sa->get_other_host(ike_sa));
+			if (this->mask & SEGMENTS_BIT(segment))
+			{
+				ike_sa->set_state(ike_sa, this->new);
+				sas[segment - 1]++;
+			}
+		}
+		enumerator->destroy(enumerator);
+
+		this->mutex->lock(this->mutex);
+		for (i = 0; i < SEGMENTS_MAX; i++)
+		{
+			this->sas[i] += sas[i];
+		}
+		this->done++;
+		this->condvar->signal(this->condvar);
+		this->mutex->unlock(this->mutex);
+	}
+}
+
+/**
+ * Job switching IKE_SA states
+ */
+static job_requeue_t switch_job(switch_t *this)
+{
+	switch_parts(this);
+	return JOB_REQUEUE_NONE;
+}
+
+/**
+ * Switch the state of all IKE_SAs in the given segments. Idle threads
+ * switch parts of the IKE_SA table in parallel, the calling thread does so
+ * too, so we complete even if no thread is available.
+ */
+static void switch_states(private_ha_segments_t *this, segment_mask_t mask,
+						  ike_sa_state_t old, ike_sa_state_t new, u_int sas[])
+{
+	timeval_t start, end;
+	switch_t *ctx;
+	u_int workers, total = 0, ms, i;
+
+	INIT(ctx,
+		.segments = this,
+		.mask = mask,
+		.old = old,
+		.new = new,
+		.parts = min(this->table_segments,
+					 lib->processor->get_idle_threads(lib->processor) + 1),
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+		.condvar = condvar_create(CONDVAR_TYPE_DEFAULT),
+		.ref = 1,
+	);
 
-	if (segment > this->count)
+	time_monotonic(&start);
+	for (workers = ctx->parts - 1; workers; workers--)
 	{
-		return;
+		ref_get(&ctx->ref);
+		lib->processor->queue_job(lib->processor,
+			(job_t*)callback_job_create_with_prio((callback_job_cb_t)switch_job,
+				ctx, (void*)switch_destroy, NULL, JOB_PRIO_CRITICAL));
 	}
+	switch_parts(ctx);
+
+	ctx->mutex->lock(ctx->mutex);
+	while (ctx->done < ctx->parts)
+	{
+		ctx->condvar->wait(ctx->condvar, ctx->mutex);
+	}
+	ctx->mutex->unlock(ctx->mutex);
+	time_monotonic(&end);
+	timersub(&end, &start, &end);
+	ms = end.tv_sec * 1000 + end.tv_usec / 1000;
+
+	for (i = 0; i < SEGMENTS_MAX; i++)
+	{
+		sas[i] = ctx->sas[i];
+		total += sas[i];
+	}
+	DBG1(DBG_CFG, "switched %u IKE_SAs to %N in %ums total, using %u threads",
+		 total, ike_sa_state_names, new, ms, ctx->parts);
+	switch_destroy(ctx);
+}
+
+/**
+ * Enable/Disable a set of segments
+ */
+static void enable_disable(private_ha_segments_t *this, segment_mask_t mask,
+						   bool enable, bool notify)
+{
+	ike_sa_state_t old, new;
+	ha_message_t *message = NULL;
+	ha_message_type_t type;
+	segment_mask_t changes = 0;
+	u_int sas[SEGMENTS_MAX] = {};
+	int i;
 
 	if (enable)
 	{
 		old = IKE_PASSIVE;
 		new = IKE_ESTABLISHED;
 		type = HA_SEGMENT_TAKE;
-		if (!(this->active & SEGMENTS_BIT(segment)))
-		{
-			this->active |= SEGMENTS_BIT(segment);
-			this->kernel->activate(this->kernel, segment);
-			changes = TRUE;
-		}
 	}
 	else
 	{
 		old = IKE_ESTABLISHED;
 		new = IKE_PASSIVE;
 		type = HA_SEGMENT_DROP;
-		if (this->active & SEGMENTS_BIT(segment))
+	}
+
+	for (i = 1; i <= this->count; i++)
+	{
+		if (!(mask & SEGMENTS_BIT(i)))
+		{
+			continue;
+		}
+		if (enable && !(this->active & SEGMENTS_BIT(i)))
 		{
-			this->active &= ~SEGMENTS_BIT(segment);
-			this->kernel->deactivate(this->kernel, segment);
-			changes = TRUE;
+			this->active |= SEGMENTS_BIT(i);
+			this->kernel->activate(this->kernel, i);
+			changes |= SEGMENTS_BIT(i);
+		}
+		if (!enable && (this->active & SEGMENTS_BIT(i)))
+		{
+			this->active &= ~SEGMENTS_BIT(i);
+			this->kernel->deactivate(this->kernel, i);
+			changes |= SEGMENTS_BIT(i);
 		}
 	}
 
 	if (changes)
 	{
-		enumerator = charon->ike_sa_manager->create_enumerator(
-												charon->ike_sa_manager, TRUE);
-		while (enumerator->enumerate(enumerator, &ike_sa))
+		switch_states(this, changes, old, new, sas);
+		for (i = 1; i <= this->count; i++)
 		{
-			if (ike_sa->get_state(ike_sa) != old)
-			{
-				continue;
-			}
-			if (this->tunnel && this->tunnel->is_sa(this->tunnel, ike_sa))
+			if (changes & SEGMENTS_BIT(i))
 			{
-				continue;
-			}
-			if (this->kernel->get_segment(this->kernel,
-									ike_sa->get_other_host(ike_sa)) == segment)
-			{
-				ike_sa->set_state(ike_sa, new);
+				log_segments(this, enable, i, sas[i - 1]);
 			}
 		}
-		enumerator->destroy(enumerator);
-		log_segments(this, enable, segment);
 	}
 
 	if (notify)
 	{
-		message = ha_message_create(type);
-		message->add_attribute(message, HA_SEGMENT, segment);
-		this->socket->push(this->socket, message);
-		message->destroy(message);
+		for (i = 1; i <= this->count; i++)
+		{
+			if (mask & SEGMENTS_BIT(i))
+			{
+				if (!message)
+				{
+					message = ha_message_create(type);
+				}
+				message->add_attribute(message, HA_SEGMENT, i);
+			}
+		}
+		if (message)
+		{
+			this->socket->push(this->socket, message);
+			message->destroy(message);
+		}
 	}
 }
 
@@ -208,20 +377,22 @@ static void enable_disable(private_ha_segments_t *this, u_int segment,
 static void enable_disable_all(private_ha_segments_t *this, u_int segment,
 							   bool enable, bool notify)
 {
+	segment_mask_t mask = 0;
 	int i;
 
-	this->mutex->lock(this->mutex);
 	if (segment == 0)
 	{
 		for (i = 1; i <= this->count; i++)
 		{
-			enable_disable(this, i, enable, notify);
+			mask |= SEGMENTS_BIT(i);
 		}
 	}
-	else
+	else if (segment <= this->count)
 	{
-		enable_disable(this, segment, enable, notify);
+		mask = SEGMENTS_BIT(segment);
 	}
+	this->mutex->lock(this->mutex);
+	enable_disable(this, mask, enable, notify);
 	this->mutex->unlock(this->mutex);
 }
 
@@ -309,12 +480,12 @@ METHOD(ha_segments_t, handle_status, void,
 			if (this->node == i % 2)
 			{
 				DBG1(DBG_CFG, "HA segment %d was not handled, taking", i);
-				enable_disable(this, i, TRUE, TRUE);
+				enable_disable(this, SEGMENTS_BIT(i), TRUE, TRUE);
 			}
 			else
 			{
 				DBG1(DBG_CFG, "HA segment %d was not handled, dropping", i);
-				enable_disable(this, i, FALSE, TRUE);
+				enable_disable(this, SEGMENTS_BIT(i), FALSE, TRUE);
 			}
 		}
 		if (twice & SEGMENTS_BIT(i))
@@ -322,12 +493,12 @@ METHOD(ha_segments_t, handle_status, void,
 			if (this->node == i % 2)
 			{
 				DBG1(DBG_CFG, "HA segment %d was handled twice, taking", i);
-				enable_disable(this, i, TRUE, TRUE);
+				enable_disable(this, SEGMENTS_BIT(i), TRUE, TRUE);
 			}
 			else
 			{
 				DBG1(DBG_CFG, "HA segment %d was handled twice, dropping", i);
-				enable_disable(this, i, FALSE, TRUE);
+				enable_disable(this, SEGMENTS_BIT(i), FALSE, TRUE);
 			}
 		}
 	}
@@ -403,7 +574,7 @@ static job_requeue_t autobalance(private_ha_segments_t *this)
 			{
 				DBG1(DBG_CFG, "autobalancing HA (%d/%d active), taking %d",
 					 active, this->count, i);
-				enable_disable(this, i, TRUE, TRUE);
+				enable_disable(this, SEGMENTS_BIT(i), TRUE, TRUE);
 				/* we claim only one in each interval */
 				break;
 			}
@@ -476,6 +647,8 @@ ha_segments_t *ha_segments_create(ha_socket_t *socket, ha_kernel_t *kernel,
 				charon->name),
 		.autobalance = lib->settings->get_int(lib->settings,
 				"%s.plugins.ha.autobalance", 0, charon->name),
+		.table_segments = max(1, lib->settings->get_int(lib->settings,
+				"%s.ikesa_table_segments", 1, charon->name)),
 	);
 
 	if (monitor)
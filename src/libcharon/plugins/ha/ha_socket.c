@@ -18,15 +18,90 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
 #include <errno.h>
 #include <unistd.h>
 
 #include <daemon.h>
 #include <networking/host.h>
 #include <threading/thread.h>
+#include <threading/mutex.h>
+#include <threading/condvar.h>
+#include <collections/linked_list.h>
 #include <processing/jobs/callback_job.h>
 
+/**
+ * Default maximum size of a datagram carrying a batch of messages
+ */
+#define DEFAULT_BATCH_SIZE 1400
+
+/**
+ * Default number of unacknowledged batches in flight
+ */
+#define DEFAULT_WINDOW 32
+
+/**
+ * Default maximum number of batches queued for transmission
+ */
+#define DEFAULT_QUEUE_SIZE 1024
+
+/**
+ * Default time in ms to wait for an acknowledgement before retransmitting
+ */
+#define DEFAULT_RETRANSMIT_TIMEOUT 200
+
+/**
+ * Default number of retransmissions before giving up on unacknowledged batches
+ */
+#define DEFAULT_RETRANSMIT_TRIES 10
+
+/**
+ * Number of duplicate acknowledgements triggering a fast retransmission
+ */
+#define DUPLICATE_ACKS 3
+
+/**
+ * Maximum size of a received datagram
+ */
+#define MAX_DATAGRAM 65535
+
 typedef struct private_ha_socket_t private_ha_socket_t;
+typedef struct batch_header_t batch_header_t;
+
+/**
+ * Header of a datagram, followed by count messages, each prefixed with its
+ * length as 16-bit integer
+ */
+struct batch_header_t {
+	/** protocol version, HA_MESSAGE_VERSION */
+	u_int8_t version;
+	/** reserved, zero */
+	u_int8_t reserved;
+	/** number of messages, zero for a datagram just acknowledging */
+	u_int16_t count;
+	/** random identifier of the sending session */
+	u_int32_t session;
+	/** sequence number of this batch */
+	u_int32_t seq;
+	/** oldest sequence number the sender still retransmits */
+	u_int32_t base;
+	/** session of the peer we acknowledge */
+	u_int32_t ack_session;
+	/** highest sequence number of the peer received in order */
+	u_int32_t ack;
+} __attribute__((packed));
+
+/**
+ * A batch of coalesced messages
+ */
+typedef struct {
+	/** sequence number, assigned when the batch gets closed */
+	u_int32_t seq;
+	/** number of messages in batch */
+	u_int16_t count;
+	/** encoded batch, including header */
+	chunk_t data;
+} batch_t;
 
 /**
  * Private data of an ha_socket_t object.
@@ -52,80 +127,545 @@ struct private_ha_socket_t {
 	 * remote host to receive/send to
 	 */
 	host_t *remote;
+
+	/**
+	 * Mutex to lock send and acknowledgement state
+	 */
+	mutex_t *mutex;
+
+	/**
+	 * Condvar to wake up the sending thread
+	 */
+	condvar_t *condvar;
+
+	/**
+	 * Closed batches not yet acknowledged, batch_t, oldest first
+	 */
+	linked_list_t *queue;
+
+	/**
+	 * Number of batches at the head of queue that have been sent
+	 */
+	u_int inflight;
+
+	/**
+	 * Batch currently filled with pushed messages, if any
+	 */
+	batch_t *current;
+
+	/**
+	 * Sequence number of the next batch closed
+	 */
+	u_int32_t seq;
+
+	/**
+	 * Our random session identifier
+	 */
+	u_int32_t session;
+
+	/**
+	 * Time the oldest batch in flight has been (re-)transmitted
+	 */
+	timeval_t sent;
+
+	/**
+	 * Number of retransmissions of the batches in flight
+	 */
+	u_int retransmits;
+
+	/**
+	 * Number of acknowledgements received not acknowledging new batches
+	 */
+	u_int dupacks;
+
+	/**
+	 * Number of batches dropped because the queue was full
+	 */
+	u_int dropped;
+
+	/**
+	 * Do we have to acknowledge received batches?
+	 */
+	bool ack_pending;
+
+	/**
+	 * Session identifier of the peer
+	 */
+	u_int32_t rx_session;
+
+	/**
+	 * Next sequence number expected from the peer
+	 */
+	u_int32_t rx_seq;
+
+	/**
+	 * Received messages not yet pulled, ha_message_t
+	 */
+	linked_list_t *received;
+
+	/**
+	 * Buffer to receive datagrams
+	 */
+	u_char *buf;
+
+	/**
+	 * Datagrams to send, used by the sending thread only
+	 */
+	chunk_t *out;
+
+	/**
+	 * Maximum size of a batch
+	 */
+	u_int batch_size;
+
+	/**
+	 * Maximum number of batches in flight
+	 */
+	u_int window;
+
+	/**
+	 * Maximum number of batches in queue
+	 */
+	u_int queue_size;
+
+	/**
+	 * Retransmission timeout in ms
+	 */
+	u_int retransmit_timeout;
+
+	/**
+	 * Number of retransmissions before giving up
+	 */
+	u_int retransmit_tries;
 };
 
 /**
- * Data to pass to the send_message() callback job
+ * Check if sequence number a is before b, handling overflows
  */
-typedef struct {
-	chunk_t chunk;
-	int fd;
-} job_data_t;
+static inline bool seq_before(u_int32_t a, u_int32_t b)
+{
+	return (int32_t)(a - b) < 0;
+}
 
 /**
- * Cleanup job data
+ * Create a batch with a buffer of the given size
  */
-static void job_data_destroy(job_data_t *this)
+static batch_t *batch_create(size_t size)
 {
-	free(this->chunk.ptr);
-	free(this);
+	batch_t *batch;
+
+	INIT(batch,
+		.data = chunk_alloc(size),
+	);
+	batch->data.len = sizeof(batch_header_t);
+	return batch;
 }
 
 /**
- * Callback to asynchronously send messages
+ * Destroy a batch
  */
-static job_requeue_t send_message(job_data_t *data)
+static void batch_destroy(batch_t *batch)
 {
-	if (send(data->fd, data->chunk.ptr, data->chunk.len, 0) < data->chunk.len)
-	{
-		DBG1(DBG_CFG, "pushing HA message failed: %s", strerror(errno));
+	free(batch->data.ptr);
+	free(batch);
+}
+
+/**
+ * Close the current batch and enqueue it for transmission, drop the oldest
+ * batch if the queue is full
+ */
+static void close_batch(private_ha_socket_t *this)
+{
+	batch_header_t *hdr;
+	batch_t *batch;
+
+	batch = this->current;
+	this->current = NULL;
+
+	batch->seq = this->seq++;
+	hdr = (batch_header_t*)batch->data.ptr;
+	*hdr = (batch_header_t){
+		.version = HA_MESSAGE_VERSION,
+		.count = htons(batch->count),
+		.session = htonl(this->session),
+		.seq = htonl(batch->seq),
+	};
+	this->queue->insert_last(this->queue, batch);
+
+	if (this->queue->get_count(this->queue) > this->queue_size)
+	{	/* newer messages are more relevant, the peer skips dropped batches
+		 * as they are before the base we announce */
+		this->queue->remove_first(this->queue, (void**)&batch);
+		batch_destroy(batch);
+		if (this->inflight)
+		{
+			this->inflight--;
+		}
+		if (!this->dropped++)
+		{
+			DBG1(DBG_CFG, "HA send queue full, dropping oldest batches");
+		}
 	}
-	return JOB_REQUEUE_NONE;
 }
 
 METHOD(ha_socket_t, push, void,
 	private_ha_socket_t *this, ha_message_t *message)
 {
 	chunk_t chunk;
+	u_int16_t len;
 
-	/* Try to send synchronously, but non-blocking. */
 	chunk = message->get_encoding(message);
-	if (send(this->fd, chunk.ptr, chunk.len, MSG_DONTWAIT) < chunk.len)
+	if (chunk.len > MAX_DATAGRAM - sizeof(batch_header_t) - sizeof(len))
+	{
+		DBG1(DBG_CFG, "HA %N message too large, not pushed",
+			 ha_message_type_names, message->get_type(message));
+		return;
+	}
+	len = htons(chunk.len);
+
+	this->mutex->lock(this->mutex);
+	if (this->current &&
+		this->current->data.len + sizeof(len) + chunk.len > this->batch_size)
+	{
+		close_batch(this);
+	}
+	if (!this->current)
 	{
-		if (errno == EAGAIN)
+		this->current = batch_create(max(this->batch_size,
+							sizeof(batch_header_t) + sizeof(len) + chunk.len));
+	}
+	memcpy(this->current->data.ptr + this->current->data.len,
+		   &len, sizeof(len));
+	this->current->data.len += sizeof(len);
+	memcpy(this->current->data.ptr + this->current->data.len,
+		   chunk.ptr, chunk.len);
+	this->current->data.len += chunk.len;
+	this->current->count++;
+	this->mutex->unlock(this->mutex);
+
+	this->condvar->signal(this->condvar);
+}
+
+/**
+ * Retransmit all batches in flight, or give up on them
+ */
+static void retransmit(private_ha_socket_t *this)
+{
+	batch_t *batch;
+
+	if (++this->retransmits > this->retransmit_tries)
+	{
+		DBG1(DBG_CFG, "HA peer does not acknowledge, dropping %d batches",
+			 this->queue->get_count(this->queue) + (this->current ? 1 : 0));
+		while (this->queue->remove_first(this->queue,
+										 (void**)&batch) == SUCCESS)
+		{
+			batch_destroy(batch);
+		}
+		if (this->current)
+		{
+			batch_destroy(this->current);
+			this->current = NULL;
+		}
+		this->retransmits = 0;
+		this->dropped = 0;
+	}
+	else
+	{
+		DBG2(DBG_CFG, "retransmitting %u HA batches", this->inflight);
+	}
+	this->inflight = 0;
+}
+
+/**
+ * Check if the sending thread has something to do
+ */
+static bool has_work(private_ha_socket_t *this)
+{
+	if (this->ack_pending)
+	{
+		return TRUE;
+	}
+	if (this->inflight >= this->window)
+	{
+		return FALSE;
+	}
+	return this->current ||
+		   this->queue->get_count(this->queue) > this->inflight;
+}
+
+/**
+ * Encode a batch for transmission, with current acknowledgement data
+ */
+static chunk_t encode_batch(private_ha_socket_t *this, batch_t *batch,
+							u_int32_t base)
+{
+	batch_header_t *hdr;
+	chunk_t data;
+
+	data = chunk_clone(batch->data);
+	hdr = (batch_header_t*)data.ptr;
+	hdr->base = htonl(base);
+	hdr->ack_session = htonl(this->rx_session);
+	hdr->ack = htonl(this->rx_seq - 1);
+	return data;
+}
+
+/**
+ * Encode a datagram just acknowledging received batches
+ */
+static chunk_t encode_ack(private_ha_socket_t *this)
+{
+	batch_header_t *hdr;
+	chunk_t data;
+
+	data = chunk_alloc(sizeof(batch_header_t));
+	hdr = (batch_header_t*)data.ptr;
+	*hdr = (batch_header_t){
+		.version = HA_MESSAGE_VERSION,
+		.session = htonl(this->session),
+		.ack_session = htonl(this->rx_session),
+		.ack = htonl(this->rx_seq - 1),
+	};
+	return data;
+}
+
+/**
+ * Sending thread, transmits batches and acknowledgements
+ */
+static job_requeue_t send_batches(private_ha_socket_t *this)
+{
+	enumerator_t *enumerator;
+	timeval_t now, deadline;
+	batch_t *batch;
+	u_int32_t base;
+	u_int i, count = 0;
+	bool oldstate;
+
+	this->mutex->lock(this->mutex);
+	thread_cleanup_push((void*)this->mutex->unlock, this->mutex);
+	while (TRUE)
+	{
+		if (this->inflight)
+		{
+			time_monotonic(&now);
+			deadline = this->sent;
+			timeval_add_ms(&deadline, this->retransmit_timeout);
+			if (!timercmp(&now, &deadline, <))
+			{
+				retransmit(this);
+			}
+		}
+		if (has_work(this))
+		{
+			break;
+		}
+		oldstate = thread_cancelability(TRUE);
+		if (this->inflight)
+		{
+			this->condvar->timed_wait_abs(this->condvar, this->mutex, deadline);
+		}
+		else
+		{
+			this->condvar->wait(this->condvar, this->mutex);
+		}
+		thread_cancelability(oldstate);
+	}
+
+	/* messages pushed while we were busy get coalesced into the current
+	 * batch, we close it only if it can be sent right away */
+	if (this->current && this->queue->get_count(this->queue) < this->window)
+	{
+		close_batch(this);
+	}
+	base = this->seq;
+	if (this->queue->get_first(this->queue, (void**)&batch) == SUCCESS)
+	{
+		base = batch->seq;
+	}
+	i = 0;
+	enumerator = this->queue->create_enumerator(this->queue);
+	while (i < this->window && enumerator->enumerate(enumerator, &batch))
+	{
+		if (i++ >= this->inflight)
+		{
+			this->out[count++] = encode_batch(this, batch, base);
+		}
+	}
+	enumerator->destroy(enumerator);
+	if (count && !this->inflight)
+	{
+		time_monotonic(&this->sent);
+	}
+	this->inflight = i;
+	if (!count && this->ack_pending)
+	{
+		this->out[count++] = encode_ack(this);
+	}
+	this->ack_pending = FALSE;
+	thread_cleanup_pop(TRUE);
+
+	/* send without holding the lock, send() might block if it acquires a
+	 * policy, while the threads pushing messages own an IKE_SA */
+	for (i = 0; i < count; i++)
+	{
+		if (send(this->fd, this->out[i].ptr, this->out[i].len, 0) <
+															this->out[i].len)
 		{
-			callback_job_t *job;
-			job_data_t *data;
+			DBG1(DBG_CFG, "pushing HA batch failed: %s", strerror(errno));
+		}
+		free(this->out[i].ptr);
+	}
+	return JOB_REQUEUE_DIRECT;
+}
 
-			/* Fallback to asynchronous transmission. This is required, as sendto()
-			 * is a blocking call if it acquires a policy. We could end up in a
-			 * deadlock, as we own an IKE_SA. */
-			INIT(data,
-				.chunk = chunk_clone(chunk),
-				.fd = this->fd,
-			);
+/**
+ * Remove batches acknowledged by the peer, count duplicate acknowledgements
+ * if the datagram carried no batch
+ */
+static void handle_ack(private_ha_socket_t *this, u_int32_t session,
+					   u_int32_t ack, bool pure)
+{
+	batch_t *batch;
+	bool acked = FALSE;
 
-			job = callback_job_create_with_prio((callback_job_cb_t)send_message,
-							data, (void*)job_data_destroy, NULL, JOB_PRIO_HIGH);
-			lib->processor->queue_job(lib->processor, (job_t*)job);
-			return;
+	if (session != this->session)
+	{
+		return;
+	}
+	while (this->queue->get_first(this->queue, (void**)&batch) == SUCCESS &&
+		   !seq_before(ack, batch->seq))
+	{
+		this->queue->remove_first(this->queue, (void**)&batch);
+		batch_destroy(batch);
+		if (this->inflight)
+		{
+			this->inflight--;
+		}
+		acked = TRUE;
+	}
+	if (acked)
+	{
+		if (this->dropped)
+		{
+			DBG1(DBG_CFG, "HA peer acknowledges again, dropped %u batches",
+				 this->dropped);
+			this->dropped = 0;
 		}
-		DBG1(DBG_CFG, "pushing HA message failed: %s", strerror(errno));
+		this->retransmits = 0;
+		this->dupacks = 0;
+		time_monotonic(&this->sent);
+		this->condvar->signal(this->condvar);
+	}
+	else if (pure && this->inflight && ++this->dupacks == DUPLICATE_ACKS)
+	{	/* the peer receives batches, but misses the oldest one in flight,
+		 * don't wait for the timeout to retransmit. Acknowledgements
+		 * piggybacked on batches of the peer are not duplicates, they just
+		 * repeat the current state. */
+		DBG2(DBG_CFG, "fast retransmitting %u HA batches", this->inflight);
+		this->inflight = 0;
+		time_monotonic(&this->sent);
+		this->condvar->signal(this->condvar);
+	}
+}
+
+/**
+ * Process a received datagram, queue contained messages if it is in order
+ */
+static void process_datagram(private_ha_socket_t *this, chunk_t data)
+{
+	batch_header_t *hdr;
+	ha_message_t *message;
+	u_int32_t session, seq, base;
+	u_int16_t count, len;
+
+	if (data.len < sizeof(batch_header_t))
+	{
+		DBG1(DBG_CFG, "HA datagram too short");
+		return;
+	}
+	hdr = (batch_header_t*)data.ptr;
+	if (hdr->version != HA_MESSAGE_VERSION)
+	{
+		DBG1(DBG_CFG, "HA datagram has version %d, expected %d",
+			 hdr->version, HA_MESSAGE_VERSION);
+		return;
+	}
+	count = ntohs(hdr->count);
+	session = ntohl(hdr->session);
+	seq = ntohl(hdr->seq);
+	base = ntohl(hdr->base);
+
+	this->mutex->lock(this->mutex);
+	handle_ack(this, ntohl(hdr->ack_session), ntohl(hdr->ack), !count);
+	if (!count)
+	{
+		this->mutex->unlock(this->mutex);
+		return;
+	}
+	if (session != this->rx_session)
+	{
+		DBG1(DBG_CFG, "HA peer started a new sync session");
+		this->rx_session = session;
+		/* earlier batches of the session might have been lost */
+		this->rx_seq = base;
+	}
+	else if (seq_before(this->rx_seq, base))
+	{
+		DBG1(DBG_CFG, "HA peer dropped %u unacknowledged batches",
+			 base - this->rx_seq);
+		this->rx_seq = base;
+	}
+	/* acknowledge in any case, our acknowledgement might have been lost */
+	this->ack_pending = TRUE;
+	if (seq != this->rx_seq)
+	{	/* duplicate or out of order, the peer retransmits in order */
+		this->mutex->unlock(this->mutex);
+		this->condvar->signal(this->condvar);
+		return;
+	}
+	this->rx_seq++;
+	this->mutex->unlock(this->mutex);
+	this->condvar->signal(this->condvar);
+
+	data = chunk_skip(data, sizeof(batch_header_t));
+	while (count--)
+	{
+		if (data.len < sizeof(len))
+		{
+			DBG1(DBG_CFG, "received invalid HA batch");
+			break;
+		}
+		memcpy(&len, data.ptr, sizeof(len));
+		len = ntohs(len);
+		data = chunk_skip(data, sizeof(len));
+		if (data.len < len)
+		{
+			DBG1(DBG_CFG, "received invalid HA batch");
+			break;
+		}
+		message = ha_message_parse(chunk_create(data.ptr, len));
+		if (message)
+		{
+			this->received->insert_last(this->received, message);
+		}
+		data = chunk_skip(data, len);
 	}
 }
 
 METHOD(ha_socket_t, pull, ha_message_t*,
 	private_ha_socket_t *this)
 {
-	while (TRUE)
+	ha_message_t *message;
+
+	while (this->received->remove_first(this->received,
+										(void**)&message) != SUCCESS)
 	{
-		ha_message_t *message;
-		char buf[1024];
 		bool oldstate;
 		ssize_t len;
 
 		oldstate = thread_cancelability(TRUE);
-		len = recv(this->fd, buf, sizeof(buf), 0);
+		len = recv(this->fd, this->buf, MAX_DATAGRAM, 0);
 		thread_cancelability(oldstate);
 		if (len <= 0)
 		{
@@ -141,12 +681,9 @@ METHOD(ha_socket_t, pull, ha_message_t*,
 					continue;
 			}
 		}
-		message = ha_message_parse(chunk_create(buf, len));
-		if (message)
-		{
-			return message;
-		}
+		process_datagram(this, chunk_create(this->buf, len));
 	}
+	return message;
 }
 
 /**
@@ -181,6 +718,23 @@ static bool open_socket(private_ha_socket_t *this)
 	return TRUE;
 }
 
+/**
+ * Create a random, non-zero session identifier
+ */
+static u_int32_t create_session()
+{
+	u_int32_t session = 0;
+	rng_t *rng;
+
+	rng = lib->crypto->create_rng(lib->crypto, RNG_WEAK);
+	if (!rng || !rng->get_bytes(rng, sizeof(session), (u_int8_t*)&session))
+	{
+		session = time_monotonic(NULL) ^ getpid();
+	}
+	DESTROY_IF(rng);
+	return session ?: 1;
+}
+
 METHOD(ha_socket_t, destroy, void,
 	private_ha_socket_t *this)
 {
@@ -190,6 +744,17 @@ METHOD(ha_socket_t, destroy, void,
 	}
 	DESTROY_IF(this->local);
 	DESTROY_IF(this->remote);
+	this->queue->destroy_function(this->queue, (void*)batch_destroy);
+	if (this->current)
+	{
+		batch_destroy(this->current);
+	}
+	this->received->destroy_offset(this->received,
+								   offsetof(ha_message_t, destroy));
+	this->condvar->destroy(this->condvar);
+	this->mutex->destroy(this->mutex);
+	free(this->buf);
+	free(this->out);
 	free(this);
 }
 
@@ -209,7 +774,30 @@ ha_socket_t *ha_socket_create(char *local, char *remote)
 		.local = host_create_from_dns(local, 0, HA_PORT),
 		.remote = host_create_from_dns(remote, 0, HA_PORT),
 		.fd = -1,
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+		.condvar = condvar_create(CONDVAR_TYPE_DEFAULT),
+		.queue = linked_list_create(),
+		.received = linked_list_create(),
+		.session = create_session(),
+		.seq = 1,
+		.buf = malloc(MAX_DATAGRAM),
+		.batch_size = lib->settings->get_int(lib->settings,
+				"%s.plugins.ha.batch_size", DEFAULT_BATCH_SIZE, charon->name),
+		.window = lib->settings->get_int(lib->settings,
+				"%s.plugins.ha.window", DEFAULT_WINDOW, charon->name),
+		.queue_size = lib->settings->get_int(lib->settings,
+				"%s.plugins.ha.queue_size", DEFAULT_QUEUE_SIZE, charon->name),
+		.retransmit_timeout = lib->settings->get_int(lib->settings,
+				"%s.plugins.ha.retransmit_timeout", DEFAULT_RETRANSMIT_TIMEOUT,
+				charon->name),
+		.retransmit_tries = lib->settings->get_int(lib->settings,
+				"%s.plugins.ha.retransmit_tries", DEFAULT_RETRANSMIT_TRIES,
+				charon->name),
 	);
+	this->batch_size = min(this->batch_size, MAX_DATAGRAM);
+	this->window = max(this->window, 1);
+	this->queue_size = max(this->queue_size, this->window);
+	this->out = calloc(this->window + 1, sizeof(chunk_t));
 
 	if (!this->local || !this->remote)
 	{
@@ -222,6 +810,9 @@ ha_socket_t *ha_socket_create(char *local, char *remote)
 		destroy(this);
 		return NULL;
 	}
+	lib->processor->queue_job(lib->processor,
+		(job_t*)callback_job_create_with_prio((callback_job_cb_t)send_batches,
+				this, NULL, (callback_job_cancel_t)return_false,
+				JOB_PRIO_CRITICAL));
 	return &this->public;
 }
-
@@ -28,13 +28,20 @@
 typedef struct ha_socket_t ha_socket_t;
 
 /**
- * Socket to send/received SA synchronization data
+ * Socket to send/received SA synchronization data.
+ *
+ * Pushed messages get coalesced into batches of up to batch_size bytes, sent
+ * by a dedicated thread. Batches carry sequence numbers, are acknowledged by
+ * the peer and retransmitted until acknowledged. At most queue_size batches
+ * are kept, the oldest get dropped if the peer does not keep up.
  */
 struct ha_socket_t {
 
 	/**
 	 * Push synchronization information to the responsible node.
 	 *
+	 * The message gets queued for transmission, the call does not block.
+	 *
 	 * @param message	message to send
 	 */
 	void (*push)(ha_socket_t *this, ha_message_t *message);
@@ -59,21 +59,12 @@ static FILE* make_connection()
 }
 
 /**
- * Initiate load-tests
+ * Copy the output of the daemon to stdout
  */
-static int initiate(unsigned int count, unsigned int delay)
+static int print_output(FILE *stream)
 {
-	FILE *stream;
 	char c;
 
-	stream = make_connection();
-	if (!stream)
-	{
-		return 1;
-	}
-
-	fprintf(stream, "%u %u\n", count, delay);
-
 	while (1)
 	{
 		fflush(stream);
@@ -92,13 +83,50 @@ static int initiate(unsigned int count, unsigned int delay)
 	return 0;
 }
 
+/**
+ * Initiate load-tests
+ */
+static int initiate(unsigned int count, unsigned int delay)
+{
+	FILE *stream;
+
+	stream = make_connection();
+	if (!stream)
+	{
+		return 1;
+	}
+	fprintf(stream, "%u %u\n", count, delay);
+	return print_output(stream);
+}
+
+/**
+ * Print the JSON report of the running load-test
+ */
+static int report()
+{
+	FILE *stream;
+
+	stream = make_connection();
+	if (!stream)
+	{
+		return 1;
+	}
+	fprintf(stream, "report\n");
+	return print_output(stream);
+}
+
 int main(int argc, char *argv[])
 {
 	if (argc >= 3 && strcmp(argv[1], "initiate") == 0)
 	{
 		return initiate(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 0);
 	}
+	if (argc >= 2 && strcmp(argv[1], "report") == 0)
+	{
+		return report();
+	}
 	fprintf(stderr, "Usage:\n");
 	fprintf(stderr, "  %s initiate <count> [<delay in ms>]\n", argv[0]);
+	fprintf(stderr, "  %s report\n", argv[0]);
 	return 1;
 }
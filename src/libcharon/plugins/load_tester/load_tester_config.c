@@ -726,6 +726,7 @@ METHOD(load_tester_config_t, destroy, void,
 load_tester_config_t *load_tester_config_create()
 {
 	private_load_tester_config_t *this;
+	char *proposal;
 
 	INIT(this,
 		.public = {
@@ -756,9 +757,15 @@ load_tester_config_t *load_tester_config_create()
 	this->responder = lib->settings->get_str(lib->settings,
 			"%s.plugins.load-tester.responder", "127.0.0.1", charon->name);
 
+	proposal = "aes128-sha1-modp768";
+	if (lib->settings->get_bool(lib->settings,
+			"%s.plugins.load-tester.null_crypto", FALSE, charon->name))
+	{	/* skip the DH calculation with NULL crypto, too */
+		proposal = "aes128-sha1-modpnull";
+	}
 	this->proposal = proposal_create_from_string(PROTO_IKE,
 				lib->settings->get_str(lib->settings,
-					"%s.plugins.load-tester.proposal", "aes128-sha1-modp768",
+					"%s.plugins.load-tester.proposal", proposal,
 					charon->name));
 	if (!this->proposal)
 	{	/* fallback */
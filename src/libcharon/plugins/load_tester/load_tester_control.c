@@ -14,6 +14,7 @@
  */
 
 #include "load_tester_control.h"
+#include "load_tester_stats.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -46,6 +47,11 @@ struct private_load_tester_control_t {
 	 * Load tester control stream service
 	 */
 	stream_service_t *service;
+
+	/**
+	 * Statistics to report
+	 */
+	load_tester_stats_t *stats;
 };
 
 /**
@@ -196,6 +202,12 @@ static bool on_accept(private_load_tester_control_t *this, stream_t *io)
 		fclose(stream);
 		return FALSE;
 	}
+	if (strpfx(buf, "report"))
+	{
+		this->stats->write_report(this->stats, stream);
+		fclose(stream);
+		return FALSE;
+	}
 	if (sscanf(buf, "%u %u", &count, &delay) < 1)
 	{
 		fclose(stream);
@@ -289,7 +301,7 @@ METHOD(load_tester_control_t, destroy, void,
 /**
  * See header
  */
-load_tester_control_t *load_tester_control_create()
+load_tester_control_t *load_tester_control_create(load_tester_stats_t *stats)
 {
 	private_load_tester_control_t *this;
 	char *uri;
@@ -298,6 +310,7 @@ load_tester_control_t *load_tester_control_create()
 		.public = {
 			.destroy = _destroy,
 		},
+		.stats = stats,
 	);
 
 	uri = lib->settings->get_str(lib->settings,
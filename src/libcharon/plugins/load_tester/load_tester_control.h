@@ -26,6 +26,9 @@
  */
 #define LOAD_TESTER_SOCKET IPSEC_PIDDIR "/charon.ldt"
 
+/* the header is used by the load-tester tool, don't include libstrongswan */
+struct load_tester_stats_t;
+
 typedef struct load_tester_control_t load_tester_control_t;
 
 /**
@@ -41,7 +44,10 @@ struct load_tester_control_t {
 
 /**
  * Create a load_tester_control instance.
+ *
+ * @param stats		statistics to report on request
  */
-load_tester_control_t *load_tester_control_create();
+load_tester_control_t *load_tester_control_create(
+										struct load_tester_stats_t *stats);
 
 #endif /** LOAD_TESTER_CONTROL_H_ @}*/
@@ -0,0 +1,604 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "load_tester_crypto.h"
+#include "load_tester_keys.h"
+
+#include <unistd.h>
+
+typedef struct null_crypter_t null_crypter_t;
+typedef struct null_aead_t null_aead_t;
+typedef struct null_signer_t null_signer_t;
+typedef struct null_prf_t null_prf_t;
+typedef struct null_rng_t null_rng_t;
+
+/**
+ * Plugin name the primitives get registered with
+ */
+#define PLUGIN_NAME "load-tester"
+
+/**
+ * Properties of a NULL crypter/AEAD algorithm
+ */
+static struct {
+	/** encryption algorithm */
+	encryption_algorithm_t algo;
+	/** block size, or ICV size for AEADs */
+	size_t block_size;
+	/** IV size */
+	size_t iv_size;
+	/** default key size, without salt */
+	size_t key_size;
+	/** size of the salt appended to the key of AEADs */
+	size_t salt_size;
+} crypters[] = {
+	{ ENCR_AES_CBC,			16,	16,	16,	0 },
+	{ ENCR_3DES,			 8,	 8,	24,	0 },
+}, aeads[] = {
+	{ ENCR_AES_GCM_ICV8,	 8,	 8,	16,	4 },
+	{ ENCR_AES_GCM_ICV12,	12,	 8,	16,	4 },
+	{ ENCR_AES_GCM_ICV16,	16,	 8,	16,	4 },
+	{ ENCR_AES_CCM_ICV8,	 8,	 8,	16,	3 },
+	{ ENCR_AES_CCM_ICV12,	12,	 8,	16,	3 },
+	{ ENCR_AES_CCM_ICV16,	16,	 8,	16,	3 },
+};
+
+/**
+ * Output and key sizes of NULL signers
+ */
+static struct {
+	/** integrity algorithm */
+	integrity_algorithm_t algo;
+	/** signature size */
+	size_t block_size;
+	/** key size */
+	size_t key_size;
+} signers[] = {
+	{ AUTH_HMAC_MD5_96,			12,	16 },
+	{ AUTH_HMAC_SHA1_96,		12,	20 },
+	{ AUTH_HMAC_SHA2_256_128,	16,	32 },
+	{ AUTH_HMAC_SHA2_384_192,	24,	48 },
+	{ AUTH_HMAC_SHA2_512_256,	32,	64 },
+	{ AUTH_AES_XCBC_96,			12,	16 },
+};
+
+/**
+ * Output and key sizes of NULL PRFs
+ */
+static struct {
+	/** pseudo random function */
+	pseudo_random_function_t algo;
+	/** output size */
+	size_t block_size;
+	/** key size */
+	size_t key_size;
+} prfs[] = {
+	{ PRF_HMAC_MD5,				16,	16 },
+	{ PRF_HMAC_SHA1,			20,	20 },
+	{ PRF_HMAC_SHA2_256,		32,	32 },
+	{ PRF_HMAC_SHA2_384,		48,	48 },
+	{ PRF_HMAC_SHA2_512,		64,	64 },
+	{ PRF_AES128_XCBC,			16,	16 },
+};
+
+/**
+ * A crypter passing data through
+ */
+struct null_crypter_t {
+
+	/**
+	 * Implements crypter_t
+	 */
+	crypter_t public;
+
+	/**
+	 * Block size
+	 */
+	size_t block_size;
+
+	/**
+	 * IV size
+	 */
+	size_t iv_size;
+
+	/**
+	 * Key size
+	 */
+	size_t key_size;
+};
+
+METHOD(crypter_t, crypter_crypt, bool,
+	null_crypter_t *this, chunk_t data, chunk_t iv, chunk_t *out)
+{
+	if (out)
+	{
+		*out = chunk_clone(data);
+	}
+	return TRUE;
+}
+
+METHOD(crypter_t, crypter_get_block_size, size_t,
+	null_crypter_t *this)
+{
+	return this->block_size;
+}
+
+METHOD(crypter_t, crypter_get_iv_size, size_t,
+	null_crypter_t *this)
+{
+	return this->iv_size;
+}
+
+METHOD(crypter_t, crypter_get_key_size, size_t,
+	null_crypter_t *this)
+{
+	return this->key_size;
+}
+
+/**
+ * Create a NULL crypter
+ */
+static crypter_t *null_crypter_create(encryption_algorithm_t algo,
+									  size_t key_size)
+{
+	null_crypter_t *this;
+	int i;
+
+	for (i = 0; i < countof(crypters); i++)
+	{
+		if (crypters[i].algo == algo)
+		{
+			INIT(this,
+				.public = {
+					.encrypt = _crypter_crypt,
+					.decrypt = _crypter_crypt,
+					.get_block_size = _crypter_get_block_size,
+					.get_iv_size = _crypter_get_iv_size,
+					.get_key_size = _crypter_get_key_size,
+					.set_key = (void*)return_true,
+					.destroy = (void*)free,
+				},
+				.block_size = crypters[i].block_size,
+				.iv_size = crypters[i].iv_size,
+				.key_size = key_size ?: crypters[i].key_size,
+			);
+			return &this->public;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * An AEAD passing data through, with a zero ICV
+ */
+struct null_aead_t {
+
+	/**
+	 * Implements aead_t
+	 */
+	aead_t public;
+
+	/**
+	 * ICV size
+	 */
+	size_t icv_size;
+
+	/**
+	 * IV size
+	 */
+	size_t iv_size;
+
+	/**
+	 * Key size, including salt
+	 */
+	size_t key_size;
+};
+
+METHOD(aead_t, aead_encrypt, bool,
+	null_aead_t *this, chunk_t plain, chunk_t assoc, chunk_t iv,
+	chunk_t *encrypted)
+{
+	if (encrypted)
+	{
+		*encrypted = chunk_alloc(plain.len + this->icv_size);
+		memcpy(encrypted->ptr, plain.ptr, plain.len);
+	}
+	else
+	{	/* ICV gets appended in place */
+		encrypted = &plain;
+		encrypted->len += this->icv_size;
+	}
+	memset(encrypted->ptr + encrypted->len - this->icv_size, 0,
+		   this->icv_size);
+	return TRUE;
+}
+
+METHOD(aead_t, aead_decrypt, bool,
+	null_aead_t *this, chunk_t encrypted, chunk_t assoc, chunk_t iv,
+	chunk_t *plain)
+{
+	if (encrypted.len < this->icv_size)
+	{
+		return FALSE;
+	}
+	encrypted.len -= this->icv_size;
+	if (plain)
+	{
+		*plain = chunk_clone(encrypted);
+	}
+	return TRUE;
+}
+
+METHOD(aead_t, aead_get_block_size, size_t,
+	null_aead_t *this)
+{
+	return 1;
+}
+
+METHOD(aead_t, aead_get_icv_size, size_t,
+	null_aead_t *this)
+{
+	return this->icv_size;
+}
+
+METHOD(aead_t, aead_get_iv_size, size_t,
+	null_aead_t *this)
+{
+	return this->iv_size;
+}
+
+METHOD(aead_t, aead_get_key_size, size_t,
+	null_aead_t *this)
+{
+	return this->key_size;
+}
+
+/**
+ * Create a NULL AEAD
+ */
+static aead_t *null_aead_create(encryption_algorithm_t algo, size_t key_size)
+{
+	null_aead_t *this;
+	int i;
+
+	for (i = 0; i < countof(aeads); i++)
+	{
+		if (aeads[i].algo == algo)
+		{
+			INIT(this,
+				.public = {
+					.encrypt = _aead_encrypt,
+					.decrypt = _aead_decrypt,
+					.get_block_size = _aead_get_block_size,
+					.get_icv_size = _aead_get_icv_size,
+					.get_iv_size = _aead_get_iv_size,
+					.get_key_size = _aead_get_key_size,
+					.set_key = (void*)return_true,
+					.destroy = (void*)free,
+				},
+				.icv_size = aeads[i].block_size,
+				.iv_size = aeads[i].iv_size,
+				.key_size = (key_size ?: aeads[i].key_size) +
+							aeads[i].salt_size,
+			);
+			return &this->public;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * A signer creating zero signatures, accepting any signature of correct size
+ */
+struct null_signer_t {
+
+	/**
+	 * Implements signer_t
+	 */
+	signer_t public;
+
+	/**
+	 * Signature size
+	 */
+	size_t block_size;
+
+	/**
+	 * Key size
+	 */
+	size_t key_size;
+};
+
+METHOD(signer_t, signer_get_signature, bool,
+	null_signer_t *this, chunk_t data, u_int8_t *buffer)
+{
+	if (buffer)
+	{
+		memset(buffer, 0, this->block_size);
+	}
+	return TRUE;
+}
+
+METHOD(signer_t, signer_allocate_signature, bool,
+	null_signer_t *this, chunk_t data, chunk_t *chunk)
+{
+	if (chunk)
+	{
+		*chunk = chunk_alloc(this->block_size);
+		memset(chunk->ptr, 0, chunk->len);
+	}
+	return TRUE;
+}
+
+METHOD(signer_t, signer_verify_signature, bool,
+	null_signer_t *this, chunk_t data, chunk_t signature)
+{
+	return signature.len == this->block_size;
+}
+
+METHOD(signer_t, signer_get_block_size, size_t,
+	null_signer_t *this)
+{
+	return this->block_size;
+}
+
+METHOD(signer_t, signer_get_key_size, size_t,
+	null_signer_t *this)
+{
+	return this->key_size;
+}
+
+/**
+ * Create a NULL signer
+ */
+static signer_t *null_signer_create(integrity_algorithm_t algo)
+{
+	null_signer_t *this;
+	int i;
+
+	for (i = 0; i < countof(signers); i++)
+	{
+		if (signers[i].algo == algo)
+		{
+			INIT(this,
+				.public = {
+					.get_signature = _signer_get_signature,
+					.allocate_signature = _signer_allocate_signature,
+					.verify_signature = _signer_verify_signature,
+					.get_block_size = _signer_get_block_size,
+					.get_key_size = _signer_get_key_size,
+					.set_key = (void*)return_true,
+					.destroy = (void*)free,
+				},
+				.block_size = signers[i].block_size,
+				.key_size = signers[i].key_size,
+			);
+			return &this->public;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * A PRF returning zeros
+ */
+struct null_prf_t {
+
+	/**
+	 * Implements prf_t
+	 */
+	prf_t public;
+
+	/**
+	 * Output size
+	 */
+	size_t block_size;
+
+	/**
+	 * Key size
+	 */
+	size_t key_size;
+};
+
+METHOD(prf_t, prf_get_bytes, bool,
+	null_prf_t *this, chunk_t seed, u_int8_t *buffer)
+{
+	if (buffer)
+	{
+		memset(buffer, 0, this->block_size);
+	}
+	return TRUE;
+}
+
+METHOD(prf_t, prf_allocate_bytes, bool,
+	null_prf_t *this, chunk_t seed, chunk_t *chunk)
+{
+	if (chunk)
+	{
+		*chunk = chunk_alloc(this->block_size);
+		memset(chunk->ptr, 0, chunk->len);
+	}
+	return TRUE;
+}
+
+METHOD(prf_t, prf_get_block_size, size_t,
+	null_prf_t *this)
+{
+	return this->block_size;
+}
+
+METHOD(prf_t, prf_get_key_size, size_t,
+	null_prf_t *this)
+{
+	return this->key_size;
+}
+
+/**
+ * Create a NULL PRF
+ */
+static prf_t *null_prf_create(pseudo_random_function_t algo)
+{
+	null_prf_t *this;
+	int i;
+
+	for (i = 0; i < countof(prfs); i++)
+	{
+		if (prfs[i].algo == algo)
+		{
+			INIT(this,
+				.public = {
+					.get_bytes = _prf_get_bytes,
+					.allocate_bytes = _prf_allocate_bytes,
+					.get_block_size = _prf_get_block_size,
+					.get_key_size = _prf_get_key_size,
+					.set_key = (void*)return_true,
+					.destroy = (void*)free,
+				},
+				.block_size = prfs[i].block_size,
+				.key_size = prfs[i].key_size,
+			);
+			return &this->public;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * A fast, non-cryptographic RNG. SPIs and nonces must still be unique, so
+ * it does not just return zeros.
+ */
+struct null_rng_t {
+
+	/**
+	 * Implements rng_t
+	 */
+	rng_t public;
+
+	/**
+	 * Seed of this instance
+	 */
+	u_int64_t seed;
+};
+
+/**
+ * Number of get_bytes() calls, each call gets its own stream
+ */
+static refcount_t rng_calls = 0;
+
+METHOD(rng_t, rng_get_bytes, bool,
+	null_rng_t *this, size_t len, u_int8_t *buffer)
+{
+	u_int64_t x, z;
+	size_t pos;
+
+	/* splitmix64, thread-safe as the state is local to each call */
+	x = this->seed + ((u_int64_t)ref_get(&rng_calls) << 32);
+	for (pos = 0; pos < len; pos += sizeof(z))
+	{
+		x += 0x9e3779b97f4a7c15ULL;
+		z = x;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+		z ^= z >> 31;
+		memcpy(buffer + pos, &z, min(sizeof(z), len - pos));
+	}
+	return TRUE;
+}
+
+METHOD(rng_t, rng_allocate_bytes, bool,
+	null_rng_t *this, size_t len, chunk_t *chunk)
+{
+	*chunk = chunk_alloc(len);
+	return rng_get_bytes(this, len, chunk->ptr);
+}
+
+/**
+ * Create a NULL RNG
+ */
+static rng_t *null_rng_create(rng_quality_t quality)
+{
+	null_rng_t *this;
+	timeval_t now;
+
+	time_monotonic(&now);
+	INIT(this,
+		.public = {
+			.get_bytes = _rng_get_bytes,
+			.allocate_bytes = _rng_allocate_bytes,
+			.destroy = (void*)free,
+		},
+		.seed = ((u_int64_t)now.tv_sec << 20) ^ now.tv_usec ^
+				((u_int64_t)getpid() << 40),
+	);
+	return &this->public;
+}
+
+/**
+ * See header
+ */
+void load_tester_crypto_register()
+{
+	bool success = TRUE;
+	int i;
+
+	for (i = 0; i < countof(crypters); i++)
+	{
+		success &= lib->crypto->add_crypter(lib->crypto, crypters[i].algo,
+											PLUGIN_NAME, null_crypter_create);
+	}
+	for (i = 0; i < countof(aeads); i++)
+	{
+		success &= lib->crypto->add_aead(lib->crypto, aeads[i].algo,
+										 PLUGIN_NAME, null_aead_create);
+	}
+	for (i = 0; i < countof(signers); i++)
+	{
+		success &= lib->crypto->add_signer(lib->crypto, signers[i].algo,
+										   PLUGIN_NAME, null_signer_create);
+	}
+	for (i = 0; i < countof(prfs); i++)
+	{
+		success &= lib->crypto->add_prf(lib->crypto, prfs[i].algo,
+										PLUGIN_NAME, null_prf_create);
+	}
+	for (i = RNG_WEAK; i <= RNG_TRUE; i++)
+	{
+		success &= lib->crypto->add_rng(lib->crypto, i, PLUGIN_NAME,
+										null_rng_create);
+	}
+	lib->creds->add_builder(lib->creds, CRED_PRIVATE_KEY, KEY_RSA, FALSE,
+					(builder_function_t)load_tester_private_key_load);
+	lib->creds->add_builder(lib->creds, CRED_PUBLIC_KEY, KEY_RSA, FALSE,
+					(builder_function_t)load_tester_public_key_load);
+	if (!success)
+	{
+		DBG1(DBG_CFG, "some NULL crypto primitives failed to register, "
+			 "disable libstrongswan.crypto_test.on_add");
+	}
+}
+
+/**
+ * See header
+ */
+void load_tester_crypto_unregister()
+{
+	lib->creds->remove_builder(lib->creds,
+					(builder_function_t)load_tester_private_key_load);
+	lib->creds->remove_builder(lib->creds,
+					(builder_function_t)load_tester_public_key_load);
+	lib->crypto->remove_rng(lib->crypto, null_rng_create);
+	lib->crypto->remove_prf(lib->crypto, null_prf_create);
+	lib->crypto->remove_signer(lib->crypto, null_signer_create);
+	lib->crypto->remove_aead(lib->crypto, null_aead_create);
+	lib->crypto->remove_crypter(lib->crypto, null_crypter_create);
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup load_tester_crypto load_tester_crypto
+ * @{ @ingroup load_tester
+ */
+
+#ifndef LOAD_TESTER_CRYPTO_H_
+#define LOAD_TESTER_CRYPTO_H_
+
+#include <library.h>
+
+/**
+ * Register NULL implementations of crypto primitives, replacing real ones.
+ *
+ * The crypters, AEADs, signers, PRFs and RNGs registered here, and RSA keys
+ * that sign with a fixed signature and accept any signature, take constant
+ * time and provide no security at all. They allow one to measure the
+ * overhead of the daemon itself, without the cost of cryptography.
+ *
+ * As the first registered implementation of an algorithm is used, this has
+ * to be called before any crypto plugin registers its features.
+ */
+void load_tester_crypto_register();
+
+/**
+ * Unregister the NULL crypto primitives.
+ */
+void load_tester_crypto_unregister();
+
+#endif /** LOAD_TESTER_CRYPTO_H_ @}*/
@@ -29,16 +29,16 @@ struct private_load_tester_ipsec_t {
 	load_tester_ipsec_t public;
 
 	/**
-	 * faked SPI counter
+	 * faked SPI counter, shared by all threads
 	 */
-	u_int32_t spi;
+	refcount_t spi;
 };
 
 METHOD(kernel_ipsec_t, get_spi, status_t,
 	private_load_tester_ipsec_t *this, host_t *src, host_t *dst,
 	u_int8_t protocol, u_int32_t reqid, u_int32_t *spi)
 {
-	*spi = ++this->spi;
+	*spi = ref_get(&this->spi);
 	return SUCCESS;
 }
 
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "load_tester_keys.h"
+
+#include <library.h>
+
+typedef struct private_load_tester_private_key_t private_load_tester_private_key_t;
+typedef struct private_load_tester_public_key_t private_load_tester_public_key_t;
+
+/**
+ * Number of RSA components of a private key
+ */
+#define RSA_PARTS 8
+
+/**
+ * Builder parts of the RSA components, modulus and public exponent first
+ */
+static builder_part_t build_parts[RSA_PARTS] = {
+	BUILD_RSA_MODULUS,
+	BUILD_RSA_PUB_EXP,
+	BUILD_RSA_PRIV_EXP,
+	BUILD_RSA_PRIME1,
+	BUILD_RSA_PRIME2,
+	BUILD_RSA_EXP1,
+	BUILD_RSA_EXP2,
+	BUILD_RSA_COEFF,
+};
+
+/**
+ * Private data of a NULL RSA private key
+ */
+struct private_load_tester_private_key_t {
+
+	/**
+	 * Public interface
+	 */
+	private_key_t public;
+
+	/**
+	 * RSA components, in the order of build_parts
+	 */
+	chunk_t parts[RSA_PARTS];
+
+	/**
+	 * Reference count
+	 */
+	refcount_t ref;
+};
+
+/**
+ * Private data of a NULL RSA public key
+ */
+struct private_load_tester_public_key_t {
+
+	/**
+	 * Public interface
+	 */
+	public_key_t public;
+
+	/**
+	 * Modulus
+	 */
+	chunk_t n;
+
+	/**
+	 * Public exponent
+	 */
+	chunk_t e;
+
+	/**
+	 * Reference count
+	 */
+	refcount_t ref;
+};
+
+/**
+ * Get the size of an RSA modulus in bits
+ */
+static int get_modulus_bits(chunk_t n)
+{
+	int bits;
+	u_char top;
+
+	if (!n.len)
+	{
+		return 0;
+	}
+	bits = n.len * 8;
+	for (top = n.ptr[0]; !(top & 0x80); top <<= 1)
+	{
+		bits--;
+	}
+	return bits;
+}
+
+METHOD(public_key_t, public_get_type, key_type_t,
+	private_load_tester_public_key_t *this)
+{
+	return KEY_RSA;
+}
+
+METHOD(public_key_t, verify, bool,
+	private_load_tester_public_key_t *this, signature_scheme_t scheme,
+	chunk_t data, chunk_t signature)
+{
+	return TRUE;
+}
+
+METHOD(public_key_t, encrypt_, bool,
+	private_load_tester_public_key_t *this, encryption_scheme_t scheme,
+	chunk_t plain, chunk_t *crypto)
+{
+	return FALSE;
+}
+
+METHOD(public_key_t, public_get_keysize, int,
+	private_load_tester_public_key_t *this)
+{
+	return get_modulus_bits(this->n);
+}
+
+METHOD(public_key_t, public_get_fingerprint, bool,
+	private_load_tester_public_key_t *this, cred_encoding_type_t type,
+	chunk_t *fp)
+{
+	if (lib->encoding->get_cache(lib->encoding, type, this, fp))
+	{
+		return TRUE;
+	}
+	return lib->encoding->encode(lib->encoding, type, this, fp,
+			CRED_PART_RSA_MODULUS, this->n, CRED_PART_RSA_PUB_EXP, this->e,
+			CRED_PART_END);
+}
+
+METHOD(public_key_t, public_get_encoding, bool,
+	private_load_tester_public_key_t *this, cred_encoding_type_t type,
+	chunk_t *encoding)
+{
+	return lib->encoding->encode(lib->encoding, type, NULL, encoding,
+			CRED_PART_RSA_MODULUS, this->n, CRED_PART_RSA_PUB_EXP, this->e,
+			CRED_PART_END);
+}
+
+METHOD(public_key_t, public_get_ref, public_key_t*,
+	private_load_tester_public_key_t *this)
+{
+	ref_get(&this->ref);
+	return &this->public;
+}
+
+METHOD(public_key_t, public_destroy, void,
+	private_load_tester_public_key_t *this)
+{
+	if (ref_put(&this->ref))
+	{
+		lib->encoding->clear_cache(lib->encoding, this);
+		free(this->n.ptr);
+		free(this->e.ptr);
+		free(this);
+	}
+}
+
+/**
+ * Create a NULL RSA public key, components get cloned
+ */
+static public_key_t *create_public_key(chunk_t n, chunk_t e)
+{
+	private_load_tester_public_key_t *this;
+
+	INIT(this,
+		.public = {
+			.get_type = _public_get_type,
+			.verify = _verify,
+			.encrypt = _encrypt_,
+			.equals = public_key_equals,
+			.get_keysize = _public_get_keysize,
+			.get_fingerprint = _public_get_fingerprint,
+			.has_fingerprint = public_key_has_fingerprint,
+			.get_encoding = _public_get_encoding,
+			.get_ref = _public_get_ref,
+			.destroy = _public_destroy,
+		},
+		.n = chunk_clone(chunk_skip_zero(n)),
+		.e = chunk_clone(chunk_skip_zero(e)),
+		.ref = 1,
+	);
+	return &this->public;
+}
+
+METHOD(private_key_t, get_type, key_type_t,
+	private_load_tester_private_key_t *this)
+{
+	return KEY_RSA;
+}
+
+METHOD(private_key_t, sign, bool,
+	private_load_tester_private_key_t *this, signature_scheme_t scheme,
+	chunk_t data, chunk_t *signature)
+{
+	*signature = chunk_alloc(this->parts[0].len);
+	memset(signature->ptr, 0, signature->len);
+	return TRUE;
+}
+
+METHOD(private_key_t, decrypt, bool,
+	private_load_tester_private_key_t *this, encryption_scheme_t scheme,
+	chunk_t crypto, chunk_t *plain)
+{
+	return FALSE;
+}
+
+METHOD(private_key_t, get_keysize, int,
+	private_load_tester_private_key_t *this)
+{
+	return get_modulus_bits(this->parts[0]);
+}
+
+METHOD(private_key_t, get_public_key, public_key_t*,
+	private_load_tester_private_key_t *this)
+{
+	return create_public_key(this->parts[0], this->parts[1]);
+}
+
+METHOD(private_key_t, get_fingerprint, bool,
+	private_load_tester_private_key_t *this, cred_encoding_type_t type,
+	chunk_t *fp)
+{
+	if (lib->encoding->get_cache(lib->encoding, type, this, fp))
+	{
+		return TRUE;
+	}
+	return lib->encoding->encode(lib->encoding, type, this, fp,
+			CRED_PART_RSA_MODULUS, this->parts[0],
+			CRED_PART_RSA_PUB_EXP, this->parts[1], CRED_PART_END);
+}
+
+METHOD(private_key_t, get_encoding, bool,
+	private_load_tester_private_key_t *this, cred_encoding_type_t type,
+	chunk_t *encoding)
+{
+	return lib->encoding->encode(lib->encoding, type, NULL, encoding,
+			CRED_PART_RSA_MODULUS, this->parts[0],
+			CRED_PART_RSA_PUB_EXP, this->parts[1],
+			CRED_PART_RSA_PRIV_EXP, this->parts[2],
+			CRED_PART_RSA_PRIME1, this->parts[3],
+			CRED_PART_RSA_PRIME2, this->parts[4],
+			CRED_PART_RSA_EXP1, this->parts[5],
+			CRED_PART_RSA_EXP2, this->parts[6],
+			CRED_PART_RSA_COEFF, this->parts[7],
+			CRED_PART_END);
+}
+
+METHOD(private_key_t, get_ref, private_key_t*,
+	private_load_tester_private_key_t *this)
+{
+	ref_get(&this->ref);
+	return &this->public;
+}
+
+METHOD(private_key_t, destroy, void,
+	private_load_tester_private_key_t *this)
+{
+	int i;
+
+	if (ref_put(&this->ref))
+	{
+		lib->encoding->clear_cache(lib->encoding, this);
+		for (i = 0; i < RSA_PARTS; i++)
+		{
+			chunk_clear(&this->parts[i]);
+		}
+		free(this);
+	}
+}
+
+/**
+ * See header
+ */
+private_key_t *load_tester_private_key_load(key_type_t type, va_list args)
+{
+	private_load_tester_private_key_t *this;
+	chunk_t parts[RSA_PARTS];
+	builder_part_t part;
+	int i;
+
+	memset(parts, 0, sizeof(parts));
+	while (TRUE)
+	{
+		part = va_arg(args, builder_part_t);
+		if (part == BUILD_END)
+		{
+			break;
+		}
+		for (i = 0; i < RSA_PARTS; i++)
+		{
+			if (part == build_parts[i])
+			{
+				parts[i] = va_arg(args, chunk_t);
+				break;
+			}
+		}
+		if (i == RSA_PARTS)
+		{
+			return NULL;
+		}
+	}
+	for (i = 0; i < RSA_PARTS; i++)
+	{
+		if (!parts[i].len)
+		{
+			return NULL;
+		}
+	}
+
+	INIT(this,
+		.public = {
+			.get_type = _get_type,
+			.sign = _sign,
+			.decrypt = _decrypt,
+			.get_keysize = _get_keysize,
+			.get_public_key = _get_public_key,
+			.equals = private_key_equals,
+			.belongs_to = private_key_belongs_to,
+			.get_fingerprint = _get_fingerprint,
+			.has_fingerprint = private_key_has_fingerprint,
+			.get_encoding = _get_encoding,
+			.get_ref = _get_ref,
+			.destroy = _destroy,
+		},
+		.ref = 1,
+	);
+	for (i = 0; i < RSA_PARTS; i++)
+	{
+		this->parts[i] = chunk_clone(chunk_skip_zero(parts[i]));
+	}
+	return &this->public;
+}
+
+/**
+ * See header
+ */
+public_key_t *load_tester_public_key_load(key_type_t type, va_list args)
+{
+	chunk_t n, e;
+
+	n = e = chunk_empty;
+	while (TRUE)
+	{
+		switch (va_arg(args, builder_part_t))
+		{
+			case BUILD_RSA_MODULUS:
+				n = va_arg(args, chunk_t);
+				continue;
+			case BUILD_RSA_PUB_EXP:
+				e = va_arg(args, chunk_t);
+				continue;
+			case BUILD_END:
+				break;
+			default:
+				return NULL;
+		}
+		break;
+	}
+	if (!n.len || !e.len)
+	{
+		return NULL;
+	}
+	return create_public_key(n, e);
+}
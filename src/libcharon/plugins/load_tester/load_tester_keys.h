@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup load_tester_keys load_tester_keys
+ * @{ @ingroup load_tester
+ */
+
+#ifndef LOAD_TESTER_KEYS_H_
+#define LOAD_TESTER_KEYS_H_
+
+#include <credentials/builder.h>
+#include <credentials/keys/private_key.h>
+#include <credentials/keys/public_key.h>
+
+/**
+ * Load a NULL RSA private key from its components.
+ *
+ * The key creates signatures of the modulus length containing zeros, without
+ * doing any RSA operation. Fingerprints and encodings are the same as those
+ * of real RSA keys.
+ *
+ * Accepts BUILD_RSA_* components.
+ *
+ * @param type		type of the key, must be KEY_RSA
+ * @param args		builder_part_t argument list
+ * @return			loaded key, NULL on failure
+ */
+private_key_t *load_tester_private_key_load(key_type_t type, va_list args);
+
+/**
+ * Load a NULL RSA public key from its components.
+ *
+ * The key accepts any signature, without doing any RSA operation.
+ *
+ * Accepts BUILD_RSA_MODULUS/BUILD_RSA_PUB_EXP components.
+ *
+ * @param type		type of the key, must be KEY_RSA
+ * @param args		builder_part_t argument list
+ * @return			loaded key, NULL on failure
+ */
+public_key_t *load_tester_public_key_load(key_type_t type, va_list args);
+
+#endif /** LOAD_TESTER_KEYS_H_ @}*/
@@ -18,6 +18,7 @@
 #include <signal.h>
 
 #include <daemon.h>
+#include <processing/jobs/callback_job.h>
 #include <processing/jobs/delete_ike_sa_job.h>
 
 typedef struct private_load_tester_listener_t private_load_tester_listener_t;
@@ -36,6 +37,11 @@ struct private_load_tester_listener_t {
 	 */
 	bool delete_after_established;
 
+	/**
+	 * Number of CHILD_SAs to establish per IKE_SA
+	 */
+	u_int child_sas;
+
 	/**
 	 * Number of established SAs
 	 */
@@ -57,6 +63,75 @@ struct private_load_tester_listener_t {
 	load_tester_config_t *config;
 };
 
+/**
+ * Data for a job initiating additional CHILD_SAs
+ */
+typedef struct {
+
+	/**
+	 * IKE_SA to create CHILD_SAs on
+	 */
+	ike_sa_id_t *id;
+
+	/**
+	 * Number of CHILD_SAs to create
+	 */
+	u_int count;
+} child_job_t;
+
+/**
+ * Destroy child_job_t data
+ */
+static void child_job_destroy(child_job_t *job)
+{
+	job->id->destroy(job->id);
+	free(job);
+}
+
+/**
+ * Queue CREATE_CHILD_SA exchanges for additional CHILD_SAs
+ */
+static job_requeue_t initiate_children(child_job_t *job)
+{
+	enumerator_t *enumerator;
+	child_cfg_t *child_cfg = NULL;
+	peer_cfg_t *peer_cfg;
+	ike_sa_t *ike_sa;
+	status_t status = SUCCESS;
+	u_int i;
+
+	ike_sa = charon->ike_sa_manager->checkout(charon->ike_sa_manager, job->id);
+	if (!ike_sa)
+	{
+		return JOB_REQUEUE_NONE;
+	}
+	peer_cfg = ike_sa->get_peer_cfg(ike_sa);
+	if (peer_cfg)
+	{
+		enumerator = peer_cfg->create_child_cfg_enumerator(peer_cfg);
+		if (!enumerator->enumerate(enumerator, &child_cfg))
+		{
+			child_cfg = NULL;
+		}
+		enumerator->destroy(enumerator);
+	}
+	for (i = 0; child_cfg && i < job->count && status == SUCCESS; i++)
+	{
+		status = ike_sa->initiate(ike_sa, child_cfg->get_ref(child_cfg),
+								  0, NULL, NULL);
+	}
+	if (status == DESTROY_ME)
+	{
+		charon->ike_sa_manager->checkin_and_destroy(charon->ike_sa_manager,
+													ike_sa);
+	}
+	else
+	{
+		charon->ike_sa_manager->checkin(charon->ike_sa_manager, ike_sa);
+	}
+	return JOB_REQUEUE_NONE;
+}
+
 METHOD(listener_t, ike_updown, bool,
 	private_load_tester_listener_t *this, ike_sa_t *ike_sa, bool up)
 {
@@ -66,6 +141,19 @@ METHOD(listener_t, ike_updown, bool,
 
 		this->established++;
 
+		if (this->child_sas > 1 && id->is_initiator(id) &&
+			!this->delete_after_established)
+		{
+			child_job_t *job;
+
+			INIT(job,
+				.id = id->clone(id),
+				.count = this->child_sas - 1,
+			);
+			lib->processor->queue_job(lib->processor,
+				(job_t*)callback_job_create((callback_job_cb_t)initiate_children,
+							job, (callback_job_cleanup_t)child_job_destroy, NULL));
+		}
 		if (this->delete_after_established)
 		{
 			lib->processor->queue_job(lib->processor,
@@ -127,6 +215,8 @@ load_tester_listener_t *load_tester_listener_create(u_int shutdown_on,
 		.delete_after_established = lib->settings->get_bool(lib->settings,
 					"%s.plugins.load-tester.delete_after_established", FALSE,
 					charon->name),
+		.child_sas = lib->settings->get_int(lib->settings,
+					"%s.plugins.load-tester.child_sas", 1, charon->name),
 		.shutdown_on = shutdown_on,
 		.config = config,
 	);
@@ -20,8 +20,13 @@
 #include "load_tester_listener.h"
 #include "load_tester_control.h"
 #include "load_tester_diffie_hellman.h"
+#include "load_tester_crypto.h"
+#include "load_tester_stats.h"
 
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <math.h>
 
 #include <hydra.h>
 #include <daemon.h>
@@ -30,6 +35,33 @@
 #include <threading/mutex.h>
 
 typedef struct private_load_tester_plugin_t private_load_tester_plugin_t;
+typedef struct phase_t phase_t;
+
+/**
+ * A phase of a load test scenario
+ */
+struct phase_t {
+
+	/**
+	 * Name of the phase
+	 */
+	char *name;
+
+	/**
+	 * Number of IKE_SAs to initiate, 0 for no limit
+	 */
+	u_int count;
+
+	/**
+	 * Duration of the phase in seconds, 0 for no limit
+	 */
+	u_int duration;
+
+	/**
+	 * Number of IKE_SAs to initiate per second
+	 */
+	u_int rate;
+};
 
 /**
  * private data of load_tester plugin
@@ -61,6 +93,16 @@ struct private_load_tester_plugin_t {
 	 */
 	load_tester_listener_t *listener;
 
+	/**
+	 * Latency and throughput statistics
+	 */
+	load_tester_stats_t *stats;
+
+	/**
+	 * File to write the JSON report to, if any
+	 */
+	char *report;
+
 	/**
 	 * number of iterations per thread
 	 */
@@ -86,6 +128,81 @@ struct private_load_tester_plugin_t {
 	 */
 	int init_limit;
 
+	/**
+	 * Phases of the scenario to run at a fixed arrival rate, as phase_t
+	 */
+	linked_list_t *phases;
+
+	/**
+	 * Enumerator over phases
+	 */
+	enumerator_t *enumerator;
+
+	/**
+	 * Currently scheduled phase, NULL if complete
+	 */
+	phase_t *phase;
+
+	/**
+	 * Has the first initiation of the current phase been scheduled
+	 */
+	bool phase_started;
+
+	/**
+	 * Start of the current phase
+	 */
+	timeval_t start;
+
+	/**
+	 * End of the current phase, if limited by duration
+	 */
+	timeval_t end;
+
+	/**
+	 * Time of the next scheduled initiation
+	 */
+	timeval_t next;
+
+	/**
+	 * Number of IKE_SAs scheduled in the current phase
+	 */
+	u_int scheduled;
+
+	/**
+	 * Number of IKE_SAs initiated in all phases
+	 */
+	u_int initiated;
+
+	/**
+	 * Number of queued initiations not yet executed
+	 */
+	u_int pending;
+
+	/**
+	 * Use exponentially distributed inter-arrival times
+	 */
+	bool poisson;
+
+	/**
+	 * State of the PRNG for inter-arrival times
+	 */
+	u_int64_t prng;
+
+	/**
+	 * Shutdown the daemon if all IKE_SAs completed
+	 */
+	bool shutdown;
+
+	/**
+	 * Number of initiators still scheduling IKE_SAs
+	 */
+	u_int scheduling;
+
+	/**
+	 * NULL crypto primitives registered
+	 */
+	bool null_crypto;
+
 	/**
 	 * mutex to lock running field
 	 */
@@ -97,6 +214,35 @@ struct private_load_tester_plugin_t {
 	condvar_t *condvar;
 };
 
+/**
+ * Initiate a single load-test IKE_SA
+ */
+static bool initiate_load_test(private_load_tester_plugin_t *this)
+{
+	peer_cfg_t *peer_cfg;
+	child_cfg_t *child_cfg = NULL;
+	enumerator_t *enumerator;
+
+	peer_cfg = charon->backends->get_peer_cfg_by_name(charon->backends,
+													  "load-test");
+	if (!peer_cfg)
+	{
+		return FALSE;
+	}
+	enumerator = peer_cfg->create_child_cfg_enumerator(peer_cfg);
+	if (!enumerator->enumerate(enumerator, &child_cfg))
+	{
+		enumerator->destroy(enumerator);
+		return FALSE;
+	}
+	enumerator->destroy(enumerator);
+
+	charon->controller->initiate(charon->controller,
+				peer_cfg, child_cfg->get_ref(child_cfg),
+				NULL, NULL, 0);
+	return TRUE;
+}
+
 /**
  * Begin the load test
  */
@@ -115,10 +261,6 @@ static job_requeue_t do_load_test(private_load_tester_plugin_t *this)
 
 	for (i = 0; this->iterations == 0 || i < this->iterations; i++)
 	{
-		peer_cfg_t *peer_cfg;
-		child_cfg_t *child_cfg = NULL;
-		enumerator_t *enumerator;
-
 		if (this->init_limit)
 		{
 			while ((charon->ike_sa_manager->get_count(charon->ike_sa_manager) -
@@ -136,23 +278,10 @@ static job_requeue_t do_load_test(private_load_tester_plugin_t *this)
 			}
 		}
 
-		peer_cfg = charon->backends->get_peer_cfg_by_name(charon->backends,
-														  "load-test");
-		if (!peer_cfg)
+		if (!initiate_load_test(this))
 		{
 			break;
 		}
-		enumerator = peer_cfg->create_child_cfg_enumerator(peer_cfg);
-		if (!enumerator->enumerate(enumerator, &child_cfg))
-		{
-			enumerator->destroy(enumerator);
-			break;
-		}
-		enumerator->destroy(enumerator);
-
-		charon->controller->initiate(charon->controller,
-					peer_cfg, child_cfg->get_ref(child_cfg),
-					NULL, NULL, 0);
 		if (s)
 		{
 			sleep(s);
@@ -169,6 +298,319 @@ static job_requeue_t do_load_test(private_load_tester_plugin_t *this)
 	return JOB_REQUEUE_NONE;
 }
 
+/**
+ * Get an exponentially distributed inter-arrival time in microseconds
+ */
+static u_int64_t get_interarrival(private_load_tester_plugin_t *this,
+								  u_int rate)
+{
+	double u;
+
+	/* xorshift64*, reproducible for a given seed on all platforms */
+	this->prng ^= this->prng >> 12;
+	this->prng ^= this->prng << 25;
+	this->prng ^= this->prng >> 27;
+	u = ((this->prng * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+	return -log(1.0 - u) * 1000000.0 / rate;
+}
+
+/**
+ * Get the time of the next initiation, FALSE if the scenario is complete.
+ * If it is the first initiation of a phase, its name is returned in start.
+ */
+static bool next_arrival(private_load_tester_plugin_t *this, timeval_t *at,
+						 char **start)
+{
+	phase_t *phase;
+	u_int64_t usecs;
+
+	*start = NULL;
+	this->mutex->lock(this->mutex);
+	while (this->phase && this->iterations != -1)
+	{
+		phase = this->phase;
+		if (!this->phase_started)
+		{
+			if (!timerisset(&this->next))
+			{
+				time_monotonic(&this->next);
+			}
+			this->start = this->end = this->next;
+			this->end.tv_sec += phase->duration;
+			this->scheduled = 0;
+			this->phase_started = TRUE;
+			*start = phase->name;
+		}
+		if (phase->duration && !timercmp(&this->next, &this->end, <))
+		{	/* continue with the next phase where this one ended */
+			this->next = this->end;
+		}
+		else if (!phase->count || this->scheduled < phase->count)
+		{
+			*at = this->next;
+			this->scheduled++;
+			if (this->poisson)
+			{
+				usecs = get_interarrival(this, phase->rate);
+				this->next.tv_sec += usecs / 1000000;
+				this->next.tv_usec += usecs % 1000000;
+			}
+			else
+			{	/* calculate from the start to avoid accumulating errors */
+				usecs = this->scheduled * 1000000ULL / phase->rate;
+				this->next = this->start;
+				this->next.tv_sec += usecs / 1000000;
+				this->next.tv_usec += usecs % 1000000;
+			}
+			if (this->next.tv_usec >= 1000000)
+			{
+				this->next.tv_sec++;
+				this->next.tv_usec -= 1000000;
+			}
+			this->mutex->unlock(this->mutex);
+			return TRUE;
+		}
+		if (!this->enumerator->enumerate(this->enumerator, &this->phase))
+		{
+			this->phase = NULL;
+		}
+		this->phase_started = FALSE;
+		*start = NULL;
+	}
+	this->mutex->unlock(this->mutex);
+	return FALSE;
+}
+
+/**
+ * Wait until the given time, FALSE if the load test got aborted
+ */
+static bool wait_until(private_load_tester_plugin_t *this, timeval_t at)
+{
+	timeval_t now;
+	bool aborted;
+
+	this->mutex->lock(this->mutex);
+	while (this->iterations != -1)
+	{
+		time_monotonic(&now);
+		if (!timercmp(&now, &at, <))
+		{
+			break;
+		}
+		this->condvar->timed_wait_abs(this->condvar, this->mutex, at);
+	}
+	aborted = this->iterations == -1;
+	this->mutex->unlock(this->mutex);
+	return !aborted;
+}
+
+/**
+ * Wait for all initiated IKE_SAs to complete and shut down the daemon
+ */
+static void shutdown_when_complete(private_load_tester_plugin_t *this)
+{
+	u_int established, failed;
+	timeval_t timeout;
+
+	this->mutex->lock(this->mutex);
+	while (this->iterations != -1)
+	{
+		this->stats->get_completed(this->stats, &established, &failed);
+		if (!this->pending && established + failed >= this->initiated)
+		{
+			DBG1(DBG_CFG, "load-test complete (%u established, %u failed), "
+				 "raising SIGTERM", established, failed);
+			kill(0, SIGTERM);
+			break;
+		}
+		time_monotonic(&timeout);
+		timeval_add_ms(&timeout, 100);
+		this->condvar->timed_wait_abs(this->condvar, this->mutex, timeout);
+	}
+	this->mutex->unlock(this->mutex);
+}
+
+/**
+ * A scheduled initiation of an IKE_SA
+ */
+typedef struct {
+
+	/**
+	 * Plugin initiating the IKE_SA
+	 */
+	private_load_tester_plugin_t *plugin;
+
+	/**
+	 * Time the IKE_SA has been scheduled at
+	 */
+	timeval_t at;
+} arrival_t;
+
+/**
+ * Initiate a scheduled IKE_SA, in a worker thread
+ */
+static job_requeue_t do_arrival(arrival_t *arrival)
+{
+	private_load_tester_plugin_t *this = arrival->plugin;
+	bool initiated;
+
+	this->mutex->lock(this->mutex);
+	if (this->iterations == -1)
+	{
+		this->mutex->unlock(this->mutex);
+		return JOB_REQUEUE_NONE;
+	}
+	this->running++;
+	this->mutex->unlock(this->mutex);
+
+	this->stats->set_arrival(this->stats, &arrival->at);
+	initiated = initiate_load_test(this);
+	this->stats->set_arrival(this->stats, NULL);
+
+	this->mutex->lock(this->mutex);
+	if (initiated)
+	{
+		this->initiated++;
+	}
+	this->pending--;
+	this->running--;
+	this->condvar->broadcast(this->condvar);
+	this->mutex->unlock(this->mutex);
+	return JOB_REQUEUE_NONE;
+}
+
+/**
+ * Initiate IKE_SAs at the arrival rates defined by the scenario
+ */
+static job_requeue_t do_rate_test(private_load_tester_plugin_t *this)
+{
+	arrival_t *arrival;
+	timeval_t at;
+	char *phase;
+	bool last;
+
+	this->mutex->lock(this->mutex);
+	this->running++;
+	this->mutex->unlock(this->mutex);
+
+	while (next_arrival(this, &at, &phase) && wait_until(this, at))
+	{
+		if (phase)
+		{
+			this->stats->start_phase(this->stats, phase);
+		}
+		/* initiating blocks until the first message is sent, which would
+		 * delay the schedule if the daemon falls behind */
+		INIT(arrival,
+			.plugin = this,
+			.at = at,
+		);
+		this->mutex->lock(this->mutex);
+		this->pending++;
+		this->mutex->unlock(this->mutex);
+		lib->processor->queue_job(lib->processor, (job_t*)
+					callback_job_create((callback_job_cb_t)do_arrival,
+										arrival, free, NULL));
+	}
+
+	this->mutex->lock(this->mutex);
+	last = --this->scheduling == 0;
+	this->mutex->unlock(this->mutex);
+	if (last && this->shutdown)
+	{
+		shutdown_when_complete(this);
+	}
+
+	this->mutex->lock(this->mutex);
+	this->running--;
+	this->condvar->broadcast(this->condvar);
+	this->mutex->unlock(this->mutex);
+	return JOB_REQUEUE_NONE;
+}
+
+/**
+ * Load the phases of the scenario
+ */
+static void load_phases(private_load_tester_plugin_t *this)
+{
+	enumerator_t *enumerator;
+	phase_t *phase;
+	char *name;
+	u_int rate;
+
+	rate = lib->settings->get_int(lib->settings,
+						"%s.plugins.load-tester.rate", 0, charon->name);
+	enumerator = lib->settings->create_section_enumerator(lib->settings,
+						"%s.plugins.load-tester.scenario", charon->name);
+	while (enumerator->enumerate(enumerator, &name))
+	{
+		INIT(phase,
+			.name = strdup(name),
+			.count = lib->settings->get_int(lib->settings,
+						"%s.plugins.load-tester.scenario.%s.count", 0,
+						charon->name, name),
+			.duration = lib->settings->get_int(lib->settings,
+						"%s.plugins.load-tester.scenario.%s.duration", 0,
+						charon->name, name),
+			.rate = lib->settings->get_int(lib->settings,
+						"%s.plugins.load-tester.scenario.%s.rate", rate,
+						charon->name, name),
+		);
+		if (!phase->rate)
+		{
+			DBG1(DBG_CFG, "load-test phase '%s' has no rate, ignored", name);
+			free(phase->name);
+			free(phase);
+			continue;
+		}
+		this->phases->insert_last(this->phases, phase);
+	}
+	enumerator->destroy(enumerator);
+
+	if (rate && !this->phases->get_count(this->phases))
+	{
+		INIT(phase,
+			.name = strdup("load-test"),
+			.count = this->iterations * this->initiators,
+			.rate = rate,
+		);
+		this->phases->insert_last(this->phases, phase);
+	}
+	this->enumerator = this->phases->create_enumerator(this->phases);
+	if (!this->enumerator->enumerate(this->enumerator, &this->phase))
+	{
+		this->phase = NULL;
+	}
+}
+
+/**
+ * Destroy a phase_t
+ */
+static void phase_destroy(phase_t *phase)
+{
+	free(phase->name);
+	free(phase);
+}
+
+/**
+ * Write the JSON report to the configured file
+ */
+static void write_report(private_load_tester_plugin_t *this)
+{
+	FILE *out;
+
+	out = fopen(this->report, "w");
+	if (!out)
+	{
+		DBG1(DBG_CFG, "writing load-test report to '%s' failed: %s",
+			 this->report, strerror(errno));
+		return;
+	}
+	this->stats->write_report(this->stats, out);
+	fclose(out);
+	DBG1(DBG_CFG, "load-test report written to '%s'", this->report);
+}
+
 METHOD(plugin_t, get_name, char*,
 	private_load_tester_plugin_t *this)
 {
@@ -187,30 +629,49 @@ static bool register_load_tester(private_load_tester_plugin_t *this,
 
 		this->config = load_tester_config_create();
 		this->creds = load_tester_creds_create();
-		this->control = load_tester_control_create();
+		this->stats = load_tester_stats_create();
+		this->control = load_tester_control_create(this->stats);
 
 		charon->backends->add_backend(charon->backends, &this->config->backend);
 		lib->credmgr->add_set(lib->credmgr, &this->creds->credential_set);
 
-		if (lib->settings->get_bool(lib->settings,
-				"%s.plugins.load-tester.shutdown_when_complete", 0, charon->name))
+		load_phases(this);
+		this->shutdown = lib->settings->get_bool(lib->settings,
+				"%s.plugins.load-tester.shutdown_when_complete", 0, charon->name);
+		if (this->shutdown && !this->phase)
 		{
 			shutdown_on = this->iterations * this->initiators;
 		}
 		this->listener = load_tester_listener_create(shutdown_on, this->config);
 		charon->bus->add_listener(charon->bus, &this->listener->listener);
+		charon->bus->add_listener(charon->bus, &this->stats->listener);
 
-		for (i = 0; i < this->initiators; i++)
+		if (this->phase)
+		{	/* open-loop load test with a fixed arrival rate */
+			this->scheduling = max(this->initiators, 1);
+			for (i = 0; i < this->scheduling; i++)
+			{
+				lib->processor->queue_job(lib->processor, (job_t*)
+					callback_job_create_with_prio((callback_job_cb_t)do_rate_test,
+										this, NULL, NULL, JOB_PRIO_CRITICAL));
+			}
+		}
+		else
 		{
-			lib->processor->queue_job(lib->processor, (job_t*)
-				callback_job_create_with_prio((callback_job_cb_t)do_load_test,
+			this->stats->start_phase(this->stats, "load-test");
+			for (i = 0; i < this->initiators; i++)
+			{
+				lib->processor->queue_job(lib->processor, (job_t*)
+					callback_job_create_with_prio((callback_job_cb_t)do_load_test,
 										this, NULL, NULL, JOB_PRIO_CRITICAL));
+			}
 		}
 	}
 	else
 	{
-		this->iterations = -1;
 		this->mutex->lock(this->mutex);
+		this->iterations = -1;
+		this->condvar->broadcast(this->condvar);
 		while (this->running)
 		{
 			this->condvar->wait(this->condvar, this->mutex);
@@ -219,10 +680,16 @@ static bool register_load_tester(private_load_tester_plugin_t *this,
 		charon->backends->remove_backend(charon->backends, &this->config->backend);
 		lib->credmgr->remove_set(lib->credmgr, &this->creds->credential_set);
 		charon->bus->remove_listener(charon->bus, &this->listener->listener);
+		charon->bus->remove_listener(charon->bus, &this->stats->listener);
+		if (this->report)
+		{
+			write_report(this);
+		}
 		this->config->destroy(this->config);
 		this->creds->destroy(this->creds);
 		this->listener->destroy(this->listener);
 		this->control->destroy(this->control);
+		this->stats->destroy(this->stats);
 	}
 	return TRUE;
 }
@@ -250,6 +717,12 @@ METHOD(plugin_t, destroy, void,
 {
 	hydra->kernel_interface->remove_ipsec_interface(hydra->kernel_interface,
 						(kernel_ipsec_constructor_t)load_tester_ipsec_create);
+	if (this->null_crypto)
+	{
+		load_tester_crypto_unregister();
+	}
+	DESTROY_IF(this->enumerator);
+	this->phases->destroy_function(this->phases, (void*)phase_destroy);
 	this->mutex->destroy(this->mutex);
 	this->condvar->destroy(this->condvar);
 	free(this);
@@ -286,15 +759,34 @@ plugin_t *load_tester_plugin_create()
 						"%s.plugins.load-tester.initiators", 0, charon->name),
 		.init_limit = lib->settings->get_int(lib->settings,
 						"%s.plugins.load-tester.init_limit", 0, charon->name),
+		.report = lib->settings->get_str(lib->settings,
+						"%s.plugins.load-tester.report", NULL, charon->name),
+		.poisson = streq(lib->settings->get_str(lib->settings,
+						"%s.plugins.load-tester.arrival", "constant",
+						charon->name), "poisson"),
+		.prng = lib->settings->get_int(lib->settings,
+						"%s.plugins.load-tester.seed", 0, charon->name) ^
+						0x9e3779b97f4a7c15ULL,
+		.phases = linked_list_create(),
 		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 		.condvar = condvar_create(CONDVAR_TYPE_DEFAULT),
 	);
 
 	if (lib->settings->get_bool(lib->settings,
-			"%s.plugins.load-tester.fake_kernel", FALSE, charon->name))
+			"%s.plugins.load-tester.fake_kernel",
+			lib->settings->get_bool(lib->settings,
+				"%s.plugins.load-tester.loopback", FALSE, charon->name),
+			charon->name))
 	{
 		hydra->kernel_interface->add_ipsec_interface(hydra->kernel_interface,
 						(kernel_ipsec_constructor_t)load_tester_ipsec_create);
 	}
+	if (lib->settings->get_bool(lib->settings,
+			"%s.plugins.load-tester.null_crypto", FALSE, charon->name))
+	{	/* register before other plugins register their features, as the
+		 * first registered implementation of an algorithm gets used */
+		load_tester_crypto_register();
+		this->null_crypto = TRUE;
+	}
 	return &this->public.plugin;
 }
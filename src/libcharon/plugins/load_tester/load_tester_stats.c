@@ -0,0 +1,659 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "load_tester_stats.h"
+
+#include <inttypes.h>
+
+#include <daemon.h>
+#include <collections/hashtable.h>
+#include <collections/linked_list.h>
+#include <threading/mutex.h>
+#include <threading/thread_value.h>
+#include <utils/histogram.h>
+
+typedef struct private_load_tester_stats_t private_load_tester_stats_t;
+typedef struct phase_t phase_t;
+typedef struct role_stats_t role_stats_t;
+typedef struct sa_entry_t sa_entry_t;
+
+/**
+ * Roles we keep statistics for
+ */
+typedef enum {
+	ROLE_INITIATOR,
+	ROLE_RESPONDER,
+	ROLE_MAX,
+} role_t;
+
+/**
+ * Names of roles, as used in reports
+ */
+static char *role_names[] = {
+	"initiator",
+	"responder",
+};
+
+/**
+ * Exchange types we measure
+ */
+static exchange_type_t exchanges[] = {
+	IKE_SA_INIT,
+	IKE_AUTH,
+	CREATE_CHILD_SA,
+	INFORMATIONAL,
+	ID_PROT,
+	AGGRESSIVE,
+	QUICK_MODE,
+	INFORMATIONAL_V1,
+	TRANSACTION,
+};
+
+/**
+ * Statistics of a role during a phase
+ */
+struct role_stats_t {
+
+	/**
+	 * Number of IKE_SAs started
+	 */
+	u_int started;
+
+	/**
+	 * Number of IKE_SAs established
+	 */
+	u_int established;
+
+	/**
+	 * Number of IKE_SAs destroyed before getting established
+	 */
+	u_int failed;
+
+	/**
+	 * Time to establish IKE_SAs
+	 */
+	histogram_t *establish;
+
+	/**
+	 * Round trip/processing time, per exchange type
+	 */
+	histogram_t *exchanges[countof(exchanges)];
+};
+
+/**
+ * A measurement phase
+ */
+struct phase_t {
+
+	/**
+	 * Name of the phase
+	 */
+	char *name;
+
+	/**
+	 * Time the phase started
+	 */
+	timeval_t start;
+
+	/**
+	 * Time the phase ended, zero if still active
+	 */
+	timeval_t end;
+
+	/**
+	 * Time the last IKE_SA of the phase completed
+	 */
+	timeval_t last;
+
+	/**
+	 * Statistics per role
+	 */
+	role_stats_t roles[ROLE_MAX];
+};
+
+/**
+ * Pending request of an IKE_SA
+ */
+typedef struct {
+
+	/**
+	 * Is a request pending
+	 */
+	bool active;
+
+	/**
+	 * Exchange type of the request
+	 */
+	exchange_type_t type;
+
+	/**
+	 * Message ID of the request
+	 */
+	u_int32_t mid;
+
+	/**
+	 * Time the request has been sent/received
+	 */
+	timeval_t time;
+} request_t;
+
+/**
+ * Tracked state of an IKE_SA
+ */
+struct sa_entry_t {
+
+	/**
+	 * Is the IKE_SA getting established
+	 */
+	bool connecting;
+
+	/**
+	 * Role we have during establishment
+	 */
+	role_t role;
+
+	/**
+	 * Time the establishment started
+	 */
+	timeval_t start;
+
+	/**
+	 * Our request and the request of the peer we currently handle
+	 */
+	request_t requests[ROLE_MAX];
+};
+
+/**
+ * Private data of an load_tester_stats_t object.
+ */
+struct private_load_tester_stats_t {
+
+	/**
+	 * Public load_tester_stats_t interface.
+	 */
+	load_tester_stats_t public;
+
+	/**
+	 * Tracked IKE_SAs, unique ID => sa_entry_t
+	 */
+	hashtable_t *sas;
+
+	/**
+	 * All phases, as phase_t
+	 */
+	linked_list_t *phases;
+
+	/**
+	 * Currently active phase, NULL if none started
+	 */
+	phase_t *current;
+
+	/**
+	 * Scheduled arrival time of the IKE_SA the thread initiates, timeval_t
+	 */
+	thread_value_t *arrival;
+
+	/**
+	 * Mutex to lock IKE_SAs and phases
+	 */
+	mutex_t *mutex;
+};
+
+/**
+ * Hashtable hash function
+ */
+static u_int hash(uintptr_t key)
+{
+	return key;
+}
+
+/**
+ * Hashtable equals function
+ */
+static bool equals(uintptr_t a, uintptr_t b)
+{
+	return a == b;
+}
+
+/**
+ * Destroy a phase
+ */
+static void phase_destroy(phase_t *phase)
+{
+	int i, j;
+
+	for (i = 0; i < ROLE_MAX; i++)
+	{
+		phase->roles[i].establish->destroy(phase->roles[i].establish);
+		for (j = 0; j < countof(exchanges); j++)
+		{
+			phase->roles[i].exchanges[j]->destroy(phase->roles[i].exchanges[j]);
+		}
+	}
+	free(phase->name);
+	free(phase);
+}
+
+/**
+ * Start a new phase, ending the current, mutex must be locked
+ */
+static void new_phase(private_load_tester_stats_t *this, char *name)
+{
+	phase_t *phase;
+	int i, j;
+
+	INIT(phase,
+		.name = strdup(name),
+	);
+	for (i = 0; i < ROLE_MAX; i++)
+	{
+		phase->roles[i].establish = histogram_create();
+		for (j = 0; j < countof(exchanges); j++)
+		{
+			phase->roles[i].exchanges[j] = histogram_create();
+		}
+	}
+	time_monotonic(&phase->start);
+	if (this->current)
+	{
+		this->current->end = phase->start;
+	}
+	this->phases->insert_last(this->phases, phase);
+	this->current = phase;
+}
+
+/**
+ * Get statistics of a role in the current phase, mutex must be locked
+ */
+static role_stats_t *get_role(private_load_tester_stats_t *this, role_t role)
+{
+	if (!this->current)
+	{
+		new_phase(this, "load-test");
+	}
+	return &this->current->roles[role];
+}
+
+/**
+ * Get the tracked state of an IKE_SA, mutex must be locked
+ */
+static sa_entry_t *get_entry(private_load_tester_stats_t *this,
+							 ike_sa_t *ike_sa, bool create)
+{
+	sa_entry_t *entry;
+	uintptr_t id;
+
+	id = ike_sa->get_unique_id(ike_sa);
+	entry = this->sas->get(this->sas, (void*)id);
+	if (!entry && create)
+	{
+		INIT(entry);
+		this->sas->put(this->sas, (void*)id, entry);
+	}
+	return entry;
+}
+
+METHOD(listener_t, ike_state_change, bool,
+	private_load_tester_stats_t *this, ike_sa_t *ike_sa, ike_sa_state_t state)
+{
+	histogram_t *histogram = NULL;
+	role_stats_t *role;
+	sa_entry_t *entry;
+	timeval_t start, *arrival;
+	uintptr_t id;
+
+	switch (state)
+	{
+		case IKE_CONNECTING:
+			this->mutex->lock(this->mutex);
+			entry = get_entry(this, ike_sa, TRUE);
+			if (!entry->connecting)
+			{
+				entry->connecting = TRUE;
+				entry->role = ROLE_INITIATOR;
+				/* the IKE_SA changes its state in the initiating thread, so
+				 * include the time it waited for being initiated, if any */
+				arrival = this->arrival->get(this->arrival);
+				if (arrival)
+				{
+					entry->start = *arrival;
+				}
+				else
+				{
+					time_monotonic(&entry->start);
+				}
+				get_role(this, ROLE_INITIATOR)->started++;
+			}
+			this->mutex->unlock(this->mutex);
+			break;
+		case IKE_ESTABLISHED:
+			this->mutex->lock(this->mutex);
+			entry = get_entry(this, ike_sa, FALSE);
+			if (entry && entry->connecting)
+			{
+				entry->connecting = FALSE;
+				role = get_role(this, entry->role);
+				role->established++;
+				histogram = role->establish;
+				start = entry->start;
+				time_monotonic(&this->current->last);
+			}
+			this->mutex->unlock(this->mutex);
+			if (histogram)
+			{
+				histogram->record_since(histogram, &start);
+			}
+			break;
+		case IKE_DESTROYING:
+			id = ike_sa->get_unique_id(ike_sa);
+			this->mutex->lock(this->mutex);
+			entry = this->sas->remove(this->sas, (void*)id);
+			if (entry && entry->connecting)
+			{
+				get_role(this, entry->role)->failed++;
+				time_monotonic(&this->current->last);
+			}
+			this->mutex->unlock(this->mutex);
+			free(entry);
+			break;
+		default:
+			break;
+	}
+	return TRUE;
+}
+
+/**
+ * Get the index of an exchange type we measure, -1 if not measured
+ */
+static int get_exchange(exchange_type_t type)
+{
+	int i;
+
+	for (i = 0; i < countof(exchanges); i++)
+	{
+		if (exchanges[i] == type)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+METHOD(listener_t, message, bool,
+	private_load_tester_stats_t *this, ike_sa_t *ike_sa, message_t *message,
+	bool incoming, bool plain)
+{
+	histogram_t *histogram = NULL;
+	exchange_type_t type;
+	request_t *request;
+	sa_entry_t *entry;
+	timeval_t now, start;
+	u_int32_t mid;
+	role_t role;
+	int index;
+
+	/* measure on the wire, i.e. encrypted messages only */
+	if (plain || !ike_sa)
+	{
+		return TRUE;
+	}
+	type = message->get_exchange_type(message);
+	index = get_exchange(type);
+	if (index < 0)
+	{
+		return TRUE;
+	}
+	mid = message->get_message_id(message);
+	/* incoming requests and our responses to them are measured as responder,
+	 * our requests and their responses as initiator */
+	role = incoming == message->get_request(message) ? ROLE_RESPONDER
+													 : ROLE_INITIATOR;
+	time_monotonic(&now);
+
+	this->mutex->lock(this->mutex);
+	entry = get_entry(this, ike_sa, message->get_request(message));
+	if (entry)
+	{
+		request = &entry->requests[role];
+		if (message->get_request(message))
+		{
+			if (!request->active || request->mid != mid || request->type != type)
+			{	/* keep the time of the first of retransmitted requests */
+				*request = (request_t){
+					.active = TRUE,
+					.type = type,
+					.mid = mid,
+					.time = now,
+				};
+			}
+			if (incoming && !entry->connecting &&
+				ike_sa->get_state(ike_sa) == IKE_CREATED)
+			{
+				entry->connecting = TRUE;
+				entry->role = ROLE_RESPONDER;
+				entry->start = now;
+				get_role(this, ROLE_RESPONDER)->started++;
+			}
+		}
+		else if (request->active && request->mid == mid && request->type == type)
+		{
+			request->active = FALSE;
+			histogram = get_role(this, role)->exchanges[index];
+			start = request->time;
+		}
+	}
+	this->mutex->unlock(this->mutex);
+
+	if (histogram)
+	{
+		histogram->record(histogram,
+				(now.tv_sec - start.tv_sec) * 1000000 +
+				(now.tv_usec - start.tv_usec));
+	}
+	return TRUE;
+}
+
+METHOD(load_tester_stats_t, start_phase, void,
+	private_load_tester_stats_t *this, char *name)
+{
+	this->mutex->lock(this->mutex);
+	new_phase(this, name);
+	this->mutex->unlock(this->mutex);
+	DBG1(DBG_CFG, "load-test phase '%s' started", name);
+}
+
+METHOD(load_tester_stats_t, set_arrival, void,
+	private_load_tester_stats_t *this, timeval_t *at)
+{
+	this->arrival->set(this->arrival, at);
+}
+
+METHOD(load_tester_stats_t, get_completed, void,
+	private_load_tester_stats_t *this, u_int *established, u_int *failed)
+{
+	enumerator_t *enumerator;
+	phase_t *phase;
+
+	*established = *failed = 0;
+	this->mutex->lock(this->mutex);
+	enumerator = this->phases->create_enumerator(this->phases);
+	while (enumerator->enumerate(enumerator, &phase))
+	{
+		*established += phase->roles[ROLE_INITIATOR].established;
+		*failed += phase->roles[ROLE_INITIATOR].failed;
+	}
+	enumerator->destroy(enumerator);
+	this->mutex->unlock(this->mutex);
+}
+
+/**
+ * Write a histogram as JSON object
+ */
+static void write_histogram(FILE *out, histogram_t *histogram, char *indent)
+{
+	enumerator_t *enumerator;
+	u_int64_t count, upper, cumulative;
+	bool first = TRUE;
+
+	count = histogram->get_count(histogram);
+	fprintf(out, "{\n");
+	fprintf(out, "%s  \"count\": %" PRIu64 ",\n", indent, count);
+	fprintf(out, "%s  \"mean_us\": %" PRIu64 ",\n", indent,
+			count ? histogram->get_sum(histogram) / count : 0);
+	fprintf(out, "%s  \"p50_us\": %" PRIu64 ",\n", indent,
+			histogram->get_percentile(histogram, 50));
+	fprintf(out, "%s  \"p90_us\": %" PRIu64 ",\n", indent,
+			histogram->get_percentile(histogram, 90));
+	fprintf(out, "%s  \"p99_us\": %" PRIu64 ",\n", indent,
+			histogram->get_percentile(histogram, 99));
+	fprintf(out, "%s  \"max_us\": %" PRIu64 ",\n", indent,
+			histogram->get_max(histogram));
+	fprintf(out, "%s  \"buckets\": [", indent);
+	enumerator = histogram->create_enumerator(histogram);
+	while (enumerator->enumerate(enumerator, &upper, &cumulative))
+	{
+		if (upper == HISTOGRAM_INF)
+		{	/* total is reported as count */
+			break;
+		}
+		fprintf(out, "%s[%" PRIu64 ", %" PRIu64 "]", first ? "" : ", ",
+				upper, cumulative);
+		first = FALSE;
+	}
+	enumerator->destroy(enumerator);
+	fprintf(out, "]\n%s}", indent);
+}
+
+/**
+ * Write statistics of a role as JSON object
+ */
+static void write_role(FILE *out, role_stats_t *role, u_int64_t usecs)
+{
+	bool first = TRUE;
+	int i;
+
+	fprintf(out, "{\n");
+	fprintf(out, "        \"started\": %u,\n", role->started);
+	fprintf(out, "        \"established\": %u,\n", role->established);
+	fprintf(out, "        \"failed\": %u,\n", role->failed);
+	fprintf(out, "        \"rate\": %.3f,\n",
+			usecs ? role->established * 1000000.0 / usecs : 0.0);
+	fprintf(out, "        \"establish\": ");
+	write_histogram(out, role->establish, "        ");
+	fprintf(out, ",\n        \"exchanges\": {");
+	for (i = 0; i < countof(exchanges); i++)
+	{
+		if (!role->exchanges[i]->get_count(role->exchanges[i]))
+		{
+			continue;
+		}
+		fprintf(out, "%s\n          \"%s\": ", first ? "" : ",",
+				enum_to_name(exchange_type_names, exchanges[i]));
+		write_histogram(out, role->exchanges[i], "          ");
+		first = FALSE;
+	}
+	fprintf(out, "%s}\n      }", first ? "" : "\n        ");
+}
+
+METHOD(load_tester_stats_t, write_report, void,
+	private_load_tester_stats_t *this, FILE *out)
+{
+	enumerator_t *enumerator;
+	phase_t *phase;
+	timeval_t now, end;
+	u_int64_t usecs;
+	bool first = TRUE;
+	int i;
+
+	time_monotonic(&now);
+	fprintf(out, "{\n  \"phases\": [");
+	this->mutex->lock(this->mutex);
+	enumerator = this->phases->create_enumerator(this->phases);
+	while (enumerator->enumerate(enumerator, &phase))
+	{
+		if (timerisset(&phase->end))
+		{
+			end = phase->end;
+		}
+		else
+		{	/* the last phase lasts until its last IKE_SA completed */
+			end = timerisset(&phase->last) ? phase->last : now;
+		}
+		usecs = (end.tv_sec - phase->start.tv_sec) * 1000000 +
+				(end.tv_usec - phase->start.tv_usec);
+		fprintf(out, "%s\n    {\n", first ? "" : ",");
+		fprintf(out, "      \"name\": \"%s\",\n", phase->name);
+		fprintf(out, "      \"duration\": %" PRIu64 ".%06" PRIu64,
+				usecs / 1000000, usecs % 1000000);
+		for (i = 0; i < ROLE_MAX; i++)
+		{
+			fprintf(out, ",\n      \"%s\": ", role_names[i]);
+			write_role(out, &phase->roles[i], usecs);
+		}
+		fprintf(out, "\n    }");
+		first = FALSE;
+	}
+	enumerator->destroy(enumerator);
+	this->mutex->unlock(this->mutex);
+	fprintf(out, "%s]\n}\n", first ? "" : "\n  ");
+}
+
+METHOD(load_tester_stats_t, destroy, void,
+	private_load_tester_stats_t *this)
+{
+	enumerator_t *enumerator;
+	sa_entry_t *entry;
+	void *id;
+
+	enumerator = this->sas->create_enumerator(this->sas);
+	while (enumerator->enumerate(enumerator, &id, &entry))
+	{
+		free(entry);
+	}
+	enumerator->destroy(enumerator);
+	this->sas->destroy(this->sas);
+	this->phases->destroy_function(this->phases, (void*)phase_destroy);
+	this->arrival->destroy(this->arrival);
+	this->mutex->destroy(this->mutex);
+	free(this);
+}
+
+/**
+ * See header
+ */
+load_tester_stats_t *load_tester_stats_create()
+{
+	private_load_tester_stats_t *this;
+
+	INIT(this,
+		.public = {
+			.listener = {
+				.ike_state_change = _ike_state_change,
+				.message = _message,
+			},
+			.start_phase = _start_phase,
+			.set_arrival = _set_arrival,
+			.get_completed = _get_completed,
+			.write_report = _write_report,
+			.destroy = _destroy,
+		},
+		.sas = hashtable_create((hashtable_hash_t)hash,
+								(hashtable_equals_t)equals, 1024),
+		.phases = linked_list_create(),
+		.arrival = thread_value_create(NULL),
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+	);
+
+	return &this->public;
+}
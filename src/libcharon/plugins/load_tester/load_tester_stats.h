@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup load_tester_stats load_tester_stats
+ * @{ @ingroup load_tester
+ */
+
+#ifndef LOAD_TESTER_STATS_H_
+#define LOAD_TESTER_STATS_H_
+
+#include <stdio.h>
+
+#include <bus/bus.h>
+
+typedef struct load_tester_stats_t load_tester_stats_t;
+
+/**
+ * Collect latency histograms and throughput of a load test.
+ *
+ * Statistics are kept separately for the initiator and the responder role,
+ * so a daemon running against itself reports both sides. Measurements get
+ * recorded in phases, each phase has its own set of histograms:
+ *
+ * - the time to establish IKE_SAs, measured on the initiator from the
+ *   scheduled arrival time of the IKE_SA, if any, or the initiation, on the
+ *   responder from the first received request
+ * - the round trip time of each exchange type, measured on the initiator
+ *   from sending a request to receiving the response
+ * - the processing time of each exchange type, measured on the responder from
+ *   receiving a request to sending the response
+ */
+struct load_tester_stats_t {
+
+	/**
+	 * Implements listener_t interface.
+	 */
+	listener_t listener;
+
+	/**
+	 * Start a new measurement phase, ending the current one.
+	 *
+	 * @param name			name of the phase, gets cloned
+	 */
+	void (*start_phase)(load_tester_stats_t *this, char *name);
+
+	/**
+	 * Set the time IKE_SAs initiated by the calling thread were scheduled at.
+	 *
+	 * The time to establish such IKE_SAs includes any delay before they
+	 * actually get initiated.
+	 *
+	 * @param at			scheduled arrival time, NULL to measure from initiation
+	 */
+	void (*set_arrival)(load_tester_stats_t *this, timeval_t *at);
+
+	/**
+	 * Get the number of IKE_SAs completed as initiator in all phases.
+	 *
+	 * @param established	number of successfully established IKE_SAs
+	 * @param failed		number of IKE_SAs failed to establish
+	 */
+	void (*get_completed)(load_tester_stats_t *this, u_int *established,
+						  u_int *failed);
+
+	/**
+	 * Write a report of all phases as JSON object.
+	 *
+	 * @param out			stream to write report to
+	 */
+	void (*write_report)(load_tester_stats_t *this, FILE *out);
+
+	/**
+	 * Destroy a load_tester_stats_t.
+	 */
+	void (*destroy)(load_tester_stats_t *this);
+};
+
+/**
+ * Create a load_tester_stats instance.
+ *
+ * @return				stats listener
+ */
+load_tester_stats_t *load_tester_stats_create();
+
+#endif /** LOAD_TESTER_STATS_H_ @}*/
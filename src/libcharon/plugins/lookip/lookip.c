@@ -134,9 +134,41 @@ static int send_request(int fd, int type, char *vip)
 }
 
 /**
- * Receive entries from fd. If block is != 0, the call blocks until closed
+ * Send a range request message, for a subnet or a "from-to" address range
  */
-static int receive(int fd, int block, int loop)
+static int send_range_request(int fd, char *range)
+{
+	lookip_range_request_t req = {
+		.req = {
+			.type = htonl(LOOKIP_LOOKUP_RANGE),
+		},
+	};
+	char *pos;
+
+	pos = strchr(range, '-');
+	if (pos)
+	{
+		snprintf(req.req.vip, sizeof(req.req.vip), "%.*s",
+				 (int)(pos - range), range);
+		snprintf(req.to, sizeof(req.to), "%s", pos + 1);
+	}
+	else
+	{
+		snprintf(req.req.vip, sizeof(req.req.vip), "%s", range);
+	}
+	if (write_all(fd, &req, sizeof(req)) != sizeof(req))
+	{
+		fprintf(stderr, "writing to socket failed: %s\n", strerror(errno));
+		return 2;
+	}
+	return 0;
+}
+
+/**
+ * Receive entries from fd. If block is != 0, the call blocks until closed.
+ * If range is != 0, a non-looping call receives all entries up to RANGE_END.
+ */
+static int receive(int fd, int block, int loop, int range)
 {
 	lookip_response_t resp;
 	char *label, name[32];
@@ -172,6 +204,12 @@ static int receive(int fd, int block, int loop)
 			case LOOKIP_NOTIFY_DOWN:
 				label = "down:";
 				break;
+			case LOOKIP_RANGE_END:
+				resp.vip[sizeof(resp.vip) - 1] = '\0';
+				printf("%-12s %16s %u entries\n",
+					   "range:", resp.vip, ntohl(resp.unique_id));
+				range = 0;
+				continue;
 			default:
 				fprintf(stderr, "received invalid message type: %d\n", resp.type);
 				return 1;
@@ -185,7 +223,7 @@ static int receive(int fd, int block, int loop)
 		printf("%-12s %16s %16s %20s %s\n",
 			   label, resp.vip, resp.ip, name, resp.id);
 	}
-	while (loop);
+	while (loop || range);
 
 	return 0;
 }
@@ -195,12 +233,12 @@ static int receive(int fd, int block, int loop)
  */
 static int interactive(int fd)
 {
-	printf("Enter IP address or 'quit'\n");
+	printf("Enter IP address, subnet, range 'from-to' or 'quit'\n");
 
 	while (1)
 	{
-		char line[64], *pos;
-		int res;
+		char line[96], *pos;
+		int res, range;
 
 		printf("> ");
 		fflush(stdout);
@@ -220,12 +258,20 @@ static int interactive(int fd)
 			{
 				return send_request(fd, LOOKIP_END, NULL);
 			}
-			res = send_request(fd, LOOKIP_LOOKUP, line);
+			range = strchr(line, '/') || strchr(line, '-');
+			if (range)
+			{
+				res = send_range_request(fd, line);
+			}
+			else
+			{
+				res = send_request(fd, LOOKIP_LOOKUP, line);
+			}
 			if (res != 0)
 			{
 				return res;
 			}
-			res = receive(fd, 1, 0);
+			res = receive(fd, 1, 0, range);
 			if (res != 0)
 			{
 				return res;
@@ -243,6 +289,7 @@ static void usage(char *cmd)
 	fprintf(stderr, "  %s --help\n", cmd);
 	fprintf(stderr, "  %s --dump\n", cmd);
 	fprintf(stderr, "  %s --lookup <IP>\n", cmd);
+	fprintf(stderr, "  %s --range <subnet>|<from>-<to>\n", cmd);
 	fprintf(stderr, "  %s --listen-up\n", cmd);
 	fprintf(stderr, "  %s --listen-down\n", cmd);
 	fprintf(stderr, "Any combination of options is allowed.\n");
@@ -255,6 +302,7 @@ int main(int argc, char *argv[])
 		{ "help", no_argument, NULL, 'h' },
 		{ "dump", no_argument, NULL, 'd' },
 		{ "lookup", required_argument, NULL, 'l' },
+		{ "range", required_argument, NULL, 'r' },
 		{ "listen-up", no_argument, NULL, 'u' },
 		{ "listen-down", no_argument, NULL, 'c' },
 		{ 0,0,0,0 }
@@ -289,6 +337,9 @@ int main(int argc, char *argv[])
 			case 'l':
 				res = send_request(fd, LOOKIP_LOOKUP, optarg);
 				break;
+			case 'r':
+				res = send_range_request(fd, optarg);
+				break;
 			case 'u':
 				res = send_request(fd, LOOKIP_REGISTER_UP, NULL);
 				break;
@@ -306,7 +357,7 @@ int main(int argc, char *argv[])
 		}
 		if (res == 0)
 		{	/* read all currently available results */
-			res = receive(fd, 0, 1);
+			res = receive(fd, 0, 1, 0);
 		}
 	}
 	if (res == 0)
@@ -314,7 +365,7 @@ int main(int argc, char *argv[])
 		/* send close message */
 		send_request(fd, LOOKIP_END, NULL);
 		/* read until socket gets closed */
-		res = receive(fd, 1, 1);
+		res = receive(fd, 1, 1, 0);
 	}
 	close(fd);
 
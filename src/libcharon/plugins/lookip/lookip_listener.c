@@ -14,6 +14,7 @@
  */
 
 #include "lookip_listener.h"
+#include "lookip_trie.h"
 
 #include <daemon.h>
 #include <collections/hashtable.h>
@@ -33,7 +34,7 @@ struct private_lookip_listener_t {
 	lookip_listener_t public;
 
 	/**
-	 * Lock for hashtable
+	 * Lock for hashtable and trie
 	 */
 	rwlock_t *lock;
 
@@ -42,6 +43,11 @@ struct private_lookip_listener_t {
 	 */
 	hashtable_t *entries;
 
+	/**
+	 * Trie indexing the same entries by address, for range lookups
+	 */
+	lookip_trie_t *trie;
+
 	/**
 	 * List of registered listeners
 	 */
@@ -72,18 +78,23 @@ typedef struct {
 	char *name;
 	/** IKE_SA unique identifier */
 	u_int unique_id;
+	/** references to this entry, held by the index and pending queries */
+	refcount_t refs;
 } entry_t;
 
 /**
- * Destroy a hashtable entry
+ * Release a reference to a hashtable entry, destroy it if it was the last
  */
 static void entry_destroy(entry_t *entry)
 {
-	entry->vip->destroy(entry->vip);
-	entry->other->destroy(entry->other);
-	entry->id->destroy(entry->id);
-	free(entry->name);
-	free(entry);
+	if (ref_put(&entry->refs))
+	{
+		entry->vip->destroy(entry->vip);
+		entry->other->destroy(entry->other);
+		entry->id->destroy(entry->id);
+		free(entry->name);
+		free(entry);
+	}
 }
 
 /**
@@ -152,6 +163,7 @@ static void add_entry(private_lookip_listener_t *this, ike_sa_t *ike_sa)
 			.id = id->clone(id),
 			.name = strdup(ike_sa->get_name(ike_sa)),
 			.unique_id = ike_sa->get_unique_id(ike_sa),
+			.refs = 1,
 		);
 
 		this->lock->read_lock(this->lock);
@@ -159,6 +171,7 @@ static void add_entry(private_lookip_listener_t *this, ike_sa_t *ike_sa)
 		this->lock->unlock(this->lock);
 
 		this->lock->write_lock(this->lock);
+		this->trie->insert(this->trie, entry->vip, entry);
 		entry = this->entries->put(this->entries, entry->vip, entry);
 		this->lock->unlock(this->lock);
 		if (entry)
@@ -183,6 +196,10 @@ static void remove_entry(private_lookip_listener_t *this, ike_sa_t *ike_sa)
 	{
 		this->lock->write_lock(this->lock);
 		entry = this->entries->remove(this->entries, vip);
+		if (entry)
+		{
+			this->trie->remove(this->trie, vip);
+		}
 		this->lock->unlock(this->lock);
 		if (entry)
 		{
@@ -239,22 +256,47 @@ METHOD(listener_t, ike_rekey, bool,
 	return TRUE;
 }
 
+/**
+ * Invoke a query callback for a snapshot of entries, release them
+ */
+static int invoke(linked_list_t *snapshot, lookip_callback_t cb, void *user)
+{
+	entry_t *entry;
+	bool more = TRUE;
+	int matches = 0;
+
+	while (snapshot->remove_first(snapshot, (void**)&entry) == SUCCESS)
+	{
+		if (more)
+		{
+			more = cb(user, TRUE, entry->vip, entry->other, entry->id,
+					  entry->name, entry->unique_id);
+			matches++;
+		}
+		entry_destroy(entry);
+	}
+	snapshot->destroy(snapshot);
+	return matches;
+}
+
 METHOD(lookip_listener_t, lookup, int,
 	private_lookip_listener_t *this, host_t *vip,
 	lookip_callback_t cb, void *user)
 {
+	linked_list_t *snapshot;
 	entry_t *entry;
-	int matches = 0;
 
+	/* collect references to matching entries, but invoke the callbacks
+	 * writing to clients without holding the lock */
+	snapshot = linked_list_create();
 	this->lock->read_lock(this->lock);
 	if (vip)
 	{
 		entry = this->entries->get(this->entries, vip);
 		if (entry)
 		{
-			cb(user, TRUE, entry->vip, entry->other, entry->id,
-			   entry->name, entry->unique_id);
-			matches ++;
+			ref_get(&entry->refs);
+			snapshot->insert_last(snapshot, entry);
 		}
 	}
 	else
@@ -264,15 +306,38 @@ METHOD(lookip_listener_t, lookup, int,
 		enumerator = this->entries->create_enumerator(this->entries);
 		while (enumerator->enumerate(enumerator, &vip, &entry))
 		{
-			cb(user, TRUE, entry->vip, entry->other, entry->id,
-			   entry->name, entry->unique_id);
-			matches++;
+			ref_get(&entry->refs);
+			snapshot->insert_last(snapshot, entry);
 		}
 		enumerator->destroy(enumerator);
 	}
 	this->lock->unlock(this->lock);
 
-	return matches;
+	return invoke(snapshot, cb, user);
+}
+
+METHOD(lookip_listener_t, lookup_range, int,
+	private_lookip_listener_t *this, traffic_selector_t *range,
+	lookip_callback_t cb, void *user)
+{
+	linked_list_t *snapshot;
+	enumerator_t *enumerator;
+	entry_t *entry;
+
+	snapshot = linked_list_create();
+	this->lock->read_lock(this->lock);
+	enumerator = this->trie->create_range_enumerator(this->trie,
+								range->get_from_address(range),
+								range->get_to_address(range));
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		ref_get(&entry->refs);
+		snapshot->insert_last(snapshot, entry);
+	}
+	enumerator->destroy(enumerator);
+	this->lock->unlock(this->lock);
+
+	return invoke(snapshot, cb, user);
 }
 
 METHOD(lookip_listener_t, add_listener, void,
@@ -314,6 +379,7 @@ METHOD(lookip_listener_t, destroy, void,
 	private_lookip_listener_t *this)
 {
 	this->listeners->destroy_function(this->listeners, free);
+	this->trie->destroy(this->trie);
 	this->entries->destroy(this->entries);
 	this->lock->destroy(this->lock);
 	free(this);
@@ -334,6 +400,7 @@ lookip_listener_t *lookip_listener_create()
 				.ike_rekey = _ike_rekey,
 			},
 			.lookup = _lookup,
+			.lookup_range = _lookup_range,
 			.add_listener = _add_listener,
 			.remove_listener = _remove_listener,
 			.destroy = _destroy,
@@ -341,6 +408,7 @@ lookip_listener_t *lookip_listener_create()
 		.lock = rwlock_create(RWLOCK_TYPE_DEFAULT),
 		.entries = hashtable_create((hashtable_hash_t)hash,
 									(hashtable_equals_t)equals, 32),
+		.trie = lookip_trie_create(),
 		.listeners = linked_list_create(),
 	);
 
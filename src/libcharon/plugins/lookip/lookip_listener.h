@@ -22,6 +22,7 @@
 #define LOOKIP_LISTENER_H_
 
 #include <bus/listeners/listener.h>
+#include <selectors/traffic_selector.h>
 
 typedef struct lookip_listener_t lookip_listener_t;
 
@@ -65,6 +66,21 @@ struct lookip_listener_t {
 	int (*lookup)(lookip_listener_t *this, host_t *vip,
 				  lookip_callback_t cb, void *user);
 
+	/**
+	 * Perform a lookup for all virtual IPs in a range, invoke callback for
+	 * matches in ascending order of their virtual IPs.
+	 *
+	 * The "up" parameter is always TRUE when the callback is invoked using
+	 * lookup_range().
+	 *
+	 * @param range		address range of virtual IPs to look up, ports ignored
+	 * @param cb		callback function to invoke
+	 * @param user		user data to pass to callback function
+	 * @return			number of matches
+	 */
+	int (*lookup_range)(lookip_listener_t *this, traffic_selector_t *range,
+						lookip_callback_t cb, void *user);
+
 	/**
 	 * Register a listener function that gets notified about virtual IP changes.
 	 *
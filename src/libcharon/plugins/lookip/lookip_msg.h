@@ -24,14 +24,17 @@
 #define LOOKIP_SOCKET IPSEC_PIDDIR "/charon.lkp"
 
 typedef struct lookip_request_t lookip_request_t;
+typedef struct lookip_range_request_t lookip_range_request_t;
 typedef struct lookip_response_t lookip_response_t;
 
 /**
  * Message type.
  *
- * The client can send a batch of request messages, containing DUMP, LOOKUP or
- * REGISTER_* messages. The server immediately starts sending responses for
- * these messages, using ENTRY or NOTIFY_* messages.
+ * The client can send a batch of request messages, containing DUMP, LOOKUP,
+ * LOOKUP_RANGE or REGISTER_* messages. The server immediately starts sending
+ * responses for these messages, using ENTRY or NOTIFY_* messages. The ENTRY
+ * messages for a LOOKUP_RANGE are followed by a RANGE_END message, allowing
+ * a client to stream many range queries over a single connection.
  * A client MUST send an END message to complete a batch. The server will
  * send any remaining responses, but will not accept new requests and closes
  * the connection when complete.
@@ -55,12 +58,17 @@ enum {
 	LOOKIP_NOTIFY_DOWN,
 	/** end of request batch */
 	LOOKIP_END,
+	/** lookup all virtual IPs in a subnet or address range */
+	LOOKIP_LOOKUP_RANGE,
+	/** reply message completing the ENTRY replies for LOOKUP_RANGE */
+	LOOKIP_RANGE_END,
 };
 
 /**
  * Request message sent from client.
  *
  * Valid request message types are DUMP, LOOKUP, REGISTER_UP/DOWN and END.
+ * LOOKUP_RANGE requests use the extended lookip_range_request_t.
  *
  * The vip field is used only in LOOKUP requests, but ignored otherwise.
  */
@@ -71,12 +79,28 @@ struct lookip_request_t {
 	char vip[40];
 } __attribute__((packed));
 
+/**
+ * Range request message sent from client.
+ *
+ * A LOOKUP_RANGE request extends the request message by the last address of
+ * the range. If it is empty, the vip field contains a subnet in CIDR notation.
+ */
+struct lookip_range_request_t {
+	/** request of type LOOKUP_RANGE, vip is the first address or a subnet */
+	lookip_request_t req;
+	/** null terminated string representation of last address, or empty */
+	char to[40];
+} __attribute__((packed));
+
 /**
  * Response message sent to client.
  *
- * Valid response message types are ENTRY, NOT_FOUND and NOTIFY_UP/DOWN.
+ * Valid response message types are ENTRY, NOT_FOUND, RANGE_END and
+ * NOTIFY_UP/DOWN.
  *
- * All fields are set in all messages, except in NOT_FOUND: Only vip is set.
+ * All fields are set in all messages, except in NOT_FOUND: Only vip is set,
+ * and in RANGE_END: vip is copied from the request, unique_id contains the
+ * number of ENTRY messages sent for it.
  */
 struct lookip_response_t {
 	/** response message type */
@@ -166,36 +166,86 @@ static bool event_cb(entry_t *entry, bool up, host_t *vip, host_t *other,
 }
 
 /**
- * Callback function for queries
+ * Number of responses to buffer before writing them to a client
  */
-static bool query_cb(stream_t *stream, bool up, host_t *vip, host_t *other,
-					 identification_t *id, char *name, u_int unique_id)
-{
-	lookip_response_t resp = {
-		.type = htonl(LOOKIP_ENTRY),
-		.unique_id = htonl(unique_id),
-	};
+#define RESPONSE_BATCH 16
 
-	snprintf(resp.vip, sizeof(resp.vip), "%H", vip);
-	snprintf(resp.ip, sizeof(resp.ip), "%H", other);
-	snprintf(resp.id, sizeof(resp.id), "%Y", id);
-	snprintf(resp.name, sizeof(resp.name), "%s", name);
+/**
+ * Responses of a query, written to the client in batches
+ */
+typedef struct {
+	/** stream to write to */
+	stream_t *stream;
+	/** buffered responses */
+	lookip_response_t resp[RESPONSE_BATCH];
+	/** number of buffered responses */
+	int count;
+	/** writing to the stream failed */
+	bool failed;
+} query_t;
 
-	if (stream->write_all(stream, &resp, sizeof(resp)))
+/**
+ * Write buffered query responses to the client
+ */
+static bool flush(query_t *query)
+{
+	if (query->count && !query->failed)
 	{
-		return TRUE;
+		if (!query->stream->write_all(query->stream, query->resp,
+									  sizeof(query->resp[0]) * query->count))
+		{
+			switch (errno)
+			{
+				case ECONNRESET:
+				case EPIPE:
+					/* client disconnected, adios */
+					break;
+				default:
+					DBG1(DBG_CFG, "sending lookip response failed: %s",
+						 strerror(errno));
+					break;
+			}
+			query->failed = TRUE;
+		}
 	}
-	switch (errno)
+	query->count = 0;
+	return !query->failed;
+}
+
+/**
+ * Get the next free response of a query, flushing buffered responses if full
+ */
+static lookip_response_t *next_response(query_t *query)
+{
+	lookip_response_t *resp;
+
+	if (query->count == RESPONSE_BATCH)
 	{
-		case ECONNRESET:
-		case EPIPE:
-			/* client disconnected, adios */
-			break;
-		default:
-			DBG1(DBG_CFG, "sending lookip response failed: %s", strerror(errno));
-			break;
+		flush(query);
 	}
-	return FALSE;
+	resp = &query->resp[query->count++];
+	memset(resp, 0, sizeof(*resp));
+	return resp;
+}
+
+/**
+ * Callback function for queries
+ */
+static bool query_cb(query_t *query, bool up, host_t *vip, host_t *other,
+					 identification_t *id, char *name, u_int unique_id)
+{
+	lookip_response_t *resp;
+
+	resp = next_response(query);
+	resp->type = htonl(LOOKIP_ENTRY);
+	resp->unique_id = htonl(unique_id);
+
+	snprintf(resp->vip, sizeof(resp->vip), "%H", vip);
+	snprintf(resp->ip, sizeof(resp->ip), "%H", other);
+	snprintf(resp->id, sizeof(resp->id), "%Y", id);
+	snprintf(resp->name, sizeof(resp->name), "%s", name);
+
+	return !query->failed;
 }
 
 /**
@@ -204,7 +254,9 @@ static bool query_cb(stream_t *stream, bool up, host_t *vip, host_t *other,
 static void query(private_lookip_socket_t *this, stream_t *stream,
 				  lookip_request_t *req)
 {
-
+	query_t query = {
+		.stream = stream,
+	};
 	host_t *vip = NULL;
 	int matches = 0;
 
@@ -215,28 +267,80 @@ static void query(private_lookip_socket_t *this, stream_t *stream,
 		if (vip)
 		{
 			matches = this->listener->lookup(this->listener, vip,
-											 (void*)query_cb, stream);
+											 (void*)query_cb, &query);
 			vip->destroy(vip);
 		}
 		if (matches == 0)
 		{
-			lookip_response_t resp = {
-				.type = htonl(LOOKIP_NOT_FOUND),
-			};
+			lookip_response_t *resp;
 
-			snprintf(resp.vip, sizeof(resp.vip), "%s", req->vip);
-			if (!stream->write_all(stream, &resp, sizeof(resp)))
-			{
-				DBG1(DBG_CFG, "sending lookip not-found failed: %s",
-					 strerror(errno));
-			}
+			resp = next_response(&query);
+			resp->type = htonl(LOOKIP_NOT_FOUND);
+			snprintf(resp->vip, sizeof(resp->vip), "%s", req->vip);
 		}
 	}
 	else
 	{	/* dump */
 		this->listener->lookup(this->listener, NULL,
-							   (void*)query_cb, stream);
+							   (void*)query_cb, &query);
 	}
+	flush(&query);
+}
+
+/**
+ * Parse the subnet or address range of a range request
+ */
+static traffic_selector_t *parse_range(lookip_range_request_t *req)
+{
+	traffic_selector_t *ts = NULL;
+	host_t *from, *to;
+
+	req->req.vip[sizeof(req->req.vip) - 1] = 0;
+	req->to[sizeof(req->to) - 1] = 0;
+
+	if (!req->to[0])
+	{
+		return traffic_selector_create_from_cidr(req->req.vip, 0, 0, 65535);
+	}
+	from = host_create_from_string(req->req.vip, 0);
+	to = host_create_from_string(req->to, 0);
+	if (from && to && from->get_family(from) == to->get_family(to))
+	{
+		ts = traffic_selector_create_from_bytes(0,
+					from->get_family(from) == AF_INET ?
+						TS_IPV4_ADDR_RANGE : TS_IPV6_ADDR_RANGE,
+					from->get_address(from), 0, to->get_address(to), 65535);
+	}
+	DESTROY_IF(from);
+	DESTROY_IF(to);
+	return ts;
+}
+
+/**
+ * Perform a range lookup, terminated by a RANGE_END response
+ */
+static void query_range(private_lookip_socket_t *this, stream_t *stream,
+						lookip_range_request_t *req)
+{
+	query_t query = {
+		.stream = stream,
+	};
+	lookip_response_t *resp;
+	traffic_selector_t *ts;
+	int matches = 0;
+
+	ts = parse_range(req);
+	if (ts)
+	{
+		matches = this->listener->lookup_range(this->listener, ts,
+											   (void*)query_cb, &query);
+		ts->destroy(ts);
+	}
+	resp = next_response(&query);
+	resp->type = htonl(LOOKIP_RANGE_END);
+	resp->unique_id = htonl(matches);
+	snprintf(resp->vip, sizeof(resp->vip), "%s", req->req.vip);
+	flush(&query);
 }
 
 /**
@@ -302,6 +406,7 @@ static bool subscribed(private_lookip_socket_t *this, stream_t *stream)
  */
 static bool on_read(private_lookip_socket_t *this, stream_t *stream)
 {
+	lookip_range_request_t range;
 	lookip_request_t req;
 
 	if (stream->read_all(stream, &req, sizeof(req)))
@@ -311,6 +416,17 @@ static bool on_read(private_lookip_socket_t *this, stream_t *stream)
 			case LOOKIP_LOOKUP:
 				query(this, stream, &req);
 				return TRUE;
+			case LOOKIP_LOOKUP_RANGE:
+				range.req = req;
+				if (!stream->read_all(stream, range.to, sizeof(range.to)))
+				{
+					DBG1(DBG_CFG, "receiving lookip range request failed: %s",
+						 strerror(errno));
+					disconnect(this, stream);
+					return FALSE;
+				}
+				query_range(this, stream, &range);
+				return TRUE;
 			case LOOKIP_DUMP:
 				query(this, stream, NULL);
 				return TRUE;
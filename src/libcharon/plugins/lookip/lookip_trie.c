@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2013 Martin Willi
+ * Copyright (C) 2013 revosec AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "lookip_trie.h"
+
+/**
+ * Maximum address length in bytes
+ */
+#define MAX_ADDR_LEN 16
+
+typedef struct private_lookip_trie_t private_lookip_trie_t;
+typedef struct node_t node_t;
+
+/**
+ * Node of the trie
+ */
+struct node_t {
+	/** prefix shared by all addresses below this node, trailing bits zero */
+	u_char key[MAX_ADDR_LEN];
+	/** prefix length in bits, full address length for leaves */
+	u_int bits;
+	/** children of internal nodes, by value of the bit following the prefix */
+	node_t *child[2];
+	/** stored value, leaves only */
+	void *value;
+};
+
+/**
+ * Private data of an lookip_trie_t object.
+ */
+struct private_lookip_trie_t {
+
+	/**
+	 * Public lookip_trie_t interface.
+	 */
+	lookip_trie_t public;
+
+	/**
+	 * Root node of IPv4 addresses
+	 */
+	node_t *v4;
+
+	/**
+	 * Root node of IPv6 addresses
+	 */
+	node_t *v6;
+
+	/**
+	 * Number of stored values
+	 */
+	u_int count;
+};
+
+/**
+ * Get the root node pointer for an address length, NULL if unsupported
+ */
+static node_t **get_root(private_lookip_trie_t *this, size_t len)
+{
+	switch (len)
+	{
+		case 4:
+			return &this->v4;
+		case 16:
+			return &this->v6;
+		default:
+			return NULL;
+	}
+}
+
+/**
+ * Get the value of the bit at a given position of a key
+ */
+static inline int get_bit(u_char *key, u_int pos)
+{
+	return (key[pos / 8] >> (7 - pos % 8)) & 1;
+}
+
+/**
+ * Get the position of the first bit differing in two keys, at most bits
+ */
+static u_int first_diff(u_char *a, u_char *b, u_int bits)
+{
+	u_char diff;
+	u_int i, pos;
+
+	for (i = 0; i * 8 < bits; i++)
+	{
+		diff = a[i] ^ b[i];
+		if (diff)
+		{
+			for (pos = i * 8; !(diff & 0x80); pos++)
+			{
+				diff <<= 1;
+			}
+			return min(pos, bits);
+		}
+	}
+	return bits;
+}
+
+/**
+ * Create a node for the first bits of a key
+ */
+static node_t *node_create(u_char *key, u_int bits, void *value)
+{
+	node_t *node;
+
+	INIT(node,
+		.bits = bits,
+		.value = value,
+	);
+	memcpy(node->key, key, bits / 8);
+	if (bits % 8)
+	{
+		node->key[bits / 8] = key[bits / 8] & (0xFF << (8 - bits % 8));
+	}
+	return node;
+}
+
+/**
+ * Recursively destroy a node and its children
+ */
+static void node_destroy(node_t *node)
+{
+	if (node)
+	{
+		node_destroy(node->child[0]);
+		node_destroy(node->child[1]);
+		free(node);
+	}
+}
+
+METHOD(lookip_trie_t, insert, void*,
+	private_lookip_trie_t *this, host_t *addr, void *value)
+{
+	node_t **pos, *node, *branch;
+	chunk_t key;
+	u_int bits, diff;
+	void *old;
+
+	key = addr->get_address(addr);
+	pos = get_root(this, key.len);
+	if (!pos)
+	{
+		return NULL;
+	}
+	bits = key.len * 8;
+
+	while (*pos)
+	{
+		node = *pos;
+		diff = first_diff(node->key, key.ptr, node->bits);
+		if (diff < node->bits)
+		{	/* key leaves the prefix of this node, branch at first difference */
+			branch = node_create(key.ptr, diff, NULL);
+			branch->child[get_bit(key.ptr, diff)] = node_create(key.ptr, bits,
+																value);
+			branch->child[!get_bit(key.ptr, diff)] = node;
+			*pos = branch;
+			this->count++;
+			return NULL;
+		}
+		if (node->bits == bits)
+		{	/* exact match */
+			old = node->value;
+			node->value = value;
+			return old;
+		}
+		pos = &node->child[get_bit(key.ptr, node->bits)];
+	}
+	*pos = node_create(key.ptr, bits, value);
+	this->count++;
+	return NULL;
+}
+
+METHOD(lookip_trie_t, remove_, void*,
+	private_lookip_trie_t *this, host_t *addr)
+{
+	node_t **pos, **parent = NULL, *node;
+	chunk_t key;
+	u_int bits;
+	void *value;
+
+	key = addr->get_address(addr);
+	pos = get_root(this, key.len);
+	if (!pos)
+	{
+		return NULL;
+	}
+	bits = key.len * 8;
+
+	while (*pos)
+	{
+		node = *pos;
+		if (first_diff(node->key, key.ptr, node->bits) < node->bits)
+		{
+			return NULL;
+		}
+		if (node->bits == bits)
+		{
+			value = node->value;
+			free(node);
+			*pos = NULL;
+			if (parent)
+			{	/* replace the parent by the remaining child */
+				node = *parent;
+				*parent = node->child[0] ?: node->child[1];
+				free(node);
+			}
+			this->count--;
+			return value;
+		}
+		parent = pos;
+		pos = &node->child[get_bit(key.ptr, node->bits)];
+	}
+	return NULL;
+}
+
+/**
+ * Enumerator over a range of addresses
+ */
+typedef struct {
+	/** implements enumerator_t */
+	enumerator_t public;
+	/** first address of range */
+	u_char from[MAX_ADDR_LEN];
+	/** last address of range */
+	u_char to[MAX_ADDR_LEN];
+	/** address length */
+	size_t len;
+	/** nodes still to visit, one sibling per level plus the current node */
+	node_t *stack[MAX_ADDR_LEN * 8 + 2];
+	/** number of nodes on stack */
+	u_int depth;
+} range_enumerator_t;
+
+/**
+ * Check if any address below a node is within the enumerated range
+ */
+static bool overlaps(range_enumerator_t *this, node_t *node)
+{
+	u_char last[MAX_ADDR_LEN];
+	u_int bits;
+
+	if (memcmp(node->key, this->to, this->len) > 0)
+	{
+		return FALSE;
+	}
+	memcpy(last, node->key, this->len);
+	bits = node->bits;
+	if (bits % 8)
+	{
+		last[bits / 8] |= 0xFF >> (bits % 8);
+		bits += 8 - bits % 8;
+	}
+	memset(last + bits / 8, 0xFF, this->len - bits / 8);
+	return memcmp(last, this->from, this->len) >= 0;
+}
+
+METHOD(enumerator_t, range_enumerate, bool,
+	range_enumerator_t *this, void **value)
+{
+	node_t *node;
+
+	while (this->depth)
+	{
+		node = this->stack[--this->depth];
+		if (!overlaps(this, node))
+		{
+			continue;
+		}
+		if (node->value)
+		{
+			*value = node->value;
+			return TRUE;
+		}
+		/* visit lower addresses first */
+		this->stack[this->depth++] = node->child[1];
+		this->stack[this->depth++] = node->child[0];
+	}
+	return FALSE;
+}
+
+METHOD(lookip_trie_t, create_range_enumerator, enumerator_t*,
+	private_lookip_trie_t *this, chunk_t from, chunk_t to)
+{
+	range_enumerator_t *enumerator;
+	node_t **root;
+
+	root = get_root(this, from.len);
+	if (!root || !*root || from.len != to.len)
+	{
+		return enumerator_create_empty();
+	}
+	INIT(enumerator,
+		.public = {
+			.enumerate = (void*)_range_enumerate,
+			.destroy = (void*)free,
+		},
+		.len = from.len,
+		.depth = 1,
+	);
+	memcpy(enumerator->from, from.ptr, from.len);
+	memcpy(enumerator->to, to.ptr, to.len);
+	enumerator->stack[0] = *root;
+
+	return &enumerator->public;
+}
+
+METHOD(lookip_trie_t, get_count, u_int,
+	private_lookip_trie_t *this)
+{
+	return this->count;
+}
+
+METHOD(lookip_trie_t, destroy, void,
+	private_lookip_trie_t *this)
+{
+	node_destroy(this->v4);
+	node_destroy(this->v6);
+	free(this);
+}
+
+/**
+ * See header
+ */
+lookip_trie_t *lookip_trie_create()
+{
+	private_lookip_trie_t *this;
+
+	INIT(this,
+		.public = {
+			.insert = _insert,
+			.remove = _remove_,
+			.create_range_enumerator = _create_range_enumerator,
+			.get_count = _get_count,
+			.destroy = _destroy,
+		},
+	);
+
+	return &this->public;
+}
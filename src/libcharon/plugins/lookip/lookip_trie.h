@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2013 Martin Willi
+ * Copyright (C) 2013 revosec AG
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup lookip_trie lookip_trie
+ * @{ @ingroup lookip
+ */
+
+#ifndef LOOKIP_TRIE_H_
+#define LOOKIP_TRIE_H_
+
+#include <networking/host.h>
+#include <collections/enumerator.h>
+
+typedef struct lookip_trie_t lookip_trie_t;
+
+/**
+ * Binary Patricia trie storing values by IPv4/IPv6 address.
+ *
+ * Path compression keeps lookups at O(address length), independent of the
+ * number of stored addresses. The trie is ordered by address, which allows
+ * efficient enumeration of all values within a subnet or address range.
+ *
+ * The trie is not thread safe, users must provide appropriate locking.
+ */
+struct lookip_trie_t {
+
+	/**
+	 * Insert a value for an address, replacing any existing value.
+	 *
+	 * @param addr		address to store value for, gets copied
+	 * @param value		value to store, non-NULL
+	 * @return			replaced value, NULL if none
+	 */
+	void* (*insert)(lookip_trie_t *this, host_t *addr, void *value);
+
+	/**
+	 * Remove the value stored for an address.
+	 *
+	 * @param addr		address to remove value for
+	 * @return			removed value, NULL if none
+	 */
+	void* (*remove)(lookip_trie_t *this, host_t *addr);
+
+	/**
+	 * Create an enumerator over values within an address range.
+	 *
+	 * Values get enumerated in ascending order of their addresses. The
+	 * boundaries are inclusive and must have the same address length.
+	 * The trie must not be modified while enumerating.
+	 *
+	 * @param from		first address of range, in network order
+	 * @param to		last address of range, in network order
+	 * @return			enumerator over void*
+	 */
+	enumerator_t* (*create_range_enumerator)(lookip_trie_t *this,
+											 chunk_t from, chunk_t to);
+
+	/**
+	 * Get the number of stored values.
+	 *
+	 * @return			number of values
+	 */
+	u_int (*get_count)(lookip_trie_t *this);
+
+	/**
+	 * Destroy a lookip_trie_t, stored values are not touched.
+	 */
+	void (*destroy)(lookip_trie_t *this);
+};
+
+/**
+ * Create a lookip_trie instance.
+ */
+lookip_trie_t *lookip_trie_create();
+
+#endif /** LOOKIP_TRIE_H_ @}*/
@@ -689,6 +689,105 @@ METHOD(stroke_list_t, status, void,
 	}
 }
 
+/**
+ * Check if an IKE_SA summary matches a peer given as address or identity
+ */
+static bool summary_matches_peer(ike_sa_summary_t *summary, host_t *host,
+								 identification_t *id)
+{
+	if (host)
+	{
+		return host->ip_equals(host, summary->other);
+	}
+	return summary->other_id->matches(summary->other_id, id) != ID_MATCH_NONE;
+}
+
+METHOD(stroke_list_t, summary, void,
+	private_stroke_list_t *this, stroke_msg_t *msg, FILE *out)
+{
+	enumerator_t *enumerator;
+	ike_sa_summary_t *summary;
+	identification_t *peer_id = NULL;
+	host_t *peer_host = NULL;
+	time_t now = time_monotonic(NULL);
+	u_int32_t matched = 0, shown = 0;
+	int state = -1;
+	bool more = FALSE;
+
+	if (msg->status_sa.state)
+	{
+		state = enum_from_name(ike_sa_state_names, msg->status_sa.state);
+		if (state == -1)
+		{
+			fprintf(out, "# unknown IKE_SA state '%s'\n", msg->status_sa.state);
+			return;
+		}
+	}
+	if (msg->status_sa.peer)
+	{
+		peer_host = host_create_from_string(msg->status_sa.peer, 0);
+		if (!peer_host)
+		{
+			peer_id = identification_create_from_string(msg->status_sa.peer);
+		}
+	}
+
+	fprintf(out, "# name\tuniqueid\tstate\tversion\tlocal\tremote\t"
+			"localid\tremoteid\tspi_i\tspi_r\tchildren\testablished\n");
+	enumerator = charon->ike_sa_manager->create_summary_enumerator(
+												charon->ike_sa_manager);
+	while (enumerator->enumerate(enumerator, &summary))
+	{
+		if ((msg->status_sa.name && !streq(msg->status_sa.name, summary->name)) ||
+			(state != -1 && summary->state != state) ||
+			(msg->status_sa.peer &&
+			 !summary_matches_peer(summary, peer_host, peer_id)))
+		{
+			continue;
+		}
+		if (matched++ < msg->status_sa.offset)
+		{
+			continue;
+		}
+		if (msg->status_sa.limit && shown == msg->status_sa.limit)
+		{
+			more = TRUE;
+			break;
+		}
+		fprintf(out, "%s\t%u\t%N\t%N\t%H\t%H\t%Y\t%Y\t"
+				"%.16"PRIx64"\t%.16"PRIx64"\t%u\t",
+				summary->name, summary->unique_id,
+				ike_sa_state_names, summary->state,
+				ike_version_names, summary->version,
+				summary->me, summary->other, summary->my_id, summary->other_id,
+				summary->id->get_initiator_spi(summary->id),
+				summary->id->get_responder_spi(summary->id),
+				summary->children);
+		if (summary->established)
+		{
+			fprintf(out, "%u\n", (u_int)(now - summary->established));
+		}
+		else
+		{
+			fprintf(out, "-\n");
+		}
+		shown++;
+	}
+	enumerator->destroy(enumerator);
+
+	if (more)
+	{
+		fprintf(out, "# %u IKE_SAs shown, next offset %u\n", shown,
+				msg->status_sa.offset + shown);
+	}
+	else
+	{
+		fprintf(out, "# %u IKE_SAs shown, no more matches\n", shown);
+	}
+	DESTROY_IF(peer_host);
+	DESTROY_IF(peer_id);
+}
+
 /**
  * create a unique certificate list without duplicates
  * certicates having the same issuer are grouped together.
@@ -1539,6 +1638,7 @@ stroke_list_t *stroke_list_create(stroke_attribute_t *attribute)
 		.public = {
 			.list = _list,
 			.status = _status,
+			.summary = _summary,
 			.leases = _leases,
 			.destroy = _destroy,
 		},
@@ -52,6 +52,16 @@ struct stroke_list_t {
 	void (*status)(stroke_list_t *this, stroke_msg_t *msg, FILE *out,
 				   bool all, bool wait);
 
+	/**
+	 * Log a paginated list of IKE_SA summaries to stroke console, one per line.
+	 *
+	 * IKE_SAs are not checked out, so this does not block on busy IKE_SAs.
+	 *
+	 * @param msg		stroke message
+	 * @param out		stroke console stream
+	 */
+	void (*summary)(stroke_list_t *this, stroke_msg_t *msg, FILE *out);
+
 	/**
 	 * Log pool leases to stroke console.
 	 *
@@ -339,6 +339,19 @@ static void stroke_status(private_stroke_socket_t *this,
 	this->list->status(this->list, msg, out, all, wait);
 }
 
+/**
+ * show IKE_SA summaries
+ */
+static void stroke_status_sa(private_stroke_socket_t *this,
+							 stroke_msg_t *msg, FILE *out)
+{
+	pop_string(msg, &msg->status_sa.name);
+	pop_string(msg, &msg->status_sa.peer);
+	pop_string(msg, &msg->status_sa.state);
+
+	this->list->summary(this->list, msg, out);
+}
+
 /**
  * list various information
  */
@@ -514,6 +527,30 @@ static void stroke_user_creds(private_stroke_socket_t *this,
 	this->config->set_user_credentials(this->config, msg, out);
 }
 
+/**
+ * Print statistics about handled stroke connections
+ */
+static void print_service_stats(private_stroke_socket_t *this, FILE *out)
+{
+	stream_service_stats_t stats;
+
+	this->service->get_stats(this->service, &stats);
+
+	fprintf(out, "\nStroke socket:\n\n");
+	fprintf(out, "%-18s %12llu\n", "accepted", stats.accepted);
+	fprintf(out, "%-18s %12u\n", "active", stats.active);
+	if (stats.accepted)
+	{
+		fprintf(out, "%-18s %12llu\n", "avg wait (us)",
+				stats.wait_total / stats.accepted);
+		fprintf(out, "%-18s %12llu\n", "max wait (us)", stats.wait_max);
+		fprintf(out, "%-18s %12llu\n", "avg run (us)",
+				stats.run_total / stats.accepted);
+		fprintf(out, "%-18s %12llu\n", "max run (us)",
+				stats.run_max);
+	}
+}
+
 /**
  * Print stroke counter values
  */
@@ -529,6 +566,32 @@ static void stroke_counters(private_stroke_socket_t *this,
 	else
 	{
 		this->counter->print(this->counter, out, msg->counters.name);
+		if (!msg->counters.name)
+		{
+			print_service_stats(this, out);
+		}
+	}
+}
+
+/**
+ * print or reset latency histograms and counters
+ */
+static void stroke_metrics(private_stroke_socket_t *this,
+						   stroke_msg_t *msg, FILE *out)
+{
+	if (!lib->metrics)
+	{
+		fprintf(out, "metrics disabled, enable them with "
+				"libstrongswan.metrics.enable\n");
+		return;
+	}
+	if (msg->metrics.reset)
+	{
+		lib->metrics->reset(lib->metrics);
+	}
+	else
+	{
+		lib->metrics->print(lib->metrics, out);
 	}
 }
 
@@ -570,23 +633,27 @@ static void stroke_config(private_stroke_socket_t *this,
 }
 
 /**
- * process a stroke request
+ * Read a stroke message from a stream, NULL on error or if the stream is closed
  */
-static bool on_accept(private_stroke_socket_t *this, stream_t *stream)
+static stroke_msg_t *read_msg(stream_t *stream)
 {
 	stroke_msg_t *msg;
 	u_int16_t len;
-	FILE *out;
 
 	/* read length */
 	if (!stream->read_all(stream, &len, sizeof(len)))
 	{
-		if (errno != EWOULDBLOCK)
+		if (errno != EWOULDBLOCK && errno != ECONNRESET)
 		{
 			DBG1(DBG_CFG, "reading length of stroke message failed: %s",
 				 strerror(errno));
 		}
-		return FALSE;
+		return NULL;
+	}
+	if (len < offsetof(stroke_msg_t, buffer))
+	{
+		DBG1(DBG_CFG, "invalid stroke message length %u", len);
+		return NULL;
 	}
 
 	/* read message */
@@ -599,18 +666,19 @@ static bool on_accept(private_stroke_socket_t *this, stream_t *stream)
 			DBG1(DBG_CFG, "reading stroke message failed: %s", strerror(errno));
 		}
 		free(msg);
-		return FALSE;
+		return NULL;
 	}
 
 	DBG3(DBG_CFG, "stroke message %b", (void*)msg, len);
+	return msg;
+}
 
-	out = stream->get_file(stream);
-	if (!out)
-	{
-		DBG1(DBG_CFG, "creating stroke output stream failed");
-		free(msg);
-		return FALSE;
-	}
+/**
+ * Process a single stroke message
+ */
+static void process_msg(private_stroke_socket_t *this, stroke_msg_t *msg,
+						FILE *out)
+{
 	switch (msg->type)
 	{
 		case STR_INITIATE:
@@ -682,10 +750,91 @@ static bool on_accept(private_stroke_socket_t *this, stream_t *stream)
 		case STR_COUNTERS:
 			stroke_counters(this, msg, out);
 			break;
+		case STR_STATUS_SA:
+			stroke_status_sa(this, msg, out);
+			break;
+		case STR_METRICS:
+			stroke_metrics(this, msg, out);
+			break;
+		case STR_BATCH:
+			DBG1(DBG_CFG, "ignoring nested stroke batch");
+			break;
 		default:
 			DBG1(DBG_CFG, "received unknown stroke");
 			break;
 	}
+}
+
+/**
+ * A batch of stroke messages sent on a single connection
+ */
+typedef struct {
+	/** stroke socket */
+	private_stroke_socket_t *this;
+	/** output stream to the client */
+	FILE *out;
+	/** number of processed messages */
+	u_int count;
+} batch_t;
+
+/**
+ * Process the next message of a batch, invoked whenever one is available
+ */
+static bool on_batch_read(batch_t *batch, stream_t *stream)
+{
+	stroke_msg_t *msg;
+
+	msg = read_msg(stream);
+	if (msg)
+	{
+		process_msg(batch->this, msg, batch->out);
+		fflush(batch->out);
+		free(msg);
+		batch->count++;
+		return TRUE;
+	}
+	DBG2(DBG_CFG, "processed batch of %u stroke messages", batch->count);
+	fclose(batch->out);
+	stream->destroy(stream);
+	free(batch);
+	return FALSE;
+}
+
+/**
+ * process a stroke request
+ */
+static bool on_accept(private_stroke_socket_t *this, stream_t *stream)
+{
+	stroke_msg_t *msg;
+	batch_t *batch;
+	FILE *out;
+
+	msg = read_msg(stream);
+	if (!msg)
+	{
+		return FALSE;
+	}
+	out = stream->get_file(stream);
+	if (!out)
+	{
+		DBG1(DBG_CFG, "creating stroke output stream failed");
+		free(msg);
+		return FALSE;
+	}
+	if (msg->type == STR_BATCH)
+	{	/* process messages in order until the client closes its end, but
+		 * don't occupy a thread while waiting for them */
+		free(msg);
+		fprintf(out, STROKE_BATCH_ACK);
+		fflush(out);
+		INIT(batch,
+			.this = this,
+			.out = out,
+		);
+		stream->on_read(stream, (stream_cb_t)on_batch_read, batch);
+		return TRUE;
+	}
+	process_msg(this, msg, out);
 	free(msg);
 	fclose(out);
 	return FALSE;
@@ -718,7 +867,7 @@ METHOD(stroke_socket_t, destroy, void,
 stroke_socket_t *stroke_socket_create()
 {
 	private_stroke_socket_t *this;
-	int max_concurrent;
+	int max_concurrent, workers;
 	char *uri;
 
 	INIT(this,
@@ -746,6 +895,8 @@ stroke_socket_t *stroke_socket_create()
 	max_concurrent = lib->settings->get_int(lib->settings,
 			"%s.plugins.stroke.max_concurrent", MAX_CONCURRENT_DEFAULT,
 			charon->name);
+	workers = lib->settings->get_int(lib->settings,
+			"%s.plugins.stroke.workers", 0, charon->name);
 	uri = lib->settings->get_str(lib->settings,
 			"%s.plugins.stroke.socket", "unix://" STROKE_SOCKET, charon->name);
 	this->service = lib->streams->create_service(lib->streams, uri, 10);
@@ -755,6 +906,10 @@ stroke_socket_t *stroke_socket_create()
 		destroy(this);
 		return NULL;
 	}
+	if (workers > 0)
+	{
+		this->service->set_workers(this->service, workers);
+	}
 	this->service->on_accept(this->service, (stream_service_cb_t)on_accept,
 							 this, JOB_PRIO_CRITICAL, max_concurrent);
 
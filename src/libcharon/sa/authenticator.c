@@ -46,6 +46,83 @@ ENUM_NEXT(auth_method_names, AUTH_XAUTH_INIT_PSK, AUTH_HYBRID_RESP_RSA, AUTH_GSP
 );
 ENUM_END(auth_method_names, AUTH_HYBRID_RESP_RSA);
 
+/**
+ * Signature schemes used by authenticators, with histograms per operation
+ */
+static struct {
+	signature_scheme_t scheme;
+	histogram_t *sign;
+	histogram_t *verify;
+} signature_metrics[] = {
+	{ SIGN_RSA_EMSA_PKCS1_NULL,		NULL, NULL },
+	{ SIGN_RSA_EMSA_PKCS1_SHA1,		NULL, NULL },
+	{ SIGN_ECDSA_WITH_NULL,			NULL, NULL },
+	{ SIGN_ECDSA_256,				NULL, NULL },
+	{ SIGN_ECDSA_384,				NULL, NULL },
+	{ SIGN_ECDSA_521,				NULL, NULL },
+};
+
+/**
+ * Get a signature histogram from the registry
+ */
+static histogram_t *get_histogram(metrics_t *metrics, char *op,
+								  signature_scheme_t scheme)
+{
+	char labels[64];
+
+	snprintf(labels, sizeof(labels), "op=\"%s\",scheme=\"%N\"", op,
+			 signature_scheme_names, scheme);
+	return metrics->histogram(metrics, "strongswan_signature_seconds", labels,
+							  "Time spent to create and verify signatures");
+}
+
+/**
+ * Described in header.
+ */
+void authenticator_metrics_init(metrics_t *metrics)
+{
+	int i;
+
+	for (i = 0; i < countof(signature_metrics); i++)
+	{
+		if (metrics)
+		{
+			signature_metrics[i].sign = get_histogram(metrics, "sign",
+											signature_metrics[i].scheme);
+			signature_metrics[i].verify = get_histogram(metrics, "verify",
+											signature_metrics[i].scheme);
+		}
+		else
+		{
+			signature_metrics[i].sign = signature_metrics[i].verify = NULL;
+		}
+	}
+}
+
+/**
+ * Described in header.
+ */
+void authenticator_record_signature(bool sign, signature_scheme_t scheme,
+									timeval_t *start)
+{
+	histogram_t *histogram;
+	int i;
+
+	for (i = 0; i < countof(signature_metrics); i++)
+	{
+		if (signature_metrics[i].scheme == scheme)
+		{
+			histogram = sign ? signature_metrics[i].sign
+							 : signature_metrics[i].verify;
+			if (histogram)
+			{
+				histogram->record_since(histogram, start);
+			}
+			break;
+		}
+	}
+}
+
 #ifdef USE_IKEV2
 
 /**
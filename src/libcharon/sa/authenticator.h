@@ -162,6 +162,23 @@ struct authenticator_t {
 	void (*destroy) (authenticator_t *this);
 };
 
+/**
+ * Look up the histograms signature operations get recorded to.
+ *
+ * @param metrics			metrics registry, NULL to stop recording
+ */
+void authenticator_metrics_init(metrics_t *metrics);
+
+/**
+ * Record the time taken by a signature operation, if metrics are enabled.
+ *
+ * @param sign				TRUE for signature creation, FALSE for verification
+ * @param scheme			signature scheme used
+ * @param start				monotonic time the operation started
+ */
+void authenticator_record_signature(bool sign, signature_scheme_t scheme,
+									timeval_t *start);
+
 /**
  * Create an IKEv2 authenticator to build signatures.
  *
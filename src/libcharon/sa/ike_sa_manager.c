@@ -26,6 +26,7 @@
 #include <threading/condvar.h>
 #include <threading/mutex.h>
 #include <threading/rwlock.h>
+#include <collections/array.h>
 #include <collections/linked_list.h>
 #include <crypto/hashers/hasher.h>
 
@@ -111,8 +112,67 @@ struct entry_t {
 	 * message ID or hash of currently processing message, -1 if none
 	 */
 	u_int32_t processing;
+
+	/**
+	 * status summary as of the last state change, without id and identities,
+	 * number of CHILD_SAs as of the last check-in
+	 */
+	ike_sa_summary_t summary;
 };
 
+/**
+ * Free the data of a status summary
+ */
+static void summary_free(ike_sa_summary_t *summary)
+{
+	free(summary->name);
+	DESTROY_IF(summary->id);
+	DESTROY_IF(summary->me);
+	DESTROY_IF(summary->other);
+	DESTROY_IF(summary->my_id);
+	DESTROY_IF(summary->other_id);
+}
+
+/**
+ * Update the status summary of an entry with a checked out IKE_SA.
+ *
+ * As this is done during each check-in, names and hosts are only recorded if
+ * the state of the IKE_SA changed. Identities are not recorded at all, the
+ * ones stored in the entry for duplicate checking are used instead.
+ */
+static void summary_update(entry_t *entry, ike_sa_t *ike_sa)
+{
+	ike_sa_summary_t *summary = &entry->summary;
+	ike_sa_state_t state;
+	host_t *host;
+
+	summary->children = ike_sa->get_child_count(ike_sa);
+	state = ike_sa->get_state(ike_sa);
+	if (summary->name && summary->state == state)
+	{
+		return;
+	}
+	summary->state = state;
+	free(summary->name);
+	summary->name = strdup(ike_sa->get_name(ike_sa));
+	host = ike_sa->get_my_host(ike_sa);
+	DESTROY_IF(summary->me);
+	summary->me = host->clone(host);
+	host = ike_sa->get_other_host(ike_sa);
+	DESTROY_IF(summary->other);
+	summary->other = host->clone(host);
+	summary->unique_id = ike_sa->get_unique_id(ike_sa);
+	summary->version = ike_sa->get_version(ike_sa);
+	if (state == IKE_ESTABLISHED)
+	{
+		summary->established = ike_sa->get_statistic(ike_sa, STAT_ESTABLISHED);
+	}
+	else
+	{
+		summary->established = 0;
+	}
+}
+
 /**
  * Implementation of entry_t.destroy.
  */
@@ -125,6 +185,7 @@ static status_t entry_destroy(entry_t *this)
 	DESTROY_IF(this->other);
 	DESTROY_IF(this->my_id);
 	DESTROY_IF(this->other_id);
+	summary_free(&this->summary);
 	this->condvar->destroy(this->condvar);
 	free(this);
 	return SUCCESS;
@@ -150,6 +211,11 @@ static entry_t *entry_create()
  */
 static bool entry_match_by_id(entry_t *entry, ike_sa_id_t *id)
 {
+	if (id->get_ike_version(id) != IKEV1_MAJOR_VERSION &&
+		id->is_initiator(id) != entry->ike_sa_id->is_initiator(entry->ike_sa_id))
+	{	/* if initiating to ourselves, we have two IKE_SAs with equal SPIs */
+		return FALSE;
+	}
 	if (id->equals(id, entry->ike_sa_id))
 	{
 		return TRUE;
@@ -463,6 +529,11 @@ struct private_enumerator_t {
 	 */
 	u_int segment;
 
+	/**
+	 * number of segments to advance to the next one enumerated
+	 */
+	u_int step;
+
 	/**
 	 * currently enumerating entry
 	 */
@@ -515,7 +586,7 @@ METHOD(enumerator_t, enumerate, bool,
 			unlock_single_segment(this->manager, this->segment);
 			this->row += this->manager->segment_count;
 		}
-		this->segment++;
+		this->segment += this->step;
 		this->row = this->segment;
 	}
 	return FALSE;
@@ -536,9 +607,11 @@ METHOD(enumerator_t, enumerator_destroy, void,
 }
 
 /**
- * Creates an enumerator to enumerate the entries in the hash table.
+ * Creates an enumerator to enumerate the entries in the hash table, starting
+ * at the given segment and skipping step segments each.
  */
-static enumerator_t* create_table_enumerator(private_ike_sa_manager_t *this)
+static enumerator_t* create_table_enumerator(private_ike_sa_manager_t *this,
+											 u_int segment, u_int step)
 {
 	private_enumerator_t *enumerator;
 
@@ -548,6 +621,9 @@ static enumerator_t* create_table_enumerator(private_ike_sa_manager_t *this)
 			.destroy = _enumerator_destroy,
 		},
 		.manager = this,
+		.segment = segment,
+		.row = segment,
+		.step = step,
 	);
 	return &enumerator->enumerator;
 }
@@ -1328,6 +1404,33 @@ METHOD(ike_sa_manager_t, checkout_by_message, ike_sa_t*,
 	return ike_sa;
 }
 
+/**
+ * Register a new IKE_SA we initiate as checked out. The response to its first
+ * request might arrive before the initiating thread checks it in, which
+ * then waits for the IKE_SA instead of dropping the response.
+ */
+static ike_sa_t *checkout_new_registered(private_ike_sa_manager_t *this,
+										 ike_version_t version)
+{
+	entry_t *entry;
+	ike_sa_t *ike_sa;
+	ike_sa_id_t *id;
+	u_int segment;
+
+	ike_sa = checkout_new(this, version, TRUE);
+	if (ike_sa)
+	{
+		id = ike_sa->get_id(ike_sa);
+		entry = entry_create();
+		entry->ike_sa_id = id->clone(id);
+		entry->ike_sa = ike_sa;
+		entry->checked_out = TRUE;
+		segment = put_entry(this, entry);
+		unlock_single_segment(this, segment);
+	}
+	return ike_sa;
+}
+
 METHOD(ike_sa_manager_t, checkout_by_config, ike_sa_t*,
 	private_ike_sa_manager_t *this, peer_cfg_t *peer_cfg)
 {
@@ -1342,12 +1445,13 @@ METHOD(ike_sa_manager_t, checkout_by_config, ike_sa_t*,
 
 	if (!this->reuse_ikesa)
 	{	/* IKE_SA reuse disable by config */
-		ike_sa = checkout_new(this, peer_cfg->get_ike_version(peer_cfg), TRUE);
+		ike_sa = checkout_new_registered(this,
+										 peer_cfg->get_ike_version(peer_cfg));
 		charon->bus->set_sa(charon->bus, ike_sa);
 		return ike_sa;
 	}
 
-	enumerator = create_table_enumerator(this);
+	enumerator = create_table_enumerator(this, 0, 1);
 	while (enumerator->enumerate(enumerator, &entry, &segment))
 	{
 		if (!wait_for_entry(this, entry, segment))
@@ -1378,7 +1482,8 @@ METHOD(ike_sa_manager_t, checkout_by_config, ike_sa_t*,
 
 	if (!ike_sa)
 	{	/* no IKE_SA using such a config, hand out a new */
-		ike_sa = checkout_new(this, peer_cfg->get_ike_version(peer_cfg), TRUE);
+		ike_sa = checkout_new_registered(this,
+										 peer_cfg->get_ike_version(peer_cfg));
 	}
 	charon->bus->set_sa(charon->bus, ike_sa);
 	return ike_sa;
@@ -1395,7 +1500,7 @@ METHOD(ike_sa_manager_t, checkout_by_id, ike_sa_t*,
 
 	DBG2(DBG_MGR, "checkout IKE_SA by ID");
 
-	enumerator = create_table_enumerator(this);
+	enumerator = create_table_enumerator(this, 0, 1);
 	while (enumerator->enumerate(enumerator, &entry, &segment))
 	{
 		if (wait_for_entry(this, entry, segment))
@@ -1446,7 +1551,7 @@ METHOD(ike_sa_manager_t, checkout_by_name, ike_sa_t*,
 	child_sa_t *child_sa;
 	u_int segment;
 
-	enumerator = create_table_enumerator(this);
+	enumerator = create_table_enumerator(this, 0, 1);
 	while (enumerator->enumerate(enumerator, &entry, &segment))
 	{
 		if (wait_for_entry(this, entry, segment))
@@ -1531,7 +1636,19 @@ static void reset_sa(void *data)
 METHOD(ike_sa_manager_t, create_enumerator, enumerator_t*,
 	private_ike_sa_manager_t* this, bool wait)
 {
-	return enumerator_create_filter(create_table_enumerator(this),
+	return enumerator_create_filter(create_table_enumerator(this, 0, 1),
+			wait ? (void*)enumerator_filter_wait : (void*)enumerator_filter_skip,
+			this, reset_sa);
+}
+
+METHOD(ike_sa_manager_t, create_part_enumerator, enumerator_t*,
+	private_ike_sa_manager_t* this, bool wait, u_int part, u_int parts)
+{
+	if (!parts || part >= parts)
+	{
+		return enumerator_create_empty();
+	}
+	return enumerator_create_filter(create_table_enumerator(this, part, parts),
 			wait ? (void*)enumerator_filter_wait : (void*)enumerator_filter_skip,
 			this, reset_sa);
 }
@@ -1626,6 +1743,7 @@ METHOD(ike_sa_manager_t, checkin, void,
 		}
 		put_connected_peers(this, entry);
 	}
+	summary_update(entry, ike_sa);
 
 	unlock_single_segment(this, segment);
 
@@ -1747,6 +1865,120 @@ METHOD(ike_sa_manager_t, create_id_enumerator, enumerator_t*,
 									 (void*)id_enumerator_cleanup, ids);
 }
 
+/**
+ * Enumerator over status summaries
+ */
+typedef struct {
+	/** implements enumerator_t */
+	enumerator_t public;
+	/** manager to enumerate */
+	private_ike_sa_manager_t *manager;
+	/** next table row to copy summaries from */
+	u_int row;
+	/** summaries copied from the current row, as ike_sa_summary_t* */
+	array_t *summaries;
+	/** currently enumerated summary */
+	ike_sa_summary_t *current;
+} summary_enumerator_t;
+
+/**
+ * Destroy a copied summary
+ */
+static void summary_destroy(ike_sa_summary_t *summary)
+{
+	if (summary)
+	{
+		summary_free(summary);
+		free(summary);
+	}
+}
+
+/**
+ * Copy the valid summaries in a row of the IKE_SA table
+ */
+static void copy_summaries(summary_enumerator_t *this, u_int row)
+{
+	private_ike_sa_manager_t *manager = this->manager;
+	ike_sa_summary_t *summary, *copy;
+	table_item_t *item;
+	entry_t *entry;
+	u_int segment;
+
+	segment = row & manager->segment_mask;
+	lock_single_segment(manager, segment);
+	for (item = manager->ike_sa_table[row]; item; item = item->next)
+	{
+		entry = item->value;
+		summary = &entry->summary;
+		if (!summary->name)
+		{	/* not yet checked in */
+			continue;
+		}
+		INIT(copy,
+			.unique_id = summary->unique_id,
+			.name = strdup(summary->name),
+			.version = summary->version,
+			.state = summary->state,
+			.id = entry->ike_sa_id->clone(entry->ike_sa_id),
+			.me = summary->me->clone(summary->me),
+			.other = summary->other->clone(summary->other),
+			.my_id = entry->my_id ? entry->my_id->clone(entry->my_id)
+								  : identification_create_from_encoding(
+														ID_ANY, chunk_empty),
+			.other_id = entry->other_id ?
+								entry->other_id->clone(entry->other_id)
+								: identification_create_from_encoding(
+														ID_ANY, chunk_empty),
+			.children = summary->children,
+			.established = summary->established,
+		);
+		array_insert(this->summaries, ARRAY_TAIL, copy);
+	}
+	unlock_single_segment(manager, segment);
+}
+
+METHOD(enumerator_t, summary_enumerate, bool,
+	summary_enumerator_t *this, ike_sa_summary_t **summary)
+{
+	summary_destroy(this->current);
+	this->current = NULL;
+
+	while (array_remove(this->summaries, ARRAY_HEAD, &this->current) == FALSE)
+	{
+		if (this->row >= this->manager->table_size)
+		{
+			return FALSE;
+		}
+		copy_summaries(this, this->row++);
+	}
+	*summary = this->current;
+	return TRUE;
+}
+
+METHOD(enumerator_t, summary_enumerator_destroy, void,
+	summary_enumerator_t *this)
+{
+	summary_destroy(this->current);
+	array_destroy_function(this->summaries, (void*)summary_destroy, NULL);
+	free(this);
+}
+
+METHOD(ike_sa_manager_t, create_summary_enumerator, enumerator_t*,
+	private_ike_sa_manager_t *this)
+{
+	summary_enumerator_t *enumerator;
+
+	INIT(enumerator,
+		.public = {
+			.enumerate = (void*)_summary_enumerate,
+			.destroy = _summary_enumerator_destroy,
+		},
+		.manager = this,
+		.summaries = array_create(0, 0),
+	);
+	return &enumerator->public;
+}
+
 /**
  * Move all CHILD_SAs from old to new
  */
@@ -1953,7 +2185,7 @@ METHOD(ike_sa_manager_t, flush, void,
 	DBG2(DBG_MGR, "going to destroy IKE_SA manager and all managed IKE_SA's");
 	/* Step 1: drive out all waiting threads  */
 	DBG2(DBG_MGR, "set driveout flags for all stored IKE_SA's");
-	enumerator = create_table_enumerator(this);
+	enumerator = create_table_enumerator(this, 0, 1);
 	while (enumerator->enumerate(enumerator, &entry, &segment))
 	{
 		/* do not accept new threads, drive out waiting threads */
@@ -1963,7 +2195,7 @@ METHOD(ike_sa_manager_t, flush, void,
 	enumerator->destroy(enumerator);
 	DBG2(DBG_MGR, "wait for all threads to leave IKE_SA's");
 	/* Step 2: wait until all are gone */
-	enumerator = create_table_enumerator(this);
+	enumerator = create_table_enumerator(this, 0, 1);
 	while (enumerator->enumerate(enumerator, &entry, &segment))
 	{
 		while (entry->waiting_threads || entry->checked_out)
@@ -1977,7 +2209,7 @@ METHOD(ike_sa_manager_t, flush, void,
 	enumerator->destroy(enumerator);
 	DBG2(DBG_MGR, "delete all IKE_SA's");
 	/* Step 3: initiate deletion of all IKE_SAs */
-	enumerator = create_table_enumerator(this);
+	enumerator = create_table_enumerator(this, 0, 1);
 	while (enumerator->enumerate(enumerator, &entry, &segment))
 	{
 		charon->bus->set_sa(charon->bus, entry->ike_sa);
@@ -2000,7 +2232,7 @@ METHOD(ike_sa_manager_t, flush, void,
 
 	DBG2(DBG_MGR, "destroy all entries");
 	/* Step 4: destroy all entries */
-	enumerator = create_table_enumerator(this);
+	enumerator = create_table_enumerator(this, 0, 1);
 	while (enumerator->enumerate(enumerator, &entry, &segment))
 	{
 		charon->bus->set_sa(charon->bus, entry->ike_sa);
@@ -2091,7 +2323,9 @@ ike_sa_manager_t *ike_sa_manager_create()
 			.check_uniqueness = _check_uniqueness,
 			.has_contact = _has_contact,
 			.create_enumerator = _create_enumerator,
+			.create_part_enumerator = _create_part_enumerator,
 			.create_id_enumerator = _create_id_enumerator,
+			.create_summary_enumerator = _create_summary_enumerator,
 			.checkin = _checkin,
 			.checkin_and_destroy = _checkin_and_destroy,
 			.get_count = _get_count,
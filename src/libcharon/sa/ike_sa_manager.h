@@ -24,10 +24,39 @@
 #define IKE_SA_MANAGER_H_
 
 typedef struct ike_sa_manager_t ike_sa_manager_t;
+typedef struct ike_sa_summary_t ike_sa_summary_t;
 
 #include <library.h>
 #include <sa/ike_sa.h>
 #include <encoding/message.h>
+
+/**
+ * Status summary of an IKE_SA, as recorded by the manager during check-in.
+ */
+struct ike_sa_summary_t {
+	/** unique ID of the IKE_SA */
+	u_int32_t unique_id;
+	/** name of the IKE_SA */
+	char *name;
+	/** IKE version */
+	ike_version_t version;
+	/** state of the IKE_SA */
+	ike_sa_state_t state;
+	/** SPIs and role of the IKE_SA */
+	ike_sa_id_t *id;
+	/** local host */
+	host_t *me;
+	/** remote host */
+	host_t *other;
+	/** local identity */
+	identification_t *my_id;
+	/** remote identity (XAuth/EAP identity, if any) */
+	identification_t *other_id;
+	/** number of CHILD_SAs */
+	u_int children;
+	/** time (monotonic) the IKE_SA got established, 0 if not */
+	time_t established;
+};
 #include <config/peer_cfg.h>
 
 /**
@@ -169,6 +198,21 @@ struct ike_sa_manager_t {
 	 */
 	enumerator_t *(*create_enumerator) (ike_sa_manager_t* this, bool wait);
 
+	/**
+	 * Create an enumerator over a part of the stored IKE_SAs.
+	 *
+	 * The segments of the IKE_SA table are split into parts, enumerators
+	 * over different parts do not lock the same segments and may run
+	 * concurrently. IKE_SAs are checked out as with create_enumerator().
+	 *
+	 * @param wait				TRUE to wait for checked out SAs, FALSE to skip
+	 * @param part				part to enumerate, 0 to parts - 1
+	 * @param parts				number of parts to split the table into
+	 * @return					enumerator over the IKE_SAs of the part
+	 */
+	enumerator_t *(*create_part_enumerator) (ike_sa_manager_t* this, bool wait,
+											 u_int part, u_int parts);
+
 	/**
 	 * Create an enumerator over ike_sa_id_t*, matching peer identities.
 	 *
@@ -183,6 +227,23 @@ struct ike_sa_manager_t {
 								identification_t *me, identification_t *other,
 								int family);
 
+	/**
+	 * Create an enumerator over the status summaries of all IKE_SAs.
+	 *
+	 * Other than create_enumerator(), this does not check out any IKE_SAs and
+	 * locks each hash table row only briefly to copy the summaries recorded
+	 * during check-in. Except for the number of CHILD_SAs, summaries are only
+	 * updated if the state of an IKE_SA changes, so the hosts might be
+	 * outdated (e.g. after a MOBIKE update). Identities are those used for
+	 * duplicate checks, i.e. %any until the IKE_SA is established.
+	 * IKE_SAs never checked in are skipped. As the order of the enumerated
+	 * IKE_SAs changes if IKE_SAs are added or removed, positions in it are
+	 * not stable across multiple enumerations.
+	 *
+	 * @return					enumerator over ike_sa_summary_t*
+	 */
+	enumerator_t* (*create_summary_enumerator)(ike_sa_manager_t *this);
+
 	/**
 	 * Checkin the SA after usage.
 	 *
@@ -78,6 +78,8 @@ METHOD(authenticator_t, build, status_t,
 	identification_t *id;
 	auth_cfg_t *auth;
 	signature_scheme_t scheme = SIGN_RSA_EMSA_PKCS1_NULL;
+	timeval_t start;
+	bool signed_ok;
 
 	if (this->type == KEY_ECDSA)
 	{
@@ -106,7 +108,10 @@ METHOD(authenticator_t, build, status_t,
 	}
 	free(dh.ptr);
 
-	if (private->sign(private, scheme, hash, &sig))
+	time_monotonic(&start);
+	signed_ok = private->sign(private, scheme, hash, &sig);
+	authenticator_record_signature(TRUE, scheme, &start);
+	if (signed_ok)
 	{
 		sig_payload = hash_payload_create(SIGNATURE_V1);
 		sig_payload->set_hash(sig_payload, sig);
@@ -138,6 +143,8 @@ METHOD(authenticator_t, process, status_t,
 	status_t status = NOT_FOUND;
 	identification_t *id;
 	signature_scheme_t scheme = SIGN_RSA_EMSA_PKCS1_NULL;
+	timeval_t start;
+	bool valid;
 
 	if (this->type == KEY_ECDSA)
 	{
@@ -169,7 +176,10 @@ METHOD(authenticator_t, process, status_t,
 														id, auth);
 	while (enumerator->enumerate(enumerator, &public, &current_auth))
 	{
-		if (public->verify(public, scheme, hash, sig))
+		time_monotonic(&start);
+		valid = public->verify(public, scheme, hash, sig);
+		authenticator_record_signature(FALSE, scheme, &start);
+		if (valid)
 		{
 			DBG1(DBG_IKE, "authentication of '%Y' with %N successful",
 				 id, key_type_names, this->type);
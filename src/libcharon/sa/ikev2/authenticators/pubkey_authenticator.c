@@ -66,6 +66,8 @@ METHOD(authenticator_t, build, status_t,
 	auth_method_t auth_method;
 	signature_scheme_t scheme;
 	keymat_v2_t *keymat;
+	timeval_t start;
+	bool signed_ok = FALSE;
 
 	id = this->ike_sa->get_my_id(this->ike_sa);
 	auth = this->ike_sa->get_auth_cfg(this->ike_sa, TRUE);
@@ -113,8 +115,13 @@ METHOD(authenticator_t, build, status_t,
 	}
 	keymat = (keymat_v2_t*)this->ike_sa->get_keymat(this->ike_sa);
 	if (keymat->get_auth_octets(keymat, FALSE, this->ike_sa_init,
-								this->nonce, id, this->reserved, &octets) &&
-		private->sign(private, scheme, octets, &auth_data))
+								this->nonce, id, this->reserved, &octets))
+	{
+		time_monotonic(&start);
+		signed_ok = private->sign(private, scheme, octets, &auth_data);
+		authenticator_record_signature(TRUE, scheme, &start);
+	}
+	if (signed_ok)
 	{
 		auth_payload = auth_payload_create();
 		auth_payload->set_auth_method(auth_payload, auth_method);
@@ -146,6 +153,8 @@ METHOD(authenticator_t, process, status_t,
 	signature_scheme_t scheme;
 	status_t status = NOT_FOUND;
 	keymat_v2_t *keymat;
+	timeval_t start;
+	bool valid;
 
 	auth_payload = (auth_payload_t*)message->get_payload(message, AUTHENTICATION);
 	if (!auth_payload)
@@ -186,7 +195,10 @@ METHOD(authenticator_t, process, status_t,
 														key_type, id, auth);
 	while (enumerator->enumerate(enumerator, &public, &current_auth))
 	{
-		if (public->verify(public, scheme, octets, auth_data))
+		time_monotonic(&start);
+		valid = public->verify(public, scheme, octets, auth_data);
+		authenticator_record_signature(FALSE, scheme, &start);
+		if (valid)
 		{
 			DBG1(DBG_IKE, "authentication of '%Y' with %N successful",
 						   id, auth_method_names, auth_method);
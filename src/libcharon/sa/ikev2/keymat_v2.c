@@ -60,6 +60,11 @@ struct private_keymat_v2_t {
 	 */
 	chunk_t skd;
 
+	/**
+	 * PRF keyed with SK_d, to derive CHILD_SA keys without re-keying
+	 */
+	prf_t *prf_skd;
+
 	/**
 	 * Key to build outging authentication data (SKp)
 	 */
@@ -374,6 +379,11 @@ METHOD(keymat_v2_t, derive_ike_keys, bool,
 		goto failure;
 	}
 	DBG4(DBG_IKE, "Sk_d secret %B", &this->skd);
+	this->prf_skd = lib->crypto->create_prf(lib->crypto, this->prf_alg);
+	if (!this->prf_skd || !this->prf_skd->set_key(this->prf_skd, this->skd))
+	{
+		goto failure;
+	}
 
 	if (!proposal->get_algorithm(proposal, ENCRYPTION_ALGORITHM, &alg, &key_size))
 	{
@@ -447,8 +457,7 @@ METHOD(keymat_v2_t, derive_child_keys, bool,
 	chunk_t *encr_r, chunk_t *integ_r)
 {
 	u_int16_t enc_alg, int_alg, enc_size = 0, int_size = 0;
-	chunk_t seed, secret = chunk_empty;
-	prf_plus_t *prf_plus;
+	chunk_t seed, keymat, secret = chunk_empty;
 
 	if (dh)
 	{
@@ -523,31 +532,31 @@ METHOD(keymat_v2_t, derive_child_keys, bool,
 		int_size /= 8;
 	}
 
-	if (!this->prf->set_key(this->prf, this->skd))
-	{
-		return FALSE;
-	}
-	prf_plus = prf_plus_create(this->prf, TRUE, seed);
-	if (!prf_plus)
+	/* derive all keys at once, in the order defined by RFC 5996 2.17 */
+	if (!this->prf_skd)
 	{
 		return FALSE;
 	}
-
-	*encr_i = *integ_i = *encr_r = *integ_r = chunk_empty;
-	if (!prf_plus->allocate_bytes(prf_plus, enc_size, encr_i) ||
-		!prf_plus->allocate_bytes(prf_plus, int_size, integ_i) ||
-		!prf_plus->allocate_bytes(prf_plus, enc_size, encr_r) ||
-		!prf_plus->allocate_bytes(prf_plus, int_size, integ_r))
+	keymat = chunk_alloca(2 * (enc_size + int_size));
+	if (!prf_plus_fill(this->prf_skd, TRUE, seed, keymat))
 	{
-		chunk_free(encr_i);
-		chunk_free(integ_i);
-		chunk_free(encr_r);
-		chunk_free(integ_r);
-		prf_plus->destroy(prf_plus);
+		memwipe(keymat.ptr, keymat.len);
+		/* the PRF might hold partial input of the failed operation, which
+		 * would corrupt all later keys derived from SK_d, so reset it */
+		if (!this->prf_skd->set_key(this->prf_skd, this->skd))
+		{
+			this->prf_skd->destroy(this->prf_skd);
+			this->prf_skd = NULL;
+		}
 		return FALSE;
 	}
-
-	prf_plus->destroy(prf_plus);
+	*encr_i = chunk_clone(chunk_create(keymat.ptr, enc_size));
+	*integ_i = chunk_clone(chunk_create(keymat.ptr + enc_size, int_size));
+	*encr_r = chunk_clone(chunk_create(keymat.ptr + enc_size + int_size,
+									   enc_size));
+	*integ_r = chunk_clone(chunk_create(keymat.ptr + 2 * enc_size + int_size,
+										int_size));
+	memwipe(keymat.ptr, keymat.len);
 
 	if (enc_size)
 	{
@@ -651,6 +660,7 @@ METHOD(keymat_t, destroy, void,
 	DESTROY_IF(this->aead_in);
 	DESTROY_IF(this->aead_out);
 	DESTROY_IF(this->prf);
+	DESTROY_IF(this->prf_skd);
 	chunk_clear(&this->skd);
 	chunk_clear(&this->skp_verify);
 	chunk_clear(&this->skp_build);
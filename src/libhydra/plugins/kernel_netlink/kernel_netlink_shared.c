@@ -54,6 +54,11 @@ struct private_netlink_socket_t {
 	 * netlink socket
 	 */
 	int socket;
+
+	/**
+	 * Round trip time of requests, NULL if metrics are disabled
+	 */
+	histogram_t *rtt;
 };
 
 /**
@@ -69,9 +74,15 @@ METHOD(netlink_socket_t, netlink_send, status_t,
 	struct sockaddr_nl addr;
 	chunk_t result = chunk_empty, tmp;
 	struct nlmsghdr *msg, peek;
+	timeval_t start;
 
 	this->mutex->lock(this->mutex);
 
+	if (this->rtt)
+	{
+		time_monotonic(&start);
+	}
+
 	in->nlmsg_seq = ++this->seq;
 	in->nlmsg_pid = getpid();
 
@@ -175,6 +186,10 @@ METHOD(netlink_socket_t, netlink_send, status_t,
 	*out_len = result.len;
 	*out = (struct nlmsghdr*)result.ptr;
 
+	if (this->rtt)
+	{
+		this->rtt->record_since(this->rtt, &start);
+	}
 	this->mutex->unlock(this->mutex);
 
 	return SUCCESS;
@@ -262,6 +277,15 @@ netlink_socket_t *netlink_socket_create(int protocol)
 		.protocol = protocol,
 	);
 
+	if (lib->metrics)
+	{
+		this->rtt = lib->metrics->histogram(lib->metrics,
+						"strongswan_kernel_netlink_rtt_seconds",
+						protocol == NETLINK_XFRM ? "socket=\"xfrm\""
+												 : "socket=\"route\"",
+						"Round trip time of netlink requests");
+	}
+
 	memset(&addr, 0, sizeof(addr));
 	addr.nl_family = AF_NETLINK;
 
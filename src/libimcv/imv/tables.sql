@@ -211,6 +211,37 @@ CREATE INDEX versions_package_product ON versions (
   package, product
 );
 
+DROP TABLE IF EXISTS package_changes;
+CREATE TABLE package_changes (
+  counter INTEGER NOT NULL
+);
+INSERT INTO package_changes (counter) VALUES (0);
+
+DROP TRIGGER IF EXISTS packages_insert;
+CREATE TRIGGER packages_insert AFTER INSERT ON packages BEGIN
+  UPDATE package_changes SET counter = counter + 1;
+END;
+DROP TRIGGER IF EXISTS packages_update;
+CREATE TRIGGER packages_update AFTER UPDATE ON packages BEGIN
+  UPDATE package_changes SET counter = counter + 1;
+END;
+DROP TRIGGER IF EXISTS packages_delete;
+CREATE TRIGGER packages_delete AFTER DELETE ON packages BEGIN
+  UPDATE package_changes SET counter = counter + 1;
+END;
+DROP TRIGGER IF EXISTS versions_insert;
+CREATE TRIGGER versions_insert AFTER INSERT ON versions BEGIN
+  UPDATE package_changes SET counter = counter + 1;
+END;
+DROP TRIGGER IF EXISTS versions_update;
+CREATE TRIGGER versions_update AFTER UPDATE ON versions BEGIN
+  UPDATE package_changes SET counter = counter + 1;
+END;
+DROP TRIGGER IF EXISTS versions_delete;
+CREATE TRIGGER versions_delete AFTER DELETE ON versions BEGIN
+  UPDATE package_changes SET counter = counter + 1;
+END;
+
 DROP TABLE IF EXISTS devices;
 CREATE TABLE devices (
   id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
@@ -16,10 +16,56 @@
 #include "imv_os_database.h"
 
 #include <utils/debug.h>
+#include <collections/hashtable.h>
+#include <threading/mutex.h>
 
 #include <string.h>
 
+/**
+ * Minimum interval in seconds between checks for package database updates
+ */
+#define CACHE_CHECK_INTERVAL 1
+
+/**
+ * Maximum lifetime in seconds of cache entries if the package database does
+ * not provide a change counter
+ */
+#define CACHE_TTL 60
+
 typedef struct private_imv_os_database_t private_imv_os_database_t;
+typedef struct cache_entry_t cache_entry_t;
+
+/**
+ * Security status of an installed package version
+ */
+typedef enum {
+	/** package not in database */
+	PACKAGE_NOT_FOUND,
+	/** no versions of package registered for product */
+	PACKAGE_NO_VERSIONS,
+	/** acceptable version */
+	PACKAGE_OK,
+	/** acceptable version fixing security issues */
+	PACKAGE_OK_SECURITY,
+	/** blacklisted version */
+	PACKAGE_BLACKLISTED,
+	/** version not matching any acceptable version */
+	PACKAGE_NO_MATCH,
+} package_status_t;
+
+/**
+ * Cached security status of a package version, in LRU order
+ */
+struct cache_entry_t {
+	/** product, package and release, separated by a zero byte */
+	chunk_t key;
+	/** security status of package version */
+	package_status_t status;
+	/** more recently used entry */
+	cache_entry_t *prev;
+	/** less recently used entry */
+	cache_entry_t *next;
+};
 
 /**
  * Private data of a imv_os_database_t object.
@@ -37,20 +83,335 @@ struct private_imv_os_database_t {
 	 */
 	database_t *db;
 
+	/**
+	 * Cached package status, chunk_t => cache_entry_t, NULL if disabled
+	 */
+	hashtable_t *cache;
+
+	/**
+	 * Most recently used cache entry
+	 */
+	cache_entry_t *head;
+
+	/**
+	 * Least recently used cache entry
+	 */
+	cache_entry_t *tail;
+
+	/**
+	 * Maximum number of cache entries
+	 */
+	u_int cache_size;
+
+	/**
+	 * Time of the last check for package database updates
+	 */
+	time_t checked;
+
+	/**
+	 * Does the package database provide a change counter?
+	 */
+	bool counter;
+
+	/**
+	 * Value of the change counter at the last check, to detect updates
+	 */
+	int changes;
+
+	/**
+	 * Time of the last cache flush
+	 */
+	time_t flushed;
+
+	/**
+	 * Incremented whenever the cache gets flushed due to updates
+	 */
+	u_int generation;
+
+	/**
+	 * Mutex to lock cache
+	 */
+	mutex_t *mutex;
 };
 
+/**
+ * Hashtable hash function
+ */
+static u_int cache_hash(chunk_t *key)
+{
+	return chunk_hash(*key);
+}
+
+/**
+ * Hashtable equals function
+ */
+static bool cache_equals(chunk_t *a, chunk_t *b)
+{
+	return chunk_equals(*a, *b);
+}
+
+/**
+ * Unlink a cache entry from the LRU list
+ */
+static void lru_remove(private_imv_os_database_t *this, cache_entry_t *entry)
+{
+	if (entry->prev)
+	{
+		entry->prev->next = entry->next;
+	}
+	else
+	{
+		this->head = entry->next;
+	}
+	if (entry->next)
+	{
+		entry->next->prev = entry->prev;
+	}
+	else
+	{
+		this->tail = entry->prev;
+	}
+}
+
+/**
+ * Insert a cache entry as most recently used into the LRU list
+ */
+static void lru_insert(private_imv_os_database_t *this, cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = this->head;
+	if (this->head)
+	{
+		this->head->prev = entry;
+	}
+	else
+	{
+		this->tail = entry;
+	}
+	this->head = entry;
+}
+
+/**
+ * Remove all cache entries
+ */
+static void flush_cache(private_imv_os_database_t *this)
+{
+	cache_entry_t *entry;
+
+	while (this->head)
+	{
+		entry = this->head;
+		this->head = entry->next;
+		this->cache->remove(this->cache, &entry->key);
+		free(entry->key.ptr);
+		free(entry);
+	}
+	this->tail = NULL;
+}
+
+/**
+ * Get the value of the change counter maintained by triggers on the packages
+ * and versions tables
+ */
+static bool get_changes(private_imv_os_database_t *this, int *changes)
+{
+	enumerator_t *e;
+	bool found = FALSE;
+
+	e = this->db->query(this->db,
+				"SELECT counter FROM package_changes", DB_INT);
+	if (e)
+	{
+		found = e->enumerate(e, changes);
+		e->destroy(e);
+	}
+	return found;
+}
+
+/**
+ * Flush the cache if the package database has been updated since the last
+ * check, which is done at most every CACHE_CHECK_INTERVAL seconds. Without a
+ * change counter, the cache gets flushed every CACHE_TTL seconds.
+ */
+static void check_cache(private_imv_os_database_t *this)
+{
+	int changes = -1;
+	time_t now;
+
+	now = time_monotonic(NULL);
+	if (now - this->checked < CACHE_CHECK_INTERVAL)
+	{
+		return;
+	}
+	this->checked = now;
+
+	if (this->counter)
+	{
+		if (get_changes(this, &changes) && changes == this->changes)
+		{
+			return;
+		}
+		/* flush on every check while the counter can't be read */
+		this->changes = changes;
+	}
+	else if (now - this->flushed < CACHE_TTL)
+	{
+		return;
+	}
+	if (this->head)
+	{
+		DBG2(DBG_IMV, "package database updated, flushing package cache");
+	}
+	flush_cache(this);
+	this->flushed = now;
+	this->generation++;
+}
+
+/**
+ * Look up the cached security status of a package version
+ */
+static bool cache_lookup(private_imv_os_database_t *this, chunk_t key,
+						 package_status_t *status, u_int *generation)
+{
+	cache_entry_t *entry;
+	bool found = FALSE;
+
+	if (!this->cache)
+	{
+		return FALSE;
+	}
+	this->mutex->lock(this->mutex);
+	check_cache(this);
+	*generation = this->generation;
+	entry = this->cache->get(this->cache, &key);
+	if (entry)
+	{
+		lru_remove(this, entry);
+		lru_insert(this, entry);
+		*status = entry->status;
+		found = TRUE;
+	}
+	this->mutex->unlock(this->mutex);
+
+	return found;
+}
+
+/**
+ * Cache the security status of a package version, evicting the least
+ * recently used entry if the cache is full. The status is not cached if the
+ * package database got updated since the lookup of the given generation.
+ */
+static void cache_store(private_imv_os_database_t *this, chunk_t key,
+						package_status_t status, u_int generation)
+{
+	cache_entry_t *entry;
+
+	if (!this->cache)
+	{
+		return;
+	}
+	this->mutex->lock(this->mutex);
+	if (generation != this->generation)
+	{
+		this->mutex->unlock(this->mutex);
+		return;
+	}
+	entry = this->cache->get(this->cache, &key);
+	if (entry)
+	{	/* stored concurrently */
+		entry->status = status;
+		this->mutex->unlock(this->mutex);
+		return;
+	}
+	if (this->cache->get_count(this->cache) >= this->cache_size)
+	{
+		entry = this->tail;
+		lru_remove(this, entry);
+		this->cache->remove(this->cache, &entry->key);
+		free(entry->key.ptr);
+		free(entry);
+	}
+	INIT(entry,
+		.key = chunk_clone(key),
+		.status = status,
+	);
+	lru_insert(this, entry);
+	this->cache->put(this->cache, &entry->key, entry);
+	this->mutex->unlock(this->mutex);
+}
+
+/**
+ * Get the security status of a package version from the database
+ */
+static status_t get_status(private_imv_os_database_t *this, int pid,
+						   char *package, char *release,
+						   package_status_t *status)
+{
+	char *cur_release;
+	int gid, security, blacklist;
+	enumerator_t *e;
+
+	/* Get primary key of package */
+	e = this->db->query(this->db,
+				"SELECT id FROM packages WHERE name = ?",
+				DB_TEXT, package, DB_INT);
+	if (!e)
+	{
+		return FAILED;
+	}
+	if (!e->enumerate(e, &gid))
+	{
+		e->destroy(e);
+		*status = PACKAGE_NOT_FOUND;
+		return SUCCESS;
+	}
+	e->destroy(e);
+
+	/* Enumerate over all acceptable versions */
+	e = this->db->query(this->db,
+			"SELECT release, security, blacklist FROM versions "
+			"WHERE product = ? AND package = ?",
+			DB_INT, pid, DB_INT, gid, DB_TEXT, DB_INT, DB_INT);
+	if (!e)
+	{
+		return FAILED;
+	}
+	*status = PACKAGE_NO_VERSIONS;
+
+	while (e->enumerate(e, &cur_release, &security, &blacklist))
+	{
+		*status = PACKAGE_NO_MATCH;
+		if (streq(release, cur_release) || streq("*", cur_release))
+		{
+			if (blacklist)
+			{
+				*status = PACKAGE_BLACKLISTED;
+			}
+			else
+			{
+				*status = security ? PACKAGE_OK_SECURITY : PACKAGE_OK;
+			}
+			break;
+		}
+	}
+	e->destroy(e);
+
+	return SUCCESS;
+}
+
 METHOD(imv_os_database_t, check_packages, status_t,
 	private_imv_os_database_t *this, imv_os_state_t *state,
 	enumerator_t *package_enumerator)
 {
-	char *product, *package, *release, *cur_release;
-	chunk_t name, version;
+	char *product, *package, *release;
+	chunk_t name, version, key;
 	os_type_t os_type;
-	int pid, gid, security, blacklist;
+	package_status_t package_status;
+	u_int generation = 0;
+	int pid;
 	int count = 0, count_ok = 0, count_no_match = 0, count_blacklist = 0;
 	enumerator_t *e;
 	status_t status = SUCCESS;
-	bool found, match;
 
 	product = state->get_info(state, &os_type, NULL, NULL);
 
@@ -67,6 +428,7 @@ METHOD(imv_os_database_t, check_packages, status_t,
 				DB_TEXT, product, DB_INT);
 	if (!e)
 	{
+		return FAILED;
 	}
 	if (!e->enumerate(e, &pid))
 	{
@@ -77,94 +439,66 @@ METHOD(imv_os_database_t, check_packages, status_t,
 
 	while (package_enumerator->enumerate(package_enumerator, &name, &version))
 	{
-		/* Convert package name chunk to a string */
-		package = strndup(name.ptr, name.len);
 		count++;
 
-		/* Get primary key of package */
-		e = this->db->query(this->db,
-					"SELECT id FROM packages WHERE name = ?",
-					DB_TEXT, package, DB_INT);
-		if (!e)
-		{
-			free(package);
-			return FAILED;
-		}
-		if (!e->enumerate(e, &gid))
-		{
-			/* package not present in database for any product - skip */
-			if (os_type == OS_TYPE_ANDROID)
-			{
-				DBG2(DBG_IMV, "package '%s' (%.*s) not found",
-					 package, version.len, version.ptr);
-			}
-			free(package);
-			e->destroy(e);
-			continue;
-		}
-		e->destroy(e);
-
-		/* Convert package version chunk to a string */
-		release = strndup(version.ptr, version.len);
-
-		/* Enumerate over all acceptable versions */
-		e = this->db->query(this->db,
-				"SELECT release, security, blacklist FROM versions "
-				"WHERE product = ? AND package = ?",
-				DB_INT, pid, DB_INT, gid, DB_TEXT, DB_INT, DB_INT);
-		if (!e)
+		key = chunk_cat("ccccc", chunk_from_str(product), chunk_from_chars(0),
+						name, chunk_from_chars(0), version);
+		if (!cache_lookup(this, key, &package_status, &generation))
 		{
+			/* Convert package name and version chunks to strings */
+			package = strndup(name.ptr, name.len);
+			release = strndup(version.ptr, version.len);
+			status = get_status(this, pid, package, release, &package_status);
 			free(package);
 			free(release);
-			return FAILED;
-		}
-		found = FALSE;
-		match = FALSE;
-
-		while (e->enumerate(e, &cur_release, &security, &blacklist))
-		{
-			found = TRUE;
-			if (streq(release, cur_release) || streq("*", cur_release))
+			if (status != SUCCESS)
 			{
-				match = TRUE;
-				break;
+				free(key.ptr);
+				return status;
 			}
+			cache_store(this, key, package_status, generation);
 		}
-		e->destroy(e);
+		free(key.ptr);
 
-		if (found)
+		switch (package_status)
 		{
-			if (match)
-			{
-				if (blacklist)
+			case PACKAGE_NOT_FOUND:
+				/* package not present in database for any product - skip */
+				if (os_type == OS_TYPE_ANDROID)
 				{
-					DBG2(DBG_IMV, "package '%s' (%s) is blacklisted",
-								   package, release);
-					count_blacklist++;
-					state->add_bad_package(state, package,
-										   OS_PACKAGE_STATE_BLACKLIST);
+					DBG2(DBG_IMV, "package '%.*s' (%.*s) not found",
+						 name.len, name.ptr, version.len, version.ptr);
 				}
-				else
-				{
-					DBG2(DBG_IMV, "package '%s' (%s)%s is ok", package, release,
-								   security ? " [s]" : "");
-					count_ok++;
-				}
-			}
-			else
-			{
-				DBG1(DBG_IMV, "package '%s' (%s) no match", package, release);
+				break;
+			case PACKAGE_NO_VERSIONS:
+				/* package not present in database for this product - skip */
+				break;
+			case PACKAGE_BLACKLISTED:
+				DBG2(DBG_IMV, "package '%.*s' (%.*s) is blacklisted",
+					 name.len, name.ptr, version.len, version.ptr);
+				count_blacklist++;
+				package = strndup(name.ptr, name.len);
+				state->add_bad_package(state, package,
+									   OS_PACKAGE_STATE_BLACKLIST);
+				free(package);
+				break;
+			case PACKAGE_OK:
+			case PACKAGE_OK_SECURITY:
+				DBG2(DBG_IMV, "package '%.*s' (%.*s)%s is ok",
+					 name.len, name.ptr, version.len, version.ptr,
+					 package_status == PACKAGE_OK_SECURITY ? " [s]" : "");
+				count_ok++;
+				break;
+			case PACKAGE_NO_MATCH:
+				DBG1(DBG_IMV, "package '%.*s' (%.*s) no match",
+					 name.len, name.ptr, version.len, version.ptr);
 				count_no_match++;
+				package = strndup(name.ptr, name.len);
 				state->add_bad_package(state, package,
 									   OS_PACKAGE_STATE_SECURITY);
-			}
-		}
-		else
-		{
-			/* package not present in database for this product - skip */
+				free(package);
+				break;
 		}
-		free(package);
-		free(release);
 	}
 	state->set_count(state, count, count_no_match, count_blacklist, count_ok);
 
@@ -185,6 +519,12 @@ METHOD(imv_os_database_t, set_device_info, void,
 METHOD(imv_os_database_t, destroy, void,
 	private_imv_os_database_t *this)
 {
+	if (this->cache)
+	{
+		flush_cache(this);
+		this->cache->destroy(this->cache);
+	}
+	this->mutex->destroy(this->mutex);
 	free(this);
 }
 
@@ -207,8 +547,24 @@ imv_os_database_t *imv_os_database_create(imv_database_t *imv_db)
 			.destroy = _destroy,
 		},
 		.db = imv_db->get_database(imv_db),
+		.cache_size = lib->settings->get_int(lib->settings,
+							"libimcv.plugins.imv-os.cache_size", 10000),
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 	);
 
+	if (this->cache_size)
+	{
+		this->cache = hashtable_create((hashtable_hash_t)cache_hash,
+									   (hashtable_equals_t)cache_equals, 1024);
+		this->counter = get_changes(this, &this->changes);
+		if (!this->counter)
+		{
+			DBG1(DBG_IMV, "package database has no change counter, package "
+				 "cache entries expire after %d seconds", CACHE_TTL);
+		}
+		this->checked = this->flushed = time_monotonic(NULL);
+	}
+
 	return &this->public;
 }
 
@@ -16,11 +16,17 @@
 #include "pts_file_meas.h"
 
 #include <collections/linked_list.h>
+#include <collections/hashtable.h>
+#include <threading/mutex.h>
+#include <threading/thread.h>
 #include <utils/debug.h>
 
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <libgen.h>
 #include <errno.h>
+#include <time.h>
 
 typedef struct private_pts_file_meas_t private_pts_file_meas_t;
 
@@ -235,47 +241,476 @@ pts_file_meas_t *pts_file_meas_create(u_int16_t request_id)
 }
 
 /**
- * Hash a file with a given absolute pathname
+ * Key of a cached file measurement
+ */
+typedef struct {
+	/** device of the file */
+	dev_t dev;
+	/** inode of the file */
+	ino_t ino;
+	/** hash algorithm used */
+	hash_algorithm_t alg;
+} cache_key_t;
+
+typedef struct cache_entry_t cache_entry_t;
+
+/**
+ * Cached file measurement
+ */
+struct cache_entry_t {
+	/** lookup key, must be first */
+	cache_key_t key;
+	/** previous entry in LRU list, more recently used */
+	cache_entry_t *prev;
+	/** next entry in LRU list, less recently used */
+	cache_entry_t *next;
+	/** modification time of the measured file */
+	time_t mtime;
+	/** status change time of the measured file */
+	time_t ctime;
+	/** size of the measured file */
+	off_t size;
+	/** file measurement */
+	u_char hash[HASH_SIZE_SHA384];
+};
+
+/**
+ * Cached file measurements, cache_key_t => cache_entry_t, NULL if disabled
  */
-static bool hash_file(hasher_t *hasher, char *pathname, u_char *hash)
+static hashtable_t *cache;
+
+/**
+ * Most recently used cache entry
+ */
+static cache_entry_t *cache_head;
+
+/**
+ * Least recently used cache entry, evicted first
+ */
+static cache_entry_t *cache_tail;
+
+/**
+ * Maximum number of cached measurements
+ */
+static u_int cache_max;
+
+/**
+ * Mutex to lock cache
+ */
+static mutex_t *cache_mutex;
+
+/**
+ * Hashtable hash function
+ */
+static u_int cache_hash(cache_key_t *key)
 {
-	u_char buffer[4096];
-	size_t bytes_read;
-	bool success = TRUE;
-	FILE *file;
+	return chunk_hash(chunk_from_thing(*key));
+}
 
-	file = fopen(pathname, "rb");
-	if (!file)
+/**
+ * Hashtable equals function
+ */
+static bool cache_equals(cache_key_t *a, cache_key_t *b)
+{
+	return memeq(a, b, sizeof(cache_key_t));
+}
+
+/**
+ * Initialize a cache key for a file
+ */
+static void cache_key_init(cache_key_t *key, struct stat *st,
+						   hash_algorithm_t alg)
+{
+	/* zero padding, as the complete key gets hashed */
+	memset(key, 0, sizeof(*key));
+	key->dev = st->st_dev;
+	key->ino = st->st_ino;
+	key->alg = alg;
+}
+
+/**
+ * Unlink an entry from the LRU list of the cache
+ */
+static void lru_remove(cache_entry_t *entry)
+{
+	if (entry->prev)
+	{
+		entry->prev->next = entry->next;
+	}
+	else
+	{
+		cache_head = entry->next;
+	}
+	if (entry->next)
+	{
+		entry->next->prev = entry->prev;
+	}
+	else
+	{
+		cache_tail = entry->prev;
+	}
+}
+
+/**
+ * Insert an entry as most recently used into the LRU list of the cache
+ */
+static void lru_insert(cache_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache_head;
+	if (cache_head)
+	{
+		cache_head->prev = entry;
+	}
+	else
+	{
+		cache_tail = entry;
+	}
+	cache_head = entry;
+}
+
+/**
+ * Look up a cached measurement of an unchanged file
+ */
+static bool cache_lookup(struct stat *st, hash_algorithm_t alg, u_char *hash,
+						 size_t hash_len)
+{
+	cache_entry_t *entry;
+	cache_key_t key;
+	bool found = FALSE;
+
+	if (!cache)
 	{
-		DBG1(DBG_PTS,"  file '%s' can not be opened, %s", pathname,
-			 strerror(errno));
 		return FALSE;
 	}
+	cache_key_init(&key, st, alg);
+
+	cache_mutex->lock(cache_mutex);
+	entry = cache->get(cache, &key);
+	if (entry && entry->mtime == st->st_mtime &&
+		entry->ctime == st->st_ctime && entry->size == st->st_size)
+	{
+		memcpy(hash, entry->hash, hash_len);
+		lru_remove(entry);
+		lru_insert(entry);
+		found = TRUE;
+	}
+	cache_mutex->unlock(cache_mutex);
+
+	return found;
+}
+
+/**
+ * Cache the measurement of a file
+ */
+static void cache_store(struct stat *st, hash_algorithm_t alg, u_char *hash,
+						size_t hash_len, time_t started)
+{
+	cache_entry_t *entry;
+
+	/* timestamps have a resolution of a second, so a file changed in the
+	 * same second it got measured could go unnoticed */
+	if (!cache || st->st_mtime >= started || st->st_ctime >= started)
+	{
+		return;
+	}
+	INIT(entry,
+		.mtime = st->st_mtime,
+		.ctime = st->st_ctime,
+		.size = st->st_size,
+	);
+	cache_key_init(&entry->key, st, alg);
+	memcpy(entry->hash, hash, hash_len);
+
+	cache_mutex->lock(cache_mutex);
+	lru_insert(entry);
+	entry = cache->put(cache, &entry->key, entry);
+	if (entry)
+	{	/* replaced a measurement of an older version of the file */
+		lru_remove(entry);
+		free(entry);
+	}
+	else if (cache->get_count(cache) > cache_max)
+	{
+		entry = cache_tail;
+		lru_remove(entry);
+		cache->remove(cache, &entry->key);
+		free(entry);
+	}
+	cache_mutex->unlock(cache_mutex);
+}
+
+/**
+ * See header
+ */
+void pts_file_meas_cache_init(void)
+{
+	if (lib->settings->get_bool(lib->settings,
+						"libimcv.plugins.imc-attestation.hash_cache", TRUE))
+	{
+		cache_max = lib->settings->get_int(lib->settings,
+						"libimcv.plugins.imc-attestation.hash_cache_size", 16384);
+		cache_max = max(cache_max, 1);
+		cache = hashtable_create((hashtable_hash_t)cache_hash,
+								 (hashtable_equals_t)cache_equals, 128);
+		cache_mutex = mutex_create(MUTEX_TYPE_DEFAULT);
+	}
+}
+
+/**
+ * See header
+ */
+void pts_file_meas_cache_deinit(void)
+{
+	cache_entry_t *entry;
+
+	if (cache)
+	{
+		while (cache_head)
+		{
+			entry = cache_head;
+			cache_head = entry->next;
+			free(entry);
+		}
+		cache_tail = NULL;
+		cache->destroy(cache);
+		cache_mutex->destroy(cache_mutex);
+		cache = NULL;
+	}
+}
+
+/**
+ * Hash the contents of an open file by reading it
+ */
+static bool hash_fd(hasher_t *hasher, int fd, u_char *hash)
+{
+	u_char buffer[16384];
+	ssize_t bytes_read;
+
 	while (TRUE)
 	{
-		bytes_read = fread(buffer, 1, sizeof(buffer), file);
-		if (bytes_read > 0)
+		bytes_read = read(fd, buffer, sizeof(buffer));
+		if (bytes_read < 0)
 		{
-			if (!hasher->get_hash(hasher, chunk_create(buffer, bytes_read), NULL))
+			if (errno == EINTR)
 			{
-				DBG1(DBG_PTS, "  hasher increment error");
-				success = FALSE;
-				break;
+				continue;
 			}
+			DBG1(DBG_PTS, "  reading file failed: %s", strerror(errno));
+			return FALSE;
 		}
-		else
+		if (bytes_read == 0)
+		{
+			break;
+		}
+		if (!hasher->get_hash(hasher, chunk_create(buffer, bytes_read), NULL))
+		{
+			DBG1(DBG_PTS, "  hasher increment error");
+			return FALSE;
+		}
+	}
+	if (!hasher->get_hash(hasher, chunk_empty, hash))
+	{
+		DBG1(DBG_PTS, "  hasher finalize error");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Check if a file has not been changed since it got stat()ed
+ */
+static bool unchanged(int fd, struct stat *st)
+{
+	struct stat now;
+
+	return fstat(fd, &now) == 0 && now.st_mtime == st->st_mtime &&
+		   now.st_ctime == st->st_ctime && now.st_size == st->st_size;
+}
+
+/**
+ * Hash a file with a given absolute pathname
+ */
+static bool hash_file(hasher_t *hasher, hash_algorithm_t alg, char *pathname,
+					  u_char *hash)
+{
+	struct stat st;
+	time_t started;
+	bool success;
+	int fd;
+
+	fd = open(pathname, O_RDONLY);
+	if (fd == -1 || fstat(fd, &st) == -1)
+	{
+		DBG1(DBG_PTS,"  file '%s' can not be opened, %s", pathname,
+			 strerror(errno));
+		if (fd != -1)
+		{
+			close(fd);
+		}
+		return FALSE;
+	}
+	if (S_ISREG(st.st_mode) &&
+		cache_lookup(&st, alg, hash, hasher->get_hash_size(hasher)))
+	{
+		close(fd);
+		return TRUE;
+	}
+	started = time(NULL);
+
+	/* files are read rather than mapped, as a file truncated while mapped
+	 * would raise SIGBUS */
+	success = hash_fd(hasher, fd, hash);
+
+	/* don't cache a measurement of a file changed while reading it */
+	if (success && S_ISREG(st.st_mode) && unchanged(fd, &st))
+	{
+		cache_store(&st, alg, hash, hasher->get_hash_size(hasher), started);
+	}
+	close(fd);
+	return success;
+}
+
+/**
+ * File of a directory to measure
+ */
+typedef struct {
+	/** relative filename */
+	char *rel_name;
+	/** absolute filename */
+	char *abs_name;
+	/** file measurement */
+	u_char hash[HASH_SIZE_SHA384];
+	/** TRUE if measurement successful */
+	bool success;
+} dir_file_t;
+
+/**
+ * Files of a directory, hashed by multiple threads
+ */
+typedef struct {
+	/** hash algorithm to use */
+	hash_algorithm_t alg;
+	/** files to measure */
+	dir_file_t *files;
+	/** number of files */
+	u_int count;
+	/** number of files handed out to threads */
+	refcount_t next;
+} dir_job_t;
+
+/**
+ * Measure files of a directory, until all files are handed out
+ */
+static void hash_dir_files(dir_job_t *job, hasher_t *hasher)
+{
+	dir_file_t *file;
+	u_int i;
+
+	while ((i = ref_get(&job->next)) <= job->count)
+	{
+		file = &job->files[i - 1];
+		file->success = hash_file(hasher, job->alg, file->abs_name,
+								  file->hash);
+	}
+}
+
+/**
+ * Thread measuring files of a directory with its own hasher
+ */
+static void *hash_dir_thread(dir_job_t *job)
+{
+	hasher_t *hasher;
+
+	hasher = lib->crypto->create_hasher(lib->crypto, job->alg);
+	if (hasher)
+	{
+		hash_dir_files(job, hasher);
+		hasher->destroy(hasher);
+	}
+	return NULL;
+}
+
+/**
+ * Measure the regular files of a directory in parallel
+ */
+static bool hash_dir(private_pts_file_meas_t *this, hasher_t *hasher,
+					 hash_algorithm_t alg, char *pathname, bool use_rel_name)
+{
+	enumerator_t *enumerator;
+	char *rel_name, *abs_name;
+	dir_job_t job = {
+		.alg = alg,
+	};
+	dir_file_t *file;
+	thread_t **threads;
+	chunk_t measurement;
+	struct stat st;
+	int count, i, size = 0;
+
+	enumerator = enumerator_create_directory(pathname);
+	if (!enumerator)
+	{
+		DBG1(DBG_PTS, "  directory '%s' can not be opened, %s", pathname,
+			 strerror(errno));
+		return FALSE;
+	}
+	while (enumerator->enumerate(enumerator, &rel_name, &abs_name, &st))
+	{
+		/* measure regular files only */
+		if (S_ISREG(st.st_mode) && *rel_name != '.')
 		{
-			if (!hasher->get_hash(hasher, chunk_empty, hash))
+			if (job.count == size)
 			{
-				DBG1(DBG_PTS, "  hasher finalize error");
-				success = FALSE;
+				size = max(2 * size, 32);
+				job.files = realloc(job.files, size * sizeof(dir_file_t));
 			}
+			job.files[job.count++] = (dir_file_t){
+				.rel_name = strdup(rel_name),
+				.abs_name = strdup(abs_name),
+			};
+		}
+	}
+	enumerator->destroy(enumerator);
+
+	/* the calling thread measures files, too */
+	count = lib->settings->get_int(lib->settings,
+						"libimcv.plugins.imc-attestation.hash_threads", 4);
+	count = min(count, (int)job.count) - 1;
+	threads = calloc(max(count, 1), sizeof(thread_t*));
+	for (i = 0; i < count; i++)
+	{
+		threads[i] = thread_create((void*)hash_dir_thread, &job);
+		if (!threads[i])
+		{
+			count = i;
 			break;
 		}
 	}
-	fclose(file);
+	hash_dir_files(&job, hasher);
+	for (i = 0; i < count; i++)
+	{
+		threads[i]->join(threads[i]);
+	}
+	free(threads);
+
+	measurement = chunk_create(NULL, hasher->get_hash_size(hasher));
+	for (i = 0; i < job.count; i++)
+	{
+		file = &job.files[i];
+		if (file->success)
+		{
+			measurement.ptr = file->hash;
+			rel_name = use_rel_name ? file->rel_name : file->abs_name;
+			DBG2(DBG_PTS, "  %#B for '%s'", &measurement, rel_name);
+			add(this, rel_name, measurement);
+		}
+		free(file->rel_name);
+		free(file->abs_name);
+	}
+	free(job.files);
 
-	return success;
+	return TRUE;
 }
 
 /**
@@ -306,48 +741,20 @@ pts_file_meas_t *pts_file_meas_create_from_path(u_int16_t request_id,
 
 	if (is_dir)
 	{
-		enumerator_t *enumerator;
-		char *rel_name, *abs_name;
-		struct stat st;
-
-		enumerator = enumerator_create_directory(pathname);
-		if (!enumerator)
-		{
-			DBG1(DBG_PTS, "  directory '%s' can not be opened, %s", pathname,
-				 strerror(errno));
-			success = FALSE;
-			goto end;
-		}
-		while (enumerator->enumerate(enumerator, &rel_name, &abs_name, &st))
-		{
-			/* measure regular files only */
-			if (S_ISREG(st.st_mode) && *rel_name != '.')
-			{
-				if (!hash_file(hasher, abs_name, hash))
-				{
-					continue;
-				}
-				filename = use_rel_name ? rel_name : abs_name;
-				DBG2(DBG_PTS, "  %#B for '%s'", &measurement, filename);
-				add(this, filename, measurement);
-			}
-		}
-		enumerator->destroy(enumerator);
+		success = hash_dir(this, hasher, hash_alg, pathname, use_rel_name);
 	}
 	else
 	{
-		if (!hash_file(hasher, pathname, hash))
+		success = hash_file(hasher, hash_alg, pathname, hash);
+		if (success)
 		{
-			success = FALSE;
-			goto end;
+			filename = use_rel_name ? basename(pathname) : pathname;
+			DBG2(DBG_PTS, "  %#B for '%s'", &measurement, filename);
+			add(this, filename, measurement);
 		}
-		filename = use_rel_name ? basename(pathname) : pathname;
-		DBG2(DBG_PTS, "  %#B for '%s'", &measurement, filename);
-		add(this, filename, measurement);
 	}
-
-end:
 	hasher->destroy(hasher);
+
 	if (success)
 	{
 		return &this->public;
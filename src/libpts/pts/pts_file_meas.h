@@ -108,4 +108,20 @@ pts_file_meas_t* pts_file_meas_create_from_path(u_int16_t request_id,
 							char* pathname, bool is_dir, bool use_rel_name,
 							pts_meas_algorithms_t alg);
 
+/**
+ * Enable caching of file measurements, if configured.
+ *
+ * Measurements of regular files get cached by device, inode and hash
+ * algorithm and are reused as long as modification time, status change time
+ * and size of the file don't change.
+ * The number of cached measurements is limited, the least recently used
+ * ones get evicted.
+ */
+void pts_file_meas_cache_init(void);
+
+/**
+ * Disable caching of file measurements, flushing the cache.
+ */
+void pts_file_meas_cache_deinit(void);
+
 #endif /** PTS_FILE_MEAS_H_ @}*/
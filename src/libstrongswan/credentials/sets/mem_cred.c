@@ -17,10 +17,16 @@
 
 #include "mem_cred.h"
 
+#include <stdlib.h>
+
 #include <threading/rwlock.h>
 #include <collections/linked_list.h>
+#include <collections/hashtable.h>
+#include <collections/array.h>
+#include <credentials/certificates/x509.h>
 
 typedef struct private_mem_cred_t private_mem_cred_t;
+typedef struct cred_index_t cred_index_t;
 
 /**
  * Private data of an mem_cred_t object.
@@ -42,27 +48,501 @@ struct private_mem_cred_t {
 	 */
 	linked_list_t *trusted;
 
+	/**
+	 * Index over trusted certificates
+	 */
+	cred_index_t *trusted_index;
+
 	/**
 	 * List of trusted and untrusted certificates, certificate_t
 	 */
 	linked_list_t *untrusted;
 
+	/**
+	 * Index over trusted and untrusted certificates
+	 */
+	cred_index_t *untrusted_index;
+
 	/**
 	 * List of private keys, private_key_t
 	 */
 	linked_list_t *keys;
 
+	/**
+	 * Index over private keys
+	 */
+	cred_index_t *keys_index;
+
 	/**
 	 * List of shared keys, as shared_entry_t
 	 */
 	linked_list_t *shared;
 
+	/**
+	 * Index over shared keys
+	 */
+	cred_index_t *shared_index;
+
 	/**
 	 * List of CDPs, as cdp_t
 	 */
 	linked_list_t *cdps;
 };
 
+/**
+ * Index over credentials by identity and key identifier.
+ *
+ * Credentials are stored in lists the index refers to, lookups return the
+ * credentials possibly matching an identity in the order of these lists. The
+ * actual match still has to be checked by the caller.
+ */
+struct cred_index_t {
+
+	/**
+	 * Indexed credentials, credential => index_entry_t
+	 */
+	hashtable_t *entries;
+
+	/**
+	 * identification_t => linked_list_t of index_entry_t
+	 */
+	hashtable_t *ids;
+
+	/**
+	 * chunk_t* => linked_list_t of index_entry_t
+	 */
+	hashtable_t *keyids;
+
+	/**
+	 * Credentials that can't be indexed, always returned, as index_entry_t
+	 */
+	linked_list_t *unindexed;
+
+	/**
+	 * Sequence number of the credential added last
+	 */
+	u_int seq;
+};
+
+/**
+ * A credential in an index
+ */
+typedef struct {
+	/** indexed credential */
+	void *cred;
+	/** sequence number, credentials added later have a higher number */
+	u_int seq;
+	/** lists in the index this entry is stored in, as linked_list_t */
+	array_t *lists;
+} index_entry_t;
+
+/**
+ * Hash function for credential pointers
+ */
+static u_int ptr_hash(void *key)
+{
+	return chunk_hash(chunk_from_thing(key));
+}
+
+/**
+ * Compare function for credential pointers
+ */
+static bool ptr_equals(void *a, void *b)
+{
+	return a == b;
+}
+
+/**
+ * Hash function for identities
+ */
+static u_int id_hash(identification_t *id)
+{
+	return id->hash(id, 0);
+}
+
+/**
+ * Compare function for identities
+ */
+static bool id_equals(identification_t *a, identification_t *b)
+{
+	return a->equals(a, b);
+}
+
+/**
+ * Hash function for key identifiers
+ */
+static u_int keyid_hash(chunk_t *key)
+{
+	return chunk_hash(*key);
+}
+
+/**
+ * Compare function for key identifiers
+ */
+static bool keyid_equals(chunk_t *a, chunk_t *b)
+{
+	return chunk_equals(*a, *b);
+}
+
+/**
+ * Create an empty index
+ */
+static cred_index_t *index_create()
+{
+	cred_index_t *index;
+
+	INIT(index,
+		.entries = hashtable_create(ptr_hash, ptr_equals, 8),
+		.ids = hashtable_create((hashtable_hash_t)id_hash,
+								(hashtable_equals_t)id_equals, 8),
+		.keyids = hashtable_create((hashtable_hash_t)keyid_hash,
+								   (hashtable_equals_t)keyid_equals, 8),
+		.unindexed = linked_list_create(),
+	);
+	return index;
+}
+
+/**
+ * Destroy an index, the credentials are not touched
+ */
+static void index_destroy(cred_index_t *index)
+{
+	enumerator_t *enumerator;
+	identification_t *id;
+	index_entry_t *entry;
+	linked_list_t *list;
+	chunk_t *keyid;
+	void *cred;
+
+	enumerator = index->entries->create_enumerator(index->entries);
+	while (enumerator->enumerate(enumerator, &cred, &entry))
+	{
+		array_destroy(entry->lists);
+		free(entry);
+	}
+	enumerator->destroy(enumerator);
+	enumerator = index->ids->create_enumerator(index->ids);
+	while (enumerator->enumerate(enumerator, &id, &list))
+	{
+		id->destroy(id);
+		list->destroy(list);
+	}
+	enumerator->destroy(enumerator);
+	enumerator = index->keyids->create_enumerator(index->keyids);
+	while (enumerator->enumerate(enumerator, &keyid, &list))
+	{
+		chunk_free(keyid);
+		free(keyid);
+		list->destroy(list);
+	}
+	enumerator->destroy(enumerator);
+	index->entries->destroy(index->entries);
+	index->ids->destroy(index->ids);
+	index->keyids->destroy(index->keyids);
+	index->unindexed->destroy(index->unindexed);
+	free(index);
+}
+
+/**
+ * Add a credential to an index, it has to be stored using the functions below
+ */
+static index_entry_t *index_add(cred_index_t *index, void *cred)
+{
+	index_entry_t *entry;
+
+	INIT(entry,
+		.cred = cred,
+		.seq = ++index->seq,
+	);
+	index->entries->put(index->entries, cred, entry);
+	return entry;
+}
+
+/**
+ * Store an entry in one of the lists of an index
+ */
+static void index_store(index_entry_t *entry, linked_list_t *list)
+{
+	list->insert_last(list, entry);
+	array_insert_create(&entry->lists, ARRAY_TAIL, list);
+}
+
+/**
+ * Store an entry by identity, it is found by lookups for equal identities
+ */
+static void index_id(cred_index_t *index, index_entry_t *entry,
+					 identification_t *id)
+{
+	linked_list_t *list;
+
+	list = index->ids->get(index->ids, id);
+	if (!list)
+	{
+		list = linked_list_create();
+		index->ids->put(index->ids, id->clone(id), list);
+	}
+	index_store(entry, list);
+}
+
+/**
+ * Store an entry by key identifier
+ */
+static void index_keyid(cred_index_t *index, index_entry_t *entry,
+						chunk_t keyid)
+{
+	linked_list_t *list;
+	chunk_t *key;
+
+	if (!keyid.len)
+	{
+		return;
+	}
+	list = index->keyids->get(index->keyids, &keyid);
+	if (!list)
+	{
+		list = linked_list_create();
+		INIT(key);
+		*key = chunk_clone(keyid);
+		index->keyids->put(index->keyids, key, list);
+	}
+	index_store(entry, list);
+}
+
+/**
+ * Store an entry that is returned for all lookups
+ */
+static void index_unindexed(cred_index_t *index, index_entry_t *entry)
+{
+	index_store(entry, index->unindexed);
+}
+
+/**
+ * Remove a credential from an index
+ */
+static void index_remove(cred_index_t *index, void *cred)
+{
+	index_entry_t *entry;
+	linked_list_t *list;
+
+	entry = index->entries->remove(index->entries, cred);
+	if (entry)
+	{
+		while (array_remove(entry->lists, ARRAY_HEAD, &list))
+		{
+			list->remove(list, entry, NULL);
+		}
+		array_destroy(entry->lists);
+		free(entry);
+	}
+}
+
+/**
+ * Enumerator over credentials found in an index
+ */
+typedef struct {
+	/** implements enumerator_t */
+	enumerator_t public;
+	/** found entries, sorted */
+	index_entry_t **entries;
+	/** number of entries */
+	int count;
+	/** next entry to enumerate */
+	int pos;
+} index_enumerator_t;
+
+METHOD(enumerator_t, index_enumerate, bool,
+	index_enumerator_t *this, void **cred)
+{
+	while (this->pos < this->count)
+	{
+		this->pos++;
+		if (this->pos > 1 &&
+			this->entries[this->pos - 1] == this->entries[this->pos - 2])
+		{	/* skip entries stored in multiple lists */
+			continue;
+		}
+		*cred = this->entries[this->pos - 1]->cred;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+METHOD(enumerator_t, index_enumerator_destroy, void,
+	index_enumerator_t *this)
+{
+	free(this->entries);
+	free(this);
+}
+
+/**
+ * Sort entries in the order of the credential lists, latest first
+ */
+static int entry_cmp(const void *a, const void *b)
+{
+	const index_entry_t *ea = *(const index_entry_t**)a;
+	const index_entry_t *eb = *(const index_entry_t**)b;
+
+	return ea->seq == eb->seq ? 0 : (ea->seq > eb->seq ? -1 : 1);
+}
+
+/**
+ * Create an enumerator over the credentials stored for up to two identities
+ * and a key identifier, and all unindexed credentials
+ */
+static enumerator_t *index_create_enumerator(cred_index_t *index,
+								identification_t *a, identification_t *b,
+								chunk_t keyid)
+{
+	index_enumerator_t *enumerator;
+	linked_list_t *lists[4];
+	enumerator_t *inner;
+	index_entry_t *entry;
+	int i, count = 0, total = 0;
+
+	lists[count++] = index->unindexed;
+	if (a)
+	{
+		lists[count++] = index->ids->get(index->ids, a);
+	}
+	if (b)
+	{
+		lists[count++] = index->ids->get(index->ids, b);
+	}
+	if (keyid.len)
+	{
+		lists[count++] = index->keyids->get(index->keyids, &keyid);
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (lists[i])
+		{
+			total += lists[i]->get_count(lists[i]);
+		}
+	}
+
+	INIT(enumerator,
+		.public = {
+			.enumerate = (void*)_index_enumerate,
+			.destroy = _index_enumerator_destroy,
+		},
+		.entries = malloc(sizeof(index_entry_t*) * max(total, 1)),
+	);
+	for (i = 0; i < count; i++)
+	{
+		if (lists[i])
+		{
+			inner = lists[i]->create_enumerator(lists[i]);
+			while (inner->enumerate(inner, &entry))
+			{
+				enumerator->entries[enumerator->count++] = entry;
+			}
+			inner->destroy(inner);
+		}
+	}
+	qsort(enumerator->entries, enumerator->count, sizeof(index_entry_t*),
+		  entry_cmp);
+	return &enumerator->public;
+}
+
+/**
+ * Add a list of credentials to an index, using the given function
+ */
+static void index_list(cred_index_t *index, linked_list_t *list,
+					   void (*add)(cred_index_t *index, void *cred))
+{
+	enumerator_t *enumerator;
+	void **creds, *cred;
+	int count = 0;
+
+	/* the lists are ordered latest first, so add them in reverse */
+	creds = malloc(sizeof(void*) * max(list->get_count(list), 1));
+	enumerator = list->create_enumerator(list);
+	while (enumerator->enumerate(enumerator, &cred))
+	{
+		creds[count++] = cred;
+	}
+	enumerator->destroy(enumerator);
+	while (count--)
+	{
+		add(index, creds[count]);
+	}
+	free(creds);
+}
+
+/**
+ * Add a certificate to an index, by subject, subjectAltNames, key
+ * identifiers, serial and the hash of its encoding, as has_subject() of
+ * X.509 certificates matches key identifiers against all of them.
+ */
+static void index_cert(cred_index_t *index, certificate_t *cert)
+{
+	index_entry_t *entry;
+	enumerator_t *enumerator;
+	identification_t *id;
+	public_key_t *public;
+	cred_encoding_type_t type;
+	hasher_t *hasher;
+	chunk_t chunk, hash;
+	x509_t *x509;
+
+	entry = index_add(index, cert);
+	if (cert->get_type(cert) != CERT_X509)
+	{	/* other certificates might match identities differently */
+		index_unindexed(index, entry);
+		return;
+	}
+	x509 = (x509_t*)cert;
+	index_id(index, entry, cert->get_subject(cert));
+	enumerator = x509->create_subjectAltName_enumerator(x509);
+	while (enumerator->enumerate(enumerator, &id))
+	{
+		index_id(index, entry, id);
+	}
+	enumerator->destroy(enumerator);
+	index_keyid(index, entry, x509->get_subjectKeyIdentifier(x509));
+	index_keyid(index, entry, x509->get_serial(x509));
+	public = cert->get_public_key(cert);
+	if (public)
+	{
+		for (type = 0; type < KEYID_MAX; type++)
+		{
+			if (public->get_fingerprint(public, type, &chunk))
+			{
+				index_keyid(index, entry, chunk);
+			}
+		}
+		public->destroy(public);
+	}
+	hasher = lib->crypto->create_hasher(lib->crypto, HASH_SHA1);
+	if (hasher)
+	{
+		if (cert->get_encoding(cert, CERT_ASN1_DER, &chunk))
+		{
+			if (hasher->allocate_hash(hasher, chunk, &hash))
+			{
+				index_keyid(index, entry, hash);
+				chunk_free(&hash);
+			}
+			chunk_free(&chunk);
+		}
+		hasher->destroy(hasher);
+	}
+}
+
+/**
+ * Create an enumerator over certificates possibly matching an identity
+ */
+static enumerator_t *create_cert_candidates(linked_list_t *list,
+											cred_index_t *index,
+											identification_t *id)
+{
+	if (!id || id->contains_wildcards(id))
+	{	/* has_subject() matches wildcards against all identities */
+		return list->create_enumerator(list);
+	}
+	return index_create_enumerator(index, id, NULL, id->get_encoding(id));
+}
+
 /**
  * Data for the certificate enumerator
  */
@@ -136,19 +616,39 @@ METHOD(credential_set_t, create_cert_enumerator, enumerator_t*,
 	this->lock->read_lock(this->lock);
 	if (trusted)
 	{
-		enumerator = this->trusted->create_enumerator(this->trusted);
+		enumerator = create_cert_candidates(this->trusted, this->trusted_index,
+											id);
 	}
 	else
 	{
-		enumerator = this->untrusted->create_enumerator(this->untrusted);
+		enumerator = create_cert_candidates(this->untrusted,
+											this->untrusted_index, id);
 	}
 	return enumerator_create_filter(enumerator, (void*)certs_filter, data,
 									(void*)cert_data_destroy);
 }
 
-static bool certificate_equals(certificate_t *item, certificate_t *cert)
+/**
+ * Find a cached certificate equal to the given one
+ */
+static certificate_t *find_cert(private_mem_cred_t *this, certificate_t *cert)
 {
-	return item->equals(item, cert);
+	certificate_t *current, *found = NULL;
+	enumerator_t *enumerator;
+
+	/* equal certificates have the same subject */
+	enumerator = create_cert_candidates(this->untrusted, this->untrusted_index,
+										cert->get_subject(cert));
+	while (enumerator->enumerate(enumerator, &current))
+	{
+		if (current->equals(current, cert))
+		{
+			found = current;
+			break;
+		}
+	}
+	enumerator->destroy(enumerator);
+	return found;
 }
 
 /**
@@ -160,9 +660,8 @@ static certificate_t *add_cert_internal(private_mem_cred_t *this, bool trusted,
 {
 	certificate_t *cached;
 	this->lock->write_lock(this->lock);
-	if (this->untrusted->find_first(this->untrusted,
-									(linked_list_match_t)certificate_equals,
-									(void**)&cached, cert) == SUCCESS)
+	cached = find_cert(this, cert);
+	if (cached)
 	{
 		cert->destroy(cert);
 		cert = cached->get_ref(cached);
@@ -172,8 +671,10 @@ static certificate_t *add_cert_internal(private_mem_cred_t *this, bool trusted,
 		if (trusted)
 		{
 			this->trusted->insert_first(this->trusted, cert->get_ref(cert));
+			index_cert(this->trusted_index, cert);
 		}
 		this->untrusted->insert_first(this->untrusted, cert->get_ref(cert));
+		index_cert(this->untrusted_index, cert);
 	}
 	this->lock->unlock(this->lock);
 	return cert;
@@ -232,6 +733,7 @@ METHOD(mem_cred_t, add_crl, bool,
 				if (new)
 				{
 					this->untrusted->remove_at(this->untrusted, enumerator);
+					index_remove(this->untrusted_index, current);
 				}
 				else
 				{
@@ -246,6 +748,7 @@ METHOD(mem_cred_t, add_crl, bool,
 	if (new)
 	{
 		this->untrusted->insert_first(this->untrusted, cert);
+		index_cert(this->untrusted_index, cert);
 	}
 	this->lock->unlock(this->lock);
 	return new;
@@ -293,6 +796,7 @@ METHOD(credential_set_t, create_private_enumerator, enumerator_t*,
 	private_mem_cred_t *this, key_type_t type, identification_t *id)
 {
 	key_data_t *data;
+	enumerator_t *enumerator;
 
 	INIT(data,
 		.lock = this->lock,
@@ -300,8 +804,42 @@ METHOD(credential_set_t, create_private_enumerator, enumerator_t*,
 		.id = id,
 	);
 	this->lock->read_lock(this->lock);
-	return enumerator_create_filter(this->keys->create_enumerator(this->keys),
-							(void*)key_filter, data, (void*)key_data_destroy);
+	if (id)
+	{
+		enumerator = index_create_enumerator(this->keys_index, NULL, NULL,
+											 id->get_encoding(id));
+	}
+	else
+	{
+		enumerator = this->keys->create_enumerator(this->keys);
+	}
+	return enumerator_create_filter(enumerator, (void*)key_filter, data,
+									(void*)key_data_destroy);
+}
+
+/**
+ * Add a private key to an index, by all its key identifiers
+ */
+static void index_key(cred_index_t *index, private_key_t *key)
+{
+	index_entry_t *entry;
+	cred_encoding_type_t type;
+	chunk_t fingerprint;
+	bool found = FALSE;
+
+	entry = index_add(index, key);
+	for (type = 0; type < KEYID_MAX; type++)
+	{
+		if (key->get_fingerprint(key, type, &fingerprint))
+		{
+			index_keyid(index, entry, fingerprint);
+			found = TRUE;
+		}
+	}
+	if (!found)
+	{
+		index_unindexed(index, entry);
+	}
 }
 
 METHOD(mem_cred_t, add_key, void,
@@ -309,6 +847,7 @@ METHOD(mem_cred_t, add_key, void,
 {
 	this->lock->write_lock(this->lock);
 	this->keys->insert_first(this->keys, key);
+	index_key(this->keys_index, key);
 	this->lock->unlock(this->lock);
 }
 
@@ -419,6 +958,7 @@ METHOD(credential_set_t, create_shared_enumerator, enumerator_t*,
 	identification_t *me, identification_t *other)
 {
 	shared_data_t *data;
+	enumerator_t *enumerator;
 
 	INIT(data,
 		.lock = this->lock,
@@ -427,9 +967,48 @@ METHOD(credential_set_t, create_shared_enumerator, enumerator_t*,
 		.type = type,
 	);
 	data->lock->read_lock(data->lock);
-	return enumerator_create_filter(
-						this->shared->create_enumerator(this->shared),
-						(void*)shared_filter, data, (void*)shared_data_destroy);
+	if (me || other)
+	{
+		enumerator = index_create_enumerator(this->shared_index, me, other,
+											 chunk_empty);
+	}
+	else
+	{
+		enumerator = this->shared->create_enumerator(this->shared);
+	}
+	return enumerator_create_filter(enumerator, (void*)shared_filter, data,
+									(void*)shared_data_destroy);
+}
+
+/**
+ * Add a shared key entry to an index, by its owners. Entries with owners
+ * containing wildcards are returned for all lookups.
+ */
+static void index_shared(cred_index_t *index, shared_entry_t *entry)
+{
+	index_entry_t *indexed;
+	enumerator_t *enumerator;
+	identification_t *id;
+	bool wildcards = FALSE;
+
+	indexed = index_add(index, entry);
+	enumerator = entry->owners->create_enumerator(entry->owners);
+	while (enumerator->enumerate(enumerator, &id))
+	{
+		if (id->contains_wildcards(id))
+		{
+			wildcards = TRUE;
+		}
+		else
+		{
+			index_id(index, indexed, id);
+		}
+	}
+	enumerator->destroy(enumerator);
+	if (wildcards || !entry->owners->get_count(entry->owners))
+	{
+		index_unindexed(index, indexed);
+	}
 }
 
 METHOD(mem_cred_t, add_shared_list, void,
@@ -444,6 +1023,7 @@ METHOD(mem_cred_t, add_shared_list, void,
 
 	this->lock->write_lock(this->lock);
 	this->shared->insert_first(this->shared, entry);
+	index_shared(this->shared_index, entry);
 	this->lock->unlock(this->lock);
 }
 
@@ -557,10 +1137,14 @@ METHOD(credential_set_t, create_cdp_enumerator, enumerator_t*,
 
 static void reset_secrets(private_mem_cred_t *this)
 {
+	index_destroy(this->keys_index);
+	index_destroy(this->shared_index);
 	this->keys->destroy_offset(this->keys, offsetof(private_key_t, destroy));
 	this->shared->destroy_function(this->shared, (void*)shared_entry_destroy);
 	this->keys = linked_list_create();
 	this->shared = linked_list_create();
+	this->keys_index = index_create();
+	this->shared_index = index_create();
 }
 
 METHOD(mem_cred_t, replace_secrets, void,
@@ -606,7 +1190,14 @@ METHOD(mem_cred_t, replace_secrets, void,
 		{
 			this->shared->insert_last(this->shared, entry);
 		}
+		/* the other set's indices refer to the moved secrets */
+		index_destroy(other->keys_index);
+		index_destroy(other->shared_index);
+		other->keys_index = index_create();
+		other->shared_index = index_create();
 	}
+	index_list(this->keys_index, this->keys, (void*)index_key);
+	index_list(this->shared_index, this->shared, (void*)index_shared);
 	this->lock->unlock(this->lock);
 }
 
@@ -622,6 +1213,8 @@ METHOD(mem_cred_t, clear_, void,
 	private_mem_cred_t *this)
 {
 	this->lock->write_lock(this->lock);
+	index_destroy(this->trusted_index);
+	index_destroy(this->untrusted_index);
 	this->trusted->destroy_offset(this->trusted,
 								  offsetof(certificate_t, destroy));
 	this->untrusted->destroy_offset(this->untrusted,
@@ -630,6 +1223,8 @@ METHOD(mem_cred_t, clear_, void,
 	this->trusted = linked_list_create();
 	this->untrusted = linked_list_create();
 	this->cdps = linked_list_create();
+	this->trusted_index = index_create();
+	this->untrusted_index = index_create();
 	this->lock->unlock(this->lock);
 
 	clear_secrets(this);
@@ -639,6 +1234,10 @@ METHOD(mem_cred_t, destroy, void,
 	private_mem_cred_t *this)
 {
 	clear_(this);
+	index_destroy(this->trusted_index);
+	index_destroy(this->untrusted_index);
+	index_destroy(this->keys_index);
+	index_destroy(this->shared_index);
 	this->trusted->destroy(this->trusted);
 	this->untrusted->destroy(this->untrusted);
 	this->keys->destroy(this->keys);
@@ -677,9 +1276,13 @@ mem_cred_t *mem_cred_create()
 			.destroy = _destroy,
 		},
 		.trusted = linked_list_create(),
+		.trusted_index = index_create(),
 		.untrusted = linked_list_create(),
+		.untrusted_index = index_create(),
 		.keys = linked_list_create(),
+		.keys_index = index_create(),
 		.shared = linked_list_create(),
+		.shared_index = index_create(),
 		.cdps = linked_list_create(),
 		.lock = rwlock_create(RWLOCK_TYPE_DEFAULT),
 	);
@@ -13,11 +13,20 @@
  * for more details.
  */
 
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdio.h>
+#include <limits.h>
+#include <sys/stat.h>
+
 #include "crypto_factory.h"
 
 #include <utils/debug.h>
 #include <threading/rwlock.h>
+#include <threading/mutex.h>
 #include <collections/linked_list.h>
+#include <collections/hashtable.h>
 #include <crypto/crypto_tester.h>
 
 const char *default_plugin_name = "default";
@@ -108,6 +117,36 @@ struct private_crypto_factory_t {
 	 */
 	linked_list_t *dhs;
 
+	/**
+	 * crypters by algorithm, as NULL terminated entry_t* vector
+	 */
+	hashtable_t *crypter_index;
+
+	/**
+	 * aead transforms by algorithm, as NULL terminated entry_t* vector
+	 */
+	hashtable_t *aead_index;
+
+	/**
+	 * signers by algorithm, as NULL terminated entry_t* vector
+	 */
+	hashtable_t *signer_index;
+
+	/**
+	 * hashers by algorithm, as NULL terminated entry_t* vector
+	 */
+	hashtable_t *hasher_index;
+
+	/**
+	 * prfs by algorithm, as NULL terminated entry_t* vector
+	 */
+	hashtable_t *prf_index;
+
+	/**
+	 * diffie hellman by group, as NULL terminated entry_t* vector
+	 */
+	hashtable_t *dh_index;
+
 	/**
 	 * test manager to test crypto algorithms
 	 */
@@ -133,41 +172,447 @@ struct private_crypto_factory_t {
 	 */
 	u_int test_failures;
 
+	/**
+	 * Successfully tested algorithms, as tested_t
+	 */
+	hashtable_t *tested;
+
+	/**
+	 * Lock for tested algorithms
+	 */
+	mutex_t *tested_mutex;
+
+	/**
+	 * File to persist test results in, NULL to keep them in memory only
+	 */
+	char *cache;
+
+	/**
+	 * TRUE if test results have been added since loading the cache
+	 */
+	bool cache_dirty;
+
+	/**
+	 * Test settings affecting results, included in cache keys
+	 */
+	char *test_flags;
+
 	/**
 	 * rwlock to lock access to modules
 	 */
 	rwlock_t *lock;
+
+	/**
+	 * Time to create DH objects (key generation), NULL if disabled
+	 */
+	histogram_t *dh_keygen;
+
+	/**
+	 * Time to derive DH shared secrets, NULL if disabled
+	 */
+	histogram_t *dh_derive;
 };
 
+/**
+ * Result of a successful algorithm test
+ */
+typedef struct {
+
+	/**
+	 * Version, algorithm, plugin, implementation and test settings
+	 */
+	char *key;
+
+	/**
+	 * Benchmarked speed
+	 */
+	u_int speed;
+
+	/**
+	 * TRUE if the key is valid across restarts
+	 */
+	bool persist;
+
+} tested_t;
+
+/**
+ * Destroy a test result
+ */
+static void tested_destroy(tested_t *this)
+{
+	free(this->key);
+	free(this);
+}
+
+/**
+ * Build the cache key for an algorithm implementation.
+ *
+ * The key identifies the object file containing the constructor by its path,
+ * modification time and size, so rebuilt plugins get tested again. It includes
+ * a digest of the test vectors for the algorithm, so the implementation gets
+ * tested again against new or changed vectors.
+ */
+static char *tested_key(private_crypto_factory_t *this, transform_type_t type,
+						u_int algo, const char *plugin_name, void *create,
+						bool *persist)
+{
+	u_int32_t vectors;
+	char *key;
+#ifdef HAVE_DLADDR
+	Dl_info dli;
+	struct stat st;
+#endif /* HAVE_DLADDR */
+
+	vectors = this->tester->get_vector_digest(this->tester, type, algo);
+#ifdef HAVE_DLADDR
+	if (dladdr(create, &dli) && dli.dli_fname &&
+		stat(dli.dli_fname, &st) == 0)
+	{
+		if (asprintf(&key, "%s %d %u %08x %s %s %s %ld %lld", VERSION, type,
+					 algo, vectors, this->test_flags, plugin_name, dli.dli_fname,
+					 (long)st.st_mtime, (long long)st.st_size) < 0)
+		{
+			return NULL;
+		}
+		*persist = TRUE;
+		return key;
+	}
+#endif /* HAVE_DLADDR */
+	if (asprintf(&key, "%s %d %u %08x %s %s %p", VERSION, type, algo,
+				 vectors, this->test_flags, plugin_name, create) < 0)
+	{
+		return NULL;
+	}
+	*persist = FALSE;
+	return key;
+}
+
+/**
+ * Run the test for an algorithm implementation
+ */
+static bool run_test(private_crypto_factory_t *this, transform_type_t type,
+					 u_int algo, const char *plugin_name, void *create,
+					 u_int *speed)
+{
+	u_int *bench = this->bench ? speed : NULL;
+
+	switch (type)
+	{
+		case ENCRYPTION_ALGORITHM:
+			return this->tester->test_crypter(this->tester, algo, 0, create,
+											  bench, plugin_name);
+		case AEAD_ALGORITHM:
+			return this->tester->test_aead(this->tester, algo, 0, create,
+										   bench, plugin_name);
+		case INTEGRITY_ALGORITHM:
+			return this->tester->test_signer(this->tester, algo, create,
+											 bench, plugin_name);
+		case HASH_ALGORITHM:
+			return this->tester->test_hasher(this->tester, algo, create,
+											 bench, plugin_name);
+		case PSEUDO_RANDOM_FUNCTION:
+			return this->tester->test_prf(this->tester, algo, create,
+										  bench, plugin_name);
+		case RANDOM_NUMBER_GENERATOR:
+			return this->tester->test_rng(this->tester, algo, create,
+										  bench, plugin_name);
+		default:
+			return TRUE;
+	}
+}
+
+/**
+ * Test an algorithm implementation, unless it has been tested already
+ */
+static bool test_cached(private_crypto_factory_t *this, transform_type_t type,
+						u_int algo, const char *plugin_name, void *create,
+						u_int *speed)
+{
+	tested_t *tested;
+	bool persist;
+	char *key;
+
+	key = tested_key(this, type, algo, plugin_name, create, &persist);
+	if (key)
+	{
+		this->tested_mutex->lock(this->tested_mutex);
+		tested = this->tested->get(this->tested, key);
+		if (tested)
+		{
+			*speed = tested->speed;
+		}
+		this->tested_mutex->unlock(this->tested_mutex);
+		if (tested)
+		{
+			DBG2(DBG_LIB, "skipped test of %N %u[%s], passed before",
+				 transform_type_names, type, algo, plugin_name);
+			free(key);
+			return TRUE;
+		}
+	}
+	if (!run_test(this, type, algo, plugin_name, create, speed))
+	{
+		free(key);
+		return FALSE;
+	}
+	if (key)
+	{
+		INIT(tested,
+			.key = key,
+			.speed = *speed,
+			.persist = persist,
+		);
+		this->tested_mutex->lock(this->tested_mutex);
+		if (this->tested->get(this->tested, key))
+		{	/* tested concurrently */
+			tested_destroy(tested);
+		}
+		else
+		{
+			this->tested->put(this->tested, tested->key, tested);
+			this->cache_dirty |= persist;
+		}
+		this->tested_mutex->unlock(this->tested_mutex);
+	}
+	return TRUE;
+}
+
+/**
+ * Load persisted test results of the current version
+ */
+static void load_cache(private_crypto_factory_t *this)
+{
+	char line[PATH_MAX + 256], *pos;
+	tested_t *tested;
+	u_int speed;
+	FILE *file;
+
+	file = fopen(this->cache, "r");
+	if (!file)
+	{
+		DBG2(DBG_LIB, "unable to open crypto test cache '%s': %s",
+			 this->cache, strerror(errno));
+		return;
+	}
+	while (fgets(line, sizeof(line), file))
+	{
+		pos = strchr(line, '\n');
+		if (pos)
+		{
+			*pos = '\0';
+		}
+		speed = strtoul(line, &pos, 10);
+		if (*pos != ' ' || !strpfx(pos + 1, VERSION " "))
+		{	/* invalid or from a different version */
+			continue;
+		}
+		INIT(tested,
+			.key = strdup(pos + 1),
+			.speed = speed,
+			.persist = TRUE,
+		);
+		if (this->tested->get(this->tested, tested->key))
+		{
+			tested_destroy(tested);
+			continue;
+		}
+		this->tested->put(this->tested, tested->key, tested);
+	}
+	fclose(file);
+}
+
+/**
+ * Write persistent test results to the cache
+ */
+static void save_cache(private_crypto_factory_t *this)
+{
+	enumerator_t *enumerator;
+	tested_t *tested;
+	FILE *file;
+	char *key;
+
+	file = fopen(this->cache, "w");
+	if (!file)
+	{
+		DBG1(DBG_LIB, "unable to write crypto test cache '%s': %s",
+			 this->cache, strerror(errno));
+		return;
+	}
+	enumerator = this->tested->create_enumerator(this->tested);
+	while (enumerator->enumerate(enumerator, &key, &tested))
+	{
+		if (tested->persist)
+		{
+			fprintf(file, "%u %s\n", tested->speed, tested->key);
+		}
+	}
+	enumerator->destroy(enumerator);
+	fclose(file);
+}
+
+/**
+ * Empty entry vector for unknown algorithms
+ */
+static entry_t *no_entries[] = { NULL };
+
+/**
+ * Look up the registered entries for an algorithm, in order of preference
+ */
+static inline entry_t **lookup(hashtable_t *index, u_int algo)
+{
+	entry_t **entries;
+
+	entries = index->get(index, (void*)(uintptr_t)algo);
+	return entries ?: no_entries;
+}
+
+/**
+ * Rebuild the index vector of an algorithm from a list, requires write lock
+ */
+static void reindex(linked_list_t *list, hashtable_t *index, u_int algo)
+{
+	enumerator_t *enumerator;
+	entry_t *entry, **entries;
+	int count = 0;
+
+	free(index->remove(index, (void*)(uintptr_t)algo));
+
+	entries = NULL;
+	enumerator = list->create_enumerator(list);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		if (entry->algo == algo)
+		{
+			entries = realloc(entries, sizeof(entry_t*) * (count + 2));
+			entries[count++] = entry;
+			entries[count] = NULL;
+		}
+	}
+	enumerator->destroy(enumerator);
+	if (entries)
+	{
+		index->put(index, (void*)(uintptr_t)algo, entries);
+	}
+}
+
+/**
+ * Hash function for algorithm identifiers
+ */
+static u_int algo_hash(void *algo)
+{
+	return (uintptr_t)algo;
+}
+
+/**
+ * Compare function for algorithm identifiers
+ */
+static bool algo_equals(void *a, void *b)
+{
+	return a == b;
+}
+
+/**
+ * DH wrapper measuring the time to derive the shared secret
+ */
+typedef struct {
+
+	/**
+	 * Implements diffie_hellman_t
+	 */
+	diffie_hellman_t public;
+
+	/**
+	 * Wrapped DH implementation
+	 */
+	diffie_hellman_t *dh;
+
+	/**
+	 * Histogram to record derivation time
+	 */
+	histogram_t *derive;
+
+} timed_dh_t;
+
+METHOD(diffie_hellman_t, timed_get_shared_secret, status_t,
+	timed_dh_t *this, chunk_t *secret)
+{
+	return this->dh->get_shared_secret(this->dh, secret);
+}
+
+METHOD(diffie_hellman_t, timed_set_other_public_value, void,
+	timed_dh_t *this, chunk_t value)
+{
+	timeval_t start;
+
+	time_monotonic(&start);
+	this->dh->set_other_public_value(this->dh, value);
+	this->derive->record_since(this->derive, &start);
+}
+
+METHOD(diffie_hellman_t, timed_get_my_public_value, void,
+	timed_dh_t *this, chunk_t *value)
+{
+	this->dh->get_my_public_value(this->dh, value);
+}
+
+METHOD(diffie_hellman_t, timed_get_dh_group, diffie_hellman_group_t,
+	timed_dh_t *this)
+{
+	return this->dh->get_dh_group(this->dh);
+}
+
+METHOD(diffie_hellman_t, timed_destroy, void,
+	timed_dh_t *this)
+{
+	this->dh->destroy(this->dh);
+	free(this);
+}
+
+/**
+ * Wrap a DH object to measure the time of the derivation
+ */
+static diffie_hellman_t *timed_dh_create(diffie_hellman_t *dh,
+										 histogram_t *derive)
+{
+	timed_dh_t *this;
+
+	INIT(this,
+		.public = {
+			.get_shared_secret = _timed_get_shared_secret,
+			.set_other_public_value = _timed_set_other_public_value,
+			.get_my_public_value = _timed_get_my_public_value,
+			.get_dh_group = _timed_get_dh_group,
+			.destroy = _timed_destroy,
+		},
+		.dh = dh,
+		.derive = derive,
+	);
+	return &this->public;
+}
+
 METHOD(crypto_factory_t, create_crypter, crypter_t*,
 	private_crypto_factory_t *this, encryption_algorithm_t algo,
 	size_t key_size)
 {
-	enumerator_t *enumerator;
-	entry_t *entry;
+	entry_t **entry;
 	crypter_t *crypter = NULL;
 
 	this->lock->read_lock(this->lock);
-	enumerator = this->crypters->create_enumerator(this->crypters);
-	while (enumerator->enumerate(enumerator, &entry))
+	for (entry = lookup(this->crypter_index, algo); *entry; entry++)
 	{
-		if (entry->algo == algo)
+		if (this->test_on_create &&
+			!this->tester->test_crypter(this->tester, algo, key_size,
+										(*entry)->create_crypter, NULL,
+										default_plugin_name))
 		{
-			if (this->test_on_create &&
-				!this->tester->test_crypter(this->tester, algo, key_size,
-											entry->create_crypter, NULL,
-											default_plugin_name))
-			{
-				continue;
-			}
-			crypter = entry->create_crypter(algo, key_size);
-			if (crypter)
-			{
-				break;
-			}
+			continue;
+		}
+		crypter = (*entry)->create_crypter(algo, key_size);
+		if (crypter)
+		{
+			break;
 		}
 	}
-	enumerator->destroy(enumerator);
 	this->lock->unlock(this->lock);
 	return crypter;
 }
@@ -176,31 +621,25 @@ METHOD(crypto_factory_t, create_aead, aead_t*,
 	private_crypto_factory_t *this, encryption_algorithm_t algo,
 	size_t key_size)
 {
-	enumerator_t *enumerator;
-	entry_t *entry;
+	entry_t **entry;
 	aead_t *aead = NULL;
 
 	this->lock->read_lock(this->lock);
-	enumerator = this->aeads->create_enumerator(this->aeads);
-	while (enumerator->enumerate(enumerator, &entry))
+	for (entry = lookup(this->aead_index, algo); *entry; entry++)
 	{
-		if (entry->algo == algo)
+		if (this->test_on_create &&
+			!this->tester->test_aead(this->tester, algo, key_size,
+									 (*entry)->create_aead, NULL,
+									 default_plugin_name))
 		{
-			if (this->test_on_create &&
-				!this->tester->test_aead(this->tester, algo, key_size,
-										 entry->create_aead, NULL,
-										 default_plugin_name))
-			{
-				continue;
-			}
-			aead = entry->create_aead(algo, key_size);
-			if (aead)
-			{
-				break;
-			}
+			continue;
+		}
+		aead = (*entry)->create_aead(algo, key_size);
+		if (aead)
+		{
+			break;
 		}
 	}
-	enumerator->destroy(enumerator);
 	this->lock->unlock(this->lock);
 	return aead;
 }
@@ -208,31 +647,25 @@ METHOD(crypto_factory_t, create_aead, aead_t*,
 METHOD(crypto_factory_t, create_signer, signer_t*,
 	private_crypto_factory_t *this, integrity_algorithm_t algo)
 {
-	enumerator_t *enumerator;
-	entry_t *entry;
+	entry_t **entry;
 	signer_t *signer = NULL;
 
 	this->lock->read_lock(this->lock);
-	enumerator = this->signers->create_enumerator(this->signers);
-	while (enumerator->enumerate(enumerator, &entry))
+	for (entry = lookup(this->signer_index, algo); *entry; entry++)
 	{
-		if (entry->algo == algo)
+		if (this->test_on_create &&
+			!this->tester->test_signer(this->tester, algo,
+									   (*entry)->create_signer, NULL,
+									   default_plugin_name))
 		{
-			if (this->test_on_create &&
-				!this->tester->test_signer(this->tester, algo,
-										   entry->create_signer, NULL,
-										   default_plugin_name))
-			{
-				continue;
-			}
-			signer = entry->create_signer(algo);
-			if (signer)
-			{
-				break;
-			}
+			continue;
+		}
+		signer = (*entry)->create_signer(algo);
+		if (signer)
+		{
+			break;
 		}
 	}
-	enumerator->destroy(enumerator);
 	this->lock->unlock(this->lock);
 
 	return signer;
@@ -242,30 +675,41 @@ METHOD(crypto_factory_t, create_hasher, hasher_t*,
 	private_crypto_factory_t *this, hash_algorithm_t algo)
 {
 	enumerator_t *enumerator;
-	entry_t *entry;
+	entry_t *entry, **current;
 	hasher_t *hasher = NULL;
 
-	this->lock->read_lock(this->lock);
-	enumerator = this->hashers->create_enumerator(this->hashers);
-	while (enumerator->enumerate(enumerator, &entry))
+	if (algo == HASH_PREFERRED)
 	{
-		if (algo == HASH_PREFERRED || entry->algo == algo)
+		this->lock->read_lock(this->lock);
+		enumerator = this->hashers->create_enumerator(this->hashers);
+		while (enumerator->enumerate(enumerator, &entry))
 		{
-			if (this->test_on_create && algo != HASH_PREFERRED &&
-				!this->tester->test_hasher(this->tester, algo,
-										   entry->create_hasher, NULL,
-										   default_plugin_name))
-			{
-				continue;
-			}
 			hasher = entry->create_hasher(entry->algo);
 			if (hasher)
 			{
 				break;
 			}
 		}
+		enumerator->destroy(enumerator);
+		this->lock->unlock(this->lock);
+		return hasher;
+	}
+	this->lock->read_lock(this->lock);
+	for (current = lookup(this->hasher_index, algo); *current; current++)
+	{
+		if (this->test_on_create &&
+			!this->tester->test_hasher(this->tester, algo,
+									   (*current)->create_hasher, NULL,
+									   default_plugin_name))
+		{
+			continue;
+		}
+		hasher = (*current)->create_hasher(algo);
+		if (hasher)
+		{
+			break;
+		}
 	}
-	enumerator->destroy(enumerator);
 	this->lock->unlock(this->lock);
 	return hasher;
 }
@@ -273,31 +717,25 @@ METHOD(crypto_factory_t, create_hasher, hasher_t*,
 METHOD(crypto_factory_t, create_prf, prf_t*,
 	private_crypto_factory_t *this, pseudo_random_function_t algo)
 {
-	enumerator_t *enumerator;
-	entry_t *entry;
+	entry_t **entry;
 	prf_t *prf = NULL;
 
 	this->lock->read_lock(this->lock);
-	enumerator = this->prfs->create_enumerator(this->prfs);
-	while (enumerator->enumerate(enumerator, &entry))
+	for (entry = lookup(this->prf_index, algo); *entry; entry++)
 	{
-		if (entry->algo == algo)
+		if (this->test_on_create &&
+			!this->tester->test_prf(this->tester, algo,
+									(*entry)->create_prf, NULL,
+									default_plugin_name))
 		{
-			if (this->test_on_create &&
-				!this->tester->test_prf(this->tester, algo,
-										entry->create_prf, NULL,
-										default_plugin_name))
-			{
-				continue;
-			}
-			prf = entry->create_prf(algo);
-			if (prf)
-			{
-				break;
-			}
+			continue;
+		}
+		prf = (*entry)->create_prf(algo);
+		if (prf)
+		{
+			break;
 		}
 	}
-	enumerator->destroy(enumerator);
 	this->lock->unlock(this->lock);
 	return prf;
 }
@@ -362,11 +800,11 @@ METHOD(crypto_factory_t, create_nonce_gen, nonce_gen_t*,
 METHOD(crypto_factory_t, create_dh, diffie_hellman_t*,
 	private_crypto_factory_t *this, diffie_hellman_group_t group, ...)
 {
-	enumerator_t *enumerator;
-	entry_t *entry;
+	entry_t **entry;
 	va_list args;
 	chunk_t g = chunk_empty, p = chunk_empty;
 	diffie_hellman_t *diffie_hellman = NULL;
+	timeval_t start;
 
 	if (group == MODP_CUSTOM)
 	{
@@ -376,21 +814,26 @@ METHOD(crypto_factory_t, create_dh, diffie_hellman_t*,
 		va_end(args);
 	}
 
+	if (this->dh_keygen)
+	{
+		time_monotonic(&start);
+	}
 	this->lock->read_lock(this->lock);
-	enumerator = this->dhs->create_enumerator(this->dhs);
-	while (enumerator->enumerate(enumerator, &entry))
+	for (entry = lookup(this->dh_index, group); *entry; entry++)
 	{
-		if (entry->algo == group)
+		diffie_hellman = (*entry)->create_dh(group, g, p);
+		if (diffie_hellman)
 		{
-			diffie_hellman = entry->create_dh(group, g, p);
-			if (diffie_hellman)
-			{
-				break;
-			}
+			break;
 		}
 	}
-	enumerator->destroy(enumerator);
 	this->lock->unlock(this->lock);
+
+	if (diffie_hellman && this->dh_keygen)
+	{
+		this->dh_keygen->record_since(this->dh_keygen, &start);
+		diffie_hellman = timed_dh_create(diffie_hellman, this->dh_derive);
+	}
 	return diffie_hellman;
 }
 
@@ -398,7 +841,7 @@ METHOD(crypto_factory_t, create_dh, diffie_hellman_t*,
  * Insert an algorithm entry to a list
  */
 static void add_entry(private_crypto_factory_t *this, linked_list_t *list,
-					  int algo, const char *plugin_name,
+					  hashtable_t *index, int algo, const char *plugin_name,
 					  u_int speed, void *create)
 {
 	entry_t *entry, *current;
@@ -437,6 +880,37 @@ static void add_entry(private_crypto_factory_t *this, linked_list_t *list,
 	{
 		list->insert_last(list, entry);
 	}
+	if (index)
+	{
+		reindex(list, index, algo);
+	}
+	this->lock->unlock(this->lock);
+}
+
+/**
+ * Remove all algorithm entries with a constructor from a list
+ */
+static void remove_entry(private_crypto_factory_t *this, linked_list_t *list,
+						 hashtable_t *index, void *create)
+{
+	entry_t *entry;
+	enumerator_t *enumerator;
+
+	this->lock->write_lock(this->lock);
+	enumerator = list->create_enumerator(list);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		if (entry->create == create)
+		{
+			list->remove_at(list, enumerator);
+			if (index)
+			{
+				reindex(list, index, entry->algo);
+			}
+			free(entry);
+		}
+	}
+	enumerator->destroy(enumerator);
 	this->lock->unlock(this->lock);
 }
 
@@ -447,10 +921,11 @@ METHOD(crypto_factory_t, add_crypter, bool,
 	u_int speed = 0;
 
 	if (!this->test_on_add ||
-		this->tester->test_crypter(this->tester, algo, 0, create,
-								   this->bench ? &speed : NULL,	plugin_name))
+		test_cached(this, ENCRYPTION_ALGORITHM, algo, plugin_name, create,
+					&speed))
 	{
-		add_entry(this, this->crypters, algo, plugin_name, speed, create);
+		add_entry(this, this->crypters, this->crypter_index,
+				  algo, plugin_name, speed, create);
 		return TRUE;
 	}
 	this->test_failures++;
@@ -460,21 +935,7 @@ METHOD(crypto_factory_t, add_crypter, bool,
 METHOD(crypto_factory_t, remove_crypter, void,
 	private_crypto_factory_t *this, crypter_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->crypters->create_enumerator(this->crypters);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_crypter == create)
-		{
-			this->crypters->remove_at(this->crypters, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->crypters, this->crypter_index, create);
 }
 
 METHOD(crypto_factory_t, add_aead, bool,
@@ -484,10 +945,11 @@ METHOD(crypto_factory_t, add_aead, bool,
 	u_int speed = 0;
 
 	if (!this->test_on_add ||
-		this->tester->test_aead(this->tester, algo, 0, create,
-								this->bench ? &speed : NULL, plugin_name))
+		test_cached(this, AEAD_ALGORITHM, algo, plugin_name, create,
+					&speed))
 	{
-		add_entry(this, this->aeads, algo, plugin_name, speed, create);
+		add_entry(this, this->aeads, this->aead_index,
+				  algo, plugin_name, speed, create);
 		return TRUE;
 	}
 	this->test_failures++;
@@ -497,21 +959,7 @@ METHOD(crypto_factory_t, add_aead, bool,
 METHOD(crypto_factory_t, remove_aead, void,
 	private_crypto_factory_t *this, aead_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->aeads->create_enumerator(this->aeads);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_aead == create)
-		{
-			this->aeads->remove_at(this->aeads, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->aeads, this->aead_index, create);
 }
 
 METHOD(crypto_factory_t, add_signer, bool,
@@ -521,10 +969,11 @@ METHOD(crypto_factory_t, add_signer, bool,
 	u_int speed = 0;
 
 	if (!this->test_on_add ||
-		this->tester->test_signer(this->tester, algo, create,
-								  this->bench ? &speed : NULL, plugin_name))
+		test_cached(this, INTEGRITY_ALGORITHM, algo, plugin_name, create,
+					&speed))
 	{
-		add_entry(this, this->signers, algo, plugin_name, speed, create);
+		add_entry(this, this->signers, this->signer_index,
+				  algo, plugin_name, speed, create);
 		return TRUE;
 	}
 	this->test_failures++;
@@ -534,21 +983,7 @@ METHOD(crypto_factory_t, add_signer, bool,
 METHOD(crypto_factory_t, remove_signer, void,
 	private_crypto_factory_t *this, signer_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->signers->create_enumerator(this->signers);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_signer == create)
-		{
-			this->signers->remove_at(this->signers, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->signers, this->signer_index, create);
 }
 
 METHOD(crypto_factory_t, add_hasher, bool,
@@ -558,10 +993,11 @@ METHOD(crypto_factory_t, add_hasher, bool,
 	u_int speed = 0;
 
 	if (!this->test_on_add ||
-		this->tester->test_hasher(this->tester, algo, create,
-								  this->bench ? &speed : NULL, plugin_name))
+		test_cached(this, HASH_ALGORITHM, algo, plugin_name, create,
+					&speed))
 	{
-		add_entry(this, this->hashers, algo, plugin_name, speed, create);
+		add_entry(this, this->hashers, this->hasher_index,
+				  algo, plugin_name, speed, create);
 		return TRUE;
 	}
 	this->test_failures++;
@@ -571,21 +1007,7 @@ METHOD(crypto_factory_t, add_hasher, bool,
 METHOD(crypto_factory_t, remove_hasher, void,
 	private_crypto_factory_t *this, hasher_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->hashers->create_enumerator(this->hashers);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_hasher == create)
-		{
-			this->hashers->remove_at(this->hashers, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->hashers, this->hasher_index, create);
 }
 
 METHOD(crypto_factory_t, add_prf, bool,
@@ -595,10 +1017,11 @@ METHOD(crypto_factory_t, add_prf, bool,
 	u_int speed = 0;
 
 	if (!this->test_on_add ||
-		this->tester->test_prf(this->tester, algo, create,
-							   this->bench ? &speed : NULL, plugin_name))
+		test_cached(this, PSEUDO_RANDOM_FUNCTION, algo, plugin_name, create,
+					&speed))
 	{
-		add_entry(this, this->prfs, algo, plugin_name, speed, create);
+		add_entry(this, this->prfs, this->prf_index,
+				  algo, plugin_name, speed, create);
 		return TRUE;
 	}
 	this->test_failures++;
@@ -608,21 +1031,7 @@ METHOD(crypto_factory_t, add_prf, bool,
 METHOD(crypto_factory_t, remove_prf, void,
 	private_crypto_factory_t *this, prf_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->prfs->create_enumerator(this->prfs);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_prf == create)
-		{
-			this->prfs->remove_at(this->prfs, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->prfs, this->prf_index, create);
 }
 
 METHOD(crypto_factory_t, add_rng, bool,
@@ -632,10 +1041,10 @@ METHOD(crypto_factory_t, add_rng, bool,
 	u_int speed = 0;
 
 	if (!this->test_on_add ||
-		this->tester->test_rng(this->tester, quality, create,
-							   this->bench ? &speed : NULL, plugin_name))
+		test_cached(this, RANDOM_NUMBER_GENERATOR, quality, plugin_name,
+					create, &speed))
 	{
-		add_entry(this, this->rngs, quality, plugin_name, speed, create);
+		add_entry(this, this->rngs, NULL, quality, plugin_name, speed, create);
 		return TRUE;
 	}
 	this->test_failures++;
@@ -645,77 +1054,35 @@ METHOD(crypto_factory_t, add_rng, bool,
 METHOD(crypto_factory_t, remove_rng, void,
 	private_crypto_factory_t *this, rng_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->rngs->create_enumerator(this->rngs);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_rng == create)
-		{
-			this->rngs->remove_at(this->rngs, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->rngs, NULL, create);
 }
 
 METHOD(crypto_factory_t, add_nonce_gen, bool,
 	private_crypto_factory_t *this, const char *plugin_name,
 	nonce_gen_constructor_t create)
 {
-	add_entry(this, this->nonce_gens, 0, plugin_name, 0, create);
+	add_entry(this, this->nonce_gens, NULL, 0, plugin_name, 0, create);
 	return TRUE;
 }
 
 METHOD(crypto_factory_t, remove_nonce_gen, void,
 	private_crypto_factory_t *this, nonce_gen_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->nonce_gens->create_enumerator(this->nonce_gens);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_nonce_gen == create)
-		{
-			this->nonce_gens->remove_at(this->nonce_gens, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->nonce_gens, NULL, create);
 }
 
 METHOD(crypto_factory_t, add_dh, bool,
 	private_crypto_factory_t *this, diffie_hellman_group_t group,
 	const char *plugin_name, dh_constructor_t create)
 {
-	add_entry(this, this->dhs, group, plugin_name, 0, create);
+	add_entry(this, this->dhs, this->dh_index, group, plugin_name, 0, create);
 	return TRUE;
 }
 
 METHOD(crypto_factory_t, remove_dh, void,
 	private_crypto_factory_t *this, dh_constructor_t create)
 {
-	entry_t *entry;
-	enumerator_t *enumerator;
-
-	this->lock->write_lock(this->lock);
-	enumerator = this->dhs->create_enumerator(this->dhs);
-	while (enumerator->enumerate(enumerator, &entry))
-	{
-		if (entry->create_dh == create)
-		{
-			this->dhs->remove_at(this->dhs, enumerator);
-			free(entry);
-		}
-	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	remove_entry(this, this->dhs, this->dh_index, create);
 }
 
 /**
@@ -906,9 +1273,50 @@ METHOD(crypto_factory_t, get_test_vector_failures, u_int,
 	return this->test_failures;
 }
 
+/**
+ * Destroy an algorithm index
+ */
+static void destroy_index(hashtable_t *index)
+{
+	enumerator_t *enumerator;
+	entry_t **entries;
+	void *algo;
+
+	enumerator = index->create_enumerator(index);
+	while (enumerator->enumerate(enumerator, &algo, &entries))
+	{
+		free(entries);
+	}
+	enumerator->destroy(enumerator);
+	index->destroy(index);
+}
+
 METHOD(crypto_factory_t, destroy, void,
 	private_crypto_factory_t *this)
 {
+	enumerator_t *enumerator;
+	tested_t *tested;
+	char *key;
+
+	if (this->cache && this->cache_dirty)
+	{
+		save_cache(this);
+	}
+	enumerator = this->tested->create_enumerator(this->tested);
+	while (enumerator->enumerate(enumerator, &key, &tested))
+	{
+		tested_destroy(tested);
+	}
+	enumerator->destroy(enumerator);
+	this->tested->destroy(this->tested);
+	this->tested_mutex->destroy(this->tested_mutex);
+	free(this->test_flags);
+	destroy_index(this->crypter_index);
+	destroy_index(this->aead_index);
+	destroy_index(this->signer_index);
+	destroy_index(this->hasher_index);
+	destroy_index(this->prf_index);
+	destroy_index(this->dh_index);
 	this->crypters->destroy(this->crypters);
 	this->aeads->destroy(this->aeads);
 	this->signers->destroy(this->signers);
@@ -975,6 +1383,14 @@ crypto_factory_t *crypto_factory_create()
 		.rngs = linked_list_create(),
 		.nonce_gens = linked_list_create(),
 		.dhs = linked_list_create(),
+		.crypter_index = hashtable_create(algo_hash, algo_equals, 32),
+		.aead_index = hashtable_create(algo_hash, algo_equals, 8),
+		.signer_index = hashtable_create(algo_hash, algo_equals, 16),
+		.hasher_index = hashtable_create(algo_hash, algo_equals, 16),
+		.prf_index = hashtable_create(algo_hash, algo_equals, 16),
+		.dh_index = hashtable_create(algo_hash, algo_equals, 32),
+		.tested = hashtable_create(hashtable_hash_str, hashtable_equals_str, 32),
+		.tested_mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 		.lock = rwlock_create(RWLOCK_TYPE_DEFAULT),
 		.tester = crypto_tester_create(),
 		.test_on_add = lib->settings->get_bool(lib->settings,
@@ -984,6 +1400,30 @@ crypto_factory_t *crypto_factory_create()
 		.bench = lib->settings->get_bool(lib->settings,
 								"libstrongswan.crypto_test.bench", FALSE),
 	);
+	if (asprintf(&this->test_flags, "%d%d%d", this->bench,
+			lib->settings->get_bool(lib->settings,
+								"libstrongswan.crypto_test.required", FALSE),
+			lib->settings->get_bool(lib->settings,
+								"libstrongswan.crypto_test.rng_true", FALSE)) < 0)
+	{
+		this->test_flags = strdup("");
+	}
+	this->cache = lib->settings->get_str(lib->settings,
+								"libstrongswan.crypto_test.cache", NULL);
+	if (this->test_on_add && this->cache)
+	{
+		load_cache(this);
+	}
+
+	if (lib->metrics)
+	{
+		this->dh_keygen = lib->metrics->histogram(lib->metrics,
+								"strongswan_dh_seconds", "op=\"keygen\"",
+								"Time spent in Diffie-Hellman operations");
+		this->dh_derive = lib->metrics->histogram(lib->metrics,
+								"strongswan_dh_seconds", "op=\"derive\"",
+								"Time spent in Diffie-Hellman operations");
+	}
 
 	return &this->public;
 }
@@ -1164,6 +1164,138 @@ METHOD(crypto_tester_t, add_rng_vector, void,
 	this->rng->insert_last(this->rng, vector);
 }
 
+/**
+ * Add a chunk of test vector data to a digest
+ */
+static u_int32_t digest_data(u_int32_t digest, u_char *ptr, size_t len)
+{
+	if (ptr)
+	{
+		digest = chunk_hash_static_inc(chunk_create(ptr, len), digest);
+	}
+	return chunk_hash_static_inc(chunk_from_thing(len), digest);
+}
+
+METHOD(crypto_tester_t, get_vector_digest, u_int32_t,
+	private_crypto_tester_t *this, transform_type_t type, u_int alg)
+{
+	enumerator_t *enumerator;
+	linked_list_t *list;
+	u_int32_t digest = 0;
+	u_int count = 0;
+	void *vector;
+
+	switch (type)
+	{
+		case ENCRYPTION_ALGORITHM:
+			list = this->crypter;
+			break;
+		case AEAD_ALGORITHM:
+			list = this->aead;
+			break;
+		case INTEGRITY_ALGORITHM:
+			list = this->signer;
+			break;
+		case HASH_ALGORITHM:
+			list = this->hasher;
+			break;
+		case PSEUDO_RANDOM_FUNCTION:
+			list = this->prf;
+			break;
+		case RANDOM_NUMBER_GENERATOR:
+			list = this->rng;
+			break;
+		default:
+			return 0;
+	}
+
+	enumerator = list->create_enumerator(list);
+	while (enumerator->enumerate(enumerator, &vector))
+	{
+		switch (type)
+		{
+			case ENCRYPTION_ALGORITHM:
+			{
+				crypter_test_vector_t *v = vector;
+
+				if (v->alg != alg)
+				{
+					continue;
+				}
+				digest = digest_data(digest, v->key, v->key_size);
+				digest = digest_data(digest, v->plain, v->len);
+				digest = digest_data(digest, v->cipher, v->len);
+				break;
+			}
+			case AEAD_ALGORITHM:
+			{
+				aead_test_vector_t *v = vector;
+
+				if (v->alg != alg)
+				{
+					continue;
+				}
+				digest = digest_data(digest, v->key, v->key_size);
+				digest = digest_data(digest, v->adata, v->alen);
+				digest = digest_data(digest, v->plain, v->len);
+				break;
+			}
+			case INTEGRITY_ALGORITHM:
+			{
+				signer_test_vector_t *v = vector;
+
+				if (v->alg != alg)
+				{
+					continue;
+				}
+				digest = digest_data(digest, v->data, v->len);
+				break;
+			}
+			case HASH_ALGORITHM:
+			{
+				hasher_test_vector_t *v = vector;
+
+				if (v->alg != alg)
+				{
+					continue;
+				}
+				digest = digest_data(digest, v->data, v->len);
+				break;
+			}
+			case PSEUDO_RANDOM_FUNCTION:
+			{
+				prf_test_vector_t *v = vector;
+
+				if (v->alg != alg)
+				{
+					continue;
+				}
+				digest = digest_data(digest, v->key, v->key_size);
+				digest = digest_data(digest, v->seed, v->len);
+				digest = digest_data(digest, NULL, v->stateful);
+				break;
+			}
+			case RANDOM_NUMBER_GENERATOR:
+			{
+				rng_test_vector_t *v = vector;
+
+				if (v->quality != alg)
+				{
+					continue;
+				}
+				digest = digest_data(digest, NULL, v->len);
+				break;
+			}
+			default:
+				break;
+		}
+		count++;
+	}
+	enumerator->destroy(enumerator);
+
+	return digest_data(digest, NULL, count);
+}
+
 METHOD(crypto_tester_t, destroy, void,
 	private_crypto_tester_t *this)
 {
@@ -1197,6 +1329,7 @@ crypto_tester_t *crypto_tester_create()
 			.add_hasher_vector = _add_hasher_vector,
 			.add_prf_vector = _add_prf_vector,
 			.add_rng_vector = _add_rng_vector,
+			.get_vector_digest = _get_vector_digest,
 			.destroy = _destroy,
 		},
 		.crypter = linked_list_create(),
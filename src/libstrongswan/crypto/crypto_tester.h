@@ -243,6 +243,19 @@ struct crypto_tester_t {
 	 */
 	void (*add_rng_vector)(crypto_tester_t *this, rng_test_vector_t *vector);
 
+	/**
+	 * Get a digest of the test vectors registered for an algorithm.
+	 *
+	 * The digest covers the number of vectors and all vector data of known
+	 * length, and is the same in different processes.
+	 *
+	 * @param type			type of the algorithm
+	 * @param alg			algorithm, or quality for RNGs
+	 * @return				digest of the registered test vectors
+	 */
+	u_int32_t (*get_vector_digest)(crypto_tester_t *this,
+								   transform_type_t type, u_int alg);
+
 	/**
 	 * Destroy a crypto_tester_t.
 	 */
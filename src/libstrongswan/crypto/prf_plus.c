@@ -18,6 +18,8 @@
 
 #include "prf_plus.h"
 
+#include <crypto/hashers/hasher.h>
+
 typedef struct private_prf_plus_t private_prf_plus_t;
 
 /**
@@ -161,3 +163,57 @@ prf_plus_t *prf_plus_create(prf_t *prf, bool counter, chunk_t seed)
 
 	return &this->public;
 }
+
+/*
+ * Description in header.
+ */
+bool prf_plus_fill(prf_t *prf, bool counter, chunk_t seed, chunk_t buffer)
+{
+	u_int8_t block[HASH_SIZE_SHA512], *out, octet = 0x01;
+	chunk_t prev = chunk_empty;
+	prf_plus_t *prf_plus;
+	size_t size, done;
+	bool success;
+
+	size = prf->get_block_size(prf);
+	if (size > sizeof(block))
+	{
+		prf_plus = prf_plus_create(prf, counter, seed);
+		if (!prf_plus)
+		{
+			return FALSE;
+		}
+		success = prf_plus->get_bytes(prf_plus, buffer.len, buffer.ptr);
+		prf_plus->destroy(prf_plus);
+		return success;
+	}
+	for (done = 0; done < buffer.len; done += size)
+	{
+		/* write full blocks directly, only the last one gets truncated */
+		out = buffer.len - done >= size ? buffer.ptr + done : block;
+		if (prev.len && !prf->get_bytes(prf, prev, NULL))
+		{
+			return FALSE;
+		}
+		if (counter)
+		{
+			if (!prf->get_bytes(prf, seed, NULL) ||
+				!prf->get_bytes(prf, chunk_from_thing(octet), out))
+			{
+				return FALSE;
+			}
+			octet++;
+		}
+		else if (!prf->get_bytes(prf, seed, out))
+		{
+			return FALSE;
+		}
+		if (out == block)
+		{
+			memcpy(buffer.ptr + done, block, buffer.len - done);
+			memwipe(block, sizeof(block));
+		}
+		prev = chunk_create(out, size);
+	}
+	return TRUE;
+}
@@ -67,4 +67,23 @@ struct prf_plus_t {
  */
 prf_plus_t *prf_plus_create(prf_t *prf, bool counter, chunk_t seed);
 
+/**
+ * Fill a caller provided buffer with prf+ output.
+ *
+ * This is equivalent to a single get_bytes() call on a new prf_plus_t, but
+ * does not allocate any memory. PRF output is written to the buffer
+ * directly and fed back to the PRF from there.
+ *
+ * If generating fails, the prf might have buffered partial input and has
+ * to be keyed again before it gets used for any other operation.
+ *
+ * @param prf				keyed prf object to use
+ * @param counter			use an appending counter byte (for IKEv2 variant)
+ * @param seed				input seed for prf
+ * @param buffer			buffer to fill completely
+ * @return					TRUE if bytes generated successfully
+ */
+bool prf_plus_fill(prf_t *prf, bool counter, chunk_t seed,
+				   chunk_t buffer) __attribute__((warn_unused_result));
+
 #endif /** PRF_PLUS_H_ @}*/
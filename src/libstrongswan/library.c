@@ -97,6 +97,7 @@ void library_deinit()
 	this->public.resolver->destroy(this->public.resolver);
 	this->public.db->destroy(this->public.db);
 	this->public.printf_hook->destroy(this->public.printf_hook);
+	DESTROY_IF(this->public.metrics);
 	this->objects->destroy(this->objects);
 	if (this->public.integrity)
 	{
@@ -256,6 +257,11 @@ bool library_init(char *settings)
 	this->objects = hashtable_create((hashtable_hash_t)hash,
 									 (hashtable_equals_t)equals, 4);
 	this->public.settings = settings_create(settings);
+	if (lib->settings->get_bool(lib->settings,
+								"libstrongswan.metrics.enable", FALSE))
+	{
+		this->public.metrics = metrics_create();
+	}
 	this->public.hosts = host_resolver_create();
 	this->public.proposal = proposal_keywords_create();
 	this->public.caps = capabilities_create();
@@ -109,6 +109,7 @@
 #include "utils/capabilities.h"
 #include "utils/integrity_checker.h"
 #include "utils/leak_detective.h"
+#include "utils/metrics.h"
 #include "utils/settings.h"
 #include "plugins/plugin_loader.h"
 
@@ -221,6 +222,11 @@ struct library_t {
 	 */
 	settings_t *settings;
 
+	/**
+	 * Latency histograms and counters, NULL if not enabled
+	 */
+	metrics_t *metrics;
+
 	/**
 	 * integrity checker to verify code integrity
 	 */
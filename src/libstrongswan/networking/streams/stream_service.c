@@ -17,10 +17,12 @@
 #include <threading/thread.h>
 #include <threading/mutex.h>
 #include <threading/condvar.h>
+#include <collections/linked_list.h>
 #include <processing/jobs/callback_job.h>
 
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
@@ -67,6 +69,11 @@ struct private_stream_service_t {
 	 */
 	u_int active;
 
+	/**
+	 * TRUE if accept()ing has been suspended due to the concurrency limit
+	 */
+	bool suspended;
+
 	/**
 	 * mutex to lock active counter
 	 */
@@ -76,6 +83,31 @@ struct private_stream_service_t {
 	 * Condvar to wait for callback termination
 	 */
 	condvar_t *condvar;
+
+	/**
+	 * Dedicated worker threads, as thread_t, if any
+	 */
+	linked_list_t *workers;
+
+	/**
+	 * TRUE if worker threads should terminate
+	 */
+	bool terminate;
+
+	/**
+	 * Accepted connections queued for worker threads, as async_data_t
+	 */
+	linked_list_t *queue;
+
+	/**
+	 * Condvar to signal queued connections to worker threads
+	 */
+	condvar_t *queued;
+
+	/**
+	 * Statistics
+	 */
+	stream_service_stats_t stats;
 };
 
 /**
@@ -88,23 +120,49 @@ typedef struct {
 	void *data;
 	/** accepted connection */
 	int fd;
+	/** time the connection got accepted */
+	timeval_t accepted;
+	/** time the callback got invoked */
+	timeval_t started;
 	/** reference to stream service */
 	private_stream_service_t *this;
 } async_data_t;
 
+/**
+ * Time in microseconds passed between two timestamps
+ */
+static u_int64_t time_passed(timeval_t *from, timeval_t *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000000LL +
+		   (to->tv_usec - from->tv_usec);
+}
+
+static bool watch(private_stream_service_t *this, int fd,
+				  watcher_event_t event);
+
 /**
  * Clean up accept data
  */
 static void destroy_async_data(async_data_t *data)
 {
 	private_stream_service_t *this = data->this;
+	timeval_t now;
+	u_int64_t passed;
 
+	time_monotonic(&now);
 	this->mutex->lock(this->mutex);
-	if (this->active-- == this->cncrncy)
+	if (data->started.tv_sec)
+	{
+		passed = time_passed(&data->started, &now);
+		this->stats.run_total += passed;
+		this->stats.run_max = max(this->stats.run_max, passed);
+	}
+	if (this->active-- == this->cncrncy && this->suspended)
 	{
 		/* leaving concurrency limit, restart accept()ing. */
-		this->public.on_accept(&this->public, this->cb, this->data,
-							   this->prio, this->cncrncy);
+		this->suspended = FALSE;
+		lib->watcher->add(lib->watcher, this->fd,
+						  WATCHER_READ, (watcher_cb_t)watch, this);
 	}
 	this->condvar->signal(this->condvar);
 	this->mutex->unlock(this->mutex);
@@ -121,7 +179,16 @@ static void destroy_async_data(async_data_t *data)
  */
 static job_requeue_t accept_async(async_data_t *data)
 {
+	private_stream_service_t *this = data->this;
 	stream_t *stream;
+	u_int64_t passed;
+
+	time_monotonic(&data->started);
+	passed = time_passed(&data->accepted, &data->started);
+	this->mutex->lock(this->mutex);
+	this->stats.wait_total += passed;
+	this->stats.wait_max = max(this->stats.wait_max, passed);
+	this->mutex->unlock(this->mutex);
 
 	stream = stream_create_from_fd(data->fd);
 	if (stream)
@@ -134,41 +201,99 @@ static job_requeue_t accept_async(async_data_t *data)
 	return JOB_REQUEUE_NONE;
 }
 
+/**
+ * Dedicated worker thread invoking callbacks for queued connections
+ */
+static void *worker(private_stream_service_t *this)
+{
+	async_data_t *data;
+
+	/* waiting on the recursive mutex is not cancellable, so we only allow
+	 * cancellation while invoking the callback */
+	thread_cancelability(FALSE);
+	while (TRUE)
+	{
+		this->mutex->lock(this->mutex);
+		while (!this->terminate &&
+			   this->queue->remove_first(this->queue, (void**)&data) != SUCCESS)
+		{
+			this->queued->wait(this->queued, this->mutex);
+		}
+		if (this->terminate)
+		{
+			this->mutex->unlock(this->mutex);
+			break;
+		}
+		this->mutex->unlock(this->mutex);
+
+		thread_cleanup_push((void*)destroy_async_data, data);
+		thread_cancelability(TRUE);
+		accept_async(data);
+		thread_cancelability(FALSE);
+		thread_cleanup_pop(TRUE);
+	}
+	return NULL;
+}
+
 /**
  * Watcher callback function
  */
 static bool watch(private_stream_service_t *this, int fd, watcher_event_t event)
 {
 	async_data_t *data;
-	bool keep = TRUE;
+	int client;
 
-	INIT(data,
-		.cb = this->cb,
-		.data = this->data,
-		.fd = accept(fd, NULL, NULL),
-		.this = this,
-	);
-
-	if (data->fd != -1)
+	while (TRUE)
 	{
 		this->mutex->lock(this->mutex);
-		if (++this->active == this->cncrncy)
+		if (this->cncrncy && this->active >= this->cncrncy)
 		{
 			/* concurrency limit reached, stop accept()ing new connections */
-			keep = FALSE;
+			this->suspended = TRUE;
+			this->mutex->unlock(this->mutex);
+			return FALSE;
 		}
 		this->mutex->unlock(this->mutex);
 
-		lib->processor->queue_job(lib->processor,
-			(job_t*)callback_job_create_with_prio((void*)accept_async, data,
-				(void*)destroy_async_data, (callback_job_cancel_t)return_false,
-				this->prio));
-	}
-	else
-	{
-		free(data);
+		/* the socket is non-blocking, accept all pending connections */
+		client = accept(fd, NULL, NULL);
+		if (client == -1)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				DBG1(DBG_NET, "accepting stream connection failed: %s",
+					 strerror(errno));
+			}
+			return TRUE;
+		}
+
+		INIT(data,
+			.cb = this->cb,
+			.data = this->data,
+			.fd = client,
+			.this = this,
+		);
+		time_monotonic(&data->accepted);
+
+		this->mutex->lock(this->mutex);
+		this->active++;
+		this->stats.accepted++;
+		if (this->workers->get_count(this->workers))
+		{
+			this->queue->insert_last(this->queue, data);
+			this->queued->signal(this->queued);
+			data = NULL;
+		}
+		this->mutex->unlock(this->mutex);
+
+		if (data)
+		{
+			lib->processor->queue_job(lib->processor,
+				(job_t*)callback_job_create_with_prio((void*)accept_async, data,
+					(void*)destroy_async_data,
+					(callback_job_cancel_t)return_false, this->prio));
+		}
 	}
-	return keep;
 }
 
 METHOD(stream_service_t, on_accept, void,
@@ -183,10 +308,11 @@ METHOD(stream_service_t, on_accept, void,
 		this->condvar->wait(this->condvar, this->mutex);
 	}
 
-	if (this->cb)
+	if (this->cb && !this->suspended)
 	{
 		lib->watcher->remove(lib->watcher, this->fd);
 	}
+	this->suspended = FALSE;
 
 	this->cb = cb;
 	this->data = data;
@@ -205,13 +331,91 @@ METHOD(stream_service_t, on_accept, void,
 	this->mutex->unlock(this->mutex);
 }
 
+/**
+ * Terminate all worker threads and drop queued connections
+ */
+static void stop_workers(private_stream_service_t *this)
+{
+	async_data_t *data;
+	thread_t *thread;
+
+	this->mutex->lock(this->mutex);
+	this->terminate = TRUE;
+	this->queued->broadcast(this->queued);
+	this->mutex->unlock(this->mutex);
+
+	while (TRUE)
+	{
+		this->mutex->lock(this->mutex);
+		if (this->workers->remove_first(this->workers,
+										(void**)&thread) != SUCCESS)
+		{
+			this->mutex->unlock(this->mutex);
+			break;
+		}
+		this->mutex->unlock(this->mutex);
+		/* cancel threads blocking in a callback */
+		thread->cancel(thread);
+		thread->join(thread);
+	}
+
+	this->mutex->lock(this->mutex);
+	this->terminate = FALSE;
+	this->mutex->unlock(this->mutex);
+
+	while (TRUE)
+	{
+		this->mutex->lock(this->mutex);
+		if (this->queue->remove_first(this->queue, (void**)&data) != SUCCESS)
+		{
+			this->mutex->unlock(this->mutex);
+			break;
+		}
+		this->mutex->unlock(this->mutex);
+		destroy_async_data(data);
+	}
+}
+
+METHOD(stream_service_t, set_workers, void,
+	private_stream_service_t *this, u_int count)
+{
+	thread_t *thread;
+
+	stop_workers(this);
+	while (count--)
+	{
+		thread = thread_create((thread_main_t)worker, this);
+		if (!thread)
+		{
+			DBG1(DBG_NET, "creating stream service worker thread failed");
+			break;
+		}
+		this->mutex->lock(this->mutex);
+		this->workers->insert_last(this->workers, thread);
+		this->mutex->unlock(this->mutex);
+	}
+}
+
+METHOD(stream_service_t, get_stats, void,
+	private_stream_service_t *this, stream_service_stats_t *stats)
+{
+	this->mutex->lock(this->mutex);
+	*stats = this->stats;
+	stats->active = this->active;
+	this->mutex->unlock(this->mutex);
+}
+
 METHOD(stream_service_t, destroy, void,
 	private_stream_service_t *this)
 {
+	stop_workers(this);
 	on_accept(this, NULL, NULL, this->prio, this->cncrncy);
 	close(this->fd);
+	this->workers->destroy(this->workers);
+	this->queue->destroy(this->queue);
 	this->mutex->destroy(this->mutex);
 	this->condvar->destroy(this->condvar);
+	this->queued->destroy(this->queued);
 	free(this);
 }
 
@@ -221,18 +425,31 @@ METHOD(stream_service_t, destroy, void,
 stream_service_t *stream_service_create_from_fd(int fd)
 {
 	private_stream_service_t *this;
+	int flags;
 
 	INIT(this,
 		.public = {
 			.on_accept = _on_accept,
+			.set_workers = _set_workers,
+			.get_stats = _get_stats,
 			.destroy = _destroy,
 		},
 		.fd = fd,
 		.prio = JOB_PRIO_MEDIUM,
 		.mutex = mutex_create(MUTEX_TYPE_RECURSIVE),
 		.condvar = condvar_create(CONDVAR_TYPE_DEFAULT),
+		.workers = linked_list_create(),
+		.queue = linked_list_create(),
+		.queued = condvar_create(CONDVAR_TYPE_DEFAULT),
 	);
 
+	/* accept() all pending connections without blocking */
+	flags = fcntl(fd, F_GETFL);
+	if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+	{
+		DBG1(DBG_NET, "setting stream service socket non-blocking failed: %s",
+			 strerror(errno));
+	}
 	return &this->public;
 }
 
@@ -22,6 +22,7 @@
 #define STREAM_SERVICE_H_
 
 typedef struct stream_service_t stream_service_t;
+typedef struct stream_service_stats_t stream_service_stats_t;
 
 #include <library.h>
 #include <processing/jobs/job.h>
@@ -48,6 +49,26 @@ typedef stream_service_t*(*stream_service_constructor_t)(char *uri, int backlog)
  */
 typedef bool (*stream_service_cb_t)(void *data, stream_t *stream);
 
+/**
+ * Statistics about client connections handled by a stream service.
+ *
+ * Times are in microseconds.
+ */
+struct stream_service_stats_t {
+	/** number of accepted connections */
+	u_int64_t accepted;
+	/** number of connections currently queued or processed */
+	u_int active;
+	/** total time connections waited for a thread to invoke the callback */
+	u_int64_t wait_total;
+	/** maximum time a connection waited for a thread */
+	u_int64_t wait_max;
+	/** total time spent in callbacks */
+	u_int64_t run_total;
+	/** maximum time spent in a callback */
+	u_int64_t run_max;
+};
+
 /**
  * A service accepting client connection streams.
  */
@@ -67,6 +88,27 @@ struct stream_service_t {
 					  stream_service_cb_t cb, void *data,
 					  job_priority_t prio, u_int cncrncy);
 
+	/**
+	 * Invoke callbacks by a pool of dedicated threads instead of jobs.
+	 *
+	 * Callbacks invoked by dedicated threads don't occupy threads of the
+	 * processor, so clients can't starve job processing (e.g. of IKE
+	 * messages) with requests that take long to process. The job priority
+	 * passed to on_accept() is ignored if dedicated threads are used. The
+	 * concurrency limit still limits the number of connections accept()ed
+	 * and processed or queued for a thread.
+	 *
+	 * @param count		number of threads, 0 to invoke callbacks by jobs
+	 */
+	void (*set_workers)(stream_service_t *this, u_int count);
+
+	/**
+	 * Get statistics about handled client connections.
+	 *
+	 * @param stats		statistics, filled in
+	 */
+	void (*get_stats)(stream_service_t *this, stream_service_stats_t *stats);
+
 	/**
 	 * Destroy a stream_service_t.
 	 */
@@ -16,6 +16,7 @@
  */
 
 #include "aes_crypter.h"
+#include "aes_ni.h"
 
 /*
  * The number of key schedule words for different block and key lengths
@@ -34,6 +35,11 @@
 
 typedef struct private_aes_crypter_t private_aes_crypter_t;
 
+/**
+ * Whether to use AES-NI for new crypters, set by the plugin
+ */
+static bool use_aes_ni = FALSE;
+
 /**
  * Class implementing the AES symmetric encryption algorithm.
  *
@@ -70,6 +76,11 @@ struct private_aes_crypter_t {
 	* Key size of this AES cypher object.
 	*/
 	u_int32_t    key_size;
+
+	/**
+	* Use AES-NI, the decryption key schedule is in AES-NI format then.
+	*/
+	bool aes_ni;
 };
 
 
@@ -1349,6 +1360,13 @@ METHOD(crypter_t, decrypt, bool,
 	}
 	in = data.ptr;
 
+	if (this->aes_ni)
+	{
+		aes_ni_decrypt_cbc(this->aes_Nrnd, (u_int8_t*)this->aes_d_key,
+						   iv.ptr, in, out, data.len);
+		return TRUE;
+	}
+
 	pos = data.len-16;
 	in += pos;
 	out += pos;
@@ -1389,6 +1407,13 @@ METHOD(crypter_t, encrypt, bool,
 		out = encrypted->ptr;
 	}
 
+	if (this->aes_ni)
+	{
+		aes_ni_encrypt_cbc(this->aes_Nrnd, (u_int8_t*)this->aes_e_key,
+						   iv.ptr, in, out, data.len);
+		return TRUE;
+	}
+
 	pos=0;
 	while(pos<data.len)
 	{
@@ -1515,6 +1540,11 @@ METHOD(crypter_t, set_key, bool,
 		}
 		cpy(kt, kf);
 	}
+	if (this->aes_ni)
+	{
+		aes_ni_set_decrypt_key(this->aes_Nrnd, (u_int8_t*)this->aes_e_key,
+							   (u_int8_t*)this->aes_d_key);
+	}
 	return TRUE;
 }
 
@@ -1525,6 +1555,14 @@ METHOD(crypter_t, destroy, void,
 	free(this);
 }
 
+/*
+ * Described in header
+ */
+void aes_crypter_set_aes_ni(bool enable)
+{
+	use_aes_ni = enable;
+}
+
 /*
  * Described in header
  */
@@ -1567,6 +1605,7 @@ aes_crypter_t *aes_crypter_create(encryption_algorithm_t algo, size_t key_size)
 		},
 		.key_size = key_size,
 		.aes_Nkey = key_size / 4,
+		.aes_ni = use_aes_ni,
 	);
 
 	return &this->public;
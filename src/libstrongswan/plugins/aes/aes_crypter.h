@@ -47,4 +47,11 @@ struct aes_crypter_t {
 aes_crypter_t *aes_crypter_create(encryption_algorithm_t algo,
 								  size_t key_size);
 
+/**
+ * Use AES-NI for crypters created afterwards.
+ *
+ * @param enable		TRUE if AES-NI is supported and should be used
+ */
+void aes_crypter_set_aes_ni(bool enable);
+
 #endif /** AES_CRYPTER_H_ @}*/
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "aes_ni.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || \
+	__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+
+#include <cpuid.h>
+#include <wmmintrin.h>
+
+/**
+ * Compile functions for AES-NI, whatever the target of the plugin is
+ */
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+
+/**
+ * Maximum number of round keys
+ */
+#define MAX_ROUND_KEYS 15
+
+/**
+ * Described in header.
+ */
+bool aes_ni_supported()
+{
+	u_int a, b, c, d;
+
+	if (!__get_cpuid(1, &a, &b, &c, &d))
+	{
+		return FALSE;
+	}
+	return (c & bit_AES) != 0;
+}
+
+/**
+ * Load a key schedule into registers
+ */
+AES_NI_TARGET
+static inline void load_key(int rounds, u_int8_t *key, __m128i k[])
+{
+	int i;
+
+	for (i = 0; i <= rounds; i++)
+	{
+		k[i] = _mm_loadu_si128((__m128i*)key + i);
+	}
+}
+
+/**
+ * Described in header.
+ */
+AES_NI_TARGET
+void aes_ni_set_decrypt_key(int rounds, u_int8_t *enc, u_int8_t *dec)
+{
+	__m128i *e = (__m128i*)enc, *d = (__m128i*)dec;
+	int i;
+
+	_mm_storeu_si128(d, _mm_loadu_si128(e + rounds));
+	for (i = 1; i < rounds; i++)
+	{
+		_mm_storeu_si128(d + i,
+					_mm_aesimc_si128(_mm_loadu_si128(e + rounds - i)));
+	}
+	_mm_storeu_si128(d + rounds, _mm_loadu_si128(e));
+}
+
+/**
+ * Described in header.
+ */
+AES_NI_TARGET
+void aes_ni_encrypt_cbc(int rounds, u_int8_t *key, u_int8_t *iv,
+						u_int8_t *in, u_int8_t *out, size_t len)
+{
+	__m128i k[MAX_ROUND_KEYS], b;
+	size_t pos;
+	int i;
+
+	load_key(rounds, key, k);
+	b = _mm_loadu_si128((__m128i*)iv);
+	for (pos = 0; pos < len; pos += 16)
+	{
+		b = _mm_xor_si128(b, _mm_loadu_si128((__m128i*)(in + pos)));
+		b = _mm_xor_si128(b, k[0]);
+		for (i = 1; i < rounds; i++)
+		{
+			b = _mm_aesenc_si128(b, k[i]);
+		}
+		b = _mm_aesenclast_si128(b, k[rounds]);
+		_mm_storeu_si128((__m128i*)(out + pos), b);
+	}
+}
+
+/**
+ * Described in header.
+ */
+AES_NI_TARGET
+void aes_ni_decrypt_cbc(int rounds, u_int8_t *key, u_int8_t *iv,
+						u_int8_t *in, u_int8_t *out, size_t len)
+{
+	__m128i k[MAX_ROUND_KEYS], c0, c1, c2, c3, b0, b1, b2, b3, prev;
+	__m128i *bi = (__m128i*)in, *bo = (__m128i*)out;
+	size_t blocks = len / 16, i;
+	int r;
+
+	load_key(rounds, key, k);
+	prev = _mm_loadu_si128((__m128i*)iv);
+	/* CBC decryption is parallelizable, interleave four independent blocks
+	 * to hide the latency of AESDEC */
+	for (i = 0; i + 4 <= blocks; i += 4)
+	{
+		c0 = _mm_loadu_si128(bi + i);
+		c1 = _mm_loadu_si128(bi + i + 1);
+		c2 = _mm_loadu_si128(bi + i + 2);
+		c3 = _mm_loadu_si128(bi + i + 3);
+		b0 = _mm_xor_si128(c0, k[0]);
+		b1 = _mm_xor_si128(c1, k[0]);
+		b2 = _mm_xor_si128(c2, k[0]);
+		b3 = _mm_xor_si128(c3, k[0]);
+		for (r = 1; r < rounds; r++)
+		{
+			b0 = _mm_aesdec_si128(b0, k[r]);
+			b1 = _mm_aesdec_si128(b1, k[r]);
+			b2 = _mm_aesdec_si128(b2, k[r]);
+			b3 = _mm_aesdec_si128(b3, k[r]);
+		}
+		b0 = _mm_aesdeclast_si128(b0, k[rounds]);
+		b1 = _mm_aesdeclast_si128(b1, k[rounds]);
+		b2 = _mm_aesdeclast_si128(b2, k[rounds]);
+		b3 = _mm_aesdeclast_si128(b3, k[rounds]);
+		_mm_storeu_si128(bo + i, _mm_xor_si128(b0, prev));
+		_mm_storeu_si128(bo + i + 1, _mm_xor_si128(b1, c0));
+		_mm_storeu_si128(bo + i + 2, _mm_xor_si128(b2, c1));
+		_mm_storeu_si128(bo + i + 3, _mm_xor_si128(b3, c2));
+		prev = c3;
+	}
+	for (; i < blocks; i++)
+	{
+		c0 = _mm_loadu_si128(bi + i);
+		b0 = _mm_xor_si128(c0, k[0]);
+		for (r = 1; r < rounds; r++)
+		{
+			b0 = _mm_aesdec_si128(b0, k[r]);
+		}
+		b0 = _mm_aesdeclast_si128(b0, k[rounds]);
+		_mm_storeu_si128(bo + i, _mm_xor_si128(b0, prev));
+		prev = c0;
+	}
+}
+
+#else /* no AES-NI support */
+
+bool aes_ni_supported()
+{
+	return FALSE;
+}
+
+void aes_ni_set_decrypt_key(int rounds, u_int8_t *enc, u_int8_t *dec)
+{
+}
+
+void aes_ni_encrypt_cbc(int rounds, u_int8_t *key, u_int8_t *iv,
+						u_int8_t *in, u_int8_t *out, size_t len)
+{
+}
+
+void aes_ni_decrypt_cbc(int rounds, u_int8_t *key, u_int8_t *iv,
+						u_int8_t *in, u_int8_t *out, size_t len)
+{
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup aes_ni aes_ni
+ * @{ @ingroup aes_p
+ */
+
+#ifndef AES_NI_H_
+#define AES_NI_H_
+
+#include <library.h>
+
+/**
+ * Check if the CPU supports the AES-NI instruction set.
+ *
+ * Always returns FALSE if the plugin has been built for an architecture
+ * or with a compiler not supporting AES-NI.
+ *
+ * @return			TRUE if AES-NI is available
+ */
+bool aes_ni_supported();
+
+/**
+ * Derive the AES-NI decryption key schedule from an encryption schedule.
+ *
+ * The encryption key schedule is expected as defined in FIPS-197, i.e.
+ * round key bytes in order.
+ *
+ * @param rounds	number of rounds, 10, 12 or 14
+ * @param enc		encryption key schedule, (rounds + 1) * 16 bytes
+ * @param dec		decryption key schedule to write, (rounds + 1) * 16 bytes
+ */
+void aes_ni_set_decrypt_key(int rounds, u_int8_t *enc, u_int8_t *dec);
+
+/**
+ * Encrypt data in CBC mode using AES-NI.
+ *
+ * @param rounds	number of rounds, 10, 12 or 14
+ * @param key		encryption key schedule
+ * @param iv		16 byte IV
+ * @param in		plaintext, a multiple of 16 bytes
+ * @param out		buffer to write ciphertext to, may equal in
+ * @param len		length of in and out
+ */
+void aes_ni_encrypt_cbc(int rounds, u_int8_t *key, u_int8_t *iv,
+						u_int8_t *in, u_int8_t *out, size_t len);
+
+/**
+ * Decrypt data in CBC mode using AES-NI.
+ *
+ * @param rounds	number of rounds, 10, 12 or 14
+ * @param key		decryption key schedule
+ * @param iv		16 byte IV
+ * @param in		ciphertext, a multiple of 16 bytes
+ * @param out		buffer to write plaintext to, may equal in
+ * @param len		length of in and out
+ */
+void aes_ni_decrypt_cbc(int rounds, u_int8_t *key, u_int8_t *iv,
+						u_int8_t *in, u_int8_t *out, size_t len);
+
+#endif /** AES_NI_H_ @}*/
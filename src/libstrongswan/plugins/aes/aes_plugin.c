@@ -17,6 +17,7 @@
 
 #include <library.h>
 #include "aes_crypter.h"
+#include "aes_ni.h"
 
 typedef struct private_aes_plugin_t private_aes_plugin_t;
 
@@ -73,6 +74,10 @@ plugin_t *aes_plugin_create()
 		},
 	);
 
+	aes_crypter_set_aes_ni(aes_ni_supported() &&
+			lib->settings->get_bool(lib->settings,
+									"libstrongswan.plugins.aes.aesni", TRUE));
+
 	return &this->public.plugin;
 }
 
@@ -24,6 +24,7 @@
 #include <dlfcn.h>
 #include <limits.h>
 #include <stdio.h>
+#include <inttypes.h>
 
 #include <utils/debug.h>
 #include <library.h>
@@ -83,6 +84,16 @@ struct private_plugin_loader_t {
 		/** Number of features in critical plugins that failed to load */
 		int critical;
 	} stats;
+
+	/**
+	 * Time spent in the phases of loading plugins, in microseconds
+	 */
+	struct {
+		/** Loading plugin files and constructing plugins */
+		u_int64_t plugins;
+		/** Loading plugin features */
+		u_int64_t features;
+	} timing;
 };
 
 /**
@@ -183,8 +194,30 @@ struct plugin_entry_t {
 	 * List of features, as provided_feature_t
 	 */
 	linked_list_t *features;
+
+	/**
+	 * Time to load and construct the plugin, in microseconds
+	 */
+	u_int64_t create_time;
+
+	/**
+	 * Time spent loading features of this plugin, in microseconds
+	 */
+	u_int64_t load_time;
 };
 
+/**
+ * Get the time passed since a monotonic timestamp, in microseconds
+ */
+static u_int64_t time_since(timeval_t *start)
+{
+	timeval_t now, diff;
+
+	time_monotonic(&now);
+	timersub(&now, start, &diff);
+	return diff.tv_sec * 1000000ULL + diff.tv_usec;
+}
+
 /**
  * Destroy a plugin entry
  */
@@ -677,9 +710,14 @@ static void load_feature(private_plugin_loader_t *this,
 	if (load_dependencies(this, provided, level))
 	{
 		char *name, *provide;
-
-		if (plugin_feature_load(provided->entry->plugin, provided->feature,
-								provided->reg))
+		timeval_t start;
+		bool success;
+
+		time_monotonic(&start);
+		success = plugin_feature_load(provided->entry->plugin,
+									  provided->feature, provided->reg);
+		provided->entry->load_time += time_since(&start);
+		if (success)
 		{
 			provided->loaded = TRUE;
 			/* insert first so we can unload the features in reverse order */
@@ -942,11 +980,13 @@ METHOD(plugin_loader_t, load_plugins, bool,
 	enumerator_t *enumerator;
 	char *default_path = NULL, *token;
 	bool critical_failed = FALSE;
+	timeval_t start, phase;
 
 #ifdef PLUGINDIR
 	default_path = PLUGINDIR;
 #endif /* PLUGINDIR */
 
+	time_monotonic(&start);
 	enumerator = enumerator_create_token(list, " ", " ");
 	while (!critical_failed && enumerator->enumerate(enumerator, &token))
 	{
@@ -976,9 +1016,11 @@ METHOD(plugin_loader_t, load_plugins, bool,
 		{
 			find_plugin(default_path, token, buf, &file);
 		}
+		time_monotonic(&phase);
 		entry = load_plugin(this, token, file, critical);
 		if (entry)
 		{
+			entry->create_time = time_since(&phase);
 			register_features(this, entry);
 		}
 		else if (critical)
@@ -989,9 +1031,12 @@ METHOD(plugin_loader_t, load_plugins, bool,
 		free(token);
 	}
 	enumerator->destroy(enumerator);
+	this->timing.plugins += time_since(&start);
 	if (!critical_failed)
 	{
+		time_monotonic(&phase);
 		load_features(this);
+		this->timing.features += time_since(&phase);
 		if (this->stats.critical > 0)
 		{
 			critical_failed = TRUE;
@@ -1049,6 +1094,7 @@ METHOD(plugin_loader_t, unload, void,
 	free(this->loaded_plugins);
 	this->loaded_plugins = NULL;
 	memset(&this->stats, 0, sizeof(this->stats));
+	memset(&this->timing, 0, sizeof(this->timing));
 }
 
 METHOD(plugin_loader_t, add_path, void,
@@ -1113,6 +1159,31 @@ METHOD(plugin_loader_t, loaded_plugins, char*,
 	return this->loaded_plugins ?: "";
 }
 
+/**
+ * Log the time spent loading plugins, in total and per plugin
+ */
+static void print_timing(private_plugin_loader_t *this, level_t level)
+{
+	enumerator_t *enumerator;
+	plugin_entry_t *entry;
+
+	dbg(DBG_LIB, level, "loading plugins took %" PRIu64 " ms (plugins %" PRIu64
+		" ms, features %" PRIu64 " ms)",
+		(this->timing.plugins + this->timing.features) / 1000,
+		this->timing.plugins / 1000, this->timing.features / 1000);
+
+	enumerator = this->plugins->create_enumerator(this->plugins);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		dbg(DBG_LIB, level + 1, "  %s: %" PRIu64 ".%03" PRIu64 " ms "
+			"constructor, %" PRIu64 ".%03" PRIu64 " ms features",
+			entry->plugin->get_name(entry->plugin),
+			entry->create_time / 1000, entry->create_time % 1000,
+			entry->load_time / 1000, entry->load_time % 1000);
+	}
+	enumerator->destroy(enumerator);
+}
+
 METHOD(plugin_loader_t, status, void,
 	private_plugin_loader_t *this, level_t level)
 {
@@ -1126,6 +1197,7 @@ METHOD(plugin_loader_t, status, void,
 				"unmet dependencies)", this->stats.failed,
 				this->stats.failed == 1 ? "" : "s", this->stats.depends);
 		}
+		print_timing(this, level);
 	}
 }
 
@@ -20,9 +20,15 @@
 #include <library.h>
 #include <utils/debug.h>
 #include <threading/mutex.h>
+#include <collections/hashtable.h>
 
 typedef struct private_sqlite_database_t private_sqlite_database_t;
 
+/**
+ * Maximum number of idle prepared statements kept for reuse
+ */
+#define MAX_CACHED_STMTS 32
+
 /**
  * private data of sqlite_database
  */
@@ -42,22 +48,100 @@ struct private_sqlite_database_t {
 	 * mutex used to lock execute()
 	 */
 	mutex_t *mutex;
+
+	/**
+	 * Idle prepared statements, SQL string => sqlite3_stmt
+	 */
+	hashtable_t *stmts;
+
+	/**
+	 * mutex used to lock stmts
+	 */
+	mutex_t *stmt_mutex;
 };
 
 /**
- * Create and run a sqlite stmt using a sql string and args
+ * Hashtable hash function for SQL strings
  */
-static sqlite3_stmt* run(private_sqlite_database_t *this, char *sql,
-						 va_list *args)
+static u_int stmt_hash(char *sql)
+{
+	return chunk_hash(chunk_from_str(sql));
+}
+
+/**
+ * Hashtable equals function for SQL strings
+ */
+static bool stmt_equals(char *a, char *b)
+{
+	return streq(a, b);
+}
+
+/**
+ * Prepare a statement, or reuse an idle one prepared from the same SQL
+ */
+static sqlite3_stmt* prepare(private_sqlite_database_t *this, char *sql)
 {
 	sqlite3_stmt *stmt = NULL;
-	int params, i, res = SQLITE_OK;
 
 #ifdef HAVE_SQLITE3_PREPARE_V2
+	/* statements prepared with v2 get recompiled if the schema changes, so
+	 * we can keep them around */
+	this->stmt_mutex->lock(this->stmt_mutex);
+	stmt = this->stmts->remove(this->stmts, sql);
+	this->stmt_mutex->unlock(this->stmt_mutex);
+	if (stmt)
+	{
+		return stmt;
+	}
 	if (sqlite3_prepare_v2(this->db, sql, -1, &stmt, NULL) == SQLITE_OK)
 #else
 	if (sqlite3_prepare(this->db, sql, -1, &stmt, NULL) == SQLITE_OK)
 #endif
+	{
+		return stmt;
+	}
+	DBG1(DBG_LIB, "preparing sqlite statement failed: %s",
+		 sqlite3_errmsg(this->db));
+	sqlite3_finalize(stmt);
+	return NULL;
+}
+
+/**
+ * Release a statement, keep it for reuse if possible
+ */
+static void release(private_sqlite_database_t *this, sqlite3_stmt *stmt)
+{
+#ifdef HAVE_SQLITE3_PREPARE_V2
+	char *sql;
+
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+
+	/* the SQL string is owned by the statement, it serves as key */
+	sql = (char*)sqlite3_sql(stmt);
+	this->stmt_mutex->lock(this->stmt_mutex);
+	if (this->stmts->get_count(this->stmts) < MAX_CACHED_STMTS &&
+		!this->stmts->get(this->stmts, sql))
+	{
+		this->stmts->put(this->stmts, sql, stmt);
+		stmt = NULL;
+	}
+	this->stmt_mutex->unlock(this->stmt_mutex);
+#endif
+	sqlite3_finalize(stmt);
+}
+
+/**
+ * Create and run a sqlite stmt using a sql string and args
+ */
+static sqlite3_stmt* run(private_sqlite_database_t *this, char *sql,
+						 va_list *args)
+{
+	sqlite3_stmt *stmt;
+	int params, i, res = SQLITE_OK;
+
+	stmt = prepare(this, sql);
+	if (stmt)
 	{
 		params = sqlite3_bind_parameter_count(stmt);
 		for (i = 1; i <= params; i++)
@@ -108,16 +192,11 @@ static sqlite3_stmt* run(private_sqlite_database_t *this, char *sql,
 			}
 		}
 	}
-	else
-	{
-		DBG1(DBG_LIB, "preparing sqlite statement failed: %s",
-			 sqlite3_errmsg(this->db));
-	}
 	if (res != SQLITE_OK)
 	{
 		DBG1(DBG_LIB, "binding sqlite statement failed: %s",
 			 sqlite3_errmsg(this->db));
-		sqlite3_finalize(stmt);
+		release(this, stmt);
 		return NULL;
 	}
 	return stmt;
@@ -141,7 +220,7 @@ typedef struct {
  */
 static void sqlite_enumerator_destroy(sqlite_enumerator_t *this)
 {
-	sqlite3_finalize(this->stmt);
+	release(this->database, this->stmt);
 #if SQLITE_VERSION_NUMBER < 3005000
 	this->database->mutex->unlock(this->database->mutex);
 #endif
@@ -274,7 +353,7 @@ METHOD(database_t, execute, int,
 			DBG1(DBG_LIB, "sqlite execute failed: %s",
 				 sqlite3_errmsg(this->db));
 		}
-		sqlite3_finalize(stmt);
+		release(this, stmt);
 	}
 	this->mutex->unlock(this->mutex);
 	return affected;
@@ -300,6 +379,19 @@ static int busy_handler(private_sqlite_database_t *this, int count)
 METHOD(database_t, destroy, void,
 	private_sqlite_database_t *this)
 {
+	enumerator_t *enumerator;
+	sqlite3_stmt *stmt;
+	char *sql;
+
+	enumerator = this->stmts->create_enumerator(this->stmts);
+	while (enumerator->enumerate(enumerator, &sql, &stmt))
+	{
+		sqlite3_finalize(stmt);
+	}
+	enumerator->destroy(enumerator);
+	this->stmts->destroy(this->stmts);
+	this->stmt_mutex->destroy(this->stmt_mutex);
+
 	if (sqlite3_close(this->db) == SQLITE_BUSY)
 	{
 		DBG1(DBG_LIB, "sqlite close failed because database is busy");
@@ -335,6 +427,9 @@ sqlite_database_t *sqlite_database_create(char *uri)
 			},
 		},
 		.mutex = mutex_create(MUTEX_TYPE_RECURSIVE),
+		.stmts = hashtable_create((hashtable_hash_t)stmt_hash,
+								  (hashtable_equals_t)stmt_equals, 8),
+		.stmt_mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 	);
 
 	if (sqlite3_open(file, &this->db) != SQLITE_OK)
@@ -57,6 +57,19 @@ typedef enum {
 
 typedef struct private_x509_cert_t private_x509_cert_t;
 
+/**
+ * Extensions decoded on first use if parsing lazily
+ */
+typedef enum {
+	LAZY_SUBJECT_ALT_NAME,
+	LAZY_CRL_DISTRIBUTION_POINTS,
+	LAZY_AUTHORITY_INFO_ACCESS,
+	LAZY_NAME_CONSTRAINTS,
+	LAZY_CERTIFICATE_POLICIES,
+	LAZY_POLICY_MAPPINGS,
+	LAZY_MAX,
+} lazy_extension_t;
+
 /**
  * Private data of a x509_cert_t object.
  */
@@ -112,7 +125,17 @@ struct private_x509_cert_t {
 	identification_t *subject;
 
 	/**
-	 * List of subjectAltNames as identification_t
+	 * Extension values not decoded yet, pointing into encoding
+	 */
+	chunk_t lazy[LAZY_MAX];
+
+	/**
+	 * ASN.1 level of the lazily decoded extension values
+	 */
+	int lazy_level;
+
+	/**
+	 * List of subjectAltNames as identification_t, NULL if not decoded yet
 	 */
 	linked_list_t *subjectAltNames;
 
@@ -601,10 +624,10 @@ static const asn1Object_t authInfoAccessObjects[] = {
 #define AUTH_INFO_ACCESS_LOCATION	3
 
 /**
- * Extracts an authorityInfoAcess location
+ * Extracts authorityInfoAcess OCSP locations into a list
  */
 static void parse_authorityInfoAccess(chunk_t blob, int level0,
-									  private_x509_cert_t *this)
+									  linked_list_t *list)
 {
 	asn1_parser_t *parser;
 	chunk_t object;
@@ -642,7 +665,7 @@ static void parse_authorityInfoAccess(chunk_t blob, int level0,
 							if (accessMethod == OID_OCSP &&
 								asprintf(&uri, "%Y", id) > 0)
 							{
-								this->ocsp_uris->insert_last(this->ocsp_uris, uri);
+								list->insert_last(list, uri);
 							}
 							id->destroy(id);
 						}
@@ -895,10 +918,10 @@ static const asn1Object_t nameConstraintsObjects[] = {
 #define NAME_CONSTRAINT_EXCLUDED  5
 
 /**
- * Parse permitted/excluded nameConstraints
+ * Parse permitted or excluded nameConstraints into a list
  */
 static void parse_nameConstraints(chunk_t blob, int level0,
-								  private_x509_cert_t *this)
+								  linked_list_t *list, bool perm)
 {
 	asn1_parser_t *parser;
 	identification_t *id;
@@ -913,17 +936,15 @@ static void parse_nameConstraints(chunk_t blob, int level0,
 		switch (objectID)
 		{
 			case NAME_CONSTRAINT_PERMITTED:
-				id = parse_generalName(object, parser->get_level(parser) + 1);
-				if (id)
+			case NAME_CONSTRAINT_EXCLUDED:
+				if (perm != (objectID == NAME_CONSTRAINT_PERMITTED))
 				{
-					this->permitted_names->insert_last(this->permitted_names, id);
+					break;
 				}
-				break;
-			case NAME_CONSTRAINT_EXCLUDED:
 				id = parse_generalName(object, parser->get_level(parser) + 1);
 				if (id)
 				{
-					this->excluded_names->insert_last(this->excluded_names, id);
+					list->insert_last(list, id);
 				}
 				break;
 			default:
@@ -958,10 +979,10 @@ static const asn1Object_t certificatePoliciesObject[] = {
 #define CERT_POLICY_EXPLICIT_TEXT	9
 
 /**
- * Parse certificatePolicies
+ * Parse certificatePolicies into a list
  */
 static void parse_certificatePolicies(chunk_t blob, int level0,
-									  private_x509_cert_t *this)
+									  linked_list_t *list)
 {
 	x509_cert_policy_t *policy = NULL;
 	asn1_parser_t *parser;
@@ -979,7 +1000,7 @@ static void parse_certificatePolicies(chunk_t blob, int level0,
 				INIT(policy,
 					.oid = chunk_clone(object),
 				);
-				this->cert_policies->insert_last(this->cert_policies, policy);
+				list->insert_last(list, policy);
 				break;
 			case CERT_POLICY_QUALIFIER_ID:
 				qualifier = asn1_known_oid(object);
@@ -1018,10 +1039,10 @@ static const asn1Object_t policyMappingsObjects[] = {
 #define POLICY_MAPPING_SUBJECT	3
 
 /**
- * Parse policyMappings
+ * Parse policyMappings into a list
  */
 static void parse_policyMappings(chunk_t blob, int level0,
-								 private_x509_cert_t *this)
+								 linked_list_t *list)
 {
 	x509_policy_mapping_t *map = NULL;
 	asn1_parser_t *parser;
@@ -1037,7 +1058,7 @@ static void parse_policyMappings(chunk_t blob, int level0,
 		{
 			case POLICY_MAPPING:
 				INIT(map);
-				this->policy_mappings->insert_last(this->policy_mappings, map);
+				list->insert_last(list, map);
 				break;
 			case POLICY_MAPPING_ISSUER:
 				if (map && !map->issuer.len)
@@ -1247,6 +1268,145 @@ end:
 	parser->destroy(parser);
 }
 
+/**
+ * Parse subjectAltNames into a list
+ */
+static void parse_subjectAltNames(chunk_t blob, int level0,
+								  linked_list_t *list)
+{
+	x509_parse_generalNames(blob, level0, FALSE, list);
+}
+
+/**
+ * Parse permitted nameConstraints into a list
+ */
+static void parse_permittedNames(chunk_t blob, int level0, linked_list_t *list)
+{
+	parse_nameConstraints(blob, level0, list, TRUE);
+}
+
+/**
+ * Parse excluded nameConstraints into a list
+ */
+static void parse_excludedNames(chunk_t blob, int level0, linked_list_t *list)
+{
+	parse_nameConstraints(blob, level0, list, FALSE);
+}
+
+/**
+ * Destroy an identification_t stored in a list
+ */
+static void id_destroy(identification_t *id)
+{
+	id->destroy(id);
+}
+
+/**
+ * Get the list of objects decoded from an extension, decode it on first use.
+ *
+ * Concurrent first calls might both decode the extension, but only one of
+ * the resulting lists gets installed.
+ */
+static linked_list_t *decode(private_x509_cert_t *this, linked_list_t **list,
+							 lazy_extension_t ext,
+							 void (*parse)(chunk_t, int, linked_list_t*),
+							 void (*destroy)(void*))
+{
+	linked_list_t *current = *list;
+
+	if (!current)
+	{
+		current = linked_list_create();
+		if (this->lazy[ext].len)
+		{
+			parse(this->lazy[ext], this->lazy_level, current);
+		}
+		if (!cas_ptr((void**)list, NULL, current))
+		{
+			current->destroy_function(current, destroy);
+			current = *list;
+		}
+	}
+	return current;
+}
+
+/**
+ * Get the list of subjectAltNames
+ */
+static linked_list_t *get_subjectAltNames(private_x509_cert_t *this)
+{
+	return decode(this, &this->subjectAltNames, LAZY_SUBJECT_ALT_NAME,
+				  parse_subjectAltNames, (void*)id_destroy);
+}
+
+/**
+ * Get the list of crlDistributionPoints
+ */
+static linked_list_t *get_crl_uris(private_x509_cert_t *this)
+{
+	return decode(this, &this->crl_uris, LAZY_CRL_DISTRIBUTION_POINTS,
+				  x509_parse_crlDistributionPoints, (void*)crl_uri_destroy);
+}
+
+/**
+ * Get the list of OCSP URIs
+ */
+static linked_list_t *get_ocsp_uris(private_x509_cert_t *this)
+{
+	return decode(this, &this->ocsp_uris, LAZY_AUTHORITY_INFO_ACCESS,
+				  parse_authorityInfoAccess, free);
+}
+
+/**
+ * Get the list of permitted name constraints
+ */
+static linked_list_t *get_permitted_names(private_x509_cert_t *this)
+{
+	return decode(this, &this->permitted_names, LAZY_NAME_CONSTRAINTS,
+				  parse_permittedNames, (void*)id_destroy);
+}
+
+/**
+ * Get the list of excluded name constraints
+ */
+static linked_list_t *get_excluded_names(private_x509_cert_t *this)
+{
+	return decode(this, &this->excluded_names, LAZY_NAME_CONSTRAINTS,
+				  parse_excludedNames, (void*)id_destroy);
+}
+
+/**
+ * Get the list of certificatePolicies
+ */
+static linked_list_t *get_cert_policies(private_x509_cert_t *this)
+{
+	return decode(this, &this->cert_policies, LAZY_CERTIFICATE_POLICIES,
+				  parse_certificatePolicies, (void*)cert_policy_destroy);
+}
+
+/**
+ * Get the list of policyMappings
+ */
+static linked_list_t *get_policy_mappings(private_x509_cert_t *this)
+{
+	return decode(this, &this->policy_mappings, LAZY_POLICY_MAPPINGS,
+				  parse_policyMappings, (void*)policy_mapping_destroy);
+}
+
+/**
+ * Decode all lazily decoded extensions, creates empty lists if not present
+ */
+static void decode_all(private_x509_cert_t *this)
+{
+	get_subjectAltNames(this);
+	get_crl_uris(this);
+	get_ocsp_uris(this);
+	get_permitted_names(this);
+	get_excluded_names(this);
+	get_cert_policies(this);
+	get_policy_mappings(this);
+}
+
 /**
  * ASN.1 definition of an X.509v3 x509_cert
  */
@@ -1298,7 +1458,7 @@ static const asn1Object_t certObjects[] = {
 /**
  * Parses an X.509v3 certificate
  */
-static bool parse_certificate(private_x509_cert_t *this)
+static bool parse_certificate(private_x509_cert_t *this, bool lazy)
 {
 	asn1_parser_t *parser;
 	chunk_t object;
@@ -1377,6 +1537,7 @@ static bool parse_certificate(private_x509_cert_t *this)
 				break;
 			case X509_OBJ_EXTN_VALUE:
 			{
+				this->lazy_level = level;
 				switch (extn_oid)
 				{
 					case OID_SUBJECT_KEY_ID:
@@ -1388,22 +1549,20 @@ static bool parse_certificate(private_x509_cert_t *this)
 						this->subjectKeyIdentifier = object;
 						break;
 					case OID_SUBJECT_ALT_NAME:
-						x509_parse_generalNames(object, level, FALSE,
-												this->subjectAltNames);
+						this->lazy[LAZY_SUBJECT_ALT_NAME] = object;
 						break;
 					case OID_BASIC_CONSTRAINTS:
 						parse_basicConstraints(object, level, this);
 						break;
 					case OID_CRL_DISTRIBUTION_POINTS:
-						x509_parse_crlDistributionPoints(object, level,
-														 this->crl_uris);
+						this->lazy[LAZY_CRL_DISTRIBUTION_POINTS] = object;
 						break;
 					case OID_AUTHORITY_KEY_ID:
 						this->authKeyIdentifier = x509_parse_authorityKeyIdentifier(object,
 														level, &this->authKeySerialNumber);
 						break;
 					case OID_AUTHORITY_INFO_ACCESS:
-						parse_authorityInfoAccess(object, level, this);
+						this->lazy[LAZY_AUTHORITY_INFO_ACCESS] = object;
 						break;
 					case OID_KEY_USAGE:
 						parse_keyUsage(object, this);
@@ -1415,13 +1574,13 @@ static bool parse_certificate(private_x509_cert_t *this)
 						parse_ipAddrBlocks(object, level, this);
 						break;
 					case OID_NAME_CONSTRAINTS:
-						parse_nameConstraints(object, level, this);
+						this->lazy[LAZY_NAME_CONSTRAINTS] = object;
 						break;
 					case OID_CERTIFICATE_POLICIES:
-						parse_certificatePolicies(object, level, this);
+						this->lazy[LAZY_CERTIFICATE_POLICIES] = object;
 						break;
 					case OID_POLICY_MAPPINGS:
-						parse_policyMappings(object, level, this);
+						this->lazy[LAZY_POLICY_MAPPINGS] = object;
 						break;
 					case OID_POLICY_CONSTRAINTS:
 						parse_policyConstraints(object, level, this);
@@ -1480,6 +1639,10 @@ end:
 	{
 		hasher_t *hasher;
 
+		if (!lazy)
+		{
+			decode_all(this);
+		}
 		/* check if the certificate is self-signed */
 		if (this->public.interface.interface.issued_by(
 											&this->public.interface.interface,
@@ -1525,6 +1688,7 @@ METHOD(certificate_t, has_subject, id_match_t,
 {
 	identification_t *current;
 	enumerator_t *enumerator;
+	linked_list_t *list;
 	id_match_t match, best;
 	chunk_t encoding;
 
@@ -1553,7 +1717,8 @@ METHOD(certificate_t, has_subject, id_match_t,
 		}
 	}
 	best = this->subject->matches(this->subject, subject);
-	enumerator = this->subjectAltNames->create_enumerator(this->subjectAltNames);
+	list = get_subjectAltNames(this);
+	enumerator = list->create_enumerator(list);
 	while (enumerator->enumerate(enumerator, &current))
 	{
 		match = current->matches(current, subject);
@@ -1758,19 +1923,25 @@ METHOD(x509_t, get_constraint, u_int,
 METHOD(x509_t, create_subjectAltName_enumerator, enumerator_t*,
 	private_x509_cert_t *this)
 {
-	return this->subjectAltNames->create_enumerator(this->subjectAltNames);
+	linked_list_t *list = get_subjectAltNames(this);
+
+	return list->create_enumerator(list);
 }
 
 METHOD(x509_t, create_ocsp_uri_enumerator, enumerator_t*,
 	private_x509_cert_t *this)
 {
-	return this->ocsp_uris->create_enumerator(this->ocsp_uris);
+	linked_list_t *list = get_ocsp_uris(this);
+
+	return list->create_enumerator(list);
 }
 
 METHOD(x509_t, create_crl_uri_enumerator, enumerator_t*,
 	private_x509_cert_t *this)
 {
-	return this->crl_uris->create_enumerator(this->crl_uris);
+	linked_list_t *list = get_crl_uris(this);
+
+	return list->create_enumerator(list);
 }
 
 METHOD(x509_t, create_ipAddrBlock_enumerator, enumerator_t*,
@@ -1782,23 +1953,33 @@ METHOD(x509_t, create_ipAddrBlock_enumerator, enumerator_t*,
 METHOD(x509_t, create_name_constraint_enumerator, enumerator_t*,
 	private_x509_cert_t *this, bool perm)
 {
+	linked_list_t *list;
+
 	if (perm)
 	{
-		return this->permitted_names->create_enumerator(this->permitted_names);
+		list = get_permitted_names(this);
+	}
+	else
+	{
+		list = get_excluded_names(this);
 	}
-	return this->excluded_names->create_enumerator(this->excluded_names);
+	return list->create_enumerator(list);
 }
 
 METHOD(x509_t, create_cert_policy_enumerator, enumerator_t*,
 	private_x509_cert_t *this)
 {
-	return this->cert_policies->create_enumerator(this->cert_policies);
+	linked_list_t *list = get_cert_policies(this);
+
+	return list->create_enumerator(list);
 }
 
 METHOD(x509_t, create_policy_mapping_enumerator, enumerator_t*,
 	private_x509_cert_t *this)
 {
-	return this->policy_mappings->create_enumerator(this->policy_mappings);
+	linked_list_t *list = get_policy_mappings(this);
+
+	return list->create_enumerator(list);
 }
 
 METHOD(certificate_t, destroy, void,
@@ -1806,20 +1987,19 @@ METHOD(certificate_t, destroy, void,
 {
 	if (ref_put(&this->ref))
 	{
-		this->subjectAltNames->destroy_offset(this->subjectAltNames,
-									offsetof(identification_t, destroy));
-		this->crl_uris->destroy_function(this->crl_uris, (void*)crl_uri_destroy);
-		this->ocsp_uris->destroy_function(this->ocsp_uris, free);
+		DESTROY_OFFSET_IF(this->subjectAltNames,
+						  offsetof(identification_t, destroy));
+		DESTROY_FUNCTION_IF(this->crl_uris, (void*)crl_uri_destroy);
+		DESTROY_FUNCTION_IF(this->ocsp_uris, free);
 		this->ipAddrBlocks->destroy_offset(this->ipAddrBlocks,
 										offsetof(traffic_selector_t, destroy));
-		this->permitted_names->destroy_offset(this->permitted_names,
-										offsetof(identification_t, destroy));
-		this->excluded_names->destroy_offset(this->excluded_names,
-										offsetof(identification_t, destroy));
-		this->cert_policies->destroy_function(this->cert_policies,
-											  (void*)cert_policy_destroy);
-		this->policy_mappings->destroy_function(this->policy_mappings,
-											  (void*)policy_mapping_destroy);
+		DESTROY_OFFSET_IF(this->permitted_names,
+						  offsetof(identification_t, destroy));
+		DESTROY_OFFSET_IF(this->excluded_names,
+						  offsetof(identification_t, destroy));
+		DESTROY_FUNCTION_IF(this->cert_policies, (void*)cert_policy_destroy);
+		DESTROY_FUNCTION_IF(this->policy_mappings,
+							(void*)policy_mapping_destroy);
 		DESTROY_IF(this->issuer);
 		DESTROY_IF(this->subject);
 		DESTROY_IF(this->public_key);
@@ -1875,14 +2055,7 @@ static private_x509_cert_t* create_empty(void)
 			},
 		},
 		.version = 1,
-		.subjectAltNames = linked_list_create(),
-		.crl_uris = linked_list_create(),
-		.ocsp_uris = linked_list_create(),
 		.ipAddrBlocks = linked_list_create(),
-		.permitted_names = linked_list_create(),
-		.excluded_names = linked_list_create(),
-		.cert_policies = linked_list_create(),
-		.policy_mappings = linked_list_create(),
 		.pathLenConstraint = X509_NO_CONSTRAINT,
 		.require_explicit = X509_NO_CONSTRAINT,
 		.inhibit_mapping = X509_NO_CONSTRAINT,
@@ -2391,7 +2564,8 @@ x509_cert_t *x509_cert_load(certificate_type_t type, va_list args)
 
 		cert->encoding = chunk_clone(blob);
 		cert->parsed = TRUE;
-		if (parse_certificate(cert))
+		if (parse_certificate(cert, lib->settings->get_bool(lib->settings,
+								"libstrongswan.x509.lazy_parsing", TRUE)))
 		{
 			cert->flags |= flags;
 			return &cert->public;
@@ -2413,6 +2587,7 @@ x509_cert_t *x509_cert_gen(certificate_type_t type, va_list args)
 	u_int constraint;
 
 	cert = create_empty();
+	decode_all(cert);
 	while (TRUE)
 	{
 		switch (va_arg(args, builder_part_t))
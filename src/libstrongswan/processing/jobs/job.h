@@ -123,6 +123,11 @@ struct job_t {
 	 */
 	job_status_t status;
 
+	/**
+	 * Time the job was queued, set by the processor if metrics are enabled
+	 */
+	timeval_t queued;
+
 	/**
 	 * Execute a job.
 	 *
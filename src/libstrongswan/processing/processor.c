@@ -31,6 +31,23 @@
 
 typedef struct private_processor_t private_processor_t;
 
+/**
+ * Data passed to the queue depth gauge of a priority
+ */
+typedef struct {
+
+	/**
+	 * Reference to the processor
+	 */
+	private_processor_t *processor;
+
+	/**
+	 * Priority of the job queue
+	 */
+	job_priority_t prio;
+
+} queue_gauge_t;
+
 /**
  * Private data of processor_t class.
  */
@@ -86,6 +103,16 @@ struct private_processor_t {
 	 * Condvar to wait for terminated threads
 	 */
 	condvar_t *thread_terminated;
+
+	/**
+	 * Time jobs spent in the queue for each priority, NULL if disabled
+	 */
+	histogram_t *wait[JOB_PRIO_MAX];
+
+	/**
+	 * Gauge data for the queue depth of each priority
+	 */
+	queue_gauge_t gauges[JOB_PRIO_MAX];
 };
 
 /**
@@ -207,6 +234,11 @@ static bool get_job(private_processor_t *this, worker_thread_t *worker)
 		if (this->jobs[i]->remove_first(this->jobs[i],
 										(void**)&worker->job) == SUCCESS)
 		{
+			if (this->wait[i])
+			{
+				this->wait[i]->record_since(this->wait[i],
+											&worker->job->queued);
+			}
 			worker->priority = i;
 			return TRUE;
 		}
@@ -214,6 +246,19 @@ static bool get_job(private_processor_t *this, worker_thread_t *worker)
 	return FALSE;
 }
 
+/**
+ * Mark a job as queued, remembering the time if metrics are enabled
+ */
+static void set_queued(private_processor_t *this, job_t *job,
+					   job_priority_t prio)
+{
+	job->status = JOB_STATUS_QUEUED;
+	if (this->wait[prio])
+	{
+		time_monotonic(&job->queued);
+	}
+}
+
 /**
  * Process a single job (provided in worker->job, worker->priority is also
  * expected to be set)
@@ -260,7 +305,7 @@ static void process_job(private_processor_t *this, worker_thread_t *worker)
 				to_destroy = worker->job;
 				break;
 			case JOB_REQUEUE_TYPE_FAIR:
-				worker->job->status = JOB_STATUS_QUEUED;
+				set_queued(this, worker->job, worker->priority);
 				this->jobs[worker->priority]->insert_last(
 									this->jobs[worker->priority], worker->job);
 				this->job_added->signal(this->job_added);
@@ -393,7 +438,7 @@ METHOD(processor_t, queue_job, void,
 	job_priority_t prio;
 
 	prio = sane_prio(job->get_priority(job));
-	job->status = JOB_STATUS_QUEUED;
+	set_queued(this, job, prio);
 
 	this->mutex->lock(this->mutex);
 	this->jobs[prio]->insert_last(this->jobs[prio], job);
@@ -411,7 +456,7 @@ METHOD(processor_t, execute_job, void,
 	if (this->desired_threads && get_idle_threads_nolock(this))
 	{
 		prio = sane_prio(job->get_priority(job));
-		job->status = JOB_STATUS_QUEUED;
+		set_queued(this, job, prio);
 		/* insert job in front to execute it immediately */
 		this->jobs[prio]->insert_first(this->jobs[prio], job);
 		queued = TRUE;
@@ -504,6 +549,13 @@ METHOD(processor_t, destroy, void,
 {
 	int i;
 
+	if (lib->metrics)
+	{
+		for (i = 0; i < JOB_PRIO_MAX; i++)
+		{
+			lib->metrics->remove_gauges(lib->metrics, &this->gauges[i]);
+		}
+	}
 	cancel(this);
 	this->thread_terminated->destroy(this->thread_terminated);
 	this->job_added->destroy(this->job_added);
@@ -516,6 +568,40 @@ METHOD(processor_t, destroy, void,
 	free(this);
 }
 
+/**
+ * Sample the number of queued jobs of a priority
+ */
+static u_int64_t get_queue_depth(queue_gauge_t *gauge)
+{
+	return get_job_load(gauge->processor, gauge->prio);
+}
+
+/**
+ * Register latency histograms and queue depth gauges
+ */
+static void register_metrics(private_processor_t *this)
+{
+	char labels[32];
+	int i;
+
+	for (i = 0; i < JOB_PRIO_MAX; i++)
+	{
+		snprintf(labels, sizeof(labels), "prio=\"%N\"",
+				 job_priority_names, i);
+		this->wait[i] = lib->metrics->histogram(lib->metrics,
+							"strongswan_job_queue_wait_seconds", labels,
+							"Time jobs spent in the processor queue");
+		this->gauges[i] = (queue_gauge_t){
+			.processor = this,
+			.prio = i,
+		};
+		lib->metrics->add_gauge(lib->metrics, "strongswan_job_queue_depth",
+							labels, "Number of jobs in the processor queue",
+							(metrics_gauge_cb_t)get_queue_depth,
+							&this->gauges[i]);
+	}
+}
+
 /*
  * Described in header.
  */
@@ -548,6 +634,10 @@ processor_t *processor_create()
 						"libstrongswan.processor.priority_threads.%N", 0,
 						job_priority_names, i);
 	}
+	if (lib->metrics)
+	{
+		register_metrics(this);
+	}
 
 	return &this->public;
 }
@@ -20,12 +20,22 @@
 #include <threading/mutex.h>
 #include <threading/condvar.h>
 #include <collections/linked_list.h>
+#include <collections/hashtable.h>
 #include <processing/jobs/callback_job.h>
 
 #include <unistd.h>
 #include <errno.h>
 #include <sys/select.h>
 #include <fcntl.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+/**
+ * Maximum number of events to fetch with a single epoll_wait() call
+ */
+#define EPOLL_EVENTS 64
+
 
 typedef struct private_watcher_t private_watcher_t;
 
@@ -40,12 +50,12 @@ struct private_watcher_t {
 	watcher_t public;
 
 	/**
-	 * List of registered FDs, as entry_t
+	 * Registered FDs, fd_entry_t indexed by FD
 	 */
-	linked_list_t *fds;
+	hashtable_t *fds;
 
 	/**
-	 * Lock to access FD list
+	 * Lock to access FD table
 	 */
 	mutex_t *mutex;
 
@@ -59,6 +69,11 @@ struct private_watcher_t {
 	 */
 	int notify[2];
 
+	/**
+	 * epoll instance, -1 to use select()
+	 */
+	int epfd;
+
 	/**
 	 * List of callback jobs to process by watcher thread, as job_t
 	 */
@@ -66,7 +81,7 @@ struct private_watcher_t {
 };
 
 /**
- * Entry for a registered file descriptor
+ * Entry for a registered callback
  */
 typedef struct {
 	/** file descriptor */
@@ -81,6 +96,20 @@ typedef struct {
 	int in_callback;
 } entry_t;
 
+/**
+ * All callbacks registered for a file descriptor
+ */
+typedef struct {
+	/** file descriptor, used as key */
+	int fd;
+	/** registered callbacks, as entry_t */
+	linked_list_t *entries;
+	/** events currently monitored using epoll */
+	u_int32_t monitored;
+	/** FD added to epoll instance? */
+	bool added;
+} fd_entry_t;
+
 /**
  * Data we pass on for an async notification
  */
@@ -95,10 +124,28 @@ typedef struct {
 	void *data;
 	/** keep registered? */
 	bool keep;
+	/** entry the callback belongs to */
+	entry_t *entry;
 	/** reference to watcher */
 	private_watcher_t *this;
 } notify_data_t;
 
+/**
+ * Hash function for FDs
+ */
+static u_int hash_fd(int *fd)
+{
+	return *fd;
+}
+
+/**
+ * Equals function for FDs
+ */
+static bool equals_fd(int *a, int *b)
+{
+	return *a == *b;
+}
+
 /**
  * Notify watcher thread about changes
  */
@@ -112,6 +159,97 @@ static void update(private_watcher_t *this)
 	}
 }
 
+/**
+ * Update the events monitored for an FD, if epoll is used
+ */
+static void update_fd(private_watcher_t *this, fd_entry_t *fd)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event event = {
+		.data.fd = fd->fd,
+	};
+	enumerator_t *enumerator;
+	entry_t *entry;
+
+	if (this->epfd == -1)
+	{
+		return;
+	}
+	enumerator = fd->entries->create_enumerator(fd->entries);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		if (!entry->in_callback)
+		{
+			if (entry->events & WATCHER_READ)
+			{
+				event.events |= EPOLLIN;
+			}
+			if (entry->events & WATCHER_WRITE)
+			{
+				event.events |= EPOLLOUT;
+			}
+			if (entry->events & WATCHER_EXCEPT)
+			{
+				event.events |= EPOLLPRI;
+			}
+		}
+	}
+	enumerator->destroy(enumerator);
+
+	if (!event.events)
+	{	/* epoll reports EPOLLHUP/EPOLLERR even with an empty event mask, so
+		 * we remove the FD while all its callbacks are active. The FD might
+		 * already be closed, so ignore errors. */
+		if (fd->added)
+		{
+			DBG3(DBG_JOB, "  unwatching %d", fd->fd);
+			epoll_ctl(this->epfd, EPOLL_CTL_DEL, fd->fd, NULL);
+			fd->added = FALSE;
+		}
+		return;
+	}
+	if (fd->added && fd->monitored == event.events)
+	{
+		return;
+	}
+	if (epoll_ctl(this->epfd, fd->added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+				  fd->fd, &event) == 0 ||
+		/* a closed and reopened FD got implicitly removed from the epoll
+		 * instance, or the reverse happened before we noticed */
+		(fd->added && errno == ENOENT &&
+		 epoll_ctl(this->epfd, EPOLL_CTL_ADD, fd->fd, &event) == 0) ||
+		(!fd->added && errno == EEXIST &&
+		 epoll_ctl(this->epfd, EPOLL_CTL_MOD, fd->fd, &event) == 0))
+	{
+		DBG3(DBG_JOB, "  watching %d for events 0x%x", fd->fd, event.events);
+		fd->monitored = event.events;
+		fd->added = TRUE;
+	}
+	else
+	{
+		DBG1(DBG_JOB, "watcher failed to watch FD %d: %s", fd->fd,
+			 strerror(errno));
+		fd->added = FALSE;
+	}
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+/**
+ * Remove and destroy an FD entry without any registered callbacks
+ */
+static void remove_fd(private_watcher_t *this, fd_entry_t *fd)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	if (fd->added)
+	{	/* the FD might already be closed, so ignore errors */
+		epoll_ctl(this->epfd, EPOLL_CTL_DEL, fd->fd, NULL);
+	}
+#endif /* HAVE_SYS_EPOLL_H */
+	this->fds->remove(this->fds, &fd->fd);
+	fd->entries->destroy(fd->entries);
+	free(fd);
+}
+
 /**
  * Cleanup function if callback gets cancelled
  */
@@ -140,33 +278,47 @@ static job_requeue_t notify_async(notify_data_t *data)
 static void notify_end(notify_data_t *data)
 {
 	private_watcher_t *this = data->this;
-	enumerator_t *enumerator;
-	entry_t *entry;
+	fd_entry_t *fd;
+	entry_t *entry = data->entry;
 
 	/* reactivate the disabled entry */
 	this->mutex->lock(this->mutex);
-	enumerator = this->fds->create_enumerator(this->fds);
-	while (enumerator->enumerate(enumerator, &entry))
+	fd = this->fds->get(this->fds, &data->fd);
+	if (fd)
 	{
-		if (entry->fd == data->fd)
+		/* the entry might be gone if the FD got removed (and re-added)
+		 * after the watcher thread has been cancelled */
+		if (fd->entries->find_first(fd->entries, NULL,
+									(void**)&entry) == SUCCESS)
 		{
 			if (!data->keep)
 			{
 				entry->events &= ~data->event;
-				if (!entry->events)
-				{
-					this->fds->remove_at(this->fds, enumerator);
-					free(entry);
-					break;
-				}
 			}
-			entry->in_callback--;
-			break;
+			if (entry->in_callback)
+			{
+				entry->in_callback--;
+			}
+			if (!entry->events && !entry->in_callback)
+			{
+				fd->entries->remove(fd->entries, entry, NULL);
+				free(entry);
+			}
+		}
+		if (fd->entries->get_count(fd->entries))
+		{
+			update_fd(this, fd);
+		}
+		else
+		{
+			remove_fd(this, fd);
 		}
 	}
-	enumerator->destroy(enumerator);
 
-	update(this);
+	if (this->epfd == -1 || !this->fds->get_count(this->fds))
+	{	/* rebuild FD sets, or terminate watcher thread */
+		update(this);
+	}
 	this->condvar->broadcast(this->condvar);
 	this->mutex->unlock(this->mutex);
 
@@ -188,10 +340,11 @@ static void notify(private_watcher_t *this, entry_t *entry,
 		.cb = entry->cb,
 		.data = entry->data,
 		.keep = TRUE,
+		.entry = entry,
 		.this = this,
 	);
 
-	/* deactivate entry, so we can select() other FDs even if the async
+	/* deactivate entry, so we can watch other FDs even if the async
 	 * processing did not handle the event yet */
 	entry->in_callback++;
 
@@ -201,12 +354,48 @@ static void notify(private_watcher_t *this, entry_t *entry,
 						JOB_PRIO_CRITICAL));
 }
 
+/**
+ * Notify all active callbacks of an FD about the given ready events
+ */
+static void notify_fd(private_watcher_t *this, fd_entry_t *fd,
+					  watcher_event_t ready)
+{
+	enumerator_t *enumerator;
+	entry_t *entry;
+
+	enumerator = fd->entries->create_enumerator(fd->entries);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		if (entry->in_callback)
+		{
+			continue;
+		}
+		if (ready & entry->events & WATCHER_READ)
+		{
+			DBG2(DBG_JOB, "watched FD %d ready to read", entry->fd);
+			notify(this, entry, WATCHER_READ);
+		}
+		if (ready & entry->events & WATCHER_WRITE)
+		{
+			DBG2(DBG_JOB, "watched FD %d ready to write", entry->fd);
+			notify(this, entry, WATCHER_WRITE);
+		}
+		if (ready & entry->events & WATCHER_EXCEPT)
+		{
+			DBG2(DBG_JOB, "watched FD %d has exception", entry->fd);
+			notify(this, entry, WATCHER_EXCEPT);
+		}
+	}
+	enumerator->destroy(enumerator);
+}
+
 /**
  * Thread cancellation function for watcher thread
  */
 static void activate_all(private_watcher_t *this)
 {
-	enumerator_t *enumerator;
+	enumerator_t *enumerator, *entries;
+	fd_entry_t *fd;
 	entry_t *entry;
 
 	/* When the watcher thread gets cancelled, we have to reactivate any entry
@@ -214,9 +403,15 @@ static void activate_all(private_watcher_t *this)
 
 	this->mutex->lock(this->mutex);
 	enumerator = this->fds->create_enumerator(this->fds);
-	while (enumerator->enumerate(enumerator, &entry))
+	while (enumerator->enumerate(enumerator, NULL, &fd))
 	{
-		entry->in_callback = 0;
+		entries = fd->entries->create_enumerator(fd->entries);
+		while (entries->enumerate(entries, &entry))
+		{
+			entry->in_callback = 0;
+		}
+		entries->destroy(entries);
+		update_fd(this, fd);
 	}
 	enumerator->destroy(enumerator);
 	this->condvar->broadcast(this->condvar);
@@ -224,11 +419,104 @@ static void activate_all(private_watcher_t *this)
 }
 
 /**
- * Dispatching function
+ * Queue the collected callback jobs, returns FALSE if there were none
  */
-static job_requeue_t watch(private_watcher_t *this)
+static bool execute_jobs(private_watcher_t *this)
 {
-	enumerator_t *enumerator;
+	job_t *job;
+	bool executed = FALSE;
+
+	while (this->jobs->remove_first(this->jobs, (void**)&job) == SUCCESS)
+	{
+		lib->processor->execute_job(lib->processor, job);
+		executed = TRUE;
+	}
+	return executed;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/**
+ * Dispatching function using epoll
+ */
+static job_requeue_t watch_epoll(private_watcher_t *this)
+{
+	struct epoll_event events[EPOLL_EVENTS];
+	watcher_event_t ready;
+	fd_entry_t *fd;
+	char buf[32];
+	bool old;
+	int i, res;
+
+	this->mutex->lock(this->mutex);
+	if (this->fds->get_count(this->fds) == 0)
+	{
+		this->mutex->unlock(this->mutex);
+		return JOB_REQUEUE_NONE;
+	}
+	this->mutex->unlock(this->mutex);
+
+	DBG2(DBG_JOB, "watcher going to epoll_wait()");
+	thread_cleanup_push((void*)activate_all, this);
+	old = thread_cancelability(TRUE);
+	res = epoll_wait(this->epfd, events, countof(events), -1);
+	thread_cancelability(old);
+	thread_cleanup_pop(FALSE);
+	if (res < 0)
+	{
+		if (errno != EINTR)
+		{
+			DBG1(DBG_JOB, "watcher epoll_wait() error: %s", strerror(errno));
+		}
+		return JOB_REQUEUE_DIRECT;
+	}
+
+	this->mutex->lock(this->mutex);
+	for (i = 0; i < res; i++)
+	{
+		if (events[i].data.fd == this->notify[0])
+		{
+			DBG2(DBG_JOB, "watcher got notification");
+			while (read(this->notify[0], buf, sizeof(buf)) > 0);
+			continue;
+		}
+		fd = this->fds->get(this->fds, &events[i].data.fd);
+		if (!fd)
+		{	/* removed in the meantime */
+			continue;
+		}
+		ready = 0;
+		if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+		{	/* like select(), report errors as readable/writable */
+			ready |= WATCHER_READ;
+		}
+		if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+		{
+			ready |= WATCHER_WRITE;
+		}
+		if (events[i].events & EPOLLPRI)
+		{
+			ready |= WATCHER_EXCEPT;
+		}
+		notify_fd(this, fd, ready);
+		/* notified callbacks are disabled until they return */
+		update_fd(this, fd);
+	}
+	this->mutex->unlock(this->mutex);
+
+	execute_jobs(this);
+	return JOB_REQUEUE_DIRECT;
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
+
+/**
+ * Dispatching function using select()
+ */
+static job_requeue_t watch_select(private_watcher_t *this)
+{
+	enumerator_t *enumerator, *entries;
+	fd_entry_t *fd;
 	entry_t *entry;
 	fd_set rd, wr, ex;
 	int maxfd = 0, res;
@@ -251,36 +539,45 @@ static job_requeue_t watch(private_watcher_t *this)
 	}
 
 	enumerator = this->fds->create_enumerator(this->fds);
-	while (enumerator->enumerate(enumerator, &entry))
+	while (enumerator->enumerate(enumerator, NULL, &fd))
 	{
-		if (!entry->in_callback)
+		if (fd->fd >= FD_SETSIZE)
+		{	/* can't be handled by select(), warned in add() */
+			continue;
+		}
+		entries = fd->entries->create_enumerator(fd->entries);
+		while (entries->enumerate(entries, &entry))
 		{
-			if (entry->events & WATCHER_READ)
-			{
-				DBG3(DBG_JOB, "  watching %d for reading", entry->fd);
-				FD_SET(entry->fd, &rd);
-			}
-			if (entry->events & WATCHER_WRITE)
+			if (!entry->in_callback)
 			{
-				DBG3(DBG_JOB, "  watching %d for writing", entry->fd);
-				FD_SET(entry->fd, &wr);
-			}
-			if (entry->events & WATCHER_EXCEPT)
-			{
-				DBG3(DBG_JOB, "  watching %d for exceptions", entry->fd);
-				FD_SET(entry->fd, &ex);
+				if (entry->events & WATCHER_READ)
+				{
+					DBG3(DBG_JOB, "  watching %d for reading", entry->fd);
+					FD_SET(entry->fd, &rd);
+				}
+				if (entry->events & WATCHER_WRITE)
+				{
+					DBG3(DBG_JOB, "  watching %d for writing", entry->fd);
+					FD_SET(entry->fd, &wr);
+				}
+				if (entry->events & WATCHER_EXCEPT)
+				{
+					DBG3(DBG_JOB, "  watching %d for exceptions", entry->fd);
+					FD_SET(entry->fd, &ex);
+				}
+				maxfd = max(maxfd, entry->fd);
 			}
-			maxfd = max(maxfd, entry->fd);
 		}
+		entries->destroy(entries);
 	}
 	enumerator->destroy(enumerator);
 	this->mutex->unlock(this->mutex);
 
 	while (TRUE)
 	{
+		watcher_event_t ready;
 		char buf[1];
 		bool old;
-		job_t *job;
 
 		DBG2(DBG_JOB, "watcher going to select()");
 		thread_cleanup_push((void*)activate_all, this);
@@ -299,34 +596,35 @@ static job_requeue_t watch(private_watcher_t *this)
 
 			this->mutex->lock(this->mutex);
 			enumerator = this->fds->create_enumerator(this->fds);
-			while (enumerator->enumerate(enumerator, &entry))
+			while (enumerator->enumerate(enumerator, NULL, &fd))
 			{
-				if (FD_ISSET(entry->fd, &rd) && (entry->events & WATCHER_READ))
+				if (fd->fd >= FD_SETSIZE)
+				{
+					continue;
+				}
+				ready = 0;
+				if (FD_ISSET(fd->fd, &rd))
 				{
-					DBG2(DBG_JOB, "watched FD %d ready to read", entry->fd);
-					notify(this, entry, WATCHER_READ);
+					ready |= WATCHER_READ;
 				}
-				if (FD_ISSET(entry->fd, &wr) && (entry->events & WATCHER_WRITE))
+				if (FD_ISSET(fd->fd, &wr))
 				{
-					DBG2(DBG_JOB, "watched FD %d ready to write", entry->fd);
-					notify(this, entry, WATCHER_WRITE);
+					ready |= WATCHER_WRITE;
 				}
-				if (FD_ISSET(entry->fd, &ex) && (entry->events & WATCHER_EXCEPT))
+				if (FD_ISSET(fd->fd, &ex))
 				{
-					DBG2(DBG_JOB, "watched FD %d has exception", entry->fd);
-					notify(this, entry, WATCHER_EXCEPT);
+					ready |= WATCHER_EXCEPT;
+				}
+				if (ready)
+				{
+					notify_fd(this, fd, ready);
 				}
 			}
 			enumerator->destroy(enumerator);
 			this->mutex->unlock(this->mutex);
 
-			if (this->jobs->get_count(this->jobs))
+			if (execute_jobs(this))
 			{
-				while (this->jobs->remove_first(this->jobs,
-												(void**)&job) == SUCCESS)
-				{
-					lib->processor->execute_job(lib->processor, job);
-				}
 				/* we temporarily disable a notified FD, rebuild FDSET */
 				return JOB_REQUEUE_DIRECT;
 			}
@@ -338,12 +636,32 @@ static job_requeue_t watch(private_watcher_t *this)
 	}
 }
 
+/**
+ * Dispatching function
+ */
+static job_requeue_t watch(private_watcher_t *this)
+{
+#ifdef HAVE_SYS_EPOLL_H
+	if (this->epfd != -1)
+	{
+		return watch_epoll(this);
+	}
+#endif /* HAVE_SYS_EPOLL_H */
+	return watch_select(this);
+}
+
 METHOD(watcher_t, add, void,
 	private_watcher_t *this, int fd, watcher_event_t events,
 	watcher_cb_t cb, void *data)
 {
+	fd_entry_t *fd_entry;
 	entry_t *entry;
 
+	if (this->epfd == -1 && fd >= FD_SETSIZE)
+	{
+		DBG1(DBG_JOB, "watcher can't watch FD %d, exceeds FD_SETSIZE", fd);
+	}
+
 	INIT(entry,
 		.fd = fd,
 		.events = events,
@@ -352,14 +670,25 @@ METHOD(watcher_t, add, void,
 	);
 
 	this->mutex->lock(this->mutex);
-	this->fds->insert_last(this->fds, entry);
-	if (this->fds->get_count(this->fds) == 1)
+	fd_entry = this->fds->get(this->fds, &fd);
+	if (!fd_entry)
+	{
+		INIT(fd_entry,
+			.fd = fd,
+			.entries = linked_list_create(),
+		);
+		this->fds->put(this->fds, &fd_entry->fd, fd_entry);
+	}
+	fd_entry->entries->insert_last(fd_entry->entries, entry);
+	update_fd(this, fd_entry);
+	if (this->fds->get_count(this->fds) == 1 &&
+		fd_entry->entries->get_count(fd_entry->entries) == 1)
 	{
 		lib->processor->queue_job(lib->processor,
 			(job_t*)callback_job_create_with_prio((void*)watch, this,
 				NULL, (callback_job_cancel_t)return_false, JOB_PRIO_CRITICAL));
 	}
-	else
+	else if (this->epfd == -1)
 	{
 		update(this);
 	}
@@ -370,6 +699,7 @@ METHOD(watcher_t, remove_, void,
 	private_watcher_t *this, int fd)
 {
 	enumerator_t *enumerator;
+	fd_entry_t *fd_entry;
 	entry_t *entry;
 
 	this->mutex->lock(this->mutex);
@@ -377,29 +707,35 @@ METHOD(watcher_t, remove_, void,
 	{
 		bool is_in_callback = FALSE;
 
-		enumerator = this->fds->create_enumerator(this->fds);
+		fd_entry = this->fds->get(this->fds, &fd);
+		if (!fd_entry)
+		{
+			break;
+		}
+		enumerator = fd_entry->entries->create_enumerator(fd_entry->entries);
 		while (enumerator->enumerate(enumerator, &entry))
 		{
-			if (entry->fd == fd)
+			if (entry->in_callback)
 			{
-				if (entry->in_callback)
-				{
-					is_in_callback = TRUE;
-					break;
-				}
-				this->fds->remove_at(this->fds, enumerator);
-				free(entry);
+				is_in_callback = TRUE;
+				break;
 			}
+			fd_entry->entries->remove_at(fd_entry->entries, enumerator);
+			free(entry);
 		}
 		enumerator->destroy(enumerator);
 		if (!is_in_callback)
 		{
+			remove_fd(this, fd_entry);
 			break;
 		}
 		this->condvar->wait(this->condvar, this->mutex);
 	}
 
-	update(this);
+	if (this->epfd == -1 || !this->fds->get_count(this->fds))
+	{
+		update(this);
+	}
 	this->mutex->unlock(this->mutex);
 }
 
@@ -417,10 +753,50 @@ METHOD(watcher_t, destroy, void,
 	{
 		close(this->notify[1]);
 	}
+	if (this->epfd != -1)
+	{
+		close(this->epfd);
+	}
 	this->jobs->destroy(this->jobs);
 	free(this);
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+
+/**
+ * Create the epoll instance and watch the notification pipe with it
+ */
+static void create_epoll(private_watcher_t *this)
+{
+	struct epoll_event event = {
+		.events = EPOLLIN,
+		.data.fd = this->notify[0],
+	};
+
+	if (!lib->settings->get_bool(lib->settings, "libstrongswan.watcher.epoll",
+								 TRUE) || this->notify[0] == -1)
+	{
+		return;
+	}
+	this->epfd = epoll_create(EPOLL_EVENTS);
+	if (this->epfd == -1)
+	{
+		DBG1(DBG_LIB, "creating watcher epoll instance failed, using "
+			 "select(): %s", strerror(errno));
+		return;
+	}
+	if (fcntl(this->epfd, F_SETFD, FD_CLOEXEC) == -1 ||
+		epoll_ctl(this->epfd, EPOLL_CTL_ADD, this->notify[0], &event) == -1)
+	{
+		DBG1(DBG_LIB, "watching notify pipe with epoll failed, using "
+			 "select(): %s", strerror(errno));
+		close(this->epfd);
+		this->epfd = -1;
+	}
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
+
 /**
  * See header
  */
@@ -435,12 +811,14 @@ watcher_t *watcher_create()
 			.remove = _remove_,
 			.destroy = _destroy,
 		},
-		.fds = linked_list_create(),
+		.fds = hashtable_create((hashtable_hash_t)hash_fd,
+								(hashtable_equals_t)equals_fd, 32),
 		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 		.condvar = condvar_create(CONDVAR_TYPE_DEFAULT),
 		.jobs = linked_list_create(),
 		.notify[0] = -1,
 		.notify[1] = -1,
+		.epfd = -1,
 	);
 
 	if (pipe(this->notify) == 0)
@@ -459,5 +837,8 @@ watcher_t *watcher_create()
 		DBG1(DBG_LIB, "creating watcher notify pipe failed: %s",
 			 strerror(errno));
 	}
+#ifdef HAVE_SYS_EPOLL_H
+	create_epoll(this);
+#endif /* HAVE_SYS_EPOLL_H */
 	return &this->public;
 }
@@ -36,8 +36,8 @@ typedef enum watcher_event_t watcher_event_t;
  * re-enable the event, while the data read can be processed in another
  * asynchronous job.
  *
- * On Linux, even if select() marks an FD as "ready", a subsequent read/write
- * can block. It is therefore highly recommended to use non-blocking I/O
+ * On Linux, even if select()/epoll marks an FD as "ready", a subsequent
+ * read/write can block. It is therefore highly recommended to use non-blocking I/O
  * and handle EAGAIN/EWOULDBLOCK gracefully.
  *
  * @param data		user data passed during registration
@@ -57,7 +57,12 @@ enum watcher_event_t {
 };
 
 /**
- * Watch multiple file descriptors using select().
+ * Watch multiple file descriptors using epoll, if available, or select().
+ *
+ * Events are level-triggered with both backends. With epoll, only changes
+ * to the watched FDs are passed to the kernel, which avoids rebuilding the
+ * set of watched FDs on each event and allows to watch FDs exceeding
+ * FD_SETSIZE.
  */
 struct watcher_t {
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "test_suite.h"
+
+#include <crypto/crypto_tester.h>
+
+static hasher_test_vector_t md5_a = {
+	.alg = HASH_MD5, .len = 1, .data = "a",
+	.hash = "\x0c\xc1\x75\xb9\xc0\xf1\xb6\xa8\x31\xc3\x99\xe2\x69\x77\x26\x61",
+};
+
+static hasher_test_vector_t md5_b = {
+	.alg = HASH_MD5, .len = 1, .data = "b",
+	.hash = "\x92\xeb\x5f\xfe\xe6\xae\x2f\xec\x3a\xd7\x1c\x77\x75\x31\x57\x8f",
+};
+
+static hasher_test_vector_t sha1_a = {
+	.alg = HASH_SHA1, .len = 1, .data = "a",
+	.hash = "\x86\xf7\xe4\x37\xfa\xa5\xa7\xfc\xe1\x5d"
+			"\x1d\xdc\xb9\xea\xea\xea\x37\x76\x67\xb8",
+};
+
+/*******************************************************************************
+ * vector digest
+ */
+
+START_TEST(test_digest_add)
+{
+	crypto_tester_t *tester;
+	u_int32_t none, one, two;
+
+	tester = crypto_tester_create();
+	none = tester->get_vector_digest(tester, HASH_ALGORITHM, HASH_MD5);
+	tester->add_hasher_vector(tester, &md5_a);
+	one = tester->get_vector_digest(tester, HASH_ALGORITHM, HASH_MD5);
+	tester->add_hasher_vector(tester, &md5_b);
+	two = tester->get_vector_digest(tester, HASH_ALGORITHM, HASH_MD5);
+	ck_assert(none != one);
+	ck_assert(one != two);
+	ck_assert(none != two);
+	tester->destroy(tester);
+}
+END_TEST
+
+START_TEST(test_digest_algorithm)
+{
+	crypto_tester_t *tester;
+	u_int32_t md5, sha1;
+
+	tester = crypto_tester_create();
+	tester->add_hasher_vector(tester, &md5_a);
+	md5 = tester->get_vector_digest(tester, HASH_ALGORITHM, HASH_MD5);
+	sha1 = tester->get_vector_digest(tester, HASH_ALGORITHM, HASH_SHA1);
+	tester->add_hasher_vector(tester, &sha1_a);
+	/* vectors for other algorithms don't change the digest */
+	ck_assert(md5 == tester->get_vector_digest(tester, HASH_ALGORITHM,
+											   HASH_MD5));
+	ck_assert(sha1 != tester->get_vector_digest(tester, HASH_ALGORITHM,
+												HASH_SHA1));
+	tester->destroy(tester);
+}
+END_TEST
+
+START_TEST(test_digest_data)
+{
+	crypto_tester_t *a, *b;
+	hasher_test_vector_t md5_c = md5_a;
+
+	a = crypto_tester_create();
+	b = crypto_tester_create();
+	a->add_hasher_vector(a, &md5_a);
+	b->add_hasher_vector(b, &md5_c);
+	/* equal vectors at different addresses have the same digest */
+	ck_assert(a->get_vector_digest(a, HASH_ALGORITHM, HASH_MD5) ==
+			  b->get_vector_digest(b, HASH_ALGORITHM, HASH_MD5));
+	md5_c.data = "c";
+	ck_assert(a->get_vector_digest(a, HASH_ALGORITHM, HASH_MD5) !=
+			  b->get_vector_digest(b, HASH_ALGORITHM, HASH_MD5));
+	a->destroy(a);
+	b->destroy(b);
+}
+END_TEST
+
+Suite *crypto_tester_suite_create()
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("crypto_tester");
+
+	tc = tcase_create("vector digest");
+	tcase_add_test(tc, test_digest_add);
+	tcase_add_test(tc, test_digest_algorithm);
+	tcase_add_test(tc, test_digest_data);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
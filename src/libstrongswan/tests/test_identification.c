@@ -644,6 +644,104 @@ START_TEST(test_contains_wildcards)
 }
 END_TEST
 
+/*******************************************************************************
+ * hash
+ */
+
+static bool id_hash_equals(char *a_str, char *b_str)
+{
+	identification_t *a, *b;
+	bool equals;
+
+	a = identification_create_from_string(a_str);
+	b = identification_create_from_string(b_str);
+	equals = a->hash(a, 0) == b->hash(b, 0);
+	a->destroy(a);
+	b->destroy(b);
+	return equals;
+}
+
+START_TEST(test_hash)
+{
+	ck_assert(id_hash_equals("C=CH, E=moon@strongswan.org, CN=moon",
+							 "C=ch, E=moon@STRONGSWAN.ORG, CN=Moon"));
+	ck_assert(id_hash_equals("C=CH, O=strongSwan", "C=CH/O=strongswan"));
+	ck_assert(!id_hash_equals("C=CH, O=strongSwan", "C=CN, O=strongSwan"));
+	ck_assert(!id_hash_equals("C=CH, O=strongSwan", "O=strongSwan, C=CH"));
+	ck_assert(id_hash_equals("moon@strongswan.org", "MOON@strongSwan.org"));
+	ck_assert(!id_hash_equals("moon@strongswan.org", "sun@strongswan.org"));
+	ck_assert(id_hash_equals("%any", "0.0.0.0"));
+	ck_assert(!id_hash_equals("192.168.1.1", "192.168.1.2"));
+}
+END_TEST
+
+START_TEST(test_hash_binary)
+{
+	identification_t *a, *b;
+	char buf[32];
+	u_int hashes[256];
+	int i, j;
+
+	/* binary encodings with null bytes must not collide */
+	for (i = 0; i < countof(hashes); i++)
+	{
+		snprintf(buf, sizeof(buf), "10.0.%d.%d", i / 16, i % 16);
+		a = identification_create_from_string(buf);
+		hashes[i] = a->hash(a, 0);
+		a->destroy(a);
+		for (j = 0; j < i; j++)
+		{
+			ck_assert(hashes[i] != hashes[j]);
+		}
+	}
+	ck_assert(!id_hash_equals("fec0::1", "fec0::2"));
+	a = identification_create_from_encoding(ID_KEY_ID,
+										chunk_from_chars(0x00, 0x01, 0x02));
+	b = identification_create_from_encoding(ID_KEY_ID,
+										chunk_from_chars(0x00, 0x01, 0x03));
+	ck_assert(a->hash(a, 0) != b->hash(b, 0));
+	a->destroy(a);
+	b->destroy(b);
+}
+END_TEST
+
+START_TEST(test_hash_inc)
+{
+	identification_t *a, *b;
+
+	a = identification_create_from_string("C=CH, O=strongSwan, CN=moon");
+	b = a->clone(a);
+	ck_assert(a->hash(a, 0) == b->hash(b, 0));
+	ck_assert(a->hash(a, 0) == a->hash(a, 0));
+	ck_assert(a->hash(a, 1) == b->hash(b, 1));
+	ck_assert(a->hash(a, 0) != a->hash(a, 1));
+	a->destroy(a);
+	b->destroy(b);
+}
+END_TEST
+
+START_TEST(test_matches_hashed)
+{
+	identification_t *a, *b;
+
+	a = identification_create_from_string("C=CH, O=strongSwan, CN=moon");
+	b = identification_create_from_string("C=CH, O=strongSwan, CN=sun");
+	/* hashes are calculated and cached on first use */
+	ck_assert(!a->equals(a, b));
+	ck_assert(a->matches(a, b) == ID_MATCH_NONE);
+	b->destroy(b);
+	b = identification_create_from_string("C=ch, O=strongswan, CN=MOON");
+	ck_assert(a->equals(a, b));
+	ck_assert(a->matches(a, b) == ID_MATCH_PERFECT);
+	b->destroy(b);
+	b = identification_create_from_string("C=CH, O=*, CN=moon");
+	ck_assert(!a->equals(a, b));
+	ck_assert(a->matches(a, b) == ID_MATCH_ONE_WILDCARD);
+	b->destroy(b);
+	a->destroy(a);
+}
+END_TEST
+
 /*******************************************************************************
  * clone
  */
@@ -707,6 +805,13 @@ Suite *identification_suite_create()
 	tcase_add_test(tc, test_contains_wildcards);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("hash");
+	tcase_add_test(tc, test_hash);
+	tcase_add_test(tc, test_hash_binary);
+	tcase_add_test(tc, test_hash_inc);
+	tcase_add_test(tc, test_matches_hashed);
+	suite_add_tcase(s, tc);
+
 	tc = tcase_create("clone");
 	tcase_add_test(tc, test_clone);
 	suite_add_tcase(s, tc);
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "test_suite.h"
+
+#include <credentials/sets/mem_cred.h>
+#include <plugins/plugin_feature.h>
+
+static mem_cred_t *creds;
+
+START_SETUP(setup_creds)
+{
+	creds = mem_cred_create();
+}
+END_SETUP
+
+START_TEARDOWN(teardown_creds)
+{
+	creds->destroy(creds);
+}
+END_TEARDOWN
+
+/**
+ * Add a shared key with the given value for up to two owners
+ */
+static void add_shared(mem_cred_t *set, char *value, char *a, char *b)
+{
+	shared_key_t *shared;
+
+	shared = shared_key_create(SHARED_IKE, chunk_clone(chunk_from_str(value)));
+	set->add_shared(set, shared,
+					a ? identification_create_from_string(a) : NULL,
+					b ? identification_create_from_string(b) : NULL, NULL);
+}
+
+/**
+ * Enumerate shared keys for the given identities and concatenate their values
+ */
+static void assert_shared(mem_cred_t *set, char *me_str, char *other_str,
+						  char *expected)
+{
+	identification_t *me = NULL, *other = NULL;
+	enumerator_t *enumerator;
+	shared_key_t *shared;
+	char buf[128] = "";
+	chunk_t key;
+
+	if (me_str)
+	{
+		me = identification_create_from_string(me_str);
+	}
+	if (other_str)
+	{
+		other = identification_create_from_string(other_str);
+	}
+	enumerator = set->set.create_shared_enumerator(&set->set, SHARED_ANY,
+												   me, other);
+	while (enumerator->enumerate(enumerator, &shared, NULL, NULL))
+	{
+		key = shared->get_key(shared);
+		if (buf[0])
+		{
+			strcat(buf, " ");
+		}
+		strncat(buf, key.ptr, key.len);
+	}
+	enumerator->destroy(enumerator);
+	DESTROY_IF(me);
+	DESTROY_IF(other);
+	ck_assert_str_eq(buf, expected);
+}
+
+START_TEST(test_shared_lookup)
+{
+	add_shared(creds, "k1", "moon@strongswan.org", "sun@strongswan.org");
+	add_shared(creds, "k2", "C=CH, O=strongSwan, CN=moon", NULL);
+	add_shared(creds, "k3", "*@strongswan.org", NULL);
+	add_shared(creds, "k4", "carol@strongswan.org", NULL);
+
+	assert_shared(creds, "moon@strongswan.org", NULL, "k3 k1");
+	assert_shared(creds, "sun@strongswan.org", "moon@strongswan.org", "k3 k1");
+	assert_shared(creds, "MOON@strongSwan.org", NULL, "k3 k1");
+	assert_shared(creds, "carol@strongswan.org", NULL, "k4 k3");
+	assert_shared(creds, "c=ch, o=strongswan, cn=MOON", NULL, "k2");
+	assert_shared(creds, "C=CH, O=strongSwan, CN=sun", NULL, "");
+	assert_shared(creds, "dave@example.com", "%any", "");
+	assert_shared(creds, NULL, NULL, "k4 k3 k2 k1");
+}
+END_TEST
+
+START_TEST(test_shared_any)
+{
+	add_shared(creds, "k1", "moon.strongswan.org", NULL);
+	add_shared(creds, "k2", "%any", NULL);
+	add_shared(creds, "k3", NULL, NULL);
+
+	assert_shared(creds, "moon.strongswan.org", NULL, "k2 k1");
+	assert_shared(creds, "sun.strongswan.org", "%any", "k2");
+}
+END_TEST
+
+START_TEST(test_shared_replace)
+{
+	mem_cred_t *other;
+
+	add_shared(creds, "k1", "moon@strongswan.org", NULL);
+	other = mem_cred_create();
+	add_shared(other, "k2", "moon@strongswan.org", NULL);
+	add_shared(other, "k3", "moon@strongswan.org", NULL);
+
+	creds->replace_secrets(creds, other, TRUE);
+	assert_shared(creds, "moon@strongswan.org", NULL, "k3 k2");
+	assert_shared(other, "moon@strongswan.org", NULL, "k3 k2");
+	add_shared(creds, "k4", "moon@strongswan.org", NULL);
+	assert_shared(creds, "moon@strongswan.org", NULL, "k4 k3 k2");
+
+	creds->replace_secrets(creds, other, FALSE);
+	assert_shared(creds, "moon@strongswan.org", NULL, "k3 k2");
+	assert_shared(other, "moon@strongswan.org", NULL, "");
+	add_shared(other, "k5", "moon@strongswan.org", NULL);
+	assert_shared(other, "moon@strongswan.org", NULL, "k5");
+	other->destroy(other);
+
+	creds->clear_secrets(creds);
+	assert_shared(creds, "moon@strongswan.org", NULL, "");
+}
+END_TEST
+
+START_TEST(test_shared_many)
+{
+	char id[32], value[16], expected[16];
+	int i;
+
+	for (i = 0; i < 1000; i++)
+	{
+		snprintf(id, sizeof(id), "site%d.strongswan.org", i);
+		snprintf(value, sizeof(value), "k%d", i);
+		add_shared(creds, value, id, NULL);
+	}
+	for (i = 0; i < 1000; i += 99)
+	{
+		snprintf(id, sizeof(id), "site%d.strongswan.org", i);
+		snprintf(expected, sizeof(expected), "k%d", i);
+		assert_shared(creds, id, NULL, expected);
+	}
+}
+END_TEST
+
+/**
+ * Create a self-signed certificate with a fresh RSA key
+ */
+static certificate_t *create_cert(char *subject, char *san,
+								  private_key_t **keyout)
+{
+	private_key_t *key;
+	identification_t *id;
+	linked_list_t *sans;
+	certificate_t *cert;
+
+	key = lib->creds->create(lib->creds, CRED_PRIVATE_KEY, KEY_RSA,
+							 BUILD_KEY_SIZE, 1024, BUILD_END);
+	ck_assert(key != NULL);
+	id = identification_create_from_string(subject);
+	sans = linked_list_create();
+	sans->insert_last(sans, identification_create_from_string(san));
+	cert = lib->creds->create(lib->creds, CRED_CERTIFICATE, CERT_X509,
+							  BUILD_SIGNING_KEY, key, BUILD_SUBJECT, id,
+							  BUILD_SUBJECT_ALTNAMES, sans, BUILD_END);
+	ck_assert(cert != NULL);
+	sans->destroy_offset(sans, offsetof(identification_t, destroy));
+	id->destroy(id);
+	*keyout = key;
+	return cert;
+}
+
+/**
+ * Count the certificates matching an identity
+ */
+static int count_certs(identification_t *id, bool trusted)
+{
+	enumerator_t *enumerator;
+	certificate_t *cert;
+	int count = 0;
+
+	enumerator = creds->set.create_cert_enumerator(&creds->set, CERT_ANY,
+												   KEY_ANY, id, trusted);
+	while (enumerator->enumerate(enumerator, &cert))
+	{
+		count++;
+	}
+	enumerator->destroy(enumerator);
+	return count;
+}
+
+static int count_certs_str(char *str, bool trusted)
+{
+	identification_t *id;
+	int count;
+
+	id = identification_create_from_string(str);
+	count = count_certs(id, trusted);
+	id->destroy(id);
+	return count;
+}
+
+START_TEST(test_cert_lookup)
+{
+	certificate_t *moon, *sun, *cached;
+	private_key_t *moon_key, *sun_key;
+	identification_t *keyid;
+	chunk_t fp;
+
+	moon = create_cert("C=CH, O=strongSwan, CN=moon", "moon.strongswan.org",
+					   &moon_key);
+	sun = create_cert("C=CH, O=strongSwan, CN=sun", "sun.strongswan.org",
+					  &sun_key);
+	creds->add_cert(creds, TRUE, moon->get_ref(moon));
+	creds->add_cert(creds, FALSE, sun->get_ref(sun));
+	cached = creds->add_cert_ref(creds, FALSE, moon->get_ref(moon));
+	ck_assert(cached == moon);
+	cached->destroy(cached);
+	creds->add_key(creds, moon_key);
+	creds->add_key(creds, sun_key);
+
+	ck_assert_int_eq(count_certs(NULL, FALSE), 2);
+	ck_assert_int_eq(count_certs(NULL, TRUE), 1);
+	ck_assert_int_eq(count_certs_str("c=ch, o=strongswan, cn=moon", FALSE), 1);
+	ck_assert_int_eq(count_certs_str("C=CH, O=strongSwan, CN=moon", TRUE), 1);
+	ck_assert_int_eq(count_certs_str("C=CH, O=strongSwan, CN=sun", TRUE), 0);
+	ck_assert_int_eq(count_certs_str("sun.strongswan.org", FALSE), 1);
+	ck_assert_int_eq(count_certs_str("C=CH, O=strongSwan, CN=*", FALSE), 2);
+	ck_assert_int_eq(count_certs_str("C=CH, O=strongSwan, CN=x", FALSE), 0);
+
+	ck_assert(moon_key->get_fingerprint(moon_key, KEYID_PUBKEY_SHA1, &fp));
+	keyid = identification_create_from_encoding(ID_KEY_ID, fp);
+	ck_assert_int_eq(count_certs(keyid, FALSE), 1);
+	keyid->destroy(keyid);
+
+	moon->destroy(moon);
+	sun->destroy(sun);
+}
+END_TEST
+
+START_TEST(test_key_lookup)
+{
+	private_key_t *moon_key, *sun_key, *found;
+	certificate_t *moon, *sun;
+	enumerator_t *enumerator;
+	identification_t *keyid;
+	chunk_t fp;
+	int count = 0;
+
+	moon = create_cert("CN=moon", "moon.strongswan.org", &moon_key);
+	sun = create_cert("CN=sun", "sun.strongswan.org", &sun_key);
+	creds->add_key(creds, moon_key);
+	creds->add_key(creds, sun_key);
+
+	ck_assert(sun_key->get_fingerprint(sun_key, KEYID_PUBKEY_INFO_SHA1, &fp));
+	keyid = identification_create_from_encoding(ID_KEY_ID, fp);
+	enumerator = creds->set.create_private_enumerator(&creds->set, KEY_ANY,
+													  keyid);
+	while (enumerator->enumerate(enumerator, &found))
+	{
+		ck_assert(found == sun_key);
+		count++;
+	}
+	enumerator->destroy(enumerator);
+	ck_assert_int_eq(count, 1);
+	keyid->destroy(keyid);
+
+	moon->destroy(moon);
+	sun->destroy(sun);
+}
+END_TEST
+
+Suite *mem_cred_suite_create()
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("mem_cred");
+
+	tc = tcase_create("shared keys");
+	tcase_add_checked_fixture(tc, setup_creds, teardown_creds);
+	tcase_add_test(tc, test_shared_lookup);
+	tcase_add_test(tc, test_shared_any);
+	tcase_add_test(tc, test_shared_replace);
+	tcase_add_test(tc, test_shared_many);
+	suite_add_tcase(s, tc);
+
+	if (lib->plugins->has_feature(lib->plugins,
+								  PLUGIN_DEPENDS(PRIVKEY_GEN, KEY_RSA)))
+	{
+		tc = tcase_create("certificates and keys");
+		tcase_add_checked_fixture(tc, setup_creds, teardown_creds);
+		tcase_add_test(tc, test_cert_lookup);
+		tcase_add_test(tc, test_key_lookup);
+		tcase_set_timeout(tc, 20);
+		suite_add_tcase(s, tc);
+	}
+
+	return s;
+}
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "test_suite.h"
+
+#include <utils/histogram.h>
+#include <utils/metrics.h>
+
+/*******************************************************************************
+ * histogram
+ */
+
+START_TEST(test_histogram_stats)
+{
+	histogram_t *histogram;
+	int i;
+
+	histogram = histogram_create();
+	ck_assert(histogram->get_count(histogram) == 0);
+	ck_assert(histogram->get_percentile(histogram, 50) == 0);
+
+	for (i = 1; i <= 100; i++)
+	{
+		histogram->record(histogram, i);
+	}
+	ck_assert(histogram->get_count(histogram) == 100);
+	ck_assert(histogram->get_sum(histogram) == 5050);
+	ck_assert(histogram->get_max(histogram) == 100);
+
+	/* 50 is in bucket (48, 52] */
+	ck_assert(histogram->get_percentile(histogram, 50) == 52);
+	ck_assert(histogram->get_percentile(histogram, 0) == 1);
+	ck_assert(histogram->get_percentile(histogram, 1) == 1);
+	ck_assert(histogram->get_percentile(histogram, 8) == 8);
+	/* limited by the largest value */
+	ck_assert(histogram->get_percentile(histogram, 100) == 100);
+	ck_assert(histogram->get_percentile(histogram, 200) == 100);
+
+	histogram->reset(histogram);
+	ck_assert(histogram->get_count(histogram) == 0);
+	ck_assert(histogram->get_sum(histogram) == 0);
+	ck_assert(histogram->get_max(histogram) == 0);
+	histogram->destroy(histogram);
+}
+END_TEST
+
+static u_int64_t precision_values[] = {
+	9, 17, 100, 1000, 12345, 1000000, 3600000000ULL,
+};
+
+START_TEST(test_histogram_precision)
+{
+	histogram_t *histogram;
+	u_int64_t value, upper;
+
+	value = precision_values[_i];
+	histogram = histogram_create();
+	histogram->record(histogram, value);
+	histogram->record(histogram, value * 2);
+	upper = histogram->get_percentile(histogram, 50);
+	ck_assert(upper >= value);
+	ck_assert(upper - value <= value / 8);
+	histogram->destroy(histogram);
+}
+END_TEST
+
+START_TEST(test_histogram_large)
+{
+	histogram_t *histogram;
+	u_int64_t large = 1ULL << 50;
+
+	histogram = histogram_create();
+	histogram->record(histogram, large);
+	ck_assert(histogram->get_max(histogram) == large);
+	ck_assert(histogram->get_percentile(histogram, 50) == large);
+	histogram->destroy(histogram);
+}
+END_TEST
+
+START_TEST(test_histogram_enumerate)
+{
+	histogram_t *histogram;
+	enumerator_t *enumerator;
+	u_int64_t upper, count, expected = 1;
+	int i;
+
+	histogram = histogram_create();
+	enumerator = histogram->create_enumerator(histogram);
+	ck_assert(enumerator->enumerate(enumerator, &upper, &count));
+	ck_assert(upper == HISTOGRAM_INF);
+	ck_assert(count == 0);
+	ck_assert(!enumerator->enumerate(enumerator, &upper, &count));
+	enumerator->destroy(enumerator);
+
+	for (i = 1; i <= 100; i++)
+	{
+		histogram->record(histogram, i);
+	}
+	enumerator = histogram->create_enumerator(histogram);
+	while (enumerator->enumerate(enumerator, &upper, &count))
+	{
+		if (upper == HISTOGRAM_INF)
+		{
+			ck_assert(count == 100);
+			break;
+		}
+		ck_assert(upper == expected);
+		ck_assert(count == min(expected, 100));
+		expected *= 2;
+	}
+	ck_assert(expected == 256);
+	ck_assert(!enumerator->enumerate(enumerator, &upper, &count));
+	enumerator->destroy(enumerator);
+	histogram->destroy(histogram);
+}
+END_TEST
+
+/*******************************************************************************
+ * metrics registry
+ */
+
+static metrics_t *metrics;
+
+START_SETUP(setup_metrics)
+{
+	metrics = metrics_create();
+}
+END_SETUP
+
+START_TEARDOWN(teardown_metrics)
+{
+	metrics->destroy(metrics);
+}
+END_TEARDOWN
+
+/**
+ * Print all metrics to a string
+ */
+static char *print_metrics()
+{
+	static char buf[4096];
+	FILE *out;
+	size_t len;
+
+	out = tmpfile();
+	ck_assert(out != NULL);
+	metrics->print(metrics, out);
+	rewind(out);
+	len = fread(buf, 1, sizeof(buf) - 1, out);
+	buf[len] = '\0';
+	fclose(out);
+	return buf;
+}
+
+START_TEST(test_metrics_lookup)
+{
+	histogram_t *a, *b;
+	metrics_counter_t *c;
+
+	a = metrics->histogram(metrics, "a_seconds", "x=\"1\"", "test");
+	b = metrics->histogram(metrics, "a_seconds", "x=\"1\"", "test");
+	ck_assert(a != NULL);
+	ck_assert(a == b);
+	b = metrics->histogram(metrics, "a_seconds", "x=\"2\"", "test");
+	ck_assert(a != b);
+	b = metrics->histogram(metrics, "a_seconds", NULL, "test");
+	ck_assert(a != b);
+
+	c = metrics->counter(metrics, "a_seconds", NULL, "test");
+	ck_assert(c == NULL);
+	c = metrics->counter(metrics, "b_total", NULL, "test");
+	ck_assert(c != NULL);
+	ck_assert(c == metrics->counter(metrics, "b_total", NULL, "test"));
+}
+END_TEST
+
+START_TEST(test_metrics_counter)
+{
+	metrics_counter_t *c;
+
+	c = metrics->counter(metrics, "c_total", NULL, "test");
+	ck_assert(c->get(c) == 0);
+	c->add(c, 1);
+	c->add(c, 41);
+	ck_assert(c->get(c) == 42);
+	metrics->reset(metrics);
+	ck_assert(c->get(c) == 0);
+}
+END_TEST
+
+START_TEST(test_metrics_print_histogram)
+{
+	histogram_t *histogram;
+
+	histogram = metrics->histogram(metrics, "lat_seconds", NULL, "Latency");
+	histogram->record(histogram, 3);
+	histogram = metrics->histogram(metrics, "lat_seconds", "op=\"x\"",
+								   "Latency");
+	histogram->record(histogram, 1500000);
+
+	ck_assert_str_eq(print_metrics(),
+		"# HELP lat_seconds Latency\n"
+		"# TYPE lat_seconds histogram\n"
+		"lat_seconds_bucket{le=\"0.000001\"} 0\n"
+		"lat_seconds_bucket{le=\"0.000002\"} 0\n"
+		"lat_seconds_bucket{le=\"0.000004\"} 1\n"
+		"lat_seconds_bucket{le=\"+Inf\"} 1\n"
+		"lat_seconds_sum 0.000003\n"
+		"lat_seconds_count 1\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000001\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000002\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000004\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000008\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000016\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000032\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000064\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000128\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000256\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.000512\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.001024\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.002048\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.004096\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.008192\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.016384\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.032768\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.065536\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.131072\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.262144\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"0.524288\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"1.048576\"} 0\n"
+		"lat_seconds_bucket{op=\"x\",le=\"2.097152\"} 1\n"
+		"lat_seconds_bucket{op=\"x\",le=\"+Inf\"} 1\n"
+		"lat_seconds_sum{op=\"x\"} 1.500000\n"
+		"lat_seconds_count{op=\"x\"} 1\n");
+}
+END_TEST
+
+static u_int64_t gauge_cb(u_int64_t *value)
+{
+	return *value;
+}
+
+START_TEST(test_metrics_print_gauge)
+{
+	metrics_counter_t *c;
+	u_int64_t a = 3, b = 7;
+
+	metrics->add_gauge(metrics, "depth", "q=\"a\"", "Depth",
+					   (metrics_gauge_cb_t)gauge_cb, &a);
+	c = metrics->counter(metrics, "ops_total", NULL, "Operations");
+	c->add(c, 5);
+	metrics->add_gauge(metrics, "depth", "q=\"b\"", "Depth",
+					   (metrics_gauge_cb_t)gauge_cb, &b);
+
+	ck_assert_str_eq(print_metrics(),
+		"# HELP depth Depth\n"
+		"# TYPE depth gauge\n"
+		"depth{q=\"a\"} 3\n"
+		"depth{q=\"b\"} 7\n"
+		"# HELP ops_total Operations\n"
+		"# TYPE ops_total counter\n"
+		"ops_total 5\n");
+
+	metrics->remove_gauges(metrics, &a);
+	b = 8;
+	ck_assert_str_eq(print_metrics(),
+		"# HELP depth Depth\n"
+		"# TYPE depth gauge\n"
+		"depth{q=\"b\"} 8\n"
+		"# HELP ops_total Operations\n"
+		"# TYPE ops_total counter\n"
+		"ops_total 5\n");
+}
+END_TEST
+
+Suite *metrics_suite_create()
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("metrics");
+
+	tc = tcase_create("histogram stats");
+	tcase_add_test(tc, test_histogram_stats);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("histogram precision");
+	tcase_add_loop_test(tc, test_histogram_precision, 0,
+						countof(precision_values));
+	tcase_add_test(tc, test_histogram_large);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("histogram enumerate");
+	tcase_add_test(tc, test_histogram_enumerate);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("registry");
+	tcase_add_checked_fixture(tc, setup_metrics, teardown_metrics);
+	tcase_add_test(tc, test_metrics_lookup);
+	tcase_add_test(tc, test_metrics_counter);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("print");
+	tcase_add_checked_fixture(tc, setup_metrics, teardown_metrics);
+	tcase_add_test(tc, test_metrics_print_histogram);
+	tcase_add_test(tc, test_metrics_print_gauge);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
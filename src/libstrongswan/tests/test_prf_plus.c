@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "test_suite.h"
+
+#include <crypto/prf_plus.h>
+
+/**
+ * PRFs to test, skipped if not supported
+ */
+static pseudo_random_function_t prfs[] = {
+	PRF_HMAC_SHA1,
+	PRF_HMAC_SHA2_256,
+	PRF_HMAC_SHA2_512,
+	PRF_AES128_XCBC,
+};
+
+/*******************************************************************************
+ * fill
+ */
+
+/**
+ * Compare prf_plus_fill() against a prf_plus_t instance
+ */
+static void test_fill_length(prf_t *prf, bool counter, size_t len)
+{
+	chunk_t seed = chunk_from_chars(0x01,0x02,0x03,0x04,0x05,0x06,0x07);
+	chunk_t expected, buffer;
+	prf_plus_t *prf_plus;
+
+	prf_plus = prf_plus_create(prf, counter, seed);
+	ck_assert(prf_plus);
+	ck_assert(prf_plus->allocate_bytes(prf_plus, len, &expected));
+	prf_plus->destroy(prf_plus);
+
+	buffer = chunk_alloca(len);
+	ck_assert(prf_plus_fill(prf, counter, seed, buffer));
+	ck_assert(chunk_equals(expected, buffer));
+	free(expected.ptr);
+}
+
+START_TEST(test_fill)
+{
+	chunk_t key = chunk_from_chars(0x42,0x42,0x42,0x42,0x42,0x42,0x42,0x42,
+								   0x42,0x42,0x42,0x42,0x42,0x42,0x42,0x42);
+	prf_t *prf;
+	size_t len;
+
+	prf = lib->crypto->create_prf(lib->crypto, prfs[_i]);
+	if (!prf)
+	{
+		return;
+	}
+	ck_assert(prf->set_key(prf, key));
+	for (len = 1; len < 3 * prf->get_block_size(prf); len++)
+	{
+		test_fill_length(prf, TRUE, len);
+		test_fill_length(prf, FALSE, len);
+	}
+	prf->destroy(prf);
+}
+END_TEST
+
+START_TEST(test_fill_empty)
+{
+	prf_t *prf;
+
+	prf = lib->crypto->create_prf(lib->crypto, prfs[_i]);
+	if (!prf)
+	{
+		return;
+	}
+	ck_assert(prf_plus_fill(prf, TRUE, chunk_empty, chunk_empty));
+	prf->destroy(prf);
+}
+END_TEST
+
+Suite *prf_plus_suite_create()
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("prf_plus");
+
+	tc = tcase_create("fill");
+	tcase_add_loop_test(tc, test_fill, 0, countof(prfs));
+	tcase_add_loop_test(tc, test_fill_empty, 0, countof(prfs));
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -81,7 +81,13 @@ int main()
 	srunner_add_suite(sr, array_suite_create());
 	srunner_add_suite(sr, identification_suite_create());
 	srunner_add_suite(sr, threading_suite_create());
+	srunner_add_suite(sr, watcher_suite_create());
 	srunner_add_suite(sr, utils_suite_create());
+	srunner_add_suite(sr, metrics_suite_create());
+	srunner_add_suite(sr, prf_plus_suite_create());
+	srunner_add_suite(sr, crypto_tester_suite_create());
+	srunner_add_suite(sr, settings_suite_create());
+	srunner_add_suite(sr, mem_cred_suite_create());
 	srunner_add_suite(sr, vectors_suite_create());
 	if (lib->plugins->has_feature(lib->plugins,
 								  PLUGIN_DEPENDS(PRIVKEY_GEN, KEY_RSA)))
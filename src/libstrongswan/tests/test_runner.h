@@ -29,7 +29,13 @@ Suite *hashtable_suite_create();
 Suite *array_suite_create();
 Suite *identification_suite_create();
 Suite *threading_suite_create();
+Suite *watcher_suite_create();
 Suite *utils_suite_create();
+Suite *metrics_suite_create();
+Suite *prf_plus_suite_create();
+Suite *crypto_tester_suite_create();
+Suite *settings_suite_create();
+Suite *mem_cred_suite_create();
 Suite *vectors_suite_create();
 Suite *ecdsa_suite_create();
 Suite *rsa_suite_create();
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "test_suite.h"
+
+#include <unistd.h>
+
+#include <utils/settings.h>
+
+#define include1 "/tmp/strongswan-settings-test-1"
+#define include2 "/tmp/strongswan-settings-test-2"
+
+static settings_t *settings;
+
+static void create_config(char *file, char *content)
+{
+	FILE *out;
+
+	out = fopen(file, "w");
+	ck_assert(out != NULL);
+	fputs(content, out);
+	fclose(out);
+}
+
+START_SETUP(setup_settings)
+{
+	create_config(include1,
+		"main {\n"
+		"	key1 = val1\n"
+		"	key2 = 42\n"
+		"	sub {\n"
+		"		key3 = yes\n"
+		"		time = 2m\n"
+		"	}\n"
+		"}\n"
+		"other {\n"
+		"	key1 = other1\n"
+		"}\n");
+	create_config(include2,
+		"main {\n"
+		"	key1 = reloaded\n"
+		"}\n");
+	settings = settings_create(include1);
+}
+END_SETUP
+
+START_TEARDOWN(teardown_settings)
+{
+	settings->destroy(settings);
+	unlink(include1);
+	unlink(include2);
+}
+END_TEARDOWN
+
+START_TEST(test_get)
+{
+	ck_assert_str_eq(settings->get_str(settings, "main.key1", NULL), "val1");
+	ck_assert_str_eq(settings->get_str(settings, "%s.key1", NULL, "other"),
+					 "other1");
+	ck_assert_int_eq(settings->get_int(settings, "main.key2", 0), 42);
+	ck_assert(settings->get_bool(settings, "%s.%s.key3", FALSE,
+								 "main", "sub"));
+	ck_assert_int_eq(settings->get_time(settings, "main.sub.time", 0), 120);
+	ck_assert_str_eq(settings->get_str(settings, "main.nokey", "def"), "def");
+	ck_assert_str_eq(settings->get_str(settings, "main", "def"), "def");
+	ck_assert_str_eq(settings->get_str(settings, "main.sub.key3.x", "def"),
+					 "def");
+}
+END_TEST
+
+START_TEST(test_set)
+{
+	settings->set_str(settings, "main.key1", "changed");
+	ck_assert_str_eq(settings->get_str(settings, "main.key1", NULL),
+					 "changed");
+	settings->set_int(settings, "%s.new.key", 7, "main");
+	ck_assert_int_eq(settings->get_int(settings, "main.new.key", 0), 7);
+	ck_assert(!settings->set_default_str(settings, "main.key2", "1"));
+	ck_assert(settings->set_default_str(settings, "main.key4", "1"));
+	ck_assert_int_eq(settings->get_int(settings, "main.key4", 0), 1);
+}
+END_TEST
+
+START_TEST(test_dotted_argument)
+{
+	/* arguments containing dots denote a single section name */
+	settings->set_str(settings, "main.%s.key", "val", "a.b");
+	ck_assert_str_eq(settings->get_str(settings, "main.%s.key", "def", "a.b"),
+					 "val");
+	ck_assert_str_eq(settings->get_str(settings, "main.a.b.key", "def"),
+					 "def");
+	ck_assert(settings->get_key(settings, "main.%s.key", "a.b") == NULL);
+}
+END_TEST
+
+START_TEST(test_key_handle)
+{
+	settings_key_t *key, *sub;
+
+	key = settings->get_key(settings, "main.key1");
+	ck_assert(key != NULL);
+	ck_assert(key == settings->get_key(settings, "%s.key1", "main"));
+	ck_assert_str_eq(key->get_str(key, NULL), "val1");
+	ck_assert_str_eq(key->get_str(key, NULL), "val1");
+
+	sub = settings->get_key(settings, "main.sub.time");
+	ck_assert_int_eq(sub->get_time(sub, 0), 120);
+	ck_assert_int_eq(sub->get_int(sub, 0), 2);
+
+	settings->set_str(settings, "main.key1", "set");
+	ck_assert_str_eq(key->get_str(key, NULL), "set");
+
+	ck_assert(settings->load_files(settings, include2, FALSE));
+	ck_assert_str_eq(key->get_str(key, NULL), "reloaded");
+	ck_assert_int_eq(sub->get_time(sub, 5), 5);
+
+	ck_assert(settings->load_files(settings, include1, TRUE));
+	ck_assert_str_eq(key->get_str(key, NULL), "val1");
+	ck_assert_int_eq(sub->get_time(sub, 5), 120);
+}
+END_TEST
+
+START_TEST(test_key_handle_missing)
+{
+	settings_key_t *key;
+
+	key = settings->get_key(settings, "main.missing");
+	ck_assert_int_eq(key->get_int(key, 3), 3);
+	ck_assert(!key->get_bool(key, FALSE));
+	settings->set_bool(settings, "main.missing", TRUE);
+	ck_assert(key->get_bool(key, FALSE));
+}
+END_TEST
+
+Suite *settings_suite_create()
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("settings");
+
+	tc = tcase_create("get/set");
+	tcase_add_checked_fixture(tc, setup_settings, teardown_settings);
+	tcase_add_test(tc, test_get);
+	tcase_add_test(tc, test_set);
+	tcase_add_test(tc, test_dotted_argument);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("key handles");
+	tcase_add_checked_fixture(tc, setup_settings, teardown_settings);
+	tcase_add_test(tc, test_key_handle);
+	tcase_add_test(tc, test_key_handle_missing);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "test_suite.h"
+
+#include <processing/watcher.h>
+#include <threading/mutex.h>
+#include <threading/condvar.h>
+
+/**
+ * Backends to test, by value of libstrongswan.watcher.epoll
+ */
+static bool use_epoll[] = { TRUE, FALSE };
+
+static watcher_t *watcher;
+static mutex_t *mutex;
+static condvar_t *condvar;
+static int notified;
+static int notified_fd;
+
+START_SETUP(setup_watcher)
+{
+	lib->processor->set_threads(lib->processor, 8);
+	mutex = mutex_create(MUTEX_TYPE_DEFAULT);
+	condvar = condvar_create(CONDVAR_TYPE_DEFAULT);
+	notified = 0;
+	notified_fd = -1;
+}
+END_SETUP
+
+START_TEARDOWN(teardown_watcher)
+{
+	/* cancel the watcher thread before destroying the watcher */
+	lib->processor->cancel(lib->processor);
+	watcher->destroy(watcher);
+	condvar->destroy(condvar);
+	mutex->destroy(mutex);
+}
+END_TEARDOWN
+
+/**
+ * Create a watcher using the backend of the current test iteration
+ */
+static watcher_t *create_watcher(int i)
+{
+	lib->settings->set_bool(lib->settings, "libstrongswan.watcher.epoll",
+							use_epoll[i]);
+	return watcher_create();
+}
+
+/**
+ * Watcher callback, consumes the data and signals the test thread
+ */
+static bool read_cb(void *data, int fd, watcher_event_t event)
+{
+	char buf[1];
+
+	ck_assert(event == WATCHER_READ);
+	ck_assert(read(fd, buf, sizeof(buf)) == 1);
+
+	mutex->lock(mutex);
+	notified++;
+	notified_fd = fd;
+	condvar->signal(condvar);
+	mutex->unlock(mutex);
+	return TRUE;
+}
+
+/**
+ * Wait until the callback has been notified the given number of times
+ */
+static bool wait_notified(int count)
+{
+	bool timed_out = FALSE;
+
+	mutex->lock(mutex);
+	while (notified < count && !timed_out)
+	{
+		timed_out = condvar->timed_wait(condvar, mutex, 1000);
+	}
+	mutex->unlock(mutex);
+	return notified >= count;
+}
+
+START_TEST(test_read)
+{
+	int fds[2], i;
+
+	watcher = create_watcher(_i);
+	ck_assert(pipe(fds) == 0);
+
+	watcher->add(watcher, fds[0], WATCHER_READ, read_cb, NULL);
+	for (i = 1; i <= 10; i++)
+	{
+		ck_assert(write(fds[1], "x", 1) == 1);
+		ck_assert(wait_notified(i));
+		ck_assert_int_eq(notified_fd, fds[0]);
+	}
+	watcher->remove(watcher, fds[0]);
+
+	close(fds[0]);
+	close(fds[1]);
+}
+END_TEST
+
+/**
+ * Watcher callback that unregisters itself
+ */
+static bool oneshot_cb(void *data, int fd, watcher_event_t event)
+{
+	read_cb(data, fd, event);
+	return FALSE;
+}
+
+START_TEST(test_oneshot)
+{
+	int fds[2];
+
+	watcher = create_watcher(_i);
+	ck_assert(pipe(fds) == 0);
+
+	watcher->add(watcher, fds[0], WATCHER_READ, oneshot_cb, NULL);
+	ck_assert(write(fds[1], "x", 1) == 1);
+	ck_assert(wait_notified(1));
+	ck_assert(write(fds[1], "x", 1) == 1);
+	ck_assert(!wait_notified(2));
+	watcher->remove(watcher, fds[0]);
+
+	close(fds[0]);
+	close(fds[1]);
+}
+END_TEST
+
+/**
+ * Get the CPU time used by the process, in ms
+ */
+static u_int64_t cpu_time()
+{
+	struct rusage usage;
+
+	ck_assert(getrusage(RUSAGE_SELF, &usage) == 0);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 +
+		   (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+}
+
+/**
+ * Watcher callback for a hung up FD, blocking for a while
+ */
+static bool hangup_cb(void *data, int fd, watcher_event_t event)
+{
+	u_int64_t *cpu = data;
+	char buf[1];
+
+	ck_assert(read(fd, buf, sizeof(buf)) == 0);
+	*cpu = cpu_time();
+	usleep(200000);
+	*cpu = cpu_time() - *cpu;
+
+	mutex->lock(mutex);
+	notified++;
+	condvar->signal(condvar);
+	mutex->unlock(mutex);
+	return FALSE;
+}
+
+START_TEST(test_hangup)
+{
+	u_int64_t cpu = 0;
+	int fds[2];
+
+	watcher = create_watcher(_i);
+	ck_assert(pipe(fds) == 0);
+
+	watcher->add(watcher, fds[0], WATCHER_READ, hangup_cb, &cpu);
+	close(fds[1]);
+	ck_assert(wait_notified(1));
+	/* the watcher must not spin on the hangup while the callback is active */
+	ck_assert(cpu < 100);
+	ck_assert(!wait_notified(2));
+	watcher->remove(watcher, fds[0]);
+
+	close(fds[0]);
+}
+END_TEST
+
+/**
+ * Watcher callback that should never get called
+ */
+static bool never_cb(void *data, int fd, watcher_event_t event)
+{
+	ck_assert(FALSE);
+	return FALSE;
+}
+
+START_TEST(test_reopen)
+{
+	int fds[2], old[2];
+
+	watcher = create_watcher(_i);
+	ck_assert(pipe(old) == 0);
+	watcher->add(watcher, old[0], WATCHER_READ, read_cb, NULL);
+
+	/* close the registered FD and reuse its number for a new pipe, which
+	 * implicitly removes it from an epoll instance */
+	close(old[0]);
+	close(old[1]);
+	ck_assert(pipe(fds) == 0);
+	if (fds[0] != old[0])
+	{
+		ck_assert(dup2(fds[0], old[0]) == old[0]);
+		close(fds[0]);
+		fds[0] = old[0];
+	}
+	/* changes the monitored events of the FD */
+	watcher->add(watcher, fds[0], WATCHER_WRITE, never_cb, NULL);
+
+	ck_assert(write(fds[1], "x", 1) == 1);
+	ck_assert(wait_notified(1));
+	ck_assert_int_eq(notified_fd, fds[0]);
+	watcher->remove(watcher, fds[0]);
+
+	close(fds[0]);
+	close(fds[1]);
+}
+END_TEST
+
+/**
+ * Number of pipes to register with epoll, limited by RLIMIT_NOFILE
+ */
+#define MANY_PIPES 2000
+
+/**
+ * Number of pipes to register with select(), limited by FD_SETSIZE
+ */
+#define SELECT_PIPES ((FD_SETSIZE - 64) / 2)
+
+/**
+ * Number of dispatch latency measurements
+ */
+#define DISPATCHES 200
+
+START_TEST(test_many)
+{
+	struct rlimit rlim;
+	timeval_t start, end;
+	int (*fds)[2], count, i, idx;
+	u_int64_t total = 0;
+
+	watcher = create_watcher(_i);
+
+	count = use_epoll[_i] ? MANY_PIPES : SELECT_PIPES;
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0)
+	{
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+		if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 &&
+			rlim.rlim_cur < count * 2 + 64)
+		{
+			count = (rlim.rlim_cur - 64) / 2;
+		}
+	}
+	fds = calloc(count, sizeof(*fds));
+	for (i = 0; i < count; i++)
+	{
+		ck_assert(pipe(fds[i]) == 0);
+		watcher->add(watcher, fds[i][0], WATCHER_READ, read_cb, NULL);
+	}
+
+	for (i = 0; i < DISPATCHES; i++)
+	{
+		idx = (i * 7919) % count;
+		time_monotonic(&start);
+		ck_assert(write(fds[idx][1], "x", 1) == 1);
+		ck_assert(wait_notified(i + 1));
+		time_monotonic(&end);
+		ck_assert_int_eq(notified_fd, fds[idx][0]);
+		total += (end.tv_sec - start.tv_sec) * 1000000 +
+				 end.tv_usec - start.tv_usec;
+	}
+	/* average dispatch latency must not grow with the number of FDs to
+	 * anything near human-noticeable delays */
+	ck_assert(total / DISPATCHES < 100000);
+
+	for (i = 0; i < count; i++)
+	{
+		watcher->remove(watcher, fds[i][0]);
+		close(fds[i][0]);
+		close(fds[i][1]);
+	}
+	free(fds);
+}
+END_TEST
+
+Suite *watcher_suite_create()
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("watcher");
+
+	tc = tcase_create("read");
+	tcase_add_checked_fixture(tc, setup_watcher, teardown_watcher);
+	tcase_add_loop_test(tc, test_read, 0, countof(use_epoll));
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("oneshot");
+	tcase_add_checked_fixture(tc, setup_watcher, teardown_watcher);
+	tcase_add_loop_test(tc, test_oneshot, 0, countof(use_epoll));
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("hangup");
+	tcase_add_checked_fixture(tc, setup_watcher, teardown_watcher);
+	tcase_add_loop_test(tc, test_hangup, 0, countof(use_epoll));
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("reopen");
+	tcase_add_checked_fixture(tc, setup_watcher, teardown_watcher);
+	tcase_add_loop_test(tc, test_reopen, 0, countof(use_epoll));
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("many");
+	tcase_add_checked_fixture(tc, setup_watcher, teardown_watcher);
+	tcase_set_timeout(tc, 30);
+	tcase_add_loop_test(tc, test_many, 0, countof(use_epoll));
+	suite_add_tcase(s, tc);
+
+	return s;
+}
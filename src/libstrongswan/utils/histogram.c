@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "histogram.h"
+
+#include <threading/mutex.h>
+
+/**
+ * Number of bits used for linear sub-buckets
+ */
+#define SUB_BITS 3
+
+/**
+ * Number of sub-buckets per power of two
+ */
+#define SUB_COUNT (1 << SUB_BITS)
+
+/**
+ * Largest power of two tracked, larger values go to the last bucket
+ */
+#define MAX_BITS 40
+
+/**
+ * Total number of buckets
+ */
+#define BUCKETS ((MAX_BITS - SUB_BITS + 1) * SUB_COUNT)
+
+typedef struct private_histogram_t private_histogram_t;
+
+/**
+ * Private data of a histogram_t object.
+ */
+struct private_histogram_t {
+
+	/**
+	 * Public interface.
+	 */
+	histogram_t public;
+
+	/**
+	 * Number of values per bucket
+	 */
+	u_int64_t buckets[BUCKETS];
+
+	/**
+	 * Sum of all values
+	 */
+	u_int64_t sum;
+
+	/**
+	 * Largest value
+	 */
+	u_int64_t max;
+
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	/**
+	 * Lock to update values if no atomic operations are available
+	 */
+	mutex_t *mutex;
+#endif
+};
+
+/**
+ * Get the index of the most significant bit set in value (>= 1)
+ */
+static inline u_int msb(u_int64_t value)
+{
+	u_int bit = 0;
+
+	while (value >>= 1)
+	{
+		bit++;
+	}
+	return bit;
+}
+
+/**
+ * Get the bucket index for a value, a bucket contains values in (lower, upper]
+ */
+static u_int get_index(u_int64_t value)
+{
+	u_int bit;
+
+	if (value)
+	{	/* shift values by one to get (lower, upper] buckets */
+		value--;
+	}
+	if (value < SUB_COUNT)
+	{
+		return value;
+	}
+	bit = msb(value);
+	if (bit >= MAX_BITS)
+	{
+		return BUCKETS - 1;
+	}
+	return (bit - SUB_BITS + 1) * SUB_COUNT +
+		   ((value >> (bit - SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+/**
+ * Get the (inclusive) upper bound of values in a bucket
+ */
+static u_int64_t get_upper(u_int index)
+{
+	u_int bit, sub;
+
+	if (index < SUB_COUNT)
+	{
+		return index + 1;
+	}
+	bit = index / SUB_COUNT + SUB_BITS - 1;
+	sub = index % SUB_COUNT;
+	return ((u_int64_t)(SUB_COUNT + sub + 1)) << (bit - SUB_BITS);
+}
+
+METHOD(histogram_t, record, void,
+	private_histogram_t *this, u_int64_t value)
+{
+	u_int index = get_index(value);
+
+#ifdef HAVE_GCC_ATOMIC_OPERATIONS
+	u_int64_t max;
+
+	__sync_fetch_and_add(&this->buckets[index], 1);
+	__sync_fetch_and_add(&this->sum, value);
+	max = this->max;
+	while (value > max &&
+		   !__sync_bool_compare_and_swap(&this->max, max, value))
+	{
+		max = this->max;
+	}
+#else
+	this->mutex->lock(this->mutex);
+	this->buckets[index]++;
+	this->sum += value;
+	this->max = max(this->max, value);
+	this->mutex->unlock(this->mutex);
+#endif
+}
+
+METHOD(histogram_t, record_since, void,
+	private_histogram_t *this, timeval_t *start)
+{
+	timeval_t now, diff;
+
+	time_monotonic(&now);
+	timersub(&now, start, &diff);
+	record(this, diff.tv_sec * 1000000ULL + diff.tv_usec);
+}
+
+/**
+ * Copy the buckets to the given array, returns the total count
+ */
+static u_int64_t snapshot(private_histogram_t *this, u_int64_t *buckets)
+{
+	u_int64_t count = 0;
+	int i;
+
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->lock(this->mutex);
+#endif
+	for (i = 0; i < BUCKETS; i++)
+	{
+		buckets[i] = this->buckets[i];
+		count += buckets[i];
+	}
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->unlock(this->mutex);
+#endif
+	return count;
+}
+
+METHOD(histogram_t, get_count, u_int64_t,
+	private_histogram_t *this)
+{
+	u_int64_t buckets[BUCKETS];
+
+	return snapshot(this, buckets);
+}
+
+METHOD(histogram_t, get_sum, u_int64_t,
+	private_histogram_t *this)
+{
+	return this->sum;
+}
+
+METHOD(histogram_t, get_max, u_int64_t,
+	private_histogram_t *this)
+{
+	return this->max;
+}
+
+METHOD(histogram_t, get_percentile, u_int64_t,
+	private_histogram_t *this, u_int percentile)
+{
+	u_int64_t buckets[BUCKETS], count, wanted, current = 0;
+	int i;
+
+	count = snapshot(this, buckets);
+	if (!count)
+	{
+		return 0;
+	}
+	wanted = (count * min(percentile, 100) + 99) / 100;
+	for (i = 0; i < BUCKETS; i++)
+	{
+		current += buckets[i];
+		if (current && current >= wanted)
+		{
+			break;
+		}
+	}
+	if (i >= BUCKETS - 1)
+	{	/* topmost bucket is unbounded */
+		return this->max;
+	}
+	return min(get_upper(i), this->max);
+}
+
+/**
+ * Enumerator over cumulative counts
+ */
+typedef struct {
+	/** implements enumerator_t */
+	enumerator_t public;
+	/** copy of the buckets */
+	u_int64_t buckets[BUCKETS];
+	/** total number of values */
+	u_int64_t count;
+	/** cumulative count up to next */
+	u_int64_t current;
+	/** next bucket index to sum up */
+	u_int next;
+	/** power of two of the next boundary, MAX_BITS + 1 if done */
+	u_int bit;
+} histogram_enumerator_t;
+
+METHOD(enumerator_t, enumerate, bool,
+	histogram_enumerator_t *this, u_int64_t *upper, u_int64_t *count)
+{
+	u_int64_t bound;
+	u_int end;
+
+	if (this->bit > MAX_BITS)
+	{
+		return FALSE;
+	}
+	if (this->bit == MAX_BITS || this->current == this->count)
+	{	/* all values covered, report the total */
+		this->bit = MAX_BITS + 1;
+		*upper = HISTOGRAM_INF;
+		*count = this->count;
+		return TRUE;
+	}
+	bound = 1ULL << this->bit++;
+	end = get_index(bound) + 1;
+	while (this->next < end)
+	{
+		this->current += this->buckets[this->next++];
+	}
+	*upper = bound;
+	*count = this->current;
+	return TRUE;
+}
+
+METHOD(histogram_t, create_enumerator, enumerator_t*,
+	private_histogram_t *this)
+{
+	histogram_enumerator_t *enumerator;
+
+	INIT(enumerator,
+		.public = {
+			.enumerate = (void*)_enumerate,
+			.destroy = (void*)free,
+		},
+	);
+	enumerator->count = snapshot(this, enumerator->buckets);
+	return &enumerator->public;
+}
+
+METHOD(histogram_t, reset, void,
+	private_histogram_t *this)
+{
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->lock(this->mutex);
+#endif
+	memset(this->buckets, 0, sizeof(this->buckets));
+	this->sum = 0;
+	this->max = 0;
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->unlock(this->mutex);
+#endif
+}
+
+METHOD(histogram_t, destroy, void,
+	private_histogram_t *this)
+{
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	this->mutex->destroy(this->mutex);
+#endif
+	free(this);
+}
+
+/*
+ * Described in header.
+ */
+histogram_t *histogram_create()
+{
+	private_histogram_t *this;
+
+	INIT(this,
+		.public = {
+			.record = _record,
+			.record_since = _record_since,
+			.get_count = _get_count,
+			.get_sum = _get_sum,
+			.get_max = _get_max,
+			.get_percentile = _get_percentile,
+			.create_enumerator = _create_enumerator,
+			.reset = _reset,
+			.destroy = _destroy,
+		},
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+#endif
+	);
+
+	return &this->public;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup histogram histogram
+ * @{ @ingroup utils
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+typedef struct histogram_t histogram_t;
+
+#include <library.h>
+#include <collections/enumerator.h>
+
+/**
+ * Upper bound enumerated for the total number of values
+ */
+#define HISTOGRAM_INF (~(u_int64_t)0)
+
+/**
+ * Latency histogram with logarithmic buckets of linear sub-buckets.
+ *
+ * Similar to HDR histograms, each power of two range is split into 8
+ * sub-buckets, so recorded values are kept with a relative error below 12.5%
+ * in constant memory. Values are recorded in microseconds, up to about 12
+ * days, larger values are recorded in the topmost bucket.
+ *
+ * If the platform provides atomic operations, recording is lock-free.
+ */
+struct histogram_t {
+
+	/**
+	 * Record a value.
+	 *
+	 * @param value			value to record, in microseconds
+	 */
+	void (*record)(histogram_t *this, u_int64_t value);
+
+	/**
+	 * Record the time passed since the given monotonic timestamp.
+	 *
+	 * @param start			start time, as returned by time_monotonic()
+	 */
+	void (*record_since)(histogram_t *this, timeval_t *start);
+
+	/**
+	 * Get the number of recorded values.
+	 *
+	 * @return				number of values
+	 */
+	u_int64_t (*get_count)(histogram_t *this);
+
+	/**
+	 * Get the sum of all recorded values.
+	 *
+	 * @return				sum of values, in microseconds
+	 */
+	u_int64_t (*get_sum)(histogram_t *this);
+
+	/**
+	 * Get the largest recorded value.
+	 *
+	 * @return				maximum value, in microseconds
+	 */
+	u_int64_t (*get_max)(histogram_t *this);
+
+	/**
+	 * Get an upper bound for a percentile of the recorded values.
+	 *
+	 * @param percentile	percentile to get, 0-100
+	 * @return				upper bound of the bucket containing it, 0 if empty
+	 */
+	u_int64_t (*get_percentile)(histogram_t *this, u_int percentile);
+
+	/**
+	 * Create an enumerator over cumulative counts at power of two boundaries.
+	 *
+	 * The enumerator works on a snapshot of the histogram. It enumerates
+	 * the number of values smaller than or equal to 1, 2, 4, ... up to the
+	 * boundary containing the largest value. The last enumerated pair has
+	 * an upper bound of HISTOGRAM_INF and contains the total number of values.
+	 *
+	 * @return				enumerator over u_int64_t upper bound, u_int64_t count
+	 */
+	enumerator_t* (*create_enumerator)(histogram_t *this);
+
+	/**
+	 * Reset all recorded values.
+	 */
+	void (*reset)(histogram_t *this);
+
+	/**
+	 * Destroy a histogram_t.
+	 */
+	void (*destroy)(histogram_t *this);
+};
+
+/**
+ * Create a histogram_t instance.
+ *
+ * @return				histogram
+ */
+histogram_t *histogram_create();
+
+#endif /** HISTOGRAM_H_ @}*/
@@ -21,6 +21,7 @@
 #include <arpa/inet.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
 
 #include "identification.h"
 
@@ -121,6 +122,16 @@ struct private_identification_t {
 	 * Type of this ID.
 	 */
 	id_type_t type;
+
+	/**
+	 * Cached hash value of the canonical form, 0 if not yet calculated
+	 */
+	u_int hash;
+
+	/**
+	 * Cached wildcard check for DNs, 0 if unknown, 1 if none, 2 if found
+	 */
+	u_char wildcards;
 };
 
 /**
@@ -547,6 +558,10 @@ METHOD(identification_t, contains_wildcards_dn, bool,
 	id_part_t type;
 	chunk_t data;
 
+	if (this->wildcards)
+	{
+		return this->wildcards == 2;
+	}
 	enumerator = create_part_enumerator(this);
 	while (enumerator->enumerate(enumerator, &type, &data))
 	{
@@ -557,6 +572,8 @@ METHOD(identification_t, contains_wildcards_dn, bool,
 		}
 	}
 	enumerator->destroy(enumerator);
+	/* IDs are immutable, so concurrent checks store the same result */
+	this->wildcards = contains ? 2 : 1;
 	return contains;
 }
 
@@ -580,6 +597,107 @@ METHOD(identification_t, equals_binary, bool,
 	return FALSE;
 }
 
+/**
+ * Hash the length and the data folded to lowercase, up to the first null byte
+ * as strncasecmp() would compare it
+ */
+static u_int hash_lower(chunk_t data, u_int hash)
+{
+	u_char buf[64];
+	size_t len, i;
+
+	hash = chunk_hash_inc(chunk_from_thing(data.len), hash);
+	while (data.len)
+	{
+		len = min(data.len, sizeof(buf));
+		for (i = 0; i < len && data.ptr[i]; i++)
+		{
+			buf[i] = tolower(data.ptr[i]);
+		}
+		hash = chunk_hash_inc(chunk_create(buf, i), hash);
+		if (i < len)
+		{
+			break;
+		}
+		data = chunk_skip(data, len);
+	}
+	return hash;
+}
+
+/**
+ * Hash the canonical form of a DN, i.e. the sequence of RDN OIDs and values,
+ * ignoring the case of the values. DNs that compare_dn() considers equal
+ * get the same hash.
+ */
+static u_int hash_dn(chunk_t dn)
+{
+	enumerator_t *enumerator;
+	chunk_t oid, data;
+	u_char type;
+	u_int hash = 0;
+
+	enumerator = create_rdn_enumerator(dn);
+	while (enumerator->enumerate(enumerator, &oid, &type, &data))
+	{
+		hash = chunk_hash_inc(oid, hash);
+		hash = hash_lower(data, hash);
+	}
+	enumerator->destroy(enumerator);
+	return hash;
+}
+
+/**
+ * Get the cached hash of the canonical form of an ID
+ */
+static u_int get_hash(private_identification_t *this)
+{
+	u_int hash = this->hash;
+
+	if (!hash)
+	{
+		switch (this->type)
+		{
+			case ID_ANY:
+				break;
+			case ID_DER_ASN1_DN:
+				hash = hash_dn(this->encoded);
+				break;
+			case ID_FQDN:
+			case ID_RFC822_ADDR:
+			case ID_USER_ID:
+				/* string IDs compare case insensitive */
+				hash = hash_lower(this->encoded, 0);
+				break;
+			default:
+				/* binary IDs compare exactly, and often contain null bytes */
+				hash = chunk_hash_inc(this->encoded, 0);
+				break;
+		}
+		/* 0 marks an uncalculated hash, the value is stored atomically */
+		this->hash = hash = hash ?: 1;
+	}
+	return hash;
+}
+
+METHOD(identification_t, hash, u_int,
+	private_identification_t *this, u_int inc)
+{
+	u_int hash = get_hash(this);
+
+	return chunk_hash_inc(chunk_from_thing(hash), inc);
+}
+
+/**
+ * Check if two DNs differ, based on their cached hash values. If this
+ * returns FALSE the DNs might still differ.
+ */
+static bool differ_dn(private_identification_t *this,
+					  identification_t *other)
+{
+	return other->get_type(other) == ID_DER_ASN1_DN &&
+		   get_hash(this) != get_hash((private_identification_t*)other);
+}
+
 /**
  * Compare to DNs, for equality if wc == NULL, for match otherwise
  */
@@ -671,6 +789,10 @@ static bool compare_dn(chunk_t t_dn, chunk_t o_dn, int *wc)
 METHOD(identification_t, equals_dn, bool,
 	private_identification_t *this, identification_t *other)
 {
+	if (differ_dn(this, other))
+	{
+		return FALSE;
+	}
 	return compare_dn(this->encoded, other->get_encoding(other), NULL);
 }
 
@@ -769,6 +891,10 @@ METHOD(identification_t, matches_dn, id_match_t,
 
 	if (this->type == other->get_type(other))
 	{
+		if (!other->contains_wildcards(other) && differ_dn(this, other))
+		{	/* without wildcards, the canonical forms must be equal */
+			return ID_MATCH_NONE;
+		}
 		if (compare_dn(this->encoded, other->get_encoding(other), &wc))
 		{
 			wc = min(wc, ID_MATCH_ONE_WILDCARD - ID_MATCH_MAX_WILDCARDS);
@@ -880,6 +1006,7 @@ static private_identification_t *identification_create(id_type_t type)
 		.public = {
 			.get_encoding = _get_encoding,
 			.get_type = _get_type,
+			.hash = _hash,
 			.create_part_enumerator = _create_part_enumerator,
 			.clone = _clone_,
 			.destroy = _destroy,
@@ -226,6 +226,19 @@ struct identification_t {
 	 */
 	bool (*equals) (identification_t *this, identification_t *other);
 
+	/**
+	 * Get a hash value for this identity.
+	 *
+	 * IDs that are equal get the same hash value, so it may be used to store
+	 * IDs in a hashtable together with equals(). DNs are hashed in a
+	 * canonical form, i.e. RDN values are folded to lowercase. The value is
+	 * calculated on first use and cached afterwards.
+	 *
+	 * @param inc		previous hash value, to hash multiple objects
+	 * @return			hash value
+	 */
+	u_int (*hash) (identification_t *this, u_int inc);
+
 	/**
 	 * Check if an ID matches a wildcard ID.
 	 *
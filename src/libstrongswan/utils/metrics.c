@@ -0,0 +1,486 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+#include "metrics.h"
+
+#include <inttypes.h>
+
+#include <threading/mutex.h>
+#include <collections/linked_list.h>
+#include <collections/hashtable.h>
+
+typedef struct private_metrics_t private_metrics_t;
+
+/**
+ * Private data of a metrics_t object.
+ */
+struct private_metrics_t {
+
+	/**
+	 * Public interface.
+	 */
+	metrics_t public;
+
+	/**
+	 * Registered metrics, grouped by name, as entry_t
+	 */
+	linked_list_t *entries;
+
+	/**
+	 * Counters and histograms by name and labels, as entry_t
+	 */
+	hashtable_t *index;
+
+	/**
+	 * Lock for the above
+	 */
+	mutex_t *mutex;
+};
+
+/**
+ * Types of metrics
+ */
+typedef enum {
+	METRIC_COUNTER,
+	METRIC_GAUGE,
+	METRIC_HISTOGRAM,
+} metric_type_t;
+
+/**
+ * Names of metric types in the exposition format
+ */
+static char *type_names[] = {
+	"counter",
+	"gauge",
+	"histogram",
+};
+
+/**
+ * Counter implementation
+ */
+typedef struct {
+	/** public interface */
+	metrics_counter_t public;
+	/** current value */
+	u_int64_t value;
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+	/** lock if no atomic operations are available */
+	mutex_t *mutex;
+#endif
+} counter_t;
+
+/**
+ * A registered metric
+ */
+typedef struct {
+	/** type of this metric */
+	metric_type_t type;
+	/** metric name */
+	char *name;
+	/** label set, NULL for none */
+	char *labels;
+	/** description */
+	char *help;
+	/** name and labels, used as key to look up the entry */
+	char *key;
+	/** counter for METRIC_COUNTER */
+	counter_t *counter;
+	/** histogram for METRIC_HISTOGRAM */
+	histogram_t *histogram;
+	/** callback for METRIC_GAUGE */
+	metrics_gauge_cb_t cb;
+	/** callback data for METRIC_GAUGE */
+	void *data;
+} entry_t;
+
+METHOD(metrics_counter_t, counter_add, void,
+	counter_t *this, u_int64_t value)
+{
+#ifdef HAVE_GCC_ATOMIC_OPERATIONS
+	__sync_fetch_and_add(&this->value, value);
+#else
+	this->mutex->lock(this->mutex);
+	this->value += value;
+	this->mutex->unlock(this->mutex);
+#endif
+}
+
+METHOD(metrics_counter_t, counter_get, u_int64_t,
+	counter_t *this)
+{
+	u_int64_t value;
+
+#ifdef HAVE_GCC_ATOMIC_OPERATIONS
+	value = __sync_fetch_and_add(&this->value, 0);
+#else
+	this->mutex->lock(this->mutex);
+	value = this->value;
+	this->mutex->unlock(this->mutex);
+#endif
+	return value;
+}
+
+/**
+ * Reset a counter
+ */
+static void counter_reset(counter_t *this)
+{
+#ifdef HAVE_GCC_ATOMIC_OPERATIONS
+	__sync_fetch_and_and(&this->value, 0);
+#else
+	this->mutex->lock(this->mutex);
+	this->value = 0;
+	this->mutex->unlock(this->mutex);
+#endif
+}
+
+/**
+ * Create a counter
+ */
+static counter_t *counter_create()
+{
+	counter_t *this;
+
+	INIT(this,
+		.public = {
+			.add = _counter_add,
+			.get = _counter_get,
+		},
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+#endif
+	);
+	return this;
+}
+
+/**
+ * Destroy an entry
+ */
+static void entry_destroy(entry_t *this)
+{
+	if (this->counter)
+	{
+#ifndef HAVE_GCC_ATOMIC_OPERATIONS
+		this->counter->mutex->destroy(this->counter->mutex);
+#endif
+		free(this->counter);
+	}
+	DESTROY_IF(this->histogram);
+	free(this->name);
+	free(this->labels);
+	free(this->help);
+	free(this->key);
+	free(this);
+}
+
+/**
+ * Hash function for entry keys
+ */
+static u_int hash(char *key)
+{
+	return chunk_hash(chunk_from_str(key));
+}
+
+/**
+ * Compare function for entry keys
+ */
+static bool equals(char *a, char *b)
+{
+	return streq(a, b);
+}
+
+/**
+ * Add an entry after existing entries with the same name
+ */
+static void add_entry(private_metrics_t *this, entry_t *entry)
+{
+	enumerator_t *enumerator;
+	entry_t *current;
+	bool found = FALSE, inserted = FALSE;
+
+	enumerator = this->entries->create_enumerator(this->entries);
+	while (enumerator->enumerate(enumerator, &current))
+	{
+		if (streq(current->name, entry->name))
+		{
+			found = TRUE;
+		}
+		else if (found)
+		{
+			this->entries->insert_before(this->entries, enumerator, entry);
+			inserted = TRUE;
+			break;
+		}
+	}
+	enumerator->destroy(enumerator);
+
+	if (!inserted)
+	{
+		this->entries->insert_last(this->entries, entry);
+	}
+}
+
+/**
+ * Create a new entry
+ */
+static entry_t *entry_create(metric_type_t type, char *name, char *labels,
+							 char *help)
+{
+	entry_t *entry;
+
+	INIT(entry,
+		.type = type,
+		.name = strdup(name),
+		.labels = labels ? strdup(labels) : NULL,
+		.help = strdup(help),
+	);
+	if (asprintf(&entry->key, "%s{%s}", name, labels ?: "") < 0)
+	{
+		entry->key = strdup(name);
+	}
+	return entry;
+}
+
+/**
+ * Get or create a counter or histogram entry
+ */
+static entry_t *get_entry(private_metrics_t *this, metric_type_t type,
+						  char *name, char *labels, char *help)
+{
+	entry_t *entry;
+	char *key;
+
+	if (asprintf(&key, "%s{%s}", name, labels ?: "") < 0)
+	{
+		return NULL;
+	}
+	this->mutex->lock(this->mutex);
+	entry = this->index->get(this->index, key);
+	if (!entry)
+	{
+		entry = entry_create(type, name, labels, help);
+		if (type == METRIC_COUNTER)
+		{
+			entry->counter = counter_create();
+		}
+		else
+		{
+			entry->histogram = histogram_create();
+		}
+		this->index->put(this->index, entry->key, entry);
+		add_entry(this, entry);
+	}
+	this->mutex->unlock(this->mutex);
+	free(key);
+
+	if (entry->type != type)
+	{
+		DBG1(DBG_LIB, "metric '%s' registered with different type", name);
+		return NULL;
+	}
+	return entry;
+}
+
+METHOD(metrics_t, histogram, histogram_t*,
+	private_metrics_t *this, char *name, char *labels, char *help)
+{
+	entry_t *entry;
+
+	entry = get_entry(this, METRIC_HISTOGRAM, name, labels, help);
+	return entry ? entry->histogram : NULL;
+}
+
+METHOD(metrics_t, counter, metrics_counter_t*,
+	private_metrics_t *this, char *name, char *labels, char *help)
+{
+	entry_t *entry;
+
+	entry = get_entry(this, METRIC_COUNTER, name, labels, help);
+	return entry ? &entry->counter->public : NULL;
+}
+
+METHOD(metrics_t, add_gauge, void,
+	private_metrics_t *this, char *name, char *labels, char *help,
+	metrics_gauge_cb_t cb, void *data)
+{
+	entry_t *entry;
+
+	entry = entry_create(METRIC_GAUGE, name, labels, help);
+	entry->cb = cb;
+	entry->data = data;
+
+	this->mutex->lock(this->mutex);
+	add_entry(this, entry);
+	this->mutex->unlock(this->mutex);
+}
+
+METHOD(metrics_t, remove_gauges, void,
+	private_metrics_t *this, void *data)
+{
+	enumerator_t *enumerator;
+	entry_t *entry;
+
+	this->mutex->lock(this->mutex);
+	enumerator = this->entries->create_enumerator(this->entries);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		if (entry->type == METRIC_GAUGE && entry->data == data)
+		{
+			this->entries->remove_at(this->entries, enumerator);
+			entry_destroy(entry);
+		}
+	}
+	enumerator->destroy(enumerator);
+	this->mutex->unlock(this->mutex);
+}
+
+/**
+ * Print a value in microseconds as seconds
+ */
+static void print_seconds(FILE *out, u_int64_t usecs)
+{
+	fprintf(out, "%" PRIu64 ".%06" PRIu64, usecs / 1000000, usecs % 1000000);
+}
+
+/**
+ * Print the buckets, sum and count of a histogram
+ */
+static void print_histogram(FILE *out, entry_t *entry)
+{
+	enumerator_t *enumerator;
+	u_int64_t upper, count;
+	char *sep = entry->labels ? "," : "";
+	char *labels = entry->labels ?: "";
+
+	enumerator = entry->histogram->create_enumerator(entry->histogram);
+	while (enumerator->enumerate(enumerator, &upper, &count))
+	{
+		fprintf(out, "%s_bucket{%s%sle=\"", entry->name, labels, sep);
+		if (upper == HISTOGRAM_INF)
+		{
+			fprintf(out, "+Inf");
+		}
+		else
+		{
+			print_seconds(out, upper);
+		}
+		fprintf(out, "\"} %" PRIu64 "\n", count);
+	}
+	enumerator->destroy(enumerator);
+
+	fprintf(out, "%s_sum%s%s%s ", entry->name, entry->labels ? "{" : "",
+			labels, entry->labels ? "}" : "");
+	print_seconds(out, entry->histogram->get_sum(entry->histogram));
+	fprintf(out, "\n%s_count%s%s%s %" PRIu64 "\n", entry->name,
+			entry->labels ? "{" : "", labels, entry->labels ? "}" : "",
+			count);
+}
+
+METHOD(metrics_t, print, void,
+	private_metrics_t *this, FILE *out)
+{
+	enumerator_t *enumerator;
+	entry_t *entry;
+	char *last = NULL;
+	u_int64_t value;
+
+	this->mutex->lock(this->mutex);
+	enumerator = this->entries->create_enumerator(this->entries);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		if (!last || !streq(last, entry->name))
+		{
+			fprintf(out, "# HELP %s %s\n", entry->name, entry->help);
+			fprintf(out, "# TYPE %s %s\n", entry->name,
+					type_names[entry->type]);
+			last = entry->name;
+		}
+		switch (entry->type)
+		{
+			case METRIC_HISTOGRAM:
+				print_histogram(out, entry);
+				continue;
+			case METRIC_COUNTER:
+				value = counter_get(entry->counter);
+				break;
+			case METRIC_GAUGE:
+			default:
+				value = entry->cb(entry->data);
+				break;
+		}
+		fprintf(out, "%s%s%s%s %" PRIu64 "\n", entry->name,
+				entry->labels ? "{" : "", entry->labels ?: "",
+				entry->labels ? "}" : "", value);
+	}
+	enumerator->destroy(enumerator);
+	this->mutex->unlock(this->mutex);
+}
+
+METHOD(metrics_t, reset, void,
+	private_metrics_t *this)
+{
+	enumerator_t *enumerator;
+	entry_t *entry;
+
+	this->mutex->lock(this->mutex);
+	enumerator = this->entries->create_enumerator(this->entries);
+	while (enumerator->enumerate(enumerator, &entry))
+	{
+		if (entry->counter)
+		{
+			counter_reset(entry->counter);
+		}
+		if (entry->histogram)
+		{
+			entry->histogram->reset(entry->histogram);
+		}
+	}
+	enumerator->destroy(enumerator);
+	this->mutex->unlock(this->mutex);
+}
+
+METHOD(metrics_t, destroy, void,
+	private_metrics_t *this)
+{
+	this->index->destroy(this->index);
+	this->entries->destroy_function(this->entries, (void*)entry_destroy);
+	this->mutex->destroy(this->mutex);
+	free(this);
+}
+
+/*
+ * Described in header.
+ */
+metrics_t *metrics_create()
+{
+	private_metrics_t *this;
+
+	INIT(this,
+		.public = {
+			.histogram = _histogram,
+			.counter = _counter,
+			.add_gauge = _add_gauge,
+			.remove_gauges = _remove_gauges,
+			.print = _print,
+			.reset = _reset,
+			.destroy = _destroy,
+		},
+		.entries = linked_list_create(),
+		.index = hashtable_create((hashtable_hash_t)hash,
+								  (hashtable_equals_t)equals, 32),
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
+	);
+
+	return &this->public;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2013 Hochschule fuer Technik Rapperswil
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.  See <http://www.fsf.org/copyleft/gpl.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+
+/**
+ * @defgroup metrics metrics
+ * @{ @ingroup utils
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+typedef struct metrics_t metrics_t;
+typedef struct metrics_counter_t metrics_counter_t;
+
+#include <stdio.h>
+
+#include <library.h>
+#include <utils/histogram.h>
+
+/**
+ * Callback function to sample a gauge.
+ *
+ * @param data			user data supplied during registration
+ * @return				current value
+ */
+typedef u_int64_t (*metrics_gauge_cb_t)(void *data);
+
+/**
+ * A monotonically increasing counter.
+ */
+struct metrics_counter_t {
+
+	/**
+	 * Increment the counter.
+	 *
+	 * @param value			value to add
+	 */
+	void (*add)(metrics_counter_t *this, u_int64_t value);
+
+	/**
+	 * Get the current value of the counter.
+	 *
+	 * @return				counter value
+	 */
+	u_int64_t (*get)(metrics_counter_t *this);
+};
+
+/**
+ * Registry of named counters, gauges and latency histograms.
+ *
+ * Metrics are identified by a name and an optional label set in the
+ * Prometheus syntax, e.g. name "strongswan_job_queue_wait_seconds" and labels
+ * 'prio="HIGH"'. Counters and histograms get created on first use and live
+ * until the registry is destroyed, so callers usually look them up once and
+ * update them without further locking.
+ */
+struct metrics_t {
+
+	/**
+	 * Get a latency histogram, create it if it does not exist yet.
+	 *
+	 * Values are recorded in microseconds but get exported in seconds, so
+	 * the name should end in "_seconds".
+	 *
+	 * @param name			metric name
+	 * @param labels		label set, NULL for none
+	 * @param help			description of the metric
+	 * @return				histogram, owned by the registry
+	 */
+	histogram_t* (*histogram)(metrics_t *this, char *name, char *labels,
+							  char *help);
+
+	/**
+	 * Get a counter, create it if it does not exist yet.
+	 *
+	 * @param name			metric name
+	 * @param labels		label set, NULL for none
+	 * @param help			description of the metric
+	 * @return				counter, owned by the registry
+	 */
+	metrics_counter_t* (*counter)(metrics_t *this, char *name, char *labels,
+								  char *help);
+
+	/**
+	 * Register a gauge sampled when the metrics get printed.
+	 *
+	 * The callback gets invoked while the registry is locked, so it must not
+	 * call into the registry.
+	 *
+	 * @param name			metric name
+	 * @param labels		label set, NULL for none
+	 * @param help			description of the metric
+	 * @param cb			callback function to sample the gauge
+	 * @param data			data to pass to callback
+	 */
+	void (*add_gauge)(metrics_t *this, char *name, char *labels, char *help,
+					  metrics_gauge_cb_t cb, void *data);
+
+	/**
+	 * Unregister all gauges registered with the given callback data.
+	 *
+	 * @param data			data passed to add_gauge()
+	 */
+	void (*remove_gauges)(metrics_t *this, void *data);
+
+	/**
+	 * Print all metrics in the Prometheus text exposition format.
+	 *
+	 * @param out			stream to print to
+	 */
+	void (*print)(metrics_t *this, FILE *out);
+
+	/**
+	 * Reset all counters and histograms.
+	 */
+	void (*reset)(metrics_t *this);
+
+	/**
+	 * Destroy a metrics_t.
+	 */
+	void (*destroy)(metrics_t *this);
+};
+
+/**
+ * Create a metrics_t instance.
+ *
+ * @return				metrics registry
+ */
+metrics_t *metrics_create();
+
+#endif /** METRICS_H_ @}*/
@@ -32,7 +32,10 @@
 #include "settings.h"
 
 #include "collections/linked_list.h"
+#include "collections/hashtable.h"
 #include "threading/rwlock.h"
+#include "threading/mutex.h"
+#include "utils/chunk.h"
 #include "utils/debug.h"
 
 #define MAX_INCLUSION_LEVEL		10
@@ -40,6 +43,7 @@
 typedef struct private_settings_t private_settings_t;
 typedef struct section_t section_t;
 typedef struct kv_t kv_t;
+typedef struct handle_t handle_t;
 
 /**
  * private data of settings
@@ -61,10 +65,37 @@ struct private_settings_t {
 	 */
 	linked_list_t *contents;
 
+	/**
+	 * key/value pairs by full key, "a.b.c" (char*) => kv_t
+	 */
+	hashtable_t *index;
+
+	/**
+	 * incremented whenever the settings get modified
+	 */
+	refcount_t generation;
+
 	/**
 	 * lock to safely access the settings
 	 */
 	rwlock_t *lock;
+
+	/**
+	 * handles by full key, char* => handle_t
+	 */
+	hashtable_t *handles;
+
+	/**
+	 * values cached by handles, replaced but not yet released, as cache_t.
+	 * As handles replace their cache at most once per generation, this grows
+	 * by at most the number of handles each time the settings get modified.
+	 */
+	linked_list_t *caches;
+
+	/**
+	 * lock for handles and caches
+	 */
+	mutex_t *mutex;
 };
 
 /**
@@ -104,6 +135,48 @@ struct kv_t {
 	char *value;
 };
 
+/**
+ * Value of a key cached by a handle, immutable once published
+ */
+typedef struct {
+
+	/**
+	 * generation of the settings the value was looked up in
+	 */
+	u_int generation;
+
+	/**
+	 * the value, NULL if not found
+	 */
+	char *value;
+} cache_t;
+
+/**
+ * Handle to a key, implements settings_key_t
+ */
+struct handle_t {
+
+	/**
+	 * public interface
+	 */
+	settings_key_t public;
+
+	/**
+	 * settings the handle belongs to
+	 */
+	private_settings_t *settings;
+
+	/**
+	 * full key
+	 */
+	char *key;
+
+	/**
+	 * currently cached value
+	 */
+	cache_t *cache;
+};
+
 /**
  * create a key/value pair
  */
@@ -226,6 +299,124 @@ static bool print_key(char *buf, int len, char *start, char *key, va_list args)
 	return res;
 }
 
+/**
+ * Print the full key, fails if an argument contains a dot and therefore can't
+ * be looked up in the index
+ */
+static bool print_full_key(char *buf, int len, char *key, va_list args)
+{
+	va_list copy;
+	int written, dots = 0;
+	char *pos;
+
+	for (pos = key; *pos; pos++)
+	{
+		if (*pos == '.')
+		{
+			dots++;
+		}
+	}
+	va_copy(copy, args);
+	written = vsnprintf(buf, len, key, copy);
+	va_end(copy);
+	if (written < 0 || written >= len)
+	{
+		return FALSE;
+	}
+	for (pos = buf; *pos; pos++)
+	{
+		if (*pos == '.')
+		{
+			dots--;
+		}
+	}
+	return dots == 0;
+}
+
+/**
+ * Hash function for full keys
+ */
+static u_int hash(char *key)
+{
+	return chunk_hash(chunk_from_str(key));
+}
+
+/**
+ * Compare function for full keys
+ */
+static bool equals(char *a, char *b)
+{
+	return streq(a, b);
+}
+
+/**
+ * Add a key/value pair to the index, adopts the key
+ */
+static void index_add(private_settings_t *this, char *key, kv_t *kv)
+{
+	if (this->index->put(this->index, key, kv))
+	{	/* the existing key is kept */
+		free(key);
+	}
+}
+
+/**
+ * Add the key/value pairs of a section and its subsections to the index.
+ * Names containing dots can't be looked up by key, so they are skipped.
+ */
+static void index_section(private_settings_t *this, section_t *section,
+						  char *prefix)
+{
+	enumerator_t *enumerator;
+	section_t *sub;
+	kv_t *kv;
+	char *key;
+
+	enumerator = section->kv->create_enumerator(section->kv);
+	while (enumerator->enumerate(enumerator, &kv))
+	{
+		if (!strchr(kv->key, '.') &&
+			asprintf(&key, "%s%s", prefix, kv->key) > 0)
+		{
+			index_add(this, key, kv);
+		}
+	}
+	enumerator->destroy(enumerator);
+
+	enumerator = section->sections->create_enumerator(section->sections);
+	while (enumerator->enumerate(enumerator, &sub))
+	{
+		if (!strchr(sub->name, '.') &&
+			asprintf(&key, "%s%s.", prefix, sub->name) > 0)
+		{
+			index_section(this, sub, key);
+			free(key);
+		}
+	}
+	enumerator->destroy(enumerator);
+}
+
+/**
+ * Rebuild the index after the tree changed, write lock must be held
+ */
+static void index_rebuild(private_settings_t *this)
+{
+	enumerator_t *enumerator;
+	kv_t *kv;
+	char *key;
+
+	enumerator = this->index->create_enumerator(this->index);
+	while (enumerator->enumerate(enumerator, &key, &kv))
+	{
+		this->index->remove_at(this->index, enumerator);
+		free(key);
+	}
+	enumerator->destroy(enumerator);
+
+	index_section(this, this->top, "");
+	ref_get(&this->generation);
+}
+
 /**
  * Find a section by a given key, using buffered key, reusable buffer.
  * If "ensure" is TRUE, the sections are created if they don't exist.
@@ -378,6 +569,19 @@ static char *find_value(private_settings_t *this, section_t *section,
 	char buf[128], keybuf[512], *value = NULL;
 	kv_t *kv;
 
+	if (section == this->top &&
+		print_full_key(keybuf, sizeof(keybuf), key, args))
+	{
+		this->lock->read_lock(this->lock);
+		kv = this->index->get(this->index, keybuf);
+		if (kv)
+		{
+			value = kv->value;
+		}
+		this->lock->unlock(this->lock);
+		return value;
+	}
+	/* arguments containing dots are used as a single section/key name */
 	if (snprintf(keybuf, sizeof(keybuf), "%s", key) >= sizeof(keybuf))
 	{
 		return NULL;
@@ -399,7 +603,7 @@ static char *find_value(private_settings_t *this, section_t *section,
 static void set_value(private_settings_t *this, section_t *section,
 					  char *key, va_list args, char *value)
 {
-	char buf[128], keybuf[512];
+	char buf[128], keybuf[512], full[512];
 	kv_t *kv;
 
 	if (snprintf(keybuf, sizeof(keybuf), "%s", key) >= sizeof(keybuf))
@@ -424,6 +628,13 @@ static void set_value(private_settings_t *this, section_t *section,
 			kv->value = strdup(value);
 			this->contents->insert_last(this->contents, kv->value);
 		}
+		if (section == this->top &&
+			print_full_key(full, sizeof(full), key, args) &&
+			!this->index->get(this->index, full))
+		{
+			index_add(this, strdup(full), kv);
+		}
+		ref_get(&this->generation);
 	}
 	this->lock->unlock(this->lock);
 }
@@ -664,6 +875,113 @@ METHOD(settings_t, set_default_str, bool,
 	return FALSE;
 }
 
+/**
+ * Get the value of a handle, cached as long as the settings are not modified
+ */
+static char *handle_value(handle_t *this)
+{
+	private_settings_t *settings = this->settings;
+	cache_t *cache, *current;
+	char *value;
+	kv_t *kv;
+
+	current = this->cache;
+	if (current && current->generation == settings->generation)
+	{
+		return current->value;
+	}
+	INIT(cache);
+	settings->lock->read_lock(settings->lock);
+	cache->generation = settings->generation;
+	kv = settings->index->get(settings->index, this->key);
+	if (kv)
+	{
+		cache->value = kv->value;
+	}
+	settings->lock->unlock(settings->lock);
+
+	value = cache->value;
+	if (!cas_ptr((void**)&this->cache, current, cache))
+	{	/* replaced concurrently, nobody else has seen ours */
+		free(cache);
+	}
+	else if (current)
+	{	/* other threads might still read the replaced cache without locking,
+		 * so we can't release it before the settings get destroyed */
+		settings->mutex->lock(settings->mutex);
+		settings->caches->insert_last(settings->caches, current);
+		settings->mutex->unlock(settings->mutex);
+	}
+	return value;
+}
+
+METHOD(settings_key_t, key_get_str, char*,
+	handle_t *this, char *def)
+{
+	return handle_value(this) ?: def;
+}
+
+METHOD(settings_key_t, key_get_bool, bool,
+	handle_t *this, bool def)
+{
+	return settings_value_as_bool(handle_value(this), def);
+}
+
+METHOD(settings_key_t, key_get_int, int,
+	handle_t *this, int def)
+{
+	return settings_value_as_int(handle_value(this), def);
+}
+
+METHOD(settings_key_t, key_get_double, double,
+	handle_t *this, double def)
+{
+	return settings_value_as_double(handle_value(this), def);
+}
+
+METHOD(settings_key_t, key_get_time, u_int32_t,
+	handle_t *this, u_int32_t def)
+{
+	return settings_value_as_time(handle_value(this), def);
+}
+
+METHOD(settings_t, get_key, settings_key_t*,
+	   private_settings_t *this, char *key, ...)
+{
+	handle_t *handle;
+	char buf[512];
+	va_list args;
+	bool valid;
+
+	va_start(args, key);
+	valid = print_full_key(buf, sizeof(buf), key, args);
+	va_end(args);
+	if (!valid)
+	{
+		return NULL;
+	}
+
+	this->mutex->lock(this->mutex);
+	handle = this->handles->get(this->handles, buf);
+	if (!handle)
+	{
+		INIT(handle,
+			.public = {
+				.get_str = _key_get_str,
+				.get_bool = _key_get_bool,
+				.get_int = _key_get_int,
+				.get_double = _key_get_double,
+				.get_time = _key_get_time,
+			},
+			.settings = this,
+			.key = strdup(buf),
+		);
+		this->handles->put(this->handles, handle->key, handle);
+	}
+	this->mutex->unlock(this->mutex);
+	return &handle->public;
+}
+
 /**
  * Enumerate section names, not sections
  */
@@ -1171,6 +1489,7 @@ static bool load_files_internal(private_settings_t *this, section_t *parent,
 	{
 		this->contents->insert_last(this->contents, text);
 	}
+	index_rebuild(this);
 	this->lock->unlock(this->lock);
 
 	section_destroy(section);
@@ -1204,6 +1523,30 @@ METHOD(settings_t, load_files_section, bool,
 METHOD(settings_t, destroy, void,
 	   private_settings_t *this)
 {
+	enumerator_t *enumerator;
+	handle_t *handle;
+	char *key;
+	kv_t *kv;
+
+	enumerator = this->handles->create_enumerator(this->handles);
+	while (enumerator->enumerate(enumerator, &key, &handle))
+	{
+		free(handle->cache);
+		free(handle->key);
+		free(handle);
+	}
+	enumerator->destroy(enumerator);
+	this->handles->destroy(this->handles);
+	this->caches->destroy_function(this->caches, free);
+	this->mutex->destroy(this->mutex);
+
+	enumerator = this->index->create_enumerator(this->index);
+	while (enumerator->enumerate(enumerator, &key, &kv))
+	{
+		free(key);
+	}
+	enumerator->destroy(enumerator);
+	this->index->destroy(this->index);
 	section_destroy(this->top);
 	this->contents->destroy_function(this->contents, (void*)free);
 	this->lock->destroy(this->lock);
@@ -1224,6 +1567,7 @@ settings_t *settings_create(char *file)
 			.get_double = _get_double,
 			.get_time = _get_time,
 			.get_bool = _get_bool,
+			.get_key = _get_key,
 			.set_str = _set_str,
 			.set_int = _set_int,
 			.set_double = _set_double,
@@ -1238,7 +1582,13 @@ settings_t *settings_create(char *file)
 		},
 		.top = section_create(NULL),
 		.contents = linked_list_create(),
+		.index = hashtable_create((hashtable_hash_t)hash,
+								  (hashtable_equals_t)equals, 128),
 		.lock = rwlock_create(RWLOCK_TYPE_DEFAULT),
+		.handles = hashtable_create((hashtable_hash_t)hash,
+									(hashtable_equals_t)equals, 32),
+		.caches = linked_list_create(),
+		.mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 	);
 
 	load_files(this, file, FALSE);
@@ -23,6 +23,7 @@
 #define SETTINGS_H_
 
 typedef struct settings_t settings_t;
+typedef struct settings_key_t settings_key_t;
 
 #include "utils.h"
 #include "collections/enumerator.h"
@@ -67,6 +68,57 @@ double settings_value_as_double(char *value, double def);
  */
 u_int32_t settings_value_as_time(char *value, u_int32_t def);
 
+/**
+ * Handle to a single settings key, resolved once for repeated lookups.
+ *
+ * A handle caches the value of its key until the settings get modified, e.g.
+ * by a reload. As long as the value is cached, lookups are lock-free and do
+ * not format or hash the key. Handles are owned by the settings object they
+ * were created by and stay valid until it is destroyed.
+ */
+struct settings_key_t {
+
+	/**
+	 * Get the value of the key as a string.
+	 *
+	 * @param def		value returned if key not found
+	 * @return			value pointing to internal string
+	 */
+	char* (*get_str)(settings_key_t *this, char *def);
+
+	/**
+	 * Get the value of the key as boolean.
+	 *
+	 * @param def		value returned if key not found
+	 * @return			value of the key
+	 */
+	bool (*get_bool)(settings_key_t *this, bool def);
+
+	/**
+	 * Get the value of the key as integer.
+	 *
+	 * @param def		value returned if key not found
+	 * @return			value of the key
+	 */
+	int (*get_int)(settings_key_t *this, int def);
+
+	/**
+	 * Get the value of the key as double.
+	 *
+	 * @param def		value returned if key not found
+	 * @return			value of the key
+	 */
+	double (*get_double)(settings_key_t *this, double def);
+
+	/**
+	 * Get the value of the key as time value.
+	 *
+	 * @param def		value returned if key not found
+	 * @return			value of the key (in seconds)
+	 */
+	u_int32_t (*get_time)(settings_key_t *this, u_int32_t def);
+};
+
 /**
  * Generic configuration options read from a config file.
  *
@@ -96,6 +148,11 @@ u_int32_t settings_value_as_time(char *value, u_int32_t def);
  * Currently only a limited set of printf format specifiers are supported
  * (namely %s, %d and %N, see implementation for details).
  *
+ * Values are looked up in a hash table indexed by the full key, which gets
+ * rebuilt whenever settings are loaded. Code that reads the same key over and
+ * over may get a settings_key_t handle via get_key() instead, which resolves
+ * the key only once per modification of the settings.
+ *
  * \section includes Including other files
  * Other files can be included, using the include statement e.g.
  * @code
@@ -193,6 +250,18 @@ struct settings_t {
 	 */
 	u_int32_t (*get_time)(settings_t *this, char *key, u_int32_t def, ...);
 
+	/**
+	 * Get a handle to read a key repeatedly.
+	 *
+	 * Getting a handle for the same key twice returns the same handle.
+	 * Arguments for the key must not contain dots.
+	 *
+	 * @param key		key including sections, printf style format
+	 * @param ...		argument list for key
+	 * @return			handle, NULL if key too long
+	 */
+	settings_key_t* (*get_key)(settings_t *this, char *key, ...);
+
 	/**
 	 * Set a string value.
 	 *
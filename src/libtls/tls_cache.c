@@ -16,11 +16,97 @@
 #include "tls_cache.h"
 
 #include <utils/debug.h>
-#include <collections/linked_list.h>
 #include <collections/hashtable.h>
-#include <threading/rwlock.h>
+#include <threading/mutex.h>
+#include <bio/bio_reader.h>
+#include <bio/bio_writer.h>
+
+/**
+ * Maximum number of shards, must be a power of two
+ */
+#define MAX_SHARDS 16
+
+/**
+ * Length of the key name identifying the key protecting a session ticket
+ */
+#define TICKET_KEY_NAME_LEN 16
+
+/**
+ * Length of the AES-128-CBC key used to encrypt session tickets
+ */
+#define TICKET_ENC_KEY_LEN 16
+
+/**
+ * Length of the HMAC-SHA-256 key used to authenticate session tickets
+ */
+#define TICKET_MAC_KEY_LEN 32
+
+/**
+ * Length of the IV of a session ticket
+ */
+#define TICKET_IV_LEN 16
+
+/**
+ * Length of the MAC of a session ticket
+ */
+#define TICKET_MAC_LEN 32
 
 typedef struct private_tls_cache_t private_tls_cache_t;
+typedef struct entry_t entry_t;
+
+/**
+ * Cached session
+ */
+struct entry_t {
+	/** session identifier */
+	chunk_t session;
+	/** master secret */
+	chunk_t master;
+	/** TLS cipher suite */
+	tls_cipher_suite_t suite;
+	/** optional identity this entry is bound to */
+	identification_t *id;
+	/** session ticket received for this session, if any */
+	chunk_t ticket;
+	/** time of add */
+	time_t t;
+	/** more recently used entry */
+	entry_t *prev;
+	/** less recently used entry */
+	entry_t *next;
+};
+
+/**
+ * Independently locked part of the cache
+ */
+typedef struct {
+	/** lock for all members */
+	mutex_t *mutex;
+	/** mapping session => entry_t, fast lookup by session */
+	hashtable_t *table;
+	/** mapping identity => most recently created entry_t bound to it */
+	hashtable_t *ids;
+	/** most recently used entry */
+	entry_t *head;
+	/** least recently used entry */
+	entry_t *tail;
+} shard_t;
+
+/**
+ * Key protecting session tickets
+ */
+typedef struct {
+	/** is this key initialized? */
+	bool valid;
+	/** key name, identifies the key a ticket has been protected with */
+	char name[TICKET_KEY_NAME_LEN];
+	/** encryption key */
+	char enc[TICKET_ENC_KEY_LEN];
+	/** authentication key */
+	char mac[TICKET_MAC_KEY_LEN];
+	/** time the key has been generated */
+	time_t created;
+} ticket_key_t;
 
 /**
  * Private data of an tls_cache_t object.
@@ -33,46 +119,35 @@ struct private_tls_cache_t {
 	tls_cache_t public;
 
 	/**
-	 * Mapping session => entry_t, fast lookup by session
+	 * Shards sessions are distributed over
 	 */
-	hashtable_t *table;
+	shard_t *shards;
 
 	/**
-	 * List containing all entries
+	 * Number of shards, a power of two
 	 */
-	linked_list_t *list;
+	u_int shard_count;
 
 	/**
-	 * Lock to list and table
+	 * Session limit of each shard
 	 */
-	rwlock_t *lock;
+	u_int shard_max;
 
 	/**
-	 * Session limit
+	 * maximum age of a session, in seconds
 	 */
-	u_int max_sessions;
+	u_int max_age;
 
 	/**
-	 * maximum age of a session, in seconds
+	 * Current and previous key protecting session tickets
 	 */
-	u_int max_age;
-};
+	ticket_key_t keys[2];
 
-/**
- * Hashtable entry
- */
-typedef struct {
-	/** session identifier */
-	chunk_t session;
-	/** master secret */
-	chunk_t master;
-	/** TLS cipher suite */
-	tls_cipher_suite_t suite;
-	/** optional identity this entry is bound to */
-	identification_t *id;
-	/** time of add */
-	time_t t;
-} entry_t;
+	/**
+	 * Lock for ticket keys
+	 */
+	mutex_t *key_mutex;
+};
 
 /**
  * Destroy an entry
@@ -81,6 +156,7 @@ static void entry_destroy(entry_t *entry)
 {
 	chunk_clear(&entry->session);
 	chunk_clear(&entry->master);
+	free(entry->ticket.ptr);
 	DESTROY_IF(entry->id);
 	free(entry);
 }
@@ -101,50 +177,178 @@ static bool equals(chunk_t *a, chunk_t *b)
 	return chunk_equals(*a, *b);
 }
 
+/**
+ * Hashtable hash function for identities
+ */
+static u_int id_hash(identification_t *key)
+{
+	return chunk_hash_inc(key->get_encoding(key), key->get_type(key));
+}
+
+/**
+ * Hashtable equals function for identities
+ */
+static bool id_equals(identification_t *a, identification_t *b)
+{
+	return a->equals(a, b);
+}
+
+/**
+ * Get the shard responsible for a session
+ */
+static shard_t *get_shard(private_tls_cache_t *this, chunk_t session)
+{
+	/* use the upper bits, the hashtables in the shards use the lower ones */
+	return &this->shards[(chunk_hash(session) >> 24) & (this->shard_count - 1)];
+}
+
+/**
+ * Unlink an entry from the LRU list of a shard
+ */
+static void lru_remove(shard_t *shard, entry_t *entry)
+{
+	if (entry->prev)
+	{
+		entry->prev->next = entry->next;
+	}
+	else
+	{
+		shard->head = entry->next;
+	}
+	if (entry->next)
+	{
+		entry->next->prev = entry->prev;
+	}
+	else
+	{
+		shard->tail = entry->prev;
+	}
+}
+
+/**
+ * Insert an entry as most recently used into the LRU list of a shard
+ */
+static void lru_insert(shard_t *shard, entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = shard->head;
+	if (shard->head)
+	{
+		shard->head->prev = entry;
+	}
+	else
+	{
+		shard->tail = entry;
+	}
+	shard->head = entry;
+}
+
+/**
+ * Remove and destroy an entry of a shard. If the identity of the entry maps
+ * to it, map it to the most recently created remaining entry bound to it.
+ */
+static void remove_entry(shard_t *shard, entry_t *entry)
+{
+	entry_t *current, *found = NULL;
+
+	lru_remove(shard, entry);
+	shard->table->remove(shard->table, &entry->session);
+	if (entry->id && shard->ids->get(shard->ids, entry->id) == entry)
+	{
+		for (current = shard->head; current; current = current->next)
+		{
+			if (current->id && (!found || current->t > found->t) &&
+				current->id->equals(current->id, entry->id))
+			{
+				found = current;
+			}
+		}
+		if (found)
+		{
+			shard->ids->put(shard->ids, found->id, found);
+		}
+		else
+		{
+			shard->ids->remove(shard->ids, entry->id);
+		}
+	}
+	entry_destroy(entry);
+}
+
 METHOD(tls_cache_t, create_, void,
 	private_tls_cache_t *this, chunk_t session, identification_t *id,
 	chunk_t master, tls_cipher_suite_t suite)
 {
-	entry_t *entry;
+	entry_t *entry, *old;
+	shard_t *shard;
+	time_t now;
+	u_int count, expired = 0;
 
+	if (!this->shard_max)
+	{
+		return;
+	}
+	now = time_monotonic(NULL);
 	INIT(entry,
 		.session = chunk_clone(session),
 		.master = chunk_clone(master),
 		.suite = suite,
 		.id = id ? id->clone(id) : NULL,
-		.t = time_monotonic(NULL),
+		.t = now,
 	);
 
-	this->lock->write_lock(this->lock);
-	this->list->insert_first(this->list, entry);
-	this->table->put(this->table, &entry->session, entry);
-	if (this->list->get_count(this->list) > this->max_sessions &&
-		this->list->remove_last(this->list, (void**)&entry) == SUCCESS)
+	shard = get_shard(this, session);
+	shard->mutex->lock(shard->mutex);
+	old = shard->table->get(shard->table, &session);
+	if (old)
+	{
+		remove_entry(shard, old);
+	}
+	lru_insert(shard, entry);
+	shard->table->put(shard->table, &entry->session, entry);
+	if (entry->id)
+	{
+		shard->ids->put(shard->ids, entry->id, entry);
+	}
+	/* the least recently used entries are usually the oldest ones, so purge
+	 * expired entries from the tail, others get removed during lookup */
+	while (shard->tail != entry && shard->tail->t + this->max_age < now)
+	{
+		remove_entry(shard, shard->tail);
+		expired++;
+	}
+	if (shard->table->get_count(shard->table) > this->shard_max)
 	{
 		DBG2(DBG_TLS, "session limit of %u reached, deleting %#B",
-			 this->max_sessions, &entry->session);
-		this->table->remove(this->table, &entry->session);
-		entry_destroy(entry);
+			 this->shard_max * this->shard_count, &shard->tail->session);
+		remove_entry(shard, shard->tail);
 	}
-	this->lock->unlock(this->lock);
+	count = shard->table->get_count(shard->table);
+	shard->mutex->unlock(shard->mutex);
 
-	DBG2(DBG_TLS, "created TLS session %#B, %d sessions",
-		 &session, this->list->get_count(this->list));
+	if (expired)
+	{
+		DBG2(DBG_TLS, "deleted %u expired TLS sessions", expired);
+	}
+	DBG2(DBG_TLS, "created TLS session %#B, %u sessions in shard",
+		 &session, count);
 }
 
 METHOD(tls_cache_t, lookup, tls_cipher_suite_t,
 	private_tls_cache_t *this, chunk_t session, identification_t *id,
-	chunk_t* master)
+	chunk_t* master, time_t *created)
 {
 	tls_cipher_suite_t suite = 0;
 	entry_t *entry;
+	shard_t *shard;
 	time_t now;
 	u_int age;
 
 	now = time_monotonic(NULL);
 
-	this->lock->write_lock(this->lock);
-	entry = this->table->get(this->table, &session);
+	shard = get_shard(this, session);
+	shard->mutex->lock(shard->mutex);
+	entry = shard->table->get(shard->table, &session);
 	if (entry)
 	{
 		age = now - entry->t;
@@ -153,15 +357,19 @@ METHOD(tls_cache_t, lookup, tls_cipher_suite_t,
 			if (!id || !entry->id || id->equals(id, entry->id))
 			{
 				*master = chunk_clone(entry->master);
+				*created = entry->t;
 				suite = entry->suite;
+				lru_remove(shard, entry);
+				lru_insert(shard, entry);
 			}
 		}
 		else
 		{
 			DBG2(DBG_TLS, "TLS session %#B expired: %u seconds", &session, age);
+			remove_entry(shard, entry);
 		}
 	}
-	this->lock->unlock(this->lock);
+	shard->mutex->unlock(shard->mutex);
 
 	if (suite)
 	{
@@ -171,43 +379,395 @@ METHOD(tls_cache_t, lookup, tls_cipher_suite_t,
 }
 
 METHOD(tls_cache_t, check, chunk_t,
-	private_tls_cache_t *this, identification_t *id)
+	private_tls_cache_t *this, identification_t *id, chunk_t *ticket)
 {
-	chunk_t session = chunk_empty;
-	enumerator_t *enumerator;
+	chunk_t session = chunk_empty, found = chunk_empty;
 	entry_t *entry;
-	time_t now;
+	shard_t *shard;
+	time_t now, t = 0;
+	u_int i;
 
 	now = time_monotonic(NULL);
-	this->lock->read_lock(this->lock);
-	enumerator = this->list->create_enumerator(this->list);
-	while (enumerator->enumerate(enumerator, &entry))
+	for (i = 0; i < this->shard_count; i++)
 	{
-		if (entry->t + this->max_age >= now &&
-			entry->id && id->equals(id, entry->id))
+		shard = &this->shards[i];
+		shard->mutex->lock(shard->mutex);
+		entry = shard->ids->get(shard->ids, id);
+		if (entry && entry->t + this->max_age >= now &&
+			(!session.len || entry->t > t))
 		{
+			chunk_free(&session);
+			chunk_free(&found);
 			session = chunk_clone(entry->session);
+			found = chunk_clone(entry->ticket);
+			t = entry->t;
+		}
+		shard->mutex->unlock(shard->mutex);
+	}
+	if (ticket)
+	{
+		*ticket = found;
+	}
+	else
+	{
+		free(found.ptr);
+	}
+	return session;
+}
+
+METHOD(tls_cache_t, store_ticket, bool,
+	private_tls_cache_t *this, chunk_t session, chunk_t ticket)
+{
+	entry_t *entry;
+	shard_t *shard;
+
+	shard = get_shard(this, session);
+	shard->mutex->lock(shard->mutex);
+	entry = shard->table->get(shard->table, &session);
+	if (entry)
+	{
+		free(entry->ticket.ptr);
+		entry->ticket = chunk_clone(ticket);
+	}
+	shard->mutex->unlock(shard->mutex);
+
+	if (!entry)
+	{
+		DBG2(DBG_TLS, "TLS session %#B for session ticket not found", &session);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Generate a new key to protect session tickets
+ */
+static bool generate_key(ticket_key_t *key, time_t now)
+{
+	rng_t *rng;
+
+	rng = lib->crypto->create_rng(lib->crypto, RNG_STRONG);
+	if (!rng ||
+		!rng->get_bytes(rng, sizeof(key->name), key->name) ||
+		!rng->get_bytes(rng, sizeof(key->enc), key->enc) ||
+		!rng->get_bytes(rng, sizeof(key->mac), key->mac))
+	{
+		DBG1(DBG_TLS, "generating TLS session ticket key failed");
+		DESTROY_IF(rng);
+		return FALSE;
+	}
+	rng->destroy(rng);
+	key->created = now;
+	key->valid = TRUE;
+	return TRUE;
+}
+
+/**
+ * Get the current key to protect session tickets, rotate it if it is older
+ * than the maximum session age
+ */
+static bool get_current_key(private_tls_cache_t *this, ticket_key_t *key,
+							time_t now)
+{
+	ticket_key_t next;
+	bool success = TRUE;
+
+	this->key_mutex->lock(this->key_mutex);
+	if (!this->keys[0].valid || this->keys[0].created + this->max_age < now)
+	{
+		success = generate_key(&next, now);
+		if (success)
+		{
+			memwipe(&this->keys[1], sizeof(ticket_key_t));
+			this->keys[1] = this->keys[0];
+			this->keys[0] = next;
+			memwipe(&next, sizeof(next));
+		}
+	}
+	*key = this->keys[0];
+	this->key_mutex->unlock(this->key_mutex);
+
+	return success;
+}
+
+/**
+ * Get the key with the given name to verify a session ticket
+ */
+static bool get_key(private_tls_cache_t *this, chunk_t name, ticket_key_t *key)
+{
+	bool found = FALSE;
+	int i;
+
+	this->key_mutex->lock(this->key_mutex);
+	for (i = 0; i < countof(this->keys); i++)
+	{
+		if (this->keys[i].valid &&
+			memeq(this->keys[i].name, name.ptr, sizeof(this->keys[i].name)))
+		{
+			*key = this->keys[i];
+			found = TRUE;
 			break;
 		}
 	}
-	enumerator->destroy(enumerator);
-	this->lock->unlock(this->lock);
+	this->key_mutex->unlock(this->key_mutex);
 
-	return session;
+	return found;
+}
+
+/**
+ * Create crypter and signer for a session ticket key
+ */
+static bool create_transforms(ticket_key_t *key, crypter_t **crypter,
+							  signer_t **signer)
+{
+	*crypter = lib->crypto->create_crypter(lib->crypto, ENCR_AES_CBC,
+										   TICKET_ENC_KEY_LEN);
+	*signer = lib->crypto->create_signer(lib->crypto, AUTH_HMAC_SHA2_256_256);
+	if (!*crypter || !*signer ||
+		!(*crypter)->set_key(*crypter, chunk_from_thing(key->enc)) ||
+		!(*signer)->set_key(*signer, chunk_from_thing(key->mac)))
+	{
+		DBG1(DBG_TLS, "AES-CBC/HMAC-SHA-256 not supported, unable to use "
+			 "TLS session tickets");
+		DESTROY_IF(*crypter);
+		DESTROY_IF(*signer);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+METHOD(tls_cache_t, create_ticket, bool,
+	private_tls_cache_t *this, identification_t *id, chunk_t master,
+	tls_cipher_suite_t suite, time_t created, chunk_t *ticket)
+{
+	char iv[TICKET_IV_LEN], name[TICKET_KEY_NAME_LEN];
+	ticket_key_t key;
+	bio_writer_t *writer;
+	crypter_t *crypter;
+	signer_t *signer;
+	chunk_t state, mac;
+	rng_t *rng;
+	time_t now;
+	u_int8_t pad;
+	bool success;
+
+	now = time_monotonic(NULL);
+	if (!get_current_key(this, &key, now))
+	{
+		return FALSE;
+	}
+	memcpy(name, key.name, sizeof(name));
+	success = create_transforms(&key, &crypter, &signer);
+	memwipe(&key, sizeof(key));
+	if (!success)
+	{
+		return FALSE;
+	}
+	rng = lib->crypto->create_rng(lib->crypto, RNG_WEAK);
+	if (!rng || !rng->get_bytes(rng, sizeof(iv), iv))
+	{
+		DBG1(DBG_TLS, "generating TLS session ticket IV failed");
+		DESTROY_IF(rng);
+		crypter->destroy(crypter);
+		signer->destroy(signer);
+		return FALSE;
+	}
+	rng->destroy(rng);
+
+	/* serialize session state, padded to the AES block size */
+	writer = bio_writer_create(96);
+	writer->write_uint16(writer, suite);
+	writer->write_uint32(writer, created);
+	writer->write_data8(writer, master);
+	if (id)
+	{
+		writer->write_uint8(writer, id->get_type(id));
+		writer->write_data16(writer, id->get_encoding(id));
+	}
+	else
+	{
+		writer->write_uint8(writer, ID_ANY);
+		writer->write_data16(writer, chunk_empty);
+	}
+	pad = crypter->get_block_size(crypter) -
+			writer->get_buf(writer).len % crypter->get_block_size(crypter);
+	memset(writer->skip(writer, pad).ptr, pad, pad);
+	state = writer->extract_buf(writer);
+	writer->destroy(writer);
+
+	success = crypter->encrypt(crypter, state, chunk_from_thing(iv), NULL);
+	crypter->destroy(crypter);
+	if (success)
+	{
+		writer = bio_writer_create(TICKET_KEY_NAME_LEN + sizeof(iv) + 2 +
+								   state.len + TICKET_MAC_LEN);
+		writer->write_data(writer, chunk_from_thing(name));
+		writer->write_data(writer, chunk_from_thing(iv));
+		writer->write_data16(writer, state);
+		mac = writer->skip(writer, TICKET_MAC_LEN);
+		success = signer->get_signature(signer, chunk_create(
+									writer->get_buf(writer).ptr,
+									writer->get_buf(writer).len - mac.len),
+									mac.ptr);
+		*ticket = writer->extract_buf(writer);
+		writer->destroy(writer);
+		if (!success)
+		{
+			chunk_free(ticket);
+		}
+	}
+	chunk_clear(&state);
+	signer->destroy(signer);
+	return success;
+}
+
+/**
+ * Parse the decrypted state of a session ticket
+ */
+static tls_cipher_suite_t parse_state(private_tls_cache_t *this,
+									  chunk_t state, identification_t *id,
+									  chunk_t *master, time_t *created)
+{
+	identification_t *bound = NULL;
+	bio_reader_t *reader;
+	u_int16_t suite;
+	u_int32_t t;
+	u_int8_t type;
+	chunk_t secret, encoding;
+	u_int age;
+
+	reader = bio_reader_create(state);
+	if (!reader->read_uint16(reader, &suite) ||
+		!reader->read_uint32(reader, &t) ||
+		!reader->read_data8(reader, &secret) ||
+		!reader->read_uint8(reader, &type) ||
+		!reader->read_data16(reader, &encoding))
+	{
+		DBG1(DBG_TLS, "TLS session ticket state invalid");
+		reader->destroy(reader);
+		return 0;
+	}
+	reader->destroy(reader);
+
+	age = time_monotonic(NULL) - t;
+	if (age > this->max_age)
+	{
+		DBG2(DBG_TLS, "TLS session ticket expired: %u seconds", age);
+		return 0;
+	}
+	if (type != ID_ANY)
+	{
+		bound = identification_create_from_encoding(type, encoding);
+	}
+	if (id && bound && !id->equals(id, bound))
+	{
+		DBG1(DBG_TLS, "TLS session ticket bound to '%Y', but peer is '%Y'",
+			 bound, id);
+		bound->destroy(bound);
+		return 0;
+	}
+	DESTROY_IF(bound);
+
+	*master = chunk_clone(secret);
+	*created = t;
+	DBG2(DBG_TLS, "resuming TLS session from ticket, age %u seconds", age);
+	return suite;
+}
+
+METHOD(tls_cache_t, lookup_ticket, tls_cipher_suite_t,
+	private_tls_cache_t *this, chunk_t ticket, identification_t *id,
+	chunk_t *master, time_t *created)
+{
+	tls_cipher_suite_t suite = 0;
+	ticket_key_t key;
+	bio_reader_t *reader;
+	crypter_t *crypter;
+	signer_t *signer;
+	chunk_t name, iv, encrypted, mac, state;
+	u_int8_t pad;
+	bool success;
+
+	reader = bio_reader_create(ticket);
+	if (!reader->read_data(reader, TICKET_KEY_NAME_LEN, &name) ||
+		!reader->read_data(reader, TICKET_IV_LEN, &iv) ||
+		!reader->read_data16(reader, &encrypted) ||
+		!reader->read_data(reader, TICKET_MAC_LEN, &mac) ||
+		reader->remaining(reader))
+	{
+		DBG1(DBG_TLS, "received invalid TLS session ticket");
+		reader->destroy(reader);
+		return 0;
+	}
+	reader->destroy(reader);
+
+	if (!get_key(this, name, &key))
+	{
+		DBG2(DBG_TLS, "key of TLS session ticket not found");
+		return 0;
+	}
+	success = create_transforms(&key, &crypter, &signer);
+	memwipe(&key, sizeof(key));
+	if (!success)
+	{
+		return 0;
+	}
+	if (!signer->verify_signature(signer,
+						chunk_create(ticket.ptr, ticket.len - mac.len), mac))
+	{
+		DBG1(DBG_TLS, "TLS session ticket authentication failed");
+	}
+	else if (!encrypted.len ||
+			 encrypted.len % crypter->get_block_size(crypter) ||
+			 !crypter->decrypt(crypter, encrypted, iv, &state))
+	{
+		DBG1(DBG_TLS, "decrypting TLS session ticket failed");
+	}
+	else
+	{
+		pad = state.ptr[state.len - 1];
+		if (pad && pad <= state.len)
+		{
+			state.len -= pad;
+			suite = parse_state(this, state, id, master, created);
+			state.len += pad;
+		}
+		else
+		{
+			DBG1(DBG_TLS, "TLS session ticket padding invalid");
+		}
+		chunk_clear(&state);
+	}
+	crypter->destroy(crypter);
+	signer->destroy(signer);
+	return suite;
+}
+
+METHOD(tls_cache_t, get_max_age, u_int,
+	private_tls_cache_t *this)
+{
+	return this->max_age;
 }
 
 METHOD(tls_cache_t, destroy, void,
 	private_tls_cache_t *this)
 {
-	entry_t *entry;
+	shard_t *shard;
+	u_int i;
 
-	while (this->list->remove_last(this->list, (void**)&entry) == SUCCESS)
+	for (i = 0; i < this->shard_count; i++)
 	{
-		entry_destroy(entry);
+		shard = &this->shards[i];
+		while (shard->head)
+		{
+			remove_entry(shard, shard->head);
+		}
+		shard->table->destroy(shard->table);
+		shard->ids->destroy(shard->ids);
+		shard->mutex->destroy(shard->mutex);
 	}
-	this->list->destroy(this->list);
-	this->table->destroy(this->table);
-	this->lock->destroy(this->lock);
+	free(this->shards);
+	memwipe(this->keys, sizeof(this->keys));
+	this->key_mutex->destroy(this->key_mutex);
 	free(this);
 }
 
@@ -217,21 +777,40 @@ METHOD(tls_cache_t, destroy, void,
 tls_cache_t *tls_cache_create(u_int max_sessions, u_int max_age)
 {
 	private_tls_cache_t *this;
+	u_int i;
 
 	INIT(this,
 		.public = {
 			.create = _create_,
 			.lookup = _lookup,
 			.check = _check,
+			.store_ticket = _store_ticket,
+			.create_ticket = _create_ticket,
+			.lookup_ticket = _lookup_ticket,
+			.get_max_age = _get_max_age,
 			.destroy = _destroy,
 		},
-		.table = hashtable_create((hashtable_hash_t)hash,
-								  (hashtable_equals_t)equals, 8),
-		.list = linked_list_create(),
-		.lock = rwlock_create(RWLOCK_TYPE_DEFAULT),
-		.max_sessions = max_sessions,
+		.shard_count = 1,
 		.max_age = max_age,
+		.key_mutex = mutex_create(MUTEX_TYPE_DEFAULT),
 	);
 
+	/* use fewer shards for small caches, each should hold some sessions */
+	while (this->shard_count < MAX_SHARDS &&
+		   this->shard_count * 2 * 8 <= max_sessions)
+	{
+		this->shard_count *= 2;
+	}
+	this->shard_max = max_sessions / this->shard_count;
+	this->shards = calloc(this->shard_count, sizeof(shard_t));
+	for (i = 0; i < this->shard_count; i++)
+	{
+		this->shards[i].mutex = mutex_create(MUTEX_TYPE_DEFAULT);
+		this->shards[i].table = hashtable_create((hashtable_hash_t)hash,
+										(hashtable_equals_t)equals, 8);
+		this->shards[i].ids = hashtable_create((hashtable_hash_t)id_hash,
+										(hashtable_equals_t)id_equals, 8);
+	}
+
 	return &this->public;
 }
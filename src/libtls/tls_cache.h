@@ -27,6 +27,13 @@ typedef struct tls_cache_t tls_cache_t;
 
 /**
  * TLS session cache facility.
+ *
+ * Sessions are distributed over a number of independently locked shards,
+ * each evicting its least recently used sessions if the session limit is
+ * reached.
+ *
+ * The cache additionally protects the state of sessions in RFC 5077 session
+ * tickets handed out by servers, and stores tickets received by clients.
  */
 struct tls_cache_t {
 
@@ -47,18 +54,67 @@ struct tls_cache_t {
 	 * @param session		session ID to find
 	 * @param id			identity the session is bound to
 	 * @param master		gets allocated master secret, if session found
+	 * @param created		gets the monotonic time the session was created
 	 * @return				TLS suite of session, 0 if none found
 	 */
 	tls_cipher_suite_t (*lookup)(tls_cache_t *this, chunk_t session,
-								 identification_t *id, chunk_t* master);
+								 identification_t *id, chunk_t* master,
+								 time_t *created);
 
 	/**
 	 * Check if we have a session for a given identity.
 	 *
 	 * @param id			identity to check
+	 * @param ticket		gets allocated session ticket, if any, or NULL
 	 * @return				allocated session ID, or chunk_empty
 	 */
-	chunk_t (*check)(tls_cache_t *this, identification_t *id);
+	chunk_t (*check)(tls_cache_t *this, identification_t *id, chunk_t *ticket);
+
+	/**
+	 * Store a session ticket received for a session.
+	 *
+	 * @param session		session ID the ticket belongs to
+	 * @param ticket		session ticket, gets cloned
+	 * @return				TRUE if session found and ticket stored
+	 */
+	bool (*store_ticket)(tls_cache_t *this, chunk_t session, chunk_t ticket);
+
+	/**
+	 * Create a session ticket protecting the state of a session.
+	 *
+	 * Tickets for resumed sessions carry the creation time of the original
+	 * session, so reissuing tickets does not extend the session lifetime.
+	 *
+	 * @param id			identity the session is bound to
+	 * @param master		TLS master secret
+	 * @param suite			TLS cipher suite of the session
+	 * @param created		monotonic time the session was created
+	 * @param ticket		allocated session ticket
+	 * @return				TRUE if ticket created
+	 */
+	bool (*create_ticket)(tls_cache_t *this, identification_t *id,
+						  chunk_t master, tls_cipher_suite_t suite,
+						  time_t created, chunk_t *ticket);
+
+	/**
+	 * Look up the session state protected in a session ticket.
+	 *
+	 * @param ticket		session ticket received
+	 * @param id			identity the session is bound to
+	 * @param master		gets allocated master secret, if ticket valid
+	 * @param created		gets the monotonic time the session was created
+	 * @return				TLS suite of session, 0 if ticket invalid
+	 */
+	tls_cipher_suite_t (*lookup_ticket)(tls_cache_t *this, chunk_t ticket,
+									identification_t *id, chunk_t *master,
+									time_t *created);
+
+	/**
+	 * Get the maximum age of sessions and tickets.
+	 *
+	 * @return				maximum age, in seconds
+	 */
+	u_int (*get_max_age)(tls_cache_t *this);
 
 	/**
 	 * Destroy a tls_cache_t.
@@ -374,6 +374,22 @@ struct private_tls_crypto_t {
 	 */
 	tls_cache_t *cache;
 
+	/**
+	 * Use RFC 5077 session tickets?
+	 */
+	bool tickets;
+
+	/**
+	 * Master secret of the current session
+	 */
+	chunk_t master;
+
+	/**
+	 * Monotonic time the current session has been created, on resumption
+	 * the time of the original handshake
+	 */
+	time_t created;
+
 	/**
 	 * All handshake data concatentated
 	 */
@@ -1498,6 +1514,9 @@ static bool derive_master(private_tls_crypto_t *this, chunk_t premaster,
 		this->cache->create(this->cache, session, id, chunk_from_thing(master),
 							this->suite);
 	}
+	chunk_clear(&this->master);
+	this->master = chunk_clone(chunk_from_thing(master));
+	this->created = time_monotonic(NULL);
 	memwipe(master, sizeof(master));
 	return TRUE;
 }
@@ -1618,43 +1637,128 @@ METHOD(tls_crypto_t, derive_secrets, bool,
 		   expand_keys(this, client_random, server_random);
 }
 
+/**
+ * Derive key material from the master secret of a resumed session
+ */
+static tls_cipher_suite_t resume(private_tls_crypto_t *this,
+								 tls_cipher_suite_t suite, chunk_t master,
+								 time_t created, chunk_t client_random,
+								 chunk_t server_random)
+{
+	this->suite = select_cipher_suite(this, &suite, 1, KEY_ANY);
+	if (this->suite)
+	{
+		if (!this->prf->set_key(this->prf, master) ||
+			!expand_keys(this, client_random, server_random))
+		{
+			this->suite = 0;
+		}
+	}
+	if (this->suite)
+	{
+		chunk_clear(&this->master);
+		this->master = master;
+		this->created = created;
+	}
+	else
+	{
+		chunk_clear(&master);
+	}
+	return this->suite;
+}
+
 METHOD(tls_crypto_t, resume_session, tls_cipher_suite_t,
 	private_tls_crypto_t *this, chunk_t session, identification_t *id,
 	chunk_t client_random, chunk_t server_random)
 {
+	tls_cipher_suite_t suite;
 	chunk_t master;
+	time_t created;
 
 	if (this->cache && session.len)
 	{
-		this->suite = this->cache->lookup(this->cache, session, id, &master);
-		if (this->suite)
+		suite = this->cache->lookup(this->cache, session, id, &master,
+									&created);
+		if (suite)
 		{
-			this->suite = select_cipher_suite(this, &this->suite, 1, KEY_ANY);
-			if (this->suite)
-			{
-				if (!this->prf->set_key(this->prf, master) ||
-					!expand_keys(this, client_random, server_random))
-				{
-					this->suite = 0;
-				}
-			}
-			chunk_clear(&master);
+			return resume(this, suite, master, created,
+						  client_random, server_random);
+		}
+	}
+	return 0;
+}
+
+METHOD(tls_crypto_t, resume_ticket, tls_cipher_suite_t,
+	private_tls_crypto_t *this, chunk_t ticket, identification_t *id,
+	chunk_t client_random, chunk_t server_random)
+{
+	tls_cipher_suite_t suite;
+	chunk_t master;
+	time_t created;
+
+	if (this->tickets && ticket.len)
+	{
+		suite = this->cache->lookup_ticket(this->cache, ticket, id, &master,
+										   &created);
+		if (suite)
+		{
+			return resume(this, suite, master, created,
+						  client_random, server_random);
 		}
-		return this->suite;
 	}
 	return 0;
 }
 
 METHOD(tls_crypto_t, get_session, chunk_t,
-	private_tls_crypto_t *this, identification_t *server)
+	private_tls_crypto_t *this, identification_t *server, chunk_t *ticket)
 {
+	*ticket = chunk_empty;
 	if (this->cache)
 	{
-		return this->cache->check(this->cache, server);
+		return this->cache->check(this->cache, server,
+								  this->tickets ? ticket : NULL);
 	}
 	return chunk_empty;
 }
 
+METHOD(tls_crypto_t, supports_tickets, bool,
+	private_tls_crypto_t *this)
+{
+	return this->tickets;
+}
+
+METHOD(tls_crypto_t, build_ticket, bool,
+	private_tls_crypto_t *this, identification_t *id, chunk_t *ticket,
+	u_int32_t *lifetime)
+{
+	u_int age, max_age;
+
+	if (!this->tickets || !this->master.len)
+	{
+		return FALSE;
+	}
+	age = time_monotonic(NULL) - this->created;
+	max_age = this->cache->get_max_age(this->cache);
+	if (age >= max_age ||
+		!this->cache->create_ticket(this->cache, id, this->master,
+									this->suite, this->created, ticket))
+	{
+		return FALSE;
+	}
+	/* the ticket expires with the original session */
+	*lifetime = max_age - age;
+	return TRUE;
+}
+
+METHOD(tls_crypto_t, store_ticket, void,
+	private_tls_crypto_t *this, chunk_t session, chunk_t ticket)
+{
+	if (this->tickets)
+	{
+		this->cache->store_ticket(this->cache, session, ticket);
+	}
+}
+
 METHOD(tls_crypto_t, change_cipher, void,
 	private_tls_crypto_t *this, bool inbound)
 {
@@ -1690,6 +1794,7 @@ METHOD(tls_crypto_t, destroy, void,
 	free(this->iv_out.ptr);
 	free(this->handshake.ptr);
 	free(this->msk.ptr);
+	chunk_clear(&this->master);
 	DESTROY_IF(this->prf);
 	free(this->suites);
 	free(this);
@@ -1721,13 +1826,19 @@ tls_crypto_t *tls_crypto_create(tls_t *tls, tls_cache_t *cache)
 			.calculate_finished = _calculate_finished,
 			.derive_secrets = _derive_secrets,
 			.resume_session = _resume_session,
+			.resume_ticket = _resume_ticket,
 			.get_session = _get_session,
+			.supports_tickets = _supports_tickets,
+			.build_ticket = _build_ticket,
+			.store_ticket = _store_ticket,
 			.change_cipher = _change_cipher,
 			.get_eap_msk = _get_eap_msk,
 			.destroy = _destroy,
 		},
 		.tls = tls,
 		.cache = cache,
+		.tickets = cache && lib->settings->get_bool(lib->settings,
+										"libtls.session_tickets", TRUE),
 	);
 
 	enumerator = lib->creds->create_builder_enumerator(lib->creds);
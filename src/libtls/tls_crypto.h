@@ -535,13 +535,56 @@ struct tls_crypto_t {
 										 chunk_t client_random,
 										 chunk_t server_random);
 
+	/**
+	 * Try to resume a TLS session from an RFC 5077 session ticket, derive
+	 * key material.
+	 *
+	 * @param ticket		session ticket received from client
+	 * @param id			identity the session is bound to
+	 * @param client_random	random data from client hello
+	 * @param server_random	random data from server hello
+	 * @return				selected suite
+	 */
+	tls_cipher_suite_t (*resume_ticket)(tls_crypto_t *this, chunk_t ticket,
+										identification_t *id,
+										chunk_t client_random,
+										chunk_t server_random);
+
 	/**
 	 * Check if we have a session to resume as a client.
 	 *
 	 * @param id			server identity to get a session for
+	 * @param ticket		allocated session ticket, or chunk_empty
 	 * @return				allocated session identifier, or chunk_empty
 	 */
-	chunk_t (*get_session)(tls_crypto_t *this, identification_t *id);
+	chunk_t (*get_session)(tls_crypto_t *this, identification_t *id,
+						   chunk_t *ticket);
+
+	/**
+	 * Check if RFC 5077 session tickets are supported.
+	 *
+	 * @return				TRUE if session tickets supported
+	 */
+	bool (*supports_tickets)(tls_crypto_t *this);
+
+	/**
+	 * Create a session ticket for the current session as a server.
+	 *
+	 * @param id			identity the session is bound to
+	 * @param ticket		allocated session ticket
+	 * @param lifetime		lifetime hint of the ticket, in seconds
+	 * @return				TRUE if ticket created
+	 */
+	bool (*build_ticket)(tls_crypto_t *this, identification_t *id,
+						 chunk_t *ticket, u_int32_t *lifetime);
+
+	/**
+	 * Store a session ticket received as a client.
+	 *
+	 * @param session		session identifier the ticket belongs to
+	 * @param ticket		received session ticket
+	 */
+	void (*store_ticket)(tls_crypto_t *this, chunk_t session, chunk_t ticket);
 
 	/**
 	 * Change the cipher used at protection layer.
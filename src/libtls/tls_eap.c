@@ -389,6 +389,10 @@ METHOD(tls_eap_t, process, status_t,
 	switch (status)
 	{
 		case INVALID_STATE:
+			if (this->is_server && this->tls->is_complete(this->tls))
+			{	/* the client finished a resumed handshake, no ack follows */
+				return SUCCESS;
+			}
 			*out = create_ack(this);
 			return NEED_MORE;
 		case FAILED:
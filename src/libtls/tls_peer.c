@@ -22,6 +22,11 @@
 
 typedef struct private_tls_peer_t private_tls_peer_t;
 
+/**
+ * Size of a session ID we generate to store a session ticket
+ */
+#define SESSION_ID_SIZE 16
+
 typedef enum {
 	STATE_INIT,
 	STATE_HELLO_SENT,
@@ -35,6 +40,7 @@ typedef enum {
 	STATE_VERIFY_SENT,
 	STATE_CIPHERSPEC_CHANGED_OUT,
 	STATE_FINISHED_SENT,
+	STATE_TICKET_RECEIVED,
 	STATE_CIPHERSPEC_CHANGED_IN,
 	STATE_FINISHED_RECEIVED,
 } peer_state_t;
@@ -119,6 +125,16 @@ struct private_tls_peer_t {
 	 */
 	chunk_t session;
 
+	/**
+	 * RFC 5077 session ticket sent to resume the session
+	 */
+	chunk_t ticket;
+
+	/**
+	 * Did the server announce a NewSessionTicket?
+	 */
+	bool ticket_expected;
+
 	/**
 	 * List of server-supported hashsig algorithms
 	 */
@@ -137,9 +153,11 @@ static status_t process_server_hello(private_tls_peer_t *this,
 									 bio_reader_t *reader)
 {
 	u_int8_t compression;
-	u_int16_t version, cipher;
+	u_int16_t version, cipher, extension;
 	chunk_t random, session, ext = chunk_empty;
+	bio_reader_t *extensions;
 	tls_cipher_suite_t suite = 0;
+	rng_t *rng;
 
 	this->crypto->append_handshake(this->crypto,
 								   TLS_SERVER_HELLO, reader->peek(reader));
@@ -156,6 +174,42 @@ static status_t process_server_hello(private_tls_peer_t *this,
 		return NEED_MORE;
 	}
 
+	if (ext.len)
+	{
+		extensions = bio_reader_create(ext);
+		while (extensions->remaining(extensions))
+		{
+			if (!extensions->read_uint16(extensions, &extension) ||
+				!extensions->read_data16(extensions, &ext))
+			{
+				DBG1(DBG_TLS, "received invalid ServerHello Extensions");
+				this->alert->add(this->alert, TLS_FATAL, TLS_DECODE_ERROR);
+				extensions->destroy(extensions);
+				return NEED_MORE;
+			}
+			DBG2(DBG_TLS, "received TLS '%N' extension",
+				 tls_extension_names, extension);
+			switch (extension)
+			{
+				case TLS_EXT_SESSION_TICKET:
+					if (!this->crypto->supports_tickets(this->crypto))
+					{
+						DBG1(DBG_TLS, "received TLS session ticket extension, "
+							 "but did not send it");
+						this->alert->add(this->alert, TLS_FATAL,
+										 TLS_UNSUPPORTED_EXTENSION);
+						extensions->destroy(extensions);
+						return NEED_MORE;
+					}
+					this->ticket_expected = TRUE;
+					break;
+				default:
+					break;
+			}
+		}
+		extensions->destroy(extensions);
+	}
+
 	memcpy(this->server_random, random.ptr, sizeof(this->server_random));
 
 	if (!this->tls->set_version(this->tls, version))
@@ -192,6 +246,16 @@ static status_t process_server_hello(private_tls_peer_t *this,
 			 tls_version_names, version, tls_cipher_suite_names, suite);
 		free(this->session.ptr);
 		this->session = chunk_clone(session);
+		if (this->ticket_expected && !this->session.len)
+		{	/* we need a session ID to store and resume the ticket */
+			rng = lib->crypto->create_rng(lib->crypto, RNG_WEAK);
+			if (!rng ||
+				!rng->allocate_bytes(rng, SESSION_ID_SIZE, &this->session))
+			{
+				DBG1(DBG_TLS, "generating TLS session identifier failed");
+			}
+			DESTROY_IF(rng);
+		}
 	}
 	this->state = STATE_HELLO_RECEIVED;
 	return NEED_MORE;
@@ -601,6 +665,35 @@ static status_t process_hello_done(private_tls_peer_t *this,
 	return NEED_MORE;
 }
 
+/**
+ * Process NewSessionTicket message
+ */
+static status_t process_new_session_ticket(private_tls_peer_t *this,
+										   bio_reader_t *reader)
+{
+	u_int32_t lifetime;
+	chunk_t ticket;
+
+	this->crypto->append_handshake(this->crypto,
+								TLS_NEW_SESSION_TICKET, reader->peek(reader));
+
+	if (!reader->read_uint32(reader, &lifetime) ||
+		!reader->read_data16(reader, &ticket))
+	{
+		DBG1(DBG_TLS, "received invalid NewSessionTicket");
+		this->alert->add(this->alert, TLS_FATAL, TLS_DECODE_ERROR);
+		return NEED_MORE;
+	}
+	if (ticket.len && this->session.len)
+	{
+		DBG2(DBG_TLS, "received TLS session ticket, lifetime %u seconds",
+			 lifetime);
+		this->crypto->store_ticket(this->crypto, this->session, ticket);
+	}
+	this->state = STATE_TICKET_RECEIVED;
+	return NEED_MORE;
+}
+
 /**
  * Process finished message
  */
@@ -648,6 +741,15 @@ METHOD(tls_handshake_t, process, status_t,
 			expected = TLS_SERVER_HELLO;
 			break;
 		case STATE_HELLO_RECEIVED:
+			if (this->resume)
+			{	/* only a new ticket may precede ChangeCipherSpec */
+				if (this->ticket_expected && type == TLS_NEW_SESSION_TICKET)
+				{
+					return process_new_session_ticket(this, reader);
+				}
+				expected = TLS_NEW_SESSION_TICKET;
+				break;
+			}
 			if (type == TLS_CERTIFICATE)
 			{
 				return process_certificate(this, reader);
@@ -676,6 +778,13 @@ METHOD(tls_handshake_t, process, status_t,
 			}
 			expected = TLS_SERVER_HELLO_DONE;
 			break;
+		case STATE_FINISHED_SENT:
+			if (this->ticket_expected && type == TLS_NEW_SESSION_TICKET)
+			{
+				return process_new_session_ticket(this, reader);
+			}
+			expected = TLS_NEW_SESSION_TICKET;
+			break;
 		case STATE_CIPHERSPEC_CHANGED_IN:
 			if (type == TLS_FINISHED)
 			{
@@ -728,7 +837,8 @@ static status_t send_client_hello(private_tls_peer_t *this,
 	writer->write_data(writer, chunk_from_thing(this->client_random));
 
 	/* session identifier */
-	this->session = this->crypto->get_session(this->crypto, this->server);
+	this->session = this->crypto->get_session(this->crypto, this->server,
+											  &this->ticket);
 	writer->write_data8(writer, this->session);
 
 	/* add TLS cipher suites */
@@ -786,6 +896,13 @@ static status_t send_client_hello(private_tls_peer_t *this,
 		extensions->write_data16(extensions, names->get_buf(names));
 		names->destroy(names);
 	}
+	if (this->crypto->supports_tickets(this->crypto))
+	{	/* an empty ticket indicates support for a new one */
+		DBG2(DBG_TLS, "sending TLS session ticket (%u bytes)",
+			 this->ticket.len);
+		extensions->write_uint16(extensions, TLS_EXT_SESSION_TICKET);
+		extensions->write_data16(extensions, this->ticket);
+	}
 
 	writer->write_data16(writer, extensions->get_buf(extensions));
 	extensions->destroy(extensions);
@@ -1091,6 +1208,10 @@ METHOD(tls_handshake_t, cipherspec_changed, bool,
 {
 	if (inbound)
 	{
+		if (this->ticket_expected)
+		{
+			return this->state == STATE_TICKET_RECEIVED;
+		}
 		if (this->resume)
 		{
 			return this->state == STATE_HELLO_RECEIVED;
@@ -1159,6 +1280,7 @@ METHOD(tls_handshake_t, destroy, void,
 	free(this->hashsig.ptr);
 	free(this->cert_types.ptr);
 	free(this->session.ptr);
+	free(this->ticket.ptr);
 	free(this);
 }
 
@@ -40,6 +40,7 @@ typedef enum {
 	STATE_CERT_VERIFY_RECEIVED,
 	STATE_CIPHERSPEC_CHANGED_IN,
 	STATE_FINISHED_RECEIVED,
+	STATE_TICKET_SENT,
 	STATE_CIPHERSPEC_CHANGED_OUT,
 	STATE_FINISHED_SENT,
 } server_state_t;
@@ -139,6 +140,11 @@ struct private_tls_server_t {
 	 */
 	bool resume;
 
+	/**
+	 * Do we issue an RFC 5077 session ticket?
+	 */
+	bool send_ticket;
+
 	/**
 	 * Hash and signature algorithms supported by peer
 	 */
@@ -215,8 +221,10 @@ static status_t process_client_hello(private_tls_server_t *this,
 {
 	u_int16_t version, extension;
 	chunk_t random, session, ciphers, compression, ext = chunk_empty;
+	chunk_t ticket = chunk_empty;
 	bio_reader_t *extensions;
 	tls_cipher_suite_t *suites;
+	bool ticket_received = FALSE;
 	int count, i;
 	rng_t *rng;
 
@@ -260,6 +268,10 @@ static status_t process_client_hello(private_tls_server_t *this,
 					this->curves_received = TRUE;
 					this->curves = chunk_clone(ext);
 					break;
+				case TLS_EXT_SESSION_TICKET:
+					ticket_received = TRUE;
+					ticket = ext;
+					break;
 				default:
 					break;
 			}
@@ -291,9 +303,22 @@ static status_t process_client_hello(private_tls_server_t *this,
 	}
 
 	this->client_version = version;
-	this->suite = this->crypto->resume_session(this->crypto, session, this->peer,
+	this->send_ticket = ticket_received &&
+						this->crypto->supports_tickets(this->crypto);
+	if (this->send_ticket && ticket.len && session.len)
+	{	/* the client detects resumption by the echo of its session ID */
+		this->suite = this->crypto->resume_ticket(this->crypto, ticket,
+										this->peer,
+										chunk_from_thing(this->client_random),
+										chunk_from_thing(this->server_random));
+	}
+	if (!this->suite)
+	{
+		this->suite = this->crypto->resume_session(this->crypto, session,
+										this->peer,
 										chunk_from_thing(this->client_random),
 										chunk_from_thing(this->server_random));
+	}
 	if (this->suite)
 	{
 		this->session = chunk_clone(session);
@@ -397,6 +422,18 @@ static status_t process_certificate(private_tls_server_t *this,
 	return NEED_MORE;
 }
 
+/**
+ * Get the session identifier to cache the session for, if any
+ */
+static chunk_t get_cached_session(private_tls_server_t *this)
+{
+	if (this->send_ticket)
+	{	/* the session state is kept by the client in a ticket */
+		return chunk_empty;
+	}
+	return this->session;
+}
+
 /**
  * Process Client Key Exchange, using premaster encryption
  */
@@ -450,7 +487,7 @@ static status_t process_key_exchange_encrypted(private_tls_server_t *this,
 	}
 
 	if (!this->crypto->derive_secrets(this->crypto, chunk_from_thing(premaster),
-									  this->session, this->peer,
+									  get_cached_session(this), this->peer,
 									  chunk_from_thing(this->client_random),
 									  chunk_from_thing(this->server_random)))
 	{
@@ -503,7 +540,7 @@ static status_t process_key_exchange_dhe(private_tls_server_t *this,
 	}
 
 	if (!this->crypto->derive_secrets(this->crypto, premaster,
-									  this->session, this->peer,
+									  get_cached_session(this), this->peer,
 									  chunk_from_thing(this->client_random),
 									  chunk_from_thing(this->server_random)))
 	{
@@ -694,6 +731,13 @@ static status_t send_server_hello(private_tls_server_t *this,
 	/* NULL compression only */
 	writer->write_uint8(writer, 0);
 
+	if (this->send_ticket)
+	{	/* announce a NewSessionTicket, with an empty extension */
+		writer->write_uint16(writer, 4);
+		writer->write_uint16(writer, TLS_EXT_SESSION_TICKET);
+		writer->write_uint16(writer, 0);
+	}
+
 	*type = TLS_SERVER_HELLO;
 	this->state = STATE_HELLO_SENT;
 	this->crypto->append_handshake(this->crypto, *type, writer->get_buf(writer));
@@ -956,6 +1000,35 @@ static status_t send_hello_done(private_tls_server_t *this,
 	return NEED_MORE;
 }
 
+/**
+ * Send NewSessionTicket
+ */
+static status_t send_new_session_ticket(private_tls_server_t *this,
+							tls_handshake_type_t *type, bio_writer_t *writer)
+{
+	chunk_t ticket = chunk_empty;
+	u_int32_t lifetime = 0;
+
+	if (this->crypto->build_ticket(this->crypto, this->peer, &ticket,
+								   &lifetime))
+	{
+		DBG2(DBG_TLS, "sending TLS session ticket, lifetime %u seconds",
+			 lifetime);
+	}
+	else
+	{	/* an empty ticket tells the client we can't issue one */
+		DBG1(DBG_TLS, "creating TLS session ticket failed, sending none");
+	}
+	writer->write_uint32(writer, lifetime);
+	writer->write_data16(writer, ticket);
+	free(ticket.ptr);
+
+	*type = TLS_NEW_SESSION_TICKET;
+	this->state = STATE_TICKET_SENT;
+	this->crypto->append_handshake(this->crypto, *type, writer->get_buf(writer));
+	return NEED_MORE;
+}
+
 /**
  * Send Finished
  */
@@ -990,6 +1063,10 @@ METHOD(tls_handshake_t, build, status_t,
 		case STATE_HELLO_RECEIVED:
 			return send_server_hello(this, type, writer);
 		case STATE_HELLO_SENT:
+			if (this->resume)
+			{	/* a resumed session continues with a new ticket, if any */
+				return send_new_session_ticket(this, type, writer);
+			}
 			return send_certificate(this, type, writer);
 		case STATE_CERT_SENT:
 			group = this->crypto->get_dh_group(this->crypto);
@@ -1002,6 +1079,12 @@ METHOD(tls_handshake_t, build, status_t,
 			return send_certificate_request(this, type, writer);
 		case STATE_CERTREQ_SENT:
 			return send_hello_done(this, type, writer);
+		case STATE_FINISHED_RECEIVED:
+			if (this->send_ticket)
+			{
+				return send_new_session_ticket(this, type, writer);
+			}
+			return INVALID_STATE;
 		case STATE_CIPHERSPEC_CHANGED_OUT:
 			return send_finished(this, type, writer);
 		case STATE_FINISHED_SENT:
@@ -1028,6 +1111,10 @@ METHOD(tls_handshake_t, cipherspec_changed, bool,
 	}
 	else
 	{
+		if (this->send_ticket)
+		{
+			return this->state == STATE_TICKET_SENT;
+		}
 		if (this->resume)
 		{
 			return this->state == STATE_HELLO_SENT;
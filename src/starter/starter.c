@@ -36,6 +36,7 @@
 #include <hydra.h>
 #include <utils/backtrace.h>
 #include <threading/thread.h>
+#include <collections/hashtable.h>
 #include <utils/debug.h>
 
 #include "confread.h"
@@ -400,12 +401,127 @@ static void usage(char *name)
 	exit(LSB_RC_INVALID_ARGUMENT);
 }
 
+/**
+ * Mark conn sections of the old config that are unchanged in the new config
+ * as replaced, and the new ones as added. Returns the number of unchanged
+ * conn sections.
+ */
+static u_int match_conns(starter_config_t *old, starter_config_t *new)
+{
+	starter_conn_t *conn, *conn2;
+	enumerator_t *enumerator;
+	linked_list_t *list;
+	hashtable_t *conns;
+	u_int count = 0;
+
+	/* only sections with the same name can be equal, so group new sections
+	 * by name instead of comparing all of them */
+	conns = hashtable_create(hashtable_hash_str, hashtable_equals_str, 128);
+	for (conn2 = new->conn_first; conn2; conn2 = conn2->next)
+	{
+		if (conn2->state == STATE_TO_ADD)
+		{
+			list = conns->get(conns, conn2->name);
+			if (!list)
+			{
+				list = linked_list_create();
+				conns->put(conns, conn2->name, list);
+			}
+			list->insert_last(list, conn2);
+		}
+	}
+	for (conn = old->conn_first; conn; conn = conn->next)
+	{
+		list = conns->get(conns, conn->name);
+		if (conn->state != STATE_ADDED || !list)
+		{
+			continue;
+		}
+		enumerator = list->create_enumerator(list);
+		while (enumerator->enumerate(enumerator, &conn2))
+		{
+			if (conn2->state == STATE_TO_ADD && starter_cmp_conn(conn, conn2))
+			{
+				conn->state = STATE_REPLACED;
+				conn2->state = STATE_ADDED;
+				conn2->id = conn->id;
+				count++;
+				break;
+			}
+		}
+		enumerator->destroy(enumerator);
+	}
+	enumerator = conns->create_enumerator(conns);
+	while (enumerator->enumerate(enumerator, NULL, &list))
+	{
+		list->destroy(list);
+	}
+	enumerator->destroy(enumerator);
+	conns->destroy(conns);
+	return count;
+}
+
+/**
+ * Same as match_conns(), but for ca sections
+ */
+static u_int match_cas(starter_config_t *old, starter_config_t *new)
+{
+	starter_ca_t *ca, *ca2;
+	enumerator_t *enumerator;
+	linked_list_t *list;
+	hashtable_t *cas;
+	u_int count = 0;
+
+	cas = hashtable_create(hashtable_hash_str, hashtable_equals_str, 16);
+	for (ca2 = new->ca_first; ca2; ca2 = ca2->next)
+	{
+		if (ca2->state == STATE_TO_ADD)
+		{
+			list = cas->get(cas, ca2->name);
+			if (!list)
+			{
+				list = linked_list_create();
+				cas->put(cas, ca2->name, list);
+			}
+			list->insert_last(list, ca2);
+		}
+	}
+	for (ca = old->ca_first; ca; ca = ca->next)
+	{
+		list = cas->get(cas, ca->name);
+		if (ca->state != STATE_ADDED || !list)
+		{
+			continue;
+		}
+		enumerator = list->create_enumerator(list);
+		while (enumerator->enumerate(enumerator, &ca2))
+		{
+			if (ca2->state == STATE_TO_ADD && starter_cmp_ca(ca, ca2))
+			{
+				ca->state = STATE_REPLACED;
+				ca2->state = STATE_ADDED;
+				count++;
+				break;
+			}
+		}
+		enumerator->destroy(enumerator);
+	}
+	enumerator = cas->create_enumerator(cas);
+	while (enumerator->enumerate(enumerator, NULL, &list))
+	{
+		list->destroy(list);
+	}
+	enumerator->destroy(enumerator);
+	cas->destroy(cas);
+	return count;
+}
+
 int main (int argc, char **argv)
 {
 	starter_config_t *cfg = NULL;
 	starter_config_t *new_cfg;
-	starter_conn_t *conn, *conn2;
-	starter_ca_t *ca, *ca2;
+	starter_conn_t *conn;
+	starter_ca_t *ca;
 
 	struct sigaction action;
 	struct stat stb;
@@ -415,6 +531,9 @@ int main (int argc, char **argv)
 	struct timespec ts;
 	unsigned long auto_update = 0;
 	time_t last_reload;
+	timeval_t reload_start, now;
+	u_int unchanged = 0, deleted = 0, added = 0;
+	bool reloaded = FALSE;
 	bool no_fork = FALSE;
 	bool attach_gdb = FALSE;
 	bool load_warning = FALSE;
@@ -679,8 +798,12 @@ int main (int argc, char **argv)
 		 */
 		if (_action_ & FLAG_ACTION_RELOAD)
 		{
+			time_monotonic(&reload_start);
+			unchanged = deleted = added = 0;
+			reloaded = TRUE;
 			if (starter_charon_pid())
 			{
+				starter_stroke_begin_batch();
 				for (conn = cfg->conn_first; conn; conn = conn->next)
 				{
 					if (conn->state == STATE_ADDED)
@@ -694,6 +817,7 @@ int main (int argc, char **argv)
 							starter_stroke_del_conn(conn);
 						}
 						conn->state = STATE_TO_ADD;
+						deleted++;
 					}
 				}
 				for (ca = cfg->ca_first; ca; ca = ca->next)
@@ -717,30 +841,24 @@ int main (int argc, char **argv)
 		if (_action_ & FLAG_ACTION_UPDATE)
 		{
 			DBG2(DBG_APP, "Reloading config...");
+			if (!reloaded)
+			{
+				time_monotonic(&reload_start);
+				unchanged = deleted = added = 0;
+			}
 			new_cfg = confread_load(config_file);
 
 			if (new_cfg && (new_cfg->err == 0))
 			{
 				/* Switch to new config. New conn will be loaded below */
-
-				/* Look for new connections that are already loaded */
-				for (conn = cfg->conn_first; conn; conn = conn->next)
+				if (starter_charon_pid())
 				{
-					if (conn->state == STATE_ADDED)
-					{
-						for (conn2 = new_cfg->conn_first; conn2; conn2 = conn2->next)
-						{
-							if (conn2->state == STATE_TO_ADD && starter_cmp_conn(conn, conn2))
-							{
-								conn->state = STATE_REPLACED;
-								conn2->state = STATE_ADDED;
-								conn2->id = conn->id;
-								break;
-							}
-						}
-					}
+					starter_stroke_begin_batch();
 				}
 
+				/* Look for new connections that are already loaded */
+				unchanged = match_conns(cfg, new_cfg);
+
 				/* Remove conn sections that have become unused */
 				for (conn = cfg->conn_first; conn; conn = conn->next)
 				{
@@ -754,25 +872,12 @@ int main (int argc, char **argv)
 							}
 							starter_stroke_del_conn(conn);
 						}
+						deleted++;
 					}
 				}
 
 				/* Look for new ca sections that are already loaded */
-				for (ca = cfg->ca_first; ca; ca = ca->next)
-				{
-					if (ca->state == STATE_ADDED)
-					{
-						for (ca2 = new_cfg->ca_first; ca2; ca2 = ca2->next)
-						{
-							if (ca2->state == STATE_TO_ADD && starter_cmp_ca(ca, ca2))
-							{
-								ca->state = STATE_REPLACED;
-								ca2->state = STATE_ADDED;
-								break;
-							}
-						}
-					}
-				}
+				match_cas(cfg, new_cfg);
 
 				/* Remove ca sections that have become unused */
 				for (ca = cfg->ca_first; ca; ca = ca->next)
@@ -787,6 +892,7 @@ int main (int argc, char **argv)
 				}
 				confread_free(cfg);
 				cfg = new_cfg;
+				reloaded = TRUE;
 			}
 			else
 			{
@@ -839,6 +945,7 @@ int main (int argc, char **argv)
 		 */
 		if (starter_charon_pid())
 		{
+			starter_stroke_begin_batch();
 			for (ca = cfg->ca_first; ca; ca = ca->next)
 			{
 				if (ca->state == STATE_TO_ADD)
@@ -865,6 +972,7 @@ int main (int argc, char **argv)
 						starter_stroke_add_conn(cfg, conn);
 					}
 					conn->state = STATE_ADDED;
+					added++;
 
 					if (conn->startup == STARTUP_START)
 					{
@@ -883,6 +991,25 @@ int main (int argc, char **argv)
 				}
 			}
 		}
+		starter_stroke_end_batch();
+		if (reloaded)
+		{
+			time_monotonic(&now);
+			timersub(&now, &reload_start, &now);
+			if (deleted || added)
+			{
+				DBG1(DBG_APP, "configuration reloaded in %u ms: %u conns "
+					 "unchanged, %u deleted, %u added",
+					 (u_int)(now.tv_sec * 1000 + now.tv_usec / 1000),
+					 unchanged, deleted, added);
+			}
+			else
+			{	/* don't log periodic updates without changes */
+				DBG2(DBG_APP, "configuration reloaded in %u ms, unchanged",
+					 (u_int)(now.tv_sec * 1000 + now.tv_usec / 1000));
+			}
+			reloaded = FALSE;
+		}
 
 		/*
 		 * If auto_update activated, when to stop select
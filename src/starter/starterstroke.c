@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -54,20 +55,23 @@ static char* push_string(stroke_msg_t *msg, char *string)
 	}
 }
 
-static int send_stroke_msg (stroke_msg_t *msg)
+/**
+ * Socket of the active batch, -1 if no batch is active
+ */
+static int batch_sock = -1;
+
+/**
+ * Connect to the stroke socket of charon
+ */
+static int connect_charon()
 {
 	struct sockaddr_un ctl_addr;
-	int byte_count;
-	char buffer[64];
+	int sock;
 
 	ctl_addr.sun_family = AF_UNIX;
 	strcpy(ctl_addr.sun_path, CHARON_CTL_FILE);
 
-	/* starter is not called from commandline, and therefore absolutely silent */
-	msg->output_verbosity = -1;
-
-	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
-
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
 	if (sock < 0)
 	{
 		DBG1(DBG_APP, "socket() failed: %s", strerror(errno));
@@ -79,24 +83,107 @@ static int send_stroke_msg (stroke_msg_t *msg)
 		close(sock);
 		return -1;
 	}
+	return sock;
+}
 
-	/* send message */
-	if (write(sock, msg, msg->length) != msg->length)
-	{
-		DBG1(DBG_APP, "write(charon_ctl) failed: %s", strerror(errno));
-		close(sock);
-		return -1;
-	}
-	while ((byte_count = read(sock, buffer, sizeof(buffer)-1)) > 0)
+/**
+ * Log output received from charon, without blocking only what is available
+ */
+static void read_output(int sock, bool block)
+{
+	char buffer[64];
+	int byte_count;
+
+	while ((byte_count = recv(sock, buffer, sizeof(buffer)-1,
+							  block ? 0 : MSG_DONTWAIT)) > 0)
 	{
 		buffer[byte_count] = '\0';
 		DBG1(DBG_APP, "%s", buffer);
 	}
-	if (byte_count < 0)
+	if (byte_count < 0 && (block || (errno != EAGAIN && errno != EWOULDBLOCK)))
 	{
 		DBG1(DBG_APP, "read() failed: %s", strerror(errno));
 	}
+}
+
+/**
+ * Write a message to charon, logging any output it sends in the meantime.
+ * Writing blocks only until the socket is ready, so charon never blocks
+ * writing output to us while we are blocked writing a message to it.
+ */
+static bool write_msg(int sock, stroke_msg_t *msg)
+{
+	struct pollfd pfd = {
+		.fd = sock,
+		.events = POLLIN | POLLOUT,
+	};
+	char *pos = (char*)msg;
+	ssize_t len, done = 0;
+
+	while (done < msg->length)
+	{
+		if (poll(&pfd, 1, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			DBG1(DBG_APP, "poll(charon_ctl) failed: %s", strerror(errno));
+			return FALSE;
+		}
+		if (pfd.revents & POLLIN)
+		{
+			read_output(sock, FALSE);
+		}
+		if (pfd.revents & (POLLOUT | POLLERR | POLLHUP))
+		{
+			len = send(sock, pos + done, msg->length - done, MSG_DONTWAIT);
+			if (len < 0)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				{
+					continue;
+				}
+				DBG1(DBG_APP, "write(charon_ctl) failed: %s", strerror(errno));
+				return FALSE;
+			}
+			done += len;
+		}
+	}
+	return TRUE;
+}
+
+static int send_stroke_msg (stroke_msg_t *msg)
+{
+	int sock;
+
+	/* starter is not called from commandline, and therefore absolutely silent */
+	msg->output_verbosity = -1;
+
+	if (batch_sock != -1)
+	{
+		if (!write_msg(batch_sock, msg))
+		{
+			close(batch_sock);
+			batch_sock = -1;
+			return -1;
+		}
+		return 0;
+	}
 
+	sock = connect_charon();
+	if (sock < 0)
+	{
+		return -1;
+	}
+
+	/* send message */
+	if (!write_msg(sock, msg))
+	{
+		close(sock);
+		return -1;
+	}
+	read_output(sock, TRUE);
 	close(sock);
 	return 0;
 }
@@ -332,3 +419,74 @@ int starter_stroke_configure(starter_config_t *cfg)
 	}
 	return 0;
 }
+
+/**
+ * Check if charon confirmed a batch, older daemons close the connection
+ */
+static bool read_batch_ack(int sock)
+{
+	char buffer[sizeof(STROKE_BATCH_ACK) - 1];
+	int byte_count, done = 0;
+
+	while (done < sizeof(buffer))
+	{
+		byte_count = recv(sock, buffer + done, sizeof(buffer) - done, 0);
+		if (byte_count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (byte_count <= 0)
+		{
+			return FALSE;
+		}
+		done += byte_count;
+	}
+	return memeq(buffer, STROKE_BATCH_ACK, sizeof(buffer));
+}
+
+int starter_stroke_begin_batch()
+{
+	stroke_msg_t msg;
+	int sock;
+
+	if (batch_sock != -1)
+	{
+		return 0;
+	}
+	sock = connect_charon();
+	if (sock < 0)
+	{
+		return -1;
+	}
+	msg.type = STR_BATCH;
+	msg.length = offsetof(stroke_msg_t, buffer);
+	msg.output_verbosity = -1;
+	if (!write_msg(sock, &msg))
+	{
+		close(sock);
+		return -1;
+	}
+	if (!read_batch_ack(sock))
+	{
+		DBG2(DBG_APP, "charon does not support stroke batches, sending "
+			 "messages individually");
+		close(sock);
+		return -1;
+	}
+	batch_sock = sock;
+	return 0;
+}
+
+int starter_stroke_end_batch()
+{
+	if (batch_sock == -1)
+	{
+		return 0;
+	}
+	/* charon processes the batch until we close our end */
+	shutdown(batch_sock, SHUT_WR);
+	read_output(batch_sock, TRUE);
+	close(batch_sock);
+	batch_sock = -1;
+	return 0;
+}
@@ -27,4 +27,12 @@ int starter_stroke_add_ca(starter_ca_t *ca);
 int starter_stroke_del_ca(starter_ca_t *ca);
 int starter_stroke_configure(starter_config_t *cfg);
 
+/**
+ * Send all following stroke messages over a single connection, processed
+ * by charon in order, until starter_stroke_end_batch() is called. If charon
+ * does not support batches, messages are sent individually.
+ */
+int starter_stroke_begin_batch();
+int starter_stroke_end_batch();
+
 #endif /* _STARTER_STROKE_H_ */
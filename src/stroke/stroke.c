@@ -38,6 +38,8 @@ struct stroke_token {
 
 static int output_verbosity = 1; /* CONTROL */
 
+static void exit_usage(char *error);
+
 static char* push_string(stroke_msg_t *msg, char *string)
 {
 	unsigned long string_start = msg->length;
@@ -382,6 +384,65 @@ static int counters(int reset, char *name)
 	return send_stroke_msg(&msg);
 }
 
+static int metrics(int reset)
+{
+	stroke_msg_t msg;
+
+	msg.type = STR_METRICS;
+	msg.length = offsetof(stroke_msg_t, buffer);
+	msg.metrics.reset = reset;
+
+	return send_stroke_msg(&msg);
+}
+
+static int status_sa(int argc, char *argv[])
+{
+	stroke_msg_t msg;
+	char *name = NULL, *peer = NULL, *state = NULL;
+	int i;
+
+	msg.type = STR_STATUS_SA;
+	msg.length = offsetof(stroke_msg_t, buffer);
+	msg.status_sa.offset = 0;
+	msg.status_sa.limit = 0;
+
+	for (i = 0; i + 1 < argc; i += 2)
+	{
+		if (streq(argv[i], "--name"))
+		{
+			name = argv[i + 1];
+		}
+		else if (streq(argv[i], "--peer"))
+		{
+			peer = argv[i + 1];
+		}
+		else if (streq(argv[i], "--state"))
+		{
+			state = argv[i + 1];
+		}
+		else if (streq(argv[i], "--offset"))
+		{
+			msg.status_sa.offset = strtoul(argv[i + 1], NULL, 10);
+		}
+		else if (streq(argv[i], "--limit"))
+		{
+			msg.status_sa.limit = strtoul(argv[i + 1], NULL, 10);
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (i != argc)
+	{
+		exit_usage("\"statussa\" got an invalid option");
+	}
+	msg.status_sa.name = push_string(&msg, name);
+	msg.status_sa.peer = push_string(&msg, peer);
+	msg.status_sa.state = push_string(&msg, state);
+	return send_stroke_msg(&msg);
+}
+
 static int set_loglevel(char *type, u_int level)
 {
 	stroke_msg_t msg;
@@ -439,6 +500,12 @@ static void exit_usage(char *error)
 	printf("    stroke statusall\n");
 	printf("  Show extended status information without blocking:\n");
 	printf("    stroke statusall-nb\n");
+	printf("  Show IKE_SAs, one per line, without blocking:\n");
+	printf("    stroke statussa [--name NAME] [--peer PEER] [--state STATE]\n");
+	printf("                    [--offset N] [--limit N]\n");
+	printf("    where: PEER is a remote address or identity, may contain wildcards\n");
+	printf("           STATE is an IKE_SA state, e.g. ESTABLISHED or CONNECTING\n");
+	printf("           offsets are not stable if IKE_SAs get added or removed\n");
 	printf("  Show list of authority and attribute certificates:\n");
 	printf("    stroke listcacerts|listocspcerts|listaacerts|listacerts\n");
 	printf("  Show list of end entity certificates, ca info records  and crls:\n");
@@ -472,6 +539,8 @@ static void exit_usage(char *error)
 	printf("           PASSWORD is the optional password, you'll be asked to enter it if not given\n");
 	printf("  Show IKE counters:\n");
 	printf("    stroke listcounters [connection-name]\n");
+	printf("  Show or reset latency histograms and counters:\n");
+	printf("    stroke listmetrics|resetmetrics\n");
 	exit_error(error);
 }
 
@@ -633,6 +702,13 @@ int main(int argc, char *argv[])
 			res = counters(token->kw == STROKE_COUNTERS_RESET,
 						   argc > 2 ? argv[2] : NULL);
 			break;
+		case STROKE_STATUS_SA:
+			res = status_sa(argc - 2, argv + 2);
+			break;
+		case STROKE_METRICS:
+		case STROKE_METRICS_RESET:
+			res = metrics(token->kw == STROKE_METRICS_RESET);
+			break;
 		default:
 			exit_usage(NULL);
 	}
@@ -64,6 +64,9 @@ typedef enum {
 	STROKE_USER_CREDS,
 	STROKE_COUNTERS,
 	STROKE_COUNTERS_RESET,
+	STROKE_STATUS_SA,
+	STROKE_METRICS,
+	STROKE_METRICS_RESET,
 } stroke_keyword_t;
 
 #define STROKE_LIST_FIRST		STROKE_LIST_PUBKEYS
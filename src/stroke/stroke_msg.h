@@ -34,6 +34,12 @@
 
 #define STROKE_BUF_LEN		2048
 
+/**
+ * Confirmation sent by charon in response to STR_BATCH, daemons not supporting
+ * batches close the connection instead
+ */
+#define STROKE_BATCH_ACK	"BATCH\n"
+
 typedef enum list_flag_t list_flag_t;
 
 /**
@@ -230,6 +236,13 @@ struct stroke_msg_t {
 		STR_USER_CREDS,
 		/* print/reset counters */
 		STR_COUNTERS,
+		/* show paginated, machine-readable IKE_SA summaries */
+		STR_STATUS_SA,
+		/* print/reset latency histograms and counters */
+		STR_METRICS,
+		/* process all following messages sent on this connection, confirmed
+		 * with STROKE_BATCH_ACK */
+		STR_BATCH,
 		/* more to come */
 	} type;
 
@@ -367,6 +380,23 @@ struct stroke_msg_t {
 			int reset;
 			char *name;
 		} counters;
+
+		/* data for STR_STATUS_SA */
+		struct {
+			/* connection name, remote address/identity and state filters */
+			char *name;
+			char *peer;
+			char *state;
+			/* number of matching IKE_SAs to skip and to show, 0 for all */
+			u_int32_t offset;
+			u_int32_t limit;
+		} status_sa;
+
+		/* data for STR_METRICS */
+		struct {
+			/* reset or print metrics? */
+			int reset;
+		} metrics;
 	};
 	char buffer[STROKE_BUF_LEN];
 };